@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "spi_monkey.h"
+#include "spm_reg.h"
+#include "spm_sim.h"
+
+#define BENCH_COL   24
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+typedef struct {
+    const char  *name;
+    const char  *path;
+    uint8_t      bus;
+    uint32_t     speed_hz;
+    size_t       ops;                        /**< Iterations */
+    spm_ecode_t (*op)(spm_device_t *dev, size_t i, size_t *payload);
+} workload_t;
+
+static uint64_t cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Split a message into CS frames at cs_change (last transfer always ends one) */
+typedef void (*frame_fn)(const struct spi_ioc_transfer *trs, size_t n, void *ctx);
+
+static void for_each_frame(const struct spi_ioc_transfer *trs, size_t n, frame_fn fn, void *ctx)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (trs[i].cs_change || i + 1 == n) {
+            fn(&trs[start], i + 1 - start, ctx);
+            start = i + 1;
+        }
+    }
+}
+
+/* Byte i of a frame, across its transfers */
+#define FRAME_FOREACH_BYTE(trs, n, pos, tx, rx, body)                          \
+    do {                                                                       \
+        size_t pos = 0;                                                        \
+        for (size_t t_ = 0; t_ < (n); t_++) {                                  \
+            const uint8_t *tp_ = (const uint8_t *)(uintptr_t)(trs)[t_].tx_buf; \
+            uint8_t *rp_ = (uint8_t *)(uintptr_t)(trs)[t_].rx_buf;             \
+            for (size_t k_ = 0; k_ < (trs)[t_].len; k_++, pos++) {             \
+                uint8_t tx = tp_ ? tp_[k_] : 0;                                \
+                uint8_t *rx = rp_ ? &rp_[k_] : NULL;                           \
+                (void)rx;                                                      \
+                body                                                           \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+/* ====================================================== */
+/* ================== Peripheral Models ================= */
+/* ====================================================== */
+
+#define NOR_SIZE      (1u << 20)
+#define NOR_PAGE      256u
+#define NOR_BUSY_POLLS 3
+
+/* SPI NOR: READ 0x03, WREN 0x06, PP 0x02, RDSR 0x05 */
+static struct {
+    uint8_t   mem[NOR_SIZE];
+    bool      wel;
+    int       busy;
+} g_nor;
+
+/* READ data phase by span so model cost stays out of the CPU figure */
+static bool nor_fast_read(const struct spi_ioc_transfer *trs, size_t n)
+{
+    const uint8_t *cmd = (const uint8_t *)(uintptr_t)trs[0].tx_buf;
+    if (n < 2 || trs[0].len != 4 || !cmd || cmd[0] != 0x03) return false;
+
+    uint32_t addr = ((uint32_t)cmd[1] << 16) | ((uint32_t)cmd[2] << 8) | cmd[3];
+    for (size_t t = 1; t < n; t++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[t].rx_buf;
+        for (size_t off = 0; rx && off < trs[t].len; ) {
+            uint32_t a = (addr + (uint32_t)off) % NOR_SIZE;
+            size_t span = trs[t].len - off < NOR_SIZE - a ? trs[t].len - off : NOR_SIZE - a;
+            memcpy(rx + off, &g_nor.mem[a], span);
+            off += span;
+        }
+        addr += trs[t].len;
+    }
+    return true;
+}
+
+static void nor_frame(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    if (nor_fast_read(trs, n)) return;
+
+    uint8_t cmd = 0;
+    uint32_t addr = 0;
+    FRAME_FOREACH_BYTE(trs, n, pos, tx, rx, {
+        if (pos == 0) {
+            cmd = tx;
+            if (cmd == 0x06 && !g_nor.busy) g_nor.wel = true;
+        } else if (cmd == 0x05) {
+            if (rx) *rx = (uint8_t)((g_nor.busy ? 0x01 : 0) | (g_nor.wel ? 0x02 : 0));
+            if (g_nor.busy) g_nor.busy--;
+        } else if (pos < 4) {
+            addr = (addr << 8) | tx;
+        } else if (cmd == 0x03) {
+            if (rx) *rx = g_nor.mem[(addr + pos - 4) % NOR_SIZE];
+        } else if (cmd == 0x02 && g_nor.wel) {
+            uint32_t a = (addr & ~(NOR_PAGE - 1)) | ((addr + pos - 4) & (NOR_PAGE - 1));
+            g_nor.mem[a % NOR_SIZE] &= tx;
+        }
+    });
+    if (cmd == 0x02 && g_nor.wel) {
+        g_nor.wel = false;
+        g_nor.busy = NOR_BUSY_POLLS;
+    }
+}
+
+static void nor_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    for_each_frame(trs, n, nor_frame, ctx);
+}
+
+/* MCP3208: start + single-ended + channel, 12-bit result in bytes 1..2 */
+static void adc_frame(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    unsigned ch = 0;
+    uint16_t v = 0;
+    FRAME_FOREACH_BYTE(trs, n, pos, tx, rx, {
+        if (pos == 0) ch = (tx & 0x01u) << 2;
+        if (pos == 1) {
+            ch |= tx >> 6;
+            v = (uint16_t)(0x100u * ch + 0x55u);
+            if (rx) *rx = (uint8_t)((v >> 8) & 0x0F);
+        }
+        if (pos == 2 && rx) *rx = (uint8_t)v;
+    });
+}
+
+static void adc_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    for_each_frame(trs, n, adc_frame, ctx);
+}
+
+/* 8-bit register file, read bit 0x80, auto-increment */
+static uint8_t g_regs[128];
+
+static void reg_frame(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    uint8_t a = 0;
+    bool rd = false;
+    FRAME_FOREACH_BYTE(trs, n, pos, tx, rx, {
+        if (pos == 0) {
+            rd = tx & 0x80;
+            a = tx & 0x7F;
+        } else {
+            if (rd && rx) *rx = g_regs[a & 0x7F];
+            else if (!rd) g_regs[a & 0x7F] = tx;
+            a++;
+        }
+    });
+}
+
+static void reg_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    for_each_frame(trs, n, reg_frame, ctx);
+}
+
+/* ====================================================== */
+/* ===================== Workloads ====================== */
+/* ====================================================== */
+
+#define READ_CHUNK    4096u
+#define FB_W          240u
+#define FB_H          240u
+#define FB_CHUNK      (SPM_BUFSIZ_DEFAULT - SPM_BUFSIZ_ALIGN)  /* data + command byte fill bufsiz */
+
+static uint8_t g_buf[FB_W * FB_H * 2];
+
+/* Dump 64 KiB: one command+data message per 4 KiB */
+static spm_ecode_t w_nor_read(spm_device_t *dev, size_t i, size_t *payload)
+{
+    (void)i;
+    for (uint32_t a = 0; a < 64u * 1024u; a += READ_CHUNK) {
+        uint8_t cmd[4] = { 0x03, (uint8_t)(a >> 16), (uint8_t)(a >> 8), (uint8_t)a };
+        spm_batch_xfer_t x[2] = {
+            { .tx = cmd, .len = sizeof(cmd) },
+            { .rx = g_buf + a, .len = READ_CHUNK },
+        };
+        spm_ecode_t rc = spm_batch(dev, x, 2);
+        if (rc != SPM_OK) return rc;
+    }
+    *payload = 64u * 1024u;
+    return SPM_OK;
+}
+
+/* Program one page: WREN and PP in one message, then RDSR until WIP clears */
+static spm_ecode_t w_nor_program(spm_device_t *dev, size_t i, size_t *payload)
+{
+    uint32_t a = (uint32_t)(i * NOR_PAGE) % NOR_SIZE;
+    uint8_t wren = 0x06;
+    uint8_t cmd[4] = { 0x02, (uint8_t)(a >> 16), (uint8_t)(a >> 8), (uint8_t)a };
+    spm_batch_xfer_t x[3] = {
+        { .tx = &wren, .len = 1, .cs_change = 1 },
+        { .tx = cmd, .len = sizeof(cmd) },
+        { .tx = g_buf, .len = NOR_PAGE },
+    };
+    spm_ecode_t rc = spm_batch(dev, x, 3);
+    if (rc != SPM_OK) return rc;
+
+    uint8_t rdsr[2] = { 0x05, 0 }, sr[2];
+    do {
+        rc = spm_transfer(dev, rdsr, sr, 2);
+        if (rc != SPM_OK) return rc;
+    } while (sr[1] & 0x01);
+
+    *payload = NOR_PAGE;
+    return SPM_OK;
+}
+
+/* One scan of 8 channels, one CS frame each, in one message */
+static spm_ecode_t w_adc_scan(spm_device_t *dev, size_t i, size_t *payload)
+{
+    (void)i;
+    uint8_t tx[8][3], rx[8][3];
+    spm_batch_xfer_t x[8];
+    for (unsigned ch = 0; ch < 8; ch++) {
+        tx[ch][0] = (uint8_t)(0x06 | (ch >> 2));
+        tx[ch][1] = (uint8_t)(ch << 6);
+        tx[ch][2] = 0;
+        x[ch] = (spm_batch_xfer_t){ .tx = tx[ch], .rx = rx[ch], .len = 3, .cs_change = ch < 7 };
+    }
+    spm_ecode_t rc = spm_batch(dev, x, 8);
+    if (rc != SPM_OK) return rc;
+
+    *payload = 8 * 2;
+    return SPM_OK;
+}
+
+/* Sensor refresh: status, 3-axis data and temperature registers */
+static spm_ecode_t w_reg_poll(spm_device_t *dev, size_t i, size_t *payload)
+{
+    (void)i;
+    static const spm_reg_proto_t proto = { .read_mask = 0x80, .auto_increment = true, .max_gap = 2 };
+    static const uint8_t addrs[] = { 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x0C, 0x0D };
+    uint8_t values[sizeof(addrs)];
+
+    spm_ecode_t rc = spm_reg_read_multi(dev, &proto, addrs, values, sizeof(addrs));
+    if (rc != SPM_OK) return rc;
+
+    *payload = sizeof(addrs);
+    return SPM_OK;
+}
+
+/* Full 240x240 RGB565 frame: RAMWR, then RAMWRC per 4 KiB message */
+static spm_ecode_t w_fb_push(spm_device_t *dev, size_t i, size_t *payload)
+{
+    (void)i;
+    static uint8_t ramwr = 0x2C, ramwrc = 0x3C;
+
+    for (size_t off = 0; off < sizeof(g_buf); off += FB_CHUNK) {
+        size_t len = sizeof(g_buf) - off < FB_CHUNK ? sizeof(g_buf) - off : FB_CHUNK;
+        spm_batch_xfer_t x[2] = {
+            { .tx = off ? &ramwrc : &ramwr, .len = 1 },
+            { .tx = g_buf + off, .len = len },
+        };
+        spm_ecode_t rc = spm_batch(dev, x, 2);
+        if (rc != SPM_OK) return rc;
+    }
+
+    *payload = sizeof(g_buf);
+    return SPM_OK;
+}
+
+static const workload_t g_workloads[] = {
+    { "nor read 64K",      "/dev/spidev0.0", 0, 20000000,  200, w_nor_read    },
+    { "nor program page",  "/dev/spidev0.0", 0, 20000000, 2000, w_nor_program },
+    { "adc scan 8ch",      "/dev/spidev1.0", 1,  2000000, 20000, w_adc_scan    },
+    { "reg poll 9",        "/dev/spidev2.0", 2,  8000000, 20000, w_reg_poll    },
+    { "fb push 240x240",   "/dev/spidev3.0", 3, 40000000,  200, w_fb_push     },
+};
+
+/* ====================================================== */
+/* ======================== Main ======================== */
+/* ====================================================== */
+
+static int run_workload(const workload_t *w, const spm_sys_ops_t *ops)
+{
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = w->speed_hz, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(w->bus, 0, &cfg, ops, &dev);
+    if (rc != SPM_OK) {
+        fprintf(stderr, "%s: open failed: %d\n", w->name, rc);
+        return 1;
+    }
+
+    /* Warm up, then measure from zeroed counters */
+    size_t payload = 0, total = 0;
+    for (size_t i = 0; i < w->ops / 10; i++) w->op(dev, i, &payload);
+    spm_sim_reset_stats();
+
+    uint64_t c0 = cpu_ns();
+    for (size_t i = 0; i < w->ops; i++) {
+        rc = w->op(dev, i, &payload);
+        if (rc != SPM_OK) {
+            fprintf(stderr, "%s: op %zu failed: %d\n", w->name, i, rc);
+            spm_dev_close(dev);
+            return 1;
+        }
+        total += payload;
+    }
+    uint64_t cpu = cpu_ns() - c0;
+
+    spm_sim_stats_t s;
+    spm_sim_get_stats(w->path, &s);
+    spm_dev_close(dev);
+
+    double wire_kbps = s.wire_ns ? (double)total / 1024.0 / ((double)s.wire_ns / 1e9) : 0.0;
+    double e2e_kbps  = (double)total / 1024.0 / ((double)(s.wire_ns + cpu) / 1e9);
+
+    int pad = BENCH_COL - (int)strlen(w->name);
+    if (pad < 1) pad = 1;
+    printf("%s%*s%10.1f %10.1f %8.2f %9.2f %7.1f%%\n", w->name, pad, "",
+           wire_kbps, e2e_kbps,
+           (double)s.syscalls / (double)w->ops,
+           (double)cpu / 1e3 / (double)w->ops,
+           100.0 * (double)cpu / (double)(s.wire_ns + cpu));
+    return 0;
+}
+
+static int run_suite(const char *title, const spm_sys_ops_t *ops)
+{
+    printf("\n%s\n", title);
+    printf("%-*s%10s %10s %8s %9s %8s\n", BENCH_COL, "workload",
+           "wire KiB/s", "e2e KiB/s", "sys/op", "cpu us/op", "cpu");
+
+    for (size_t k = 0; k < sizeof(g_workloads) / sizeof(g_workloads[0]); k++) {
+        if (run_workload(&g_workloads[k], ops) != 0) return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    spm_sim_reset();
+    spm_sim_add("/dev/spidev0.0", 0, nor_model, NULL);
+    spm_sim_add("/dev/spidev1.0", 0, adc_model, NULL);
+    spm_sim_add("/dev/spidev2.0", 0, reg_model, NULL);
+    spm_sim_add("/dev/spidev3.0", 0, NULL, NULL);
+
+    memset(g_nor.mem, 0xFF, sizeof(g_nor.mem));
+    for (size_t i = 0; i < sizeof(g_buf); i++) g_buf[i] = (uint8_t)(i * 7);
+
+    printf("Application workloads against simulated peripherals\n");
+    printf("(wire = modeled bus time, e2e = payload / (wire + library CPU))\n");
+
+    if (run_suite("ioctl backend (SPM_SYS_SIM)", &SPM_SYS_SIM) != 0) return 1;
+    if (run_suite("message backend (SPM_SYS_SIM_MSG)", &SPM_SYS_SIM_MSG) != 0) return 1;
+    return 0;
+}
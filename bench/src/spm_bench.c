@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "spi_monkey.h"
+#include "spm_sys_fake.h"
+
+#define BENCH_ITERS 2000000u
+#define BENCH_COL   44
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+typedef spm_ecode_t (*bench_fn)(spm_device_t *dev);
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_print(const char *name, double ns_per_call)
+{
+    int pad = BENCH_COL - (int)strlen(name);
+    if (pad < 1) pad = 1;
+    printf("%s%*s%8.1f ns/call\n", name, pad, "", ns_per_call);
+}
+
+static void bench_run(const char *name, spm_device_t *dev, bench_fn fn)
+{
+    /* Warm up caches and branch predictors */
+    for (unsigned i = 0; i < BENCH_ITERS / 10; i++) fn(dev);
+
+    uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < BENCH_ITERS; i++) fn(dev);
+    uint64_t t1 = now_ns();
+
+    bench_print(name, (double)(t1 - t0) / BENCH_ITERS);
+}
+
+/* ====================================================== */
+/* ===================== Workloads ====================== */
+/* ====================================================== */
+
+static uint8_t g_tx[16];
+static uint8_t g_rx[16];
+
+static spm_batch_xfer_t g_xfers[4] = {
+    { .tx = g_tx,  .rx = NULL, .len = 1 },
+    { .tx = g_tx,  .rx = g_rx, .len = 4 },
+    { .tx = NULL,  .rx = g_rx, .len = 8 },
+    { .tx = g_tx,  .rx = NULL, .len = 2 },
+};
+
+static spm_ecode_t b_transfer(spm_device_t *dev)
+{
+    return spm_transfer(dev, g_tx, g_rx, sizeof(g_tx));
+}
+
+static spm_ecode_t b_transfer_unchecked(spm_device_t *dev)
+{
+    return spm_transfer_unchecked(dev, g_tx, g_rx, sizeof(g_tx));
+}
+
+static spm_ecode_t b_batch(spm_device_t *dev)
+{
+    return spm_batch(dev, g_xfers, 4);
+}
+
+static spm_ecode_t b_batch_unchecked(spm_device_t *dev)
+{
+    return spm_batch_unchecked(dev, g_xfers, 4);
+}
+
+static spm_ecode_t h_noop_post(spm_device_t *dev, const spm_hook_call_t *call, spm_ecode_t rc, void *ctx)
+{
+    (void)dev; (void)call; (void)ctx;
+    return rc;
+}
+
+/* ====================================================== */
+/* ======================== Main ======================== */
+/* ====================================================== */
+
+int main(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    if (rc != SPM_OK) {
+        fprintf(stderr, "open failed: %d\n", rc);
+        return 1;
+    }
+
+    printf("Per-call overhead against the fake backend (%u iterations)\n\n", BENCH_ITERS);
+
+    spm_dev_set_validation(dev, SPM_VALIDATE_FULL);
+    bench_run("transfer [full]",        dev, b_transfer);
+    bench_run("batch(4) [full]",        dev, b_batch);
+
+    spm_dev_set_validation(dev, SPM_VALIDATE_DEBUG);
+    bench_run("transfer [debug]",       dev, b_transfer);
+    bench_run("batch(4) [debug]",       dev, b_batch);
+
+    spm_dev_set_validation(dev, SPM_VALIDATE_NONE);
+    bench_run("transfer [none]",        dev, b_transfer);
+    bench_run("batch(4) [none]",        dev, b_batch);
+
+    bench_run("transfer_unchecked",     dev, b_transfer_unchecked);
+    bench_run("batch_unchecked(4)",     dev, b_batch_unchecked);
+
+    spm_hook_t noop = { .post = h_noop_post };
+    spm_dev_add_hook(dev, &noop);
+    bench_run("transfer [none, 1 hook]", dev, b_transfer);
+    bench_run("batch(4) [none, 1 hook]", dev, b_batch);
+    spm_dev_remove_hook(dev, &noop);
+
+    spm_dev_close(dev);
+    return 0;
+}
@@ -20,6 +20,14 @@ extern "C" {
 #define SPM_DEFAULT_SPEED_HZ     5000000u   /* 5 MHz */
 #define SPM_PATH_MAX             32 
 #define SPM_MAX_BATCH_XFERS      256
+#define SPM_MAX_HOOKS            8
+#define SPM_MAX_TAGS             64
+#define SPM_BUFSIZ_DEFAULT       4096u  /* spidev default bufsiz: cap on a message's tx and rx bytes */
+#define SPM_BUFSIZ_ALIGN         128u   /* spidev counts each transfer rounded up to ARCH_DMA_MINALIGN */
+#define SPM_MEM_MAX_DUMMY        16
+
+/* What a transfer of len bytes counts against bufsiz */
+#define SPM_BUFSIZ_COST(len)     (((size_t)(len) + SPM_BUFSIZ_ALIGN - 1) & ~(size_t)(SPM_BUFSIZ_ALIGN - 1))
 
 /* ====================================================== */
 /* ======================= Types ======================== */
@@ -38,6 +46,64 @@ typedef enum {
     SPM_MODE3 = SPI_MODE_3,  /**< CPOL=1, CPHA=1 */
 } spm_mode_t;
 
+/**
+ * @brief Parameter validation level of the data-transfer path.
+ *
+ * Governs the checks performed by spm_transfer(), spm_write(),
+ * spm_read() and spm_batch(). Configuration and info calls always
+ * validate their parameters.
+ */
+typedef enum {
+    SPM_VALIDATE_NONE  = 0,  /**< No checks (caller is trusted) */
+    SPM_VALIDATE_DEBUG = 1,  /**< Checks only in builds without NDEBUG */
+    SPM_VALIDATE_FULL  = 2,  /**< Always check (default) */
+} spm_validation_t;
+
+/**
+ * @brief Where speed and bits-per-word are kept.
+ */
+typedef enum {
+    SPM_CFG_DRIVER       = 0,  /**< Written to the driver on every change (default) */
+    SPM_CFG_PER_TRANSFER = 1,  /**< Cached only, carried in each transfer */
+} spm_cfg_policy_t;
+
+/**
+ * @brief Write-combining limits.
+ *
+ * Pending writes are flushed as one SPI_IOC_MESSAGE(n) when any limit
+ * is reached.
+ */
+typedef struct {
+    size_t    max_bytes;      /**< Buffered tx bytes (0 = 4096) */
+    uint32_t  max_xfers;      /**< Buffered writes, up to SPM_MAX_BATCH_XFERS (0 = 64) */
+    uint32_t  max_delay_us;   /**< Age of the oldest pending write (0 = no time bound) */
+} spm_wc_cfg_t;
+
+/**
+ * @brief Write-combining counters.
+ */
+typedef struct {
+    uint64_t  writes;         /**< Writes combined */
+    uint64_t  flushes;        /**< Messages issued for combined writes */
+    uint64_t  timed_flushes;  /**< Flushes triggered by max_delay_us */
+    double    avg_combine;    /**< writes / flushes */
+} spm_wc_stats_t;
+
+/**
+ * @brief Bus use attributed to one caller-supplied tag.
+ */
+typedef struct {
+    uint8_t   tag;
+    uint64_t  messages;       /**< Messages submitted, one syscall each */
+    uint64_t  xfers;          /**< Transfers in those messages */
+    uint64_t  bytes;          /**< Bytes clocked (each direction) */
+    uint64_t  errors;         /**< Messages that failed */
+    uint64_t  wire_ns;        /**< Estimated clock time: words * bpw / speed, plus delays */
+    uint64_t  ioctl_ns;       /**< Measured time in the driver call */
+    uint64_t  ioctl_max_ns;
+    double    wire_share;     /**< Share of the device's estimated wire time */
+} spm_tag_stats_t;
+
 /**
  * @brief Batch transfer descriptor.
  */
@@ -64,6 +130,79 @@ typedef struct {
     bool        cs_change;       /**< Deassert CS between transfers */
 } spm_cfg_t;
 
+/**
+ * @brief One device of a bulk open.
+ *
+ * bus, cs and cfg are inputs; the rest is filled in by
+ * spm_dev_open_bulk().
+ */
+typedef struct {
+    uint8_t           bus;
+    uint8_t           cs;
+    const spm_cfg_t  *cfg;           /**< Initial config (NULL = defaults) */
+    spm_device_t     *dev;           /**< Output: handle, NULL on failure */
+    spm_ecode_t       rc;            /**< Output: open result */
+    uint64_t          open_ns;       /**< Output: open() of the node */
+    uint64_t          cfg_write_ns;  /**< Output: config write */
+    uint64_t          probe_ns;      /**< Output: config read-back */
+} spm_open_entry_t;
+
+/**
+ * @brief Startup time of a bulk open.
+ *
+ * Phase times are summed over devices; total_ns is wall-clock time.
+ */
+typedef struct {
+    uint64_t  total_ns;
+    uint64_t  open_ns;
+    uint64_t  cfg_write_ns;
+    uint64_t  probe_ns;
+    size_t    buses;          /**< Distinct buses */
+    size_t    threads;        /**< Workers used (1 = opened inline) */
+    size_t    opened;
+    size_t    failed;
+} spm_open_report_t;
+
+/**
+ * @brief Operation seen by an interceptor.
+ */
+typedef enum {
+    SPM_HOOK_TRANSFER = 0,  /**< spm_transfer(), spm_write(), spm_read() */
+    SPM_HOOK_BATCH    = 1,  /**< spm_batch() and write-combining flushes */
+    SPM_HOOK_CONFIG   = 2,  /**< Configuration writes */
+} spm_hook_op_t;
+
+/**
+ * @brief One intercepted operation.
+ *
+ * Data operations carry their descriptors (a single transfer as one
+ * descriptor, zero speed/bpw meaning the device config); rx buffers
+ * hold the results by the time post runs. Config writes carry no
+ * descriptors; cfg is the requested config in pre and the config the
+ * driver accepted in post.
+ */
+typedef struct {
+    spm_hook_op_t            op;
+    const spm_batch_xfer_t  *xfers;
+    size_t                   count;
+    const spm_cfg_t         *cfg;
+} spm_hook_call_t;
+
+/**
+ * @brief Interceptor.
+ *
+ * pre runs before the operation in attach order; a non-OK return
+ * skips the operation and becomes its result. post runs afterwards in
+ * reverse order for every hook whose pre let it through, and returns
+ * the result passed on (e.g. SPM_ECRC from a checksum check). Either
+ * callback may be NULL.
+ */
+typedef struct {
+    spm_ecode_t (*pre)(spm_device_t *dev, const spm_hook_call_t *call, void *ctx);
+    spm_ecode_t (*post)(spm_device_t *dev, const spm_hook_call_t *call, spm_ecode_t rc, void *ctx);
+    void *ctx;
+} spm_hook_t;
+
 /* ====================================================== */
 /* ================= Device Lifecycle =================== */
 /* ====================================================== */
@@ -130,6 +269,31 @@ spm_ecode_t spm_dev_close(
     spm_device_t *dev
 );
 
+/**
+ * @brief Open many devices, one worker per bus.
+ *
+ * Devices on the same bus (one controller) are opened one after
+ * another in list order; different buses proceed concurrently. Each
+ * entry gets its own handle, result and phase times. Devices that
+ * opened stay open when others fail.
+ *
+ * @param entries      Devices to open (must not be NULL)
+ * @param count        Number of entries (must be > 0)
+ * @param sys          System operations (NULL = default)
+ * @param max_threads  Worker cap (0 = one per bus)
+ * @param out_report   Output: startup breakdown (may be NULL)
+ *
+ * @return SPM_OK if all opened, else the first failing entry's code
+ *         (SPM_EPARAM for invalid arguments, nothing opened)
+ */
+spm_ecode_t spm_dev_open_bulk(
+    spm_open_entry_t *entries,
+    size_t count,
+    const spm_sys_ops_t *sys,
+    size_t max_threads,
+    spm_open_report_t *out_report
+);
+
 /* ====================================================== */
 /* =================== Data Transfer ==================== */
 /* ====================================================== */
@@ -214,6 +378,159 @@ spm_ecode_t spm_batch(
     size_t count
 );
 
+/**
+ * @brief spm_transfer() accounted to an explicit tag.
+ *
+ * @param dev  Device handle
+ * @param tag  Accounting tag (< SPM_MAX_TAGS), overrides the device tag
+ * @param tx   Transmit buffer (NULL for read-only)
+ * @param rx   Receive buffer (NULL for write-only)
+ * @param len  Transfer length in bytes (1..UINT32_MAX)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_transfer_tagged(
+    spm_device_t *dev,
+    uint8_t tag,
+    const void *tx,
+    void *rx,
+    size_t len
+);
+
+/**
+ * @brief spm_batch() accounted to an explicit tag.
+ *
+ * @param dev    Device handle
+ * @param tag    Accounting tag (< SPM_MAX_TAGS), overrides the device tag
+ * @param xfers  Array of transfer descriptors (must not be NULL)
+ * @param count  Number of transfers (1..256)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_batch_tagged(
+    spm_device_t *dev,
+    uint8_t tag,
+    const spm_batch_xfer_t *xfers,
+    size_t count
+);
+
+/**
+ * @brief Unchecked full-duplex SPI transfer.
+ * 
+ * Same as spm_transfer() but skips handle and parameter validation
+ * regardless of the device validation level. Intended for trusted
+ * inner loops.
+ * 
+ * @param dev  Device handle (must be valid)
+ * @param tx   Transmit buffer (NULL for read-only)
+ * @param rx   Receive buffer (NULL for write-only)
+ * @param len  Transfer length in bytes (1..UINT32_MAX)
+ * 
+ * @return SPM_OK on success, error code otherwise
+ * 
+ * @warning Invalid arguments result in undefined behavior
+ */
+spm_ecode_t spm_transfer_unchecked(
+    spm_device_t *dev,
+    const void *tx,
+    void *rx,
+    size_t len
+);
+
+/**
+ * @brief Unchecked write-only SPI transfer.
+ * 
+ * @see spm_transfer_unchecked()
+ */
+spm_ecode_t spm_write_unchecked(
+    spm_device_t *dev,
+    const void *tx,
+    size_t len
+);
+
+/**
+ * @brief Unchecked read-only SPI transfer.
+ * 
+ * @see spm_transfer_unchecked()
+ */
+spm_ecode_t spm_read_unchecked(
+    spm_device_t *dev,
+    void *rx,
+    size_t len
+);
+
+/**
+ * @brief Unchecked batch SPI transfers.
+ * 
+ * Same as spm_batch() but skips handle, count and per-descriptor
+ * validation.
+ * 
+ * @param dev     Device handle (must be valid)
+ * @param xfers   Array of transfer descriptors (must be valid)
+ * @param count   Number of transfers (1..256)
+ * 
+ * @return SPM_OK on success, error code otherwise
+ * 
+ * @warning Invalid arguments result in undefined behavior
+ */
+spm_ecode_t spm_batch_unchecked(
+    spm_device_t *dev,
+    const spm_batch_xfer_t *xfers,
+    size_t count
+);
+
+/* ====================================================== */
+/* ==================== Memory Reads ==================== */
+/* ====================================================== */
+
+/**
+ * @brief Read command of a memory-style device (SPI NOR, EEPROM, FRAM).
+ *
+ * A frame is the opcode, the address big-endian and dummy bytes, then
+ * data from consecutive addresses, under one CS assertion.
+ */
+typedef struct {
+    uint8_t   read_cmd;      /**< Opcode (0 = 0x03) */
+    uint8_t   addr_bytes;    /**< Address bytes, 1..4 (0 = 3) */
+    uint8_t   dummy_bytes;   /**< Dummy bytes after the address (up to SPM_MEM_MAX_DUMMY) */
+    size_t    bufsiz;        /**< Max bytes per message, spidev bufsiz (0 = 4096) */
+} spm_mem_cfg_t;
+
+/**
+ * @brief One range of a memory read.
+ */
+typedef struct {
+    uint32_t  addr;          /**< Device address */
+    void     *dst;           /**< Destination (must not be NULL) */
+    size_t    len;           /**< Bytes (> 0) */
+} spm_mem_range_t;
+
+/**
+ * @brief Read address ranges in messages spidev accepts.
+ *
+ * spidev rejects a message whose tx bytes or rx bytes, each transfer
+ * rounded up to SPM_BUFSIZ_ALIGN, add up to more than bufsiz. Ranges
+ * are cut into frames of at most bufsiz data bytes, and consecutive
+ * frames share a message while both sums and SPM_MAX_BATCH_XFERS
+ * allow.
+ *
+ * @param dev       Device handle
+ * @param cfg       Read command (NULL = 0x03, 3 address bytes, 4096)
+ * @param ranges    Ranges, read in order (must not be NULL)
+ * @param count     Number of ranges (must be > 0)
+ * @param out_msgs  Output: incremented per message issued (may be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM if cfg or a range is invalid or bufsiz
+ *         is below SPM_BUFSIZ_ALIGN, or the spm_batch() error
+ */
+spm_ecode_t spm_mem_read(
+    spm_device_t *dev,
+    const spm_mem_cfg_t *cfg,
+    const spm_mem_range_t *ranges,
+    size_t count,
+    uint64_t *out_msgs
+);
+
 /* ====================================================== */
 /* ============== Configuration Management ============== */
 /* ====================================================== */
@@ -319,6 +636,268 @@ spm_ecode_t spm_dev_set_bpw(
     uint8_t bpw
 );
 
+/**
+ * @brief Set the validation level of the data-transfer path.
+ * 
+ * New devices start with the build-time default SPM_VALIDATION_DEFAULT
+ * (SPM_VALIDATE_FULL unless overridden). SPM_VALIDATE_DEBUG behaves
+ * like FULL in debug builds (make DEBUG=1) and like NONE in release
+ * builds, which define NDEBUG.
+ * 
+ * @param dev    Device handle
+ * @param level  Desired validation level
+ * 
+ * @return SPM_OK on success, SPM_EPARAM if level is unknown
+ * 
+ * @note A NULL handle is still rejected at every level
+ */
+spm_ecode_t spm_dev_set_validation(
+    spm_device_t *dev,
+    spm_validation_t level
+);
+
+/**
+ * @brief Get the validation level of the data-transfer path.
+ * 
+ * @param dev        Device handle
+ * @param out_level  Output: current level (must not be NULL)
+ * 
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_dev_get_validation(
+    const spm_device_t *dev,
+    spm_validation_t *out_level
+);
+
+/**
+ * @brief Select how speed and bits-per-word are applied.
+ * 
+ * With SPM_CFG_PER_TRANSFER, speed_hz and bits_per_word live only in
+ * the cached config and are carried in every spi_ioc_transfer, so
+ * changing them costs no syscall. Only mode bits are written to the
+ * driver, and only when they change. spm_dev_get_cfg() and
+ * spm_dev_refresh_cfg() read the mode from the driver and report the
+ * cached speed/bpw. Switching back to SPM_CFG_DRIVER writes the cached
+ * config to the driver.
+ * 
+ * @param dev     Device handle
+ * @param policy  SPM_CFG_DRIVER or SPM_CFG_PER_TRANSFER
+ * 
+ * @return SPM_OK on success, error code otherwise
+ * 
+ * @note Per-transfer speeds are not read back, so driver clamping is
+ *       not reflected in the cached config
+ */
+spm_ecode_t spm_dev_set_cfg_policy(
+    spm_device_t *dev,
+    spm_cfg_policy_t policy
+);
+
+/**
+ * @brief Get the configuration policy.
+ * 
+ * @param dev         Device handle
+ * @param out_policy  Output: current policy (must not be NULL)
+ * 
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_dev_get_cfg_policy(
+    const spm_device_t *dev,
+    spm_cfg_policy_t *out_policy
+);
+
+/* ====================================================== */
+/* ================== Write Combining =================== */
+/* ====================================================== */
+
+/**
+ * @brief Enable or disable write combining.
+ * 
+ * While enabled, spm_write() and write-only spm_transfer() calls copy
+ * their data into a per-device pending batch and return. Each write
+ * keeps its own CS assertion, speed, bpw and delay. The batch is sent
+ * when a limit in cfg is reached, when max_delay_us expires (checked
+ * by a per-device timer thread), and before any read, batch, config
+ * or close call so device order is preserved.
+ * 
+ * @param dev  Device handle
+ * @param cfg  Limits, or NULL to flush and disable
+ * 
+ * @return SPM_OK on success, error code otherwise
+ * 
+ * @note Write errors are reported by the next call that flushes, or by
+ *       spm_dev_flush()
+ */
+spm_ecode_t spm_dev_set_write_combining(
+    spm_device_t *dev,
+    const spm_wc_cfg_t *cfg
+);
+
+/**
+ * @brief Send all pending combined writes.
+ * 
+ * @param dev  Device handle
+ * 
+ * @return SPM_OK on success, or the first deferred write error
+ */
+spm_ecode_t spm_dev_flush(
+    spm_device_t *dev
+);
+
+/**
+ * @brief Get write-combining counters.
+ * 
+ * @param dev        Device handle
+ * @param out_stats  Output: counters (must not be NULL)
+ * 
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_dev_get_wc_stats(
+    spm_device_t *dev,
+    spm_wc_stats_t *out_stats
+);
+
+/* ====================================================== */
+/* ==================== Interceptors ==================== */
+/* ====================================================== */
+
+/**
+ * @brief Attach an interceptor to a device.
+ *
+ * Hooks wrap spm_transfer(), spm_batch() and configuration writes,
+ * including write-combining flushes (which may run on the timer
+ * thread). A device without hooks only tests one pointer per call.
+ * Callbacks must not issue transfers or config calls on the same
+ * device.
+ *
+ * @param dev   Device handle
+ * @param hook  Interceptor, copied (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ESTATE if already attached,
+ *         SPM_ENOMEM if SPM_MAX_HOOKS are attached
+ */
+spm_ecode_t spm_dev_add_hook(
+    spm_device_t *dev,
+    const spm_hook_t *hook
+);
+
+/**
+ * @brief Detach an interceptor (matched on pre, post and ctx).
+ *
+ * @param dev   Device handle
+ * @param hook  Interceptor as attached (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM if not attached, SPM_ENOMEM
+ */
+spm_ecode_t spm_dev_remove_hook(
+    spm_device_t *dev,
+    const spm_hook_t *hook
+);
+
+/* ====================================================== */
+/* ================ Bus-Time Accounting ================= */
+/* ====================================================== */
+
+/**
+ * @brief Enable or disable per-tag bus accounting.
+ *
+ * While enabled, every data message is timed and its bytes, transfers
+ * and estimated wire time are added to the tag it was issued under:
+ * the explicit tag of spm_transfer_tagged() / spm_batch_tagged(), else
+ * the device tag. Write combining flushes before a write with another
+ * tag so each message has one owner. Enabling clears the counters;
+ * disabling frees them.
+ *
+ * @param dev     Device handle
+ * @param enable  On or off
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_dev_set_tag_accounting(
+    spm_device_t *dev,
+    bool enable
+);
+
+/**
+ * @brief Set the tag of untagged calls on this handle (initially 0).
+ *
+ * @param dev  Device handle
+ * @param tag  Accounting tag (< SPM_MAX_TAGS)
+ *
+ * @return SPM_OK on success, SPM_EPARAM if tag is out of range
+ */
+spm_ecode_t spm_dev_set_tag(
+    spm_device_t *dev,
+    uint8_t tag
+);
+
+/**
+ * @brief Get the tag of untagged calls on this handle.
+ *
+ * @param dev      Device handle
+ * @param out_tag  Output: tag (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_dev_get_tag(
+    const spm_device_t *dev,
+    uint8_t *out_tag
+);
+
+/**
+ * @brief Per-tag counters, for tags that issued at least one message.
+ *
+ * @param dev        Device handle
+ * @param out_stats  Output: entries in tag order (may be NULL if cap is 0)
+ * @param cap        Entries in out_stats
+ * @param out_count  Output: number of active tags (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ESTATE if accounting is off, SPM_ENOMEM if cap
+ *         is too small (the first cap entries and out_count are set)
+ */
+spm_ecode_t spm_dev_get_tag_stats(
+    spm_device_t *dev,
+    spm_tag_stats_t *out_stats,
+    size_t cap,
+    size_t *out_count
+);
+
+/**
+ * @brief Clear the per-tag counters.
+ *
+ * @param dev  Device handle
+ *
+ * @return SPM_OK, SPM_ESTATE if accounting is off
+ */
+spm_ecode_t spm_dev_reset_tag_stats(
+    spm_device_t *dev
+);
+
+/* ====================================================== */
+/* ===================== Live Stats ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Publish this device's counters to the process's live segment.
+ *
+ * While enabled, every data message is timed and added to a slot of
+ * the shared-memory segment created by spm_live_start() (spm_live.h),
+ * where monitors such as spm-top read it without locking. The
+ * write-combining queue depth and the number of callers inside the
+ * driver are published as gauges. Enabling starts from zero; the slot
+ * is freed on disable and close.
+ *
+ * @param dev     Device handle
+ * @param enable  On or off
+ *
+ * @return SPM_OK, SPM_ESTATE if the segment is not started,
+ *         SPM_ENOMEM if all its slots are taken
+ */
+spm_ecode_t spm_dev_set_live(
+    spm_device_t *dev,
+    bool enable
+);
+
 /* ====================================================== */
 /* ==================== Device Info ===================== */
 /* ====================================================== */
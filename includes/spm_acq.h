@@ -0,0 +1,206 @@
+#ifndef SPMACQ_H
+#define SPMACQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_acq spm_acq_t;
+
+/**
+ * @brief Block transform run by the fill thread.
+ *
+ * Called on every filled block before it is handed out; may rewrite
+ * the data in place and shorten it (e.g. decode and decimate). A
+ * failure stops the acquisition like a failed fill.
+ *
+ * @param ctx   process_ctx from the config
+ * @param data  Block data (block_len bytes)
+ * @param len   In: block_len, out: valid bytes
+ */
+typedef spm_ecode_t (*spm_acq_process_fn)(void *ctx, uint8_t *data, size_t *len);
+
+/**
+ * @brief Acquisition configuration.
+ *
+ * A block is the unit handed to the application. It is filled by one
+ * prepared batch: either a continuous stream of chunk_len transfers
+ * (frame_len = 0) or one CS frame per frame_len bytes. The batch is
+ * sent as consecutive messages, each holding at most
+ * SPM_MAX_BATCH_XFERS transfers and keeping its tx and rx sums within
+ * bufsiz as spidev counts them (see spm_mem_read()).
+ *
+ * With latency_us set, each block is instead a single message whose
+ * depth (transfers per message) is tuned at runtime: the fill thread
+ * fits message time = overhead + depth * transfer time to its own
+ * fills and picks the largest depth that keeps a message within the
+ * bound. block_len is then the upper limit of a block.
+ */
+typedef struct {
+    size_t       block_len;     /**< Bytes per block (must be > 0) */
+    size_t       nbufs;         /**< Preallocated blocks (>= 2, 0 = 2) */
+    size_t       chunk_len;     /**< Max bytes per transfer when streaming (0 = bufsiz, aligned down) */
+    size_t       frame_len;     /**< Bytes per CS frame (0 = stream whole block) */
+    const void  *tx_frame;      /**< Per-frame tx template, frame_len bytes (NULL = dummy) */
+    uint16_t     frame_delay_usecs; /**< Delay after each frame */
+    bool         overwrite;     /**< On overrun drop the oldest ready block instead of waiting */
+    spm_acq_process_fn process; /**< Transform applied in the fill thread (NULL = none) */
+    void        *process_ctx;   /**< Context passed to process */
+    uint32_t     latency_us;    /**< Autotune depth to this message time bound (0 = fixed) */
+    size_t       bufsiz;        /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+} spm_acq_cfg_t;
+
+/**
+ * @brief Block handed to the application.
+ */
+typedef struct {
+    uint8_t  *data;   /**< Received bytes */
+    size_t    len;    /**< Valid bytes (block_len, or as set by process) */
+    uint64_t  seq;    /**< Fill sequence number; gaps mean dropped blocks */
+    int       index;  /**< Internal buffer index */
+} spm_acq_block_t;
+
+/**
+ * @brief Acquisition counters.
+ */
+typedef struct {
+    uint64_t  blocks;          /**< Blocks filled */
+    uint64_t  overruns;        /**< Fills that found no free buffer */
+    uint64_t  dropped;         /**< Ready blocks discarded (overwrite mode) */
+    uint64_t  consumer_waits;  /**< Acquire calls that had to wait for the bus */
+    uint64_t  errors;          /**< Failed fills */
+    uint64_t  fill_ns;         /**< Total time spent in fills */
+    uint64_t  process_ns;      /**< Total time spent in the process hook */
+    uint64_t  messages;        /**< spm_batch() calls */
+    uint32_t  depth;           /**< Transfers per message (current, when autotuned) */
+    double    msg_overhead_ns; /**< Autotune: fitted per-message cost */
+    double    xfer_ns;         /**< Autotune: fitted per-transfer time */
+    double    est_latency_ns;  /**< Autotune: msg_overhead_ns + depth * xfer_ns */
+    double    est_xfers_per_s; /**< Autotune: depth / est_latency_ns */
+} spm_acq_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a ping-pong acquisition object.
+ *
+ * Allocates nbufs blocks and prepares one batch per block. The
+ * device is not touched until spm_acq_start().
+ *
+ * @param dev      Device handle
+ * @param cfg      Configuration (must not be NULL)
+ * @param out_acq  Output: acquisition handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ *
+ * @note block_len must be a multiple of frame_len when frames are used,
+ *       and one transfer (chunk_len or frame_len, rounded up to
+ *       SPM_BUFSIZ_ALIGN) must fit in bufsiz
+ */
+spm_ecode_t spm_acq_create(
+    spm_device_t *dev,
+    const spm_acq_cfg_t *cfg,
+    spm_acq_t **out_acq
+);
+
+/**
+ * @brief Start the background fill thread.
+ *
+ * While running, the thread owns the device: no other calls may be
+ * made on it until spm_acq_stop() returns.
+ *
+ * @param acq  Acquisition handle
+ *
+ * @return SPM_OK on success, SPM_ESTATE if already running
+ */
+spm_ecode_t spm_acq_start(
+    spm_acq_t *acq
+);
+
+/**
+ * @brief Stop the fill thread and wait for it to exit.
+ *
+ * Ready blocks remain available to spm_acq_acquire().
+ *
+ * @param acq  Acquisition handle
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_acq_stop(
+    spm_acq_t *acq
+);
+
+/**
+ * @brief Stop and free an acquisition object.
+ *
+ * @param acq  Acquisition handle (may be NULL)
+ */
+void spm_acq_destroy(
+    spm_acq_t *acq
+);
+
+/* ====================================================== */
+/* ====================== Handoff ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Take the oldest filled block.
+ *
+ * The block belongs to the caller until spm_acq_release(). Holding
+ * nbufs - 1 blocks leaves the fill thread one buffer to work with.
+ *
+ * @param acq         Acquisition handle
+ * @param timeout_ms  Max wait (-1 = forever, 0 = poll)
+ * @param out_blk     Output: block (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ETIMEOUT, SPM_ESTATE if stopped and drained,
+ *         or the error of a failed fill
+ */
+spm_ecode_t spm_acq_acquire(
+    spm_acq_t *acq,
+    int timeout_ms,
+    spm_acq_block_t *out_blk
+);
+
+/**
+ * @brief Return a block to the fill thread.
+ *
+ * @param acq  Acquisition handle
+ * @param blk  Block from spm_acq_acquire()
+ *
+ * @return SPM_OK on success, SPM_EPARAM if the block is not held
+ */
+spm_ecode_t spm_acq_release(
+    spm_acq_t *acq,
+    const spm_acq_block_t *blk
+);
+
+/**
+ * @brief Snapshot of the acquisition counters.
+ *
+ * @param acq        Acquisition handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_acq_get_stats(
+    spm_acq_t *acq,
+    spm_acq_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMACQ_H */
@@ -0,0 +1,185 @@
+#ifndef SPMASSET_H
+#define SPMASSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+#define SPM_ASSET_MAX_BLOCK  (1u << 22)
+
+typedef struct spm_asset spm_asset_t;
+
+/**
+ * @brief Asset reader configuration.
+ *
+ * A packed asset is a header, a block index and the blocks, each
+ * compressed independently with LZ4 (block format) or stored raw when
+ * that is smaller. The index makes any block readable on its own.
+ */
+typedef struct {
+    uint8_t   read_cmd;      /**< Flash read opcode (0 = 0x03) */
+    uint8_t   addr_bytes;    /**< Address bytes, 3 or 4 (0 = 3) */
+    uint8_t   dummy_bytes;   /**< Dummy bytes after the address (e.g. 1 for 0x0B) */
+    size_t    bufsiz;        /**< Max bytes per message, spidev bufsiz (0 = 4096, else >= SPM_BUFSIZ_ALIGN) */
+    bool      serial;        /**< Read and decode on the calling thread, one after the other */
+} spm_asset_cfg_t;
+
+/**
+ * @brief Layout of an opened asset.
+ */
+typedef struct {
+    uint32_t  size;          /**< Uncompressed bytes */
+    uint32_t  block_size;    /**< Uncompressed bytes per block (the last may be shorter) */
+    uint32_t  blocks;
+    uint32_t  packed_size;   /**< Header, index and blocks as stored */
+} spm_asset_info_t;
+
+/**
+ * @brief Reader counters.
+ */
+typedef struct {
+    uint64_t  reads;         /**< spm_asset_read() calls */
+    uint64_t  blocks;        /**< Blocks decoded */
+    uint64_t  cache_hits;    /**< Partial blocks served from the last decoded block */
+    uint64_t  bytes_in;      /**< Block bytes read from flash */
+    uint64_t  bytes_out;     /**< Bytes delivered */
+    uint64_t  messages;      /**< Flash read messages */
+    uint64_t  read_ns;       /**< Time spent reading blocks */
+    uint64_t  decode_ns;     /**< Time spent decoding */
+    uint64_t  stall_ns;      /**< Decoder time spent waiting for a block */
+    uint64_t  total_ns;      /**< Time inside spm_asset_read() */
+    double    overlap;       /**< Share of decode time hidden behind reads */
+} spm_asset_stats_t;
+
+/* ====================================================== */
+/* ====================== Packing ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Worst-case packed size.
+ *
+ * @param size        Uncompressed bytes
+ * @param block_size  Uncompressed bytes per block
+ *
+ * @return Bytes (0 if the arguments are invalid)
+ */
+size_t spm_asset_pack_bound(
+    size_t size,
+    uint32_t block_size
+);
+
+/**
+ * @brief Pack data into the asset format (for image builders and tests).
+ *
+ * @param src         Uncompressed bytes
+ * @param size        Byte count (<= UINT32_MAX)
+ * @param block_size  Uncompressed bytes per block (1..SPM_ASSET_MAX_BLOCK)
+ * @param out         Destination
+ * @param cap         Destination size (spm_asset_pack_bound() always fits)
+ * @param out_len     Output: packed size (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ENOMEM if cap is too small
+ */
+spm_ecode_t spm_asset_pack(
+    const void *src,
+    size_t size,
+    uint32_t block_size,
+    void *out,
+    size_t cap,
+    size_t *out_len
+);
+
+/* ====================================================== */
+/* ====================== Reading ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Open a packed asset stored in flash.
+ *
+ * Reads and checks the header and index. Unless cfg->serial is set, a
+ * prefetch thread is started that reads the next block while the
+ * caller decodes the current one.
+ *
+ * @param dev        Flash device
+ * @param addr       Flash address of the asset
+ * @param cfg        Configuration (NULL = defaults)
+ * @param out_asset  Output: asset handle (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ECRC if the header or index is damaged, error code otherwise
+ */
+spm_ecode_t spm_asset_open(
+    spm_device_t *dev,
+    uint32_t addr,
+    const spm_asset_cfg_t *cfg,
+    spm_asset_t **out_asset
+);
+
+/**
+ * @brief Stop the prefetch thread and free an asset (the device stays open).
+ *
+ * @param asset  Asset handle (may be NULL)
+ */
+void spm_asset_close(
+    spm_asset_t *asset
+);
+
+/**
+ * @brief Layout of an opened asset.
+ *
+ * @param asset     Asset handle
+ * @param out_info  Output: layout (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_asset_get_info(
+    const spm_asset_t *asset,
+    spm_asset_info_t *out_info
+);
+
+/**
+ * @brief Decompress a byte range.
+ *
+ * Only the blocks covering the range are read. Whole blocks decode
+ * straight into dst; partial ones go through a one-block cache.
+ *
+ * @param asset   Asset handle
+ * @param offset  Uncompressed offset
+ * @param dst     Destination
+ * @param len     Byte count (offset + len <= size)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ECRC if a block does not decode, or a bus error
+ */
+spm_ecode_t spm_asset_read(
+    spm_asset_t *asset,
+    uint32_t offset,
+    void *dst,
+    size_t len
+);
+
+/**
+ * @brief Snapshot of the reader counters.
+ *
+ * @param asset      Asset handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_asset_get_stats(
+    spm_asset_t *asset,
+    spm_asset_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMASSET_H */
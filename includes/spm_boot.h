@@ -0,0 +1,214 @@
+#ifndef SPMBOOT_H
+#define SPMBOOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_boot spm_boot_t;
+
+/**
+ * @brief Bootloader flasher configuration.
+ *
+ * Speaks the STM32 SPI bootloader protocol (AN4286): SOF 0x5A,
+ * command + complement, ACK (0x79) / NACK (0x1F) after every phase,
+ * big-endian addresses and XOR checksums.
+ */
+typedef struct {
+    uint32_t  base;              /**< Flash base address (0 = 0x08000000) */
+    size_t    chunk;             /**< Bytes per Write/Read Memory command (4..256, multiple of 4, 0 = 256) */
+    bool      mass_erase;        /**< spm_boot_flash(): mass erase before writing */
+    bool      verify;            /**< spm_boot_flash(): read back and compare */
+    int       ack_timeout_ms;    /**< ACK timeout of command/address/data phases (0 = 1000) */
+    int       erase_timeout_ms;  /**< ACK timeout of the erase command (0 = 30000) */
+} spm_boot_cfg_t;
+
+/**
+ * @brief Flasher counters.
+ */
+typedef struct {
+    uint64_t  bytes_written;
+    uint64_t  bytes_read;
+    uint64_t  messages;          /**< spm_batch() calls */
+    uint64_t  poll_bytes;        /**< Bytes clocked while waiting for ACKs */
+    uint64_t  poll_misses;       /**< ACK polls that came back empty */
+    uint64_t  nacks;
+    uint64_t  erase_ns;
+    uint64_t  write_ns;
+    uint64_t  verify_ns;
+    uint32_t  image_crc;         /**< CRC-32 of the last image (spm_boot_flash) */
+    uint32_t  readback_crc;      /**< CRC-32 of its read-back (0 if not verified) */
+    double    write_kbps;        /**< KiB/s of the last write pass */
+    double    verify_kbps;       /**< KiB/s of the last verify pass */
+} spm_boot_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a flasher on an open device.
+ *
+ * @param dev       Device handle (SPI mode 0, <= 8 MHz for STM32 targets)
+ * @param cfg       Configuration (NULL = defaults)
+ * @param out_boot  Output: flasher handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_boot_create(
+    spm_device_t *dev,
+    const spm_boot_cfg_t *cfg,
+    spm_boot_t **out_boot
+);
+
+/**
+ * @brief Free a flasher (the device stays open).
+ *
+ * Sends a pending host acknowledge so the target is left idle.
+ *
+ * @param boot  Flasher handle (may be NULL)
+ */
+void spm_boot_destroy(
+    spm_boot_t *boot
+);
+
+/* ====================================================== */
+/* ====================== Commands ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Synchronize with the bootloader (SOF + ACK).
+ *
+ * @param boot  Flasher handle
+ *
+ * @return SPM_OK, SPM_EIO on NACK, SPM_ETIMEOUT
+ */
+spm_ecode_t spm_boot_sync(
+    spm_boot_t *boot
+);
+
+/**
+ * @brief Mass erase via Extended Erase (0x44, 0xFFFF).
+ *
+ * @param boot  Flasher handle
+ *
+ * @return SPM_OK, SPM_EIO on NACK, SPM_ETIMEOUT
+ */
+spm_ecode_t spm_boot_erase(
+    spm_boot_t *boot
+);
+
+/**
+ * @brief Write memory in chunk-sized Write Memory commands.
+ *
+ * Each protocol phase is one message: the host acknowledge of the
+ * previous ACK, the phase bytes, the dummy byte and an ACK poll window
+ * sized from the ACK latency seen so far. The tail is padded with 0xFF
+ * to a multiple of 4.
+ *
+ * @param boot  Flasher handle
+ * @param addr  Target address
+ * @param data  Bytes to write
+ * @param len   Byte count
+ *
+ * @return SPM_OK, SPM_EIO on NACK, SPM_ETIMEOUT, SPM_EPARAM
+ */
+spm_ecode_t spm_boot_write(
+    spm_boot_t *boot,
+    uint32_t addr,
+    const void *data,
+    size_t len
+);
+
+/**
+ * @brief Read memory in chunk-sized Read Memory commands.
+ *
+ * @param boot  Flasher handle
+ * @param addr  Target address
+ * @param out   Destination
+ * @param len   Byte count
+ *
+ * @return SPM_OK, SPM_EIO on NACK, SPM_ETIMEOUT, SPM_EPARAM
+ */
+spm_ecode_t spm_boot_read(
+    spm_boot_t *boot,
+    uint32_t addr,
+    void *out,
+    size_t len
+);
+
+/**
+ * @brief Jump to application code (Go, 0x21).
+ *
+ * @param boot  Flasher handle
+ * @param addr  Start address
+ *
+ * @return SPM_OK, SPM_EIO on NACK, SPM_ETIMEOUT
+ */
+spm_ecode_t spm_boot_go(
+    spm_boot_t *boot,
+    uint32_t addr
+);
+
+/* ====================================================== */
+/* ====================== Flashing ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Erase (optional), write and verify (optional) an image at base.
+ *
+ * Verification reads the image back in bulk and compares it; CRC-32s
+ * of both are left in the stats.
+ *
+ * @param boot   Flasher handle
+ * @param image  Image bytes
+ * @param len    Image size
+ *
+ * @return SPM_OK, SPM_ECRC if verification failed, or a command error
+ */
+spm_ecode_t spm_boot_flash(
+    spm_boot_t *boot,
+    const void *image,
+    size_t len
+);
+
+/**
+ * @brief spm_boot_flash() on a memory-mapped file.
+ *
+ * @param boot  Flasher handle
+ * @param path  Binary image path
+ *
+ * @return As spm_boot_flash(), SPM_ENODEV if the file cannot be mapped
+ */
+spm_ecode_t spm_boot_flash_file(
+    spm_boot_t *boot,
+    const char *path
+);
+
+/**
+ * @brief Snapshot of the flasher counters.
+ *
+ * @param boot       Flasher handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_boot_get_stats(
+    const spm_boot_t *boot,
+    spm_boot_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMBOOT_H */
@@ -0,0 +1,212 @@
+#ifndef SPMCAM_H
+#define SPMCAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_cam spm_cam_t;
+
+/**
+ * @brief FIFO camera capture configuration.
+ *
+ * Targets ArduCAM-style modules: capture is triggered through the FIFO
+ * control register, completion and the 23-bit FIFO length are polled in
+ * one batched message, and the frame is pulled with a single burst FIFO
+ * read split into bufsiz-sized messages under one CS assertion.
+ */
+typedef struct {
+    size_t    max_frame;    /**< Bytes per pool buffer; longer FIFOs are truncated (0 = 384 KiB) */
+    size_t    nbufs;        /**< Pool buffers (>= 2, 0 = 3) */
+    size_t    bufsiz;       /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+    uint8_t   burst_dummy;  /**< Dummy bytes clocked after the burst read command */
+    uint32_t  poll_us;      /**< Capture-done poll interval (0 = 500) */
+    int       timeout_ms;   /**< Capture-done timeout (0 = 1000) */
+    bool      overwrite;    /**< Drop the oldest ready frame instead of waiting for a free buffer */
+} spm_cam_cfg_t;
+
+/**
+ * @brief Frame handed to the application.
+ *
+ * data points into a pool buffer (no copy) and spans SOI to EOI.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t         len;       /**< JPEG bytes, SOI to EOI inclusive */
+    size_t         fifo_len;  /**< Bytes reported by the FIFO length registers */
+    uint64_t       seq;       /**< Capture sequence number; gaps mean dropped frames */
+    uint64_t       t_ns;      /**< CLOCK_MONOTONIC time the capture completed */
+    int            index;     /**< Internal buffer index */
+} spm_cam_frame_t;
+
+/**
+ * @brief Capture counters.
+ */
+typedef struct {
+    uint64_t  frames;        /**< Frames delivered */
+    uint64_t  bytes;         /**< JPEG bytes delivered */
+    uint64_t  fifo_bytes;    /**< Bytes read from the FIFO */
+    uint64_t  bad_frames;    /**< FIFO contents without SOI/EOI (discarded) */
+    uint64_t  truncated;     /**< FIFO lengths above max_frame */
+    uint64_t  polls;         /**< Capture-done status reads */
+    uint64_t  overruns;      /**< Captures that found no free buffer */
+    uint64_t  dropped;       /**< Ready frames discarded (overwrite mode) */
+    uint64_t  errors;        /**< Failed captures */
+    uint64_t  read_ns;       /**< Time spent in burst reads */
+    uint64_t  scan_ns;       /**< Time spent locating SOI/EOI */
+    double    fps;           /**< Frames per second since start */
+    double    bytes_per_s;   /**< JPEG bytes per second since start */
+} spm_cam_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a FIFO camera capture object.
+ *
+ * Allocates the buffer pool; the device is not touched until
+ * spm_cam_start().
+ *
+ * @param dev      Device handle
+ * @param cfg      Configuration (NULL = defaults)
+ * @param out_cam  Output: capture handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_cam_create(
+    spm_device_t *dev,
+    const spm_cam_cfg_t *cfg,
+    spm_cam_t **out_cam
+);
+
+/**
+ * @brief Start the background capture thread.
+ *
+ * While running, the thread owns the device.
+ *
+ * @param cam  Capture handle
+ *
+ * @return SPM_OK on success, SPM_ESTATE if already running
+ */
+spm_ecode_t spm_cam_start(
+    spm_cam_t *cam
+);
+
+/**
+ * @brief Stop the capture thread and wait for it to exit.
+ *
+ * Ready frames remain available to spm_cam_acquire().
+ *
+ * @param cam  Capture handle
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_cam_stop(
+    spm_cam_t *cam
+);
+
+/**
+ * @brief Stop and free a capture object.
+ *
+ * @param cam  Capture handle (may be NULL)
+ */
+void spm_cam_destroy(
+    spm_cam_t *cam
+);
+
+/* ====================================================== */
+/* ====================== Handoff ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Take the oldest captured frame.
+ *
+ * The frame belongs to the caller until spm_cam_release().
+ *
+ * @param cam         Capture handle
+ * @param timeout_ms  Max wait (-1 = forever, 0 = poll)
+ * @param out_frame   Output: frame (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ETIMEOUT, SPM_ESTATE if stopped and drained,
+ *         or the error that stopped the capture thread
+ */
+spm_ecode_t spm_cam_acquire(
+    spm_cam_t *cam,
+    int timeout_ms,
+    spm_cam_frame_t *out_frame
+);
+
+/**
+ * @brief Return a frame buffer to the pool.
+ *
+ * @param cam    Capture handle
+ * @param frame  Frame from spm_cam_acquire()
+ *
+ * @return SPM_OK on success, SPM_EPARAM if the frame is not held
+ */
+spm_ecode_t spm_cam_release(
+    spm_cam_t *cam,
+    const spm_cam_frame_t *frame
+);
+
+/**
+ * @brief Snapshot of the capture counters.
+ *
+ * @param cam        Capture handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_cam_get_stats(
+    spm_cam_t *cam,
+    spm_cam_stats_t *out_stats
+);
+
+/* ====================================================== */
+/* ====================== Scanning ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Locate the JPEG image (SOI FF D8 ... EOI FF D9) in a buffer.
+ *
+ * Uses AVX2/SSE2 (runtime dispatch) or NEON kernels that test 16-32
+ * byte pairs per step.
+ *
+ * @param buf      Raw FIFO bytes
+ * @param len      Bytes in buf
+ * @param out_off  Output: offset of SOI (must not be NULL)
+ * @param out_len  Output: bytes up to and including EOI (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM, or SPM_EIO if no complete image was found
+ */
+spm_ecode_t spm_cam_find_jpeg(
+    const uint8_t *buf,
+    size_t len,
+    size_t *out_off,
+    size_t *out_len
+);
+
+/**
+ * @brief Name of the marker scan kernel selected on this CPU.
+ *
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char *spm_cam_kernel(
+    void
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMCAM_H */
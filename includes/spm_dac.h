@@ -0,0 +1,192 @@
+#ifndef SPMDAC_H
+#define SPMDAC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_dac spm_dac_t;
+
+/**
+ * @brief DAC playback configuration.
+ *
+ * Every sample becomes one command word of word_len bytes, sent MSB
+ * first: cmd | (sample << data_shift). E.g. an MCP4921 (12-bit, gain 1,
+ * buffered) uses word_len = 2, bits = 12, cmd = 0x7000.
+ *
+ * spidev counts each word rounded up to SPM_BUFSIZ_ALIGN, so a message
+ * holds at most bufsiz / SPM_BUFSIZ_COST(word_len) samples (32 with
+ * the default bufsiz) and never more than SPM_MAX_BATCH_XFERS.
+ */
+typedef struct {
+    uint8_t   word_len;         /**< Bytes per command word (1..4) */
+    uint8_t   bits;             /**< Sample bits (1..32) */
+    uint8_t   data_shift;       /**< Bit position of the sample in the word */
+    uint32_t  cmd;              /**< Constant bits OR'd into every word (channel, gain, ...) */
+    uint32_t  sample_rate_hz;   /**< Target sample rate (must be > 0) */
+    size_t    ring_len;         /**< Ring capacity in samples (0 = 4096) */
+    uint16_t  samples_per_msg;  /**< Samples per SPI_IOC_MESSAGE (0 = 64 or as many as fit bufsiz) */
+    size_t    bufsiz;           /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+} spm_dac_cfg_t;
+
+/**
+ * @brief Playback counters.
+ */
+typedef struct {
+    uint64_t  samples;        /**< Samples sent */
+    uint64_t  messages;       /**< SPI messages issued */
+    uint64_t  underruns;      /**< Times the ring ran empty while playing */
+    uint64_t  errors;         /**< Failed messages */
+    uint16_t  delay_usecs;    /**< Kernel delay after each sample */
+    double    paced_rate_hz;  /**< Rate implied by word time and delay */
+    double    rate_hz;        /**< Measured samples/s since start */
+} spm_dac_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a playback engine.
+ *
+ * Reads the device speed once to derive the per-sample delay that
+ * paces samples inside the kernel: each sample is its own CS frame
+ * followed by delay_usecs, samples_per_msg frames per message.
+ *
+ * @param dev      Device handle
+ * @param cfg      Configuration (must not be NULL)
+ * @param out_dac  Output: engine handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ *
+ * @note Pacing resolution is 1 us; driver CS handling adds to it
+ */
+spm_ecode_t spm_dac_create(
+    spm_device_t *dev,
+    const spm_dac_cfg_t *cfg,
+    spm_dac_t **out_dac
+);
+
+/**
+ * @brief Start the playback thread.
+ *
+ * While running, the thread owns the device.
+ *
+ * @param dac  Engine handle
+ *
+ * @return SPM_OK on success, SPM_ESTATE if already running
+ */
+spm_ecode_t spm_dac_start(
+    spm_dac_t *dac
+);
+
+/**
+ * @brief Stop playback after the message in flight.
+ *
+ * Samples still in the ring are kept for the next start.
+ *
+ * @param dac  Engine handle
+ *
+ * @return SPM_OK, or the error that stopped playback
+ */
+spm_ecode_t spm_dac_stop(
+    spm_dac_t *dac
+);
+
+/**
+ * @brief Stop and free an engine.
+ *
+ * @param dac  Engine handle (may be NULL)
+ */
+void spm_dac_destroy(
+    spm_dac_t *dac
+);
+
+/* ====================================================== */
+/* ====================== Samples ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Queue samples for streaming playback.
+ *
+ * Samples are encoded into command words as they enter the ring.
+ *
+ * @param dac          Engine handle
+ * @param samples      Sample values (low bits used)
+ * @param n            Number of samples
+ * @param timeout_ms   Max wait for ring space (-1 = forever, 0 = no wait)
+ * @param out_written  Output: samples queued (may be NULL)
+ *
+ * @return SPM_OK if all were queued, SPM_ETIMEOUT if only part fit,
+ *         or the error that stopped playback
+ */
+spm_ecode_t spm_dac_write(
+    spm_dac_t *dac,
+    const uint32_t *samples,
+    size_t n,
+    int timeout_ms,
+    size_t *out_written
+);
+
+/**
+ * @brief Replay a precomputed waveform in a loop.
+ *
+ * The table is encoded once and played instead of the ring until
+ * replaced or cleared. Only allowed while stopped.
+ *
+ * @param dac      Engine handle
+ * @param samples  One period of the waveform (NULL = back to streaming)
+ * @param n        Number of samples
+ *
+ * @return SPM_OK on success, SPM_ESTATE if running, error code otherwise
+ */
+spm_ecode_t spm_dac_load_loop(
+    spm_dac_t *dac,
+    const uint32_t *samples,
+    size_t n
+);
+
+/**
+ * @brief Encode samples into command words.
+ *
+ * @param cfg      Word format (must not be NULL)
+ * @param samples  Sample values
+ * @param n        Number of samples
+ * @param out      Output: n * word_len bytes
+ *
+ * @return SPM_OK on success, SPM_EPARAM on invalid input
+ */
+spm_ecode_t spm_dac_encode(
+    const spm_dac_cfg_t *cfg,
+    const uint32_t *samples,
+    size_t n,
+    uint8_t *out
+);
+
+/**
+ * @brief Snapshot of the playback counters.
+ *
+ * @param dac        Engine handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_dac_get_stats(
+    spm_dac_t *dac,
+    spm_dac_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMDAC_H */
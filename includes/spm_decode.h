@@ -0,0 +1,110 @@
+#ifndef SPMDECODE_H
+#define SPMDECODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spm_error.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+/**
+ * @brief Packed sample format of a receive buffer.
+ *
+ * A frame is header_len bytes (status, channel tag, command echo)
+ * followed by channels interleaved samples of container bytes each.
+ * A sample occupies bits [shift, shift + bits) of its container, e.g.
+ * an 18-bit left-justified sample in 3 bytes has bits = 18, shift = 6.
+ */
+typedef struct {
+    uint8_t  bits;           /**< Significant bits per sample (1..32) */
+    uint8_t  container;      /**< Bytes per sample on the wire (1..4) */
+    uint8_t  shift;          /**< Bit offset of the sample in its container */
+    bool     little_endian;  /**< Byte order (false = big-endian, the SPI norm) */
+    bool     is_signed;      /**< Two's complement */
+    uint8_t  header_len;     /**< Bytes to skip at the start of each frame */
+    uint8_t  channels;       /**< Samples per frame (0 = 1) */
+    size_t   stride;         /**< Bytes between frames (0 = packed) */
+} spm_fmt_t;
+
+/* ====================================================== */
+/* ====================== Decoding ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Decode frames into per-channel int32 arrays.
+ *
+ * Deinterleaves channel c of every frame into out[c] (structure of
+ * arrays). Headerless frames use SIMD kernels (AVX2, SSSE3 or NEON,
+ * picked at runtime); other layouts use the scalar path.
+ *
+ * @param fmt      Sample format (must not be NULL)
+ * @param src      Receive buffer, nframes * stride bytes
+ * @param nframes  Number of frames
+ * @param out      One array of nframes entries per channel
+ *
+ * @return SPM_OK on success, SPM_EPARAM on invalid format or buffers
+ *
+ * @note Unsigned 32-bit samples above INT32_MAX wrap
+ */
+spm_ecode_t spm_decode_i32(
+    const spm_fmt_t *fmt,
+    const void *src,
+    size_t nframes,
+    int32_t *const *out
+);
+
+/**
+ * @brief Decode frames into per-channel float arrays.
+ *
+ * Same as spm_decode_i32() followed by out = sample * scale + offset.
+ *
+ * @param fmt      Sample format (must not be NULL)
+ * @param src      Receive buffer, nframes * stride bytes
+ * @param nframes  Number of frames
+ * @param out      One array of nframes entries per channel
+ * @param scale    Multiplier, e.g. vref / 2^(bits-1)
+ * @param offset   Added after scaling
+ *
+ * @return SPM_OK on success, SPM_EPARAM on invalid format or buffers
+ */
+spm_ecode_t spm_decode_f32(
+    const spm_fmt_t *fmt,
+    const void *src,
+    size_t nframes,
+    float *const *out,
+    float scale,
+    float offset
+);
+
+/**
+ * @brief Bytes per frame of a format.
+ *
+ * @param fmt  Sample format
+ *
+ * @return stride, or the packed frame size if stride is 0; 0 if fmt is NULL
+ */
+size_t spm_fmt_frame_len(
+    const spm_fmt_t *fmt
+);
+
+/**
+ * @brief Name of the SIMD kernel selected on this CPU.
+ *
+ * @return "avx2", "ssse3", "neon" or "scalar"
+ */
+const char *spm_decode_kernel(
+    void
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMDECODE_H */
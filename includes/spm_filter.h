@@ -0,0 +1,168 @@
+#ifndef SPMFILTER_H
+#define SPMFILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spm_error.h"
+#include "spm_decode.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_filter spm_filter_t;
+
+/**
+ * @brief Filter kind.
+ */
+typedef enum {
+    SPM_FILTER_MOVAVG = 0,  /**< Moving average over len samples */
+    SPM_FILTER_CIC    = 1,  /**< Cascaded integrator-comb, order stages */
+    SPM_FILTER_FIR    = 2,  /**< FIR with caller-supplied taps */
+} spm_filter_type_t;
+
+/**
+ * @brief Decimating filter configuration.
+ *
+ * Every channel is filtered independently and one output is produced
+ * per decim inputs. Outputs are float and multiplied by scale; moving
+ * average and CIC outputs are normalized to unity DC gain, FIR taps
+ * are applied as given.
+ */
+typedef struct {
+    spm_filter_type_t  type;
+    uint32_t           decim;      /**< Decimation ratio (0 = 1) */
+    uint8_t            channels;   /**< Channels (0 = 1) */
+    float              scale;      /**< Output scale, e.g. vref / 2^(bits-1) (0 = 1) */
+    uint32_t           len;        /**< MOVAVG window (0 = decim) */
+    uint8_t            stages;     /**< CIC order (1..6, 0 = 3) */
+    const float       *taps;       /**< FIR coefficients (copied) */
+    size_t             ntaps;      /**< FIR length */
+    const spm_fmt_t   *fmt;        /**< Input format for spm_filter_acq_process() (copied, may be NULL) */
+} spm_filter_cfg_t;
+
+/**
+ * @brief Cost counters.
+ */
+typedef struct {
+    uint64_t  calls;        /**< Process calls */
+    uint64_t  in_samples;   /**< Input samples, all channels */
+    uint64_t  out_samples;  /**< Output samples, all channels */
+    uint64_t  ns;           /**< Time spent filtering (excluding decode) */
+    uint64_t  decode_ns;    /**< Time spent decoding in spm_filter_acq_process() */
+} spm_filter_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a decimating filter.
+ *
+ * @param cfg    Configuration (must not be NULL)
+ * @param out_f  Output: filter handle (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM on invalid config, SPM_ENOMEM
+ */
+spm_ecode_t spm_filter_create(
+    const spm_filter_cfg_t *cfg,
+    spm_filter_t **out_f
+);
+
+/**
+ * @brief Clear filter history and phase.
+ *
+ * @param f  Filter handle
+ */
+void spm_filter_reset(
+    spm_filter_t *f
+);
+
+/**
+ * @brief Free a filter.
+ *
+ * @param f  Filter handle (may be NULL)
+ */
+void spm_filter_destroy(
+    spm_filter_t *f
+);
+
+/* ====================================================== */
+/* ===================== Processing ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Filter and decimate per-channel samples.
+ *
+ * State carries over between calls, so a stream may be fed in blocks
+ * of any size. FIR dot products use AVX2/FMA, SSE or NEON kernels
+ * picked at runtime; CIC and moving average run exact integer
+ * recursions.
+ *
+ * @param f      Filter handle
+ * @param in     One array of n samples per channel (e.g. spm_decode_i32() output)
+ * @param n      Input samples per channel
+ * @param out    One array per channel, room for n / decim + 1 outputs
+ * @param out_n  Output: samples written per channel (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM on invalid input
+ */
+spm_ecode_t spm_filter_process(
+    spm_filter_t *f,
+    const int32_t *const *in,
+    size_t n,
+    float *const *out,
+    size_t *out_n
+);
+
+/**
+ * @brief Acquisition process hook: decode, filter and decimate in place.
+ *
+ * Pass as spm_acq_cfg_t.process with the filter as context (requires
+ * cfg.fmt). Replaces the block contents with interleaved float frames
+ * (channels floats each) and shortens the block accordingly.
+ *
+ * @param ctx   Filter handle
+ * @param data  Block data
+ * @param len   In: raw bytes, out: filtered bytes
+ *
+ * @return SPM_OK on success, SPM_EPARAM if the output would not fit
+ */
+spm_ecode_t spm_filter_acq_process(
+    void *ctx,
+    uint8_t *data,
+    size_t *len
+);
+
+/**
+ * @brief Snapshot of the cost counters.
+ *
+ * @param f          Filter handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_filter_get_stats(
+    const spm_filter_t *f,
+    spm_filter_stats_t *out_stats
+);
+
+/**
+ * @brief Name of the FIR kernel selected on this CPU.
+ *
+ * @return "avx2", "sse", "neon" or "scalar"
+ */
+const char *spm_filter_kernel(
+    void
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMFILTER_H */
@@ -0,0 +1,176 @@
+#ifndef SPMGATHER_H
+#define SPMGATHER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_gather_plan spm_gather_plan_t;
+
+/**
+ * @brief One read of a gather.
+ */
+typedef struct {
+    uint32_t  addr;          /**< Device address */
+    size_t    len;           /**< Bytes (> 0) */
+    void     *dst;           /**< Destination (must not be NULL) */
+} spm_gather_req_t;
+
+/**
+ * @brief Read framing and cost model.
+ *
+ * Every frame is one CS assertion: the opcode (unless addr_only), the
+ * address big-endian with addr_mask OR'ed in, dummy bytes, then data
+ * from consecutive addresses. That covers SPI NOR reads and register
+ * devices with auto-increment.
+ */
+typedef struct {
+    uint8_t   read_cmd;      /**< Opcode before the address (0 = 0x03) */
+    bool      addr_only;     /**< No opcode, the frame starts with the address */
+    uint8_t   addr_bytes;    /**< Address bytes, 1..4 (0 = 3) */
+    uint32_t  addr_mask;     /**< OR'ed into the sent address, e.g. 0x80 as a register read bit */
+    uint8_t   dummy_bytes;   /**< Dummy bytes after the address */
+    uint32_t  frame_ns;      /**< Cost of a frame beyond its bytes: CS gap, descriptor setup
+                                  (0 = 1000, see spm_gather_calibrate()) */
+    size_t    max_msg;       /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+} spm_gather_cfg_t;
+
+/**
+ * @brief What a plan issues.
+ */
+typedef struct {
+    size_t    requests;
+    size_t    spans;         /**< Address ranges after merging */
+    size_t    frames;        /**< CS frames (a span longer than a message is split) */
+    size_t    messages;      /**< spm_batch() calls per read */
+    uint64_t  bytes_wanted;  /**< Sum of request lengths */
+    uint64_t  bytes_read;    /**< Data bytes clocked, including gaps read through */
+    uint64_t  est_ns;        /**< Modeled bus time of the plan's frames */
+    uint64_t  est_split_ns;  /**< Same with one frame per request */
+} spm_gather_info_t;
+
+/* ====================================================== */
+/* ===================== Read Plans ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Prepare a reusable sparse read.
+ *
+ * Sorts the requests by address and merges neighbours when clocking
+ * the gap between them costs less than another frame: its opcode,
+ * address and dummy bytes plus cfg->frame_ns, at the device's current
+ * speed. Overlapping and adjacent requests always merge. A frame
+ * carries at most max_msg rounded down to SPM_BUFSIZ_ALIGN data bytes,
+ * and frames are packed into as few messages as SPM_MAX_BATCH_XFERS and
+ * spidev's bufsiz accounting allow: header and data sums, each
+ * transfer rounded up to SPM_BUFSIZ_ALIGN, stay within max_msg. A span holding a single request is read straight into its
+ * destination; merged spans go through a plan buffer and are copied
+ * out.
+ *
+ * @param dev       Device (for its speed)
+ * @param cfg       Framing and costs (NULL = 0x03 with 3 address bytes)
+ * @param reqs      Requests, any order; copied
+ * @param count     Number of requests (must be > 0)
+ * @param out_plan  Output: plan handle (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM if a request is empty or runs past the
+ *         address space or max_msg is below SPM_BUFSIZ_ALIGN, SPM_ENOMEM
+ */
+spm_ecode_t spm_gather_plan_create(
+    spm_device_t *dev,
+    const spm_gather_cfg_t *cfg,
+    const spm_gather_req_t *reqs,
+    size_t count,
+    spm_gather_plan_t **out_plan
+);
+
+/**
+ * @brief Execute a prepared read and fill every request's destination.
+ *
+ * @param dev   Device handle
+ * @param plan  Plan handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_gather_plan_read(
+    spm_device_t *dev,
+    spm_gather_plan_t *plan
+);
+
+/**
+ * @brief Describe a plan.
+ *
+ * @param plan      Plan handle
+ * @param out_info  Output: plan shape and cost (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_gather_plan_get_info(
+    const spm_gather_plan_t *plan,
+    spm_gather_info_t *out_info
+);
+
+/**
+ * @brief Free a plan.
+ *
+ * @param plan  Plan handle (may be NULL)
+ */
+void spm_gather_plan_destroy(
+    spm_gather_plan_t *plan
+);
+
+/* ====================================================== */
+/* ================== One-Shot Access =================== */
+/* ====================================================== */
+
+/**
+ * @brief Plan, execute and free a sparse read.
+ *
+ * @param dev    Device handle
+ * @param cfg    Framing and costs (NULL = defaults)
+ * @param reqs   Requests (must not be NULL)
+ * @param count  Number of requests (must be > 0)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_gather_read(
+    spm_device_t *dev,
+    const spm_gather_cfg_t *cfg,
+    const spm_gather_req_t *reqs,
+    size_t count
+);
+
+/**
+ * @brief Measure the per-frame cost on this device.
+ *
+ * Times one long frame against the same bytes split into several
+ * frames (reads at address 0) and returns the difference per extra
+ * frame, less its opcode and address bytes. Store the result in
+ * cfg->frame_ns.
+ *
+ * @param dev           Device handle
+ * @param cfg           Framing (NULL = defaults)
+ * @param out_frame_ns  Output: nanoseconds (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_gather_calibrate(
+    spm_device_t *dev,
+    const spm_gather_cfg_t *cfg,
+    uint32_t *out_frame_ns
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMGATHER_H */
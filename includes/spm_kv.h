@@ -0,0 +1,250 @@
+#ifndef SPMKV_H
+#define SPMKV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+#define SPM_KV_MAX_KEY  255
+
+typedef struct spm_kv spm_kv_t;
+
+/**
+ * @brief Key-value store configuration.
+ *
+ * The store owns sectors [base, base + sectors * sector_size) of a
+ * 3-byte-address SPI NOR (READ 0x03, WREN 0x06, PP 0x02, SE 0x20,
+ * RDSR 0x05). Records are only ever appended; a sector is erased once
+ * garbage collection has moved its live records out.
+ */
+typedef struct {
+    uint32_t  base;              /**< Flash offset of the first sector (multiple of sector_size) */
+    uint32_t  sectors;           /**< Sectors in the log (>= 3) */
+    uint32_t  sector_size;       /**< Erase unit, power of two (0 = 4096) */
+    uint32_t  page_size;         /**< Program unit, power of two <= sector_size (0 = 256) */
+    uint32_t  gc_free;           /**< Erased sectors background GC keeps ready (0 = 2) */
+    uint32_t  idle_us;           /**< Quiet time before background work (0 = 5000) */
+    int       prog_timeout_ms;   /**< Page program busy timeout (0 = 20) */
+    int       erase_timeout_ms;  /**< Sector erase busy timeout (0 = 2000) */
+} spm_kv_cfg_t;
+
+/**
+ * @brief Store counters and wear statistics.
+ */
+typedef struct {
+    uint32_t  keys;
+    uint32_t  sectors_free;      /**< Erased, ready for appends */
+    uint32_t  sectors_dirty;     /**< Collected, waiting for an erase */
+    uint64_t  live_bytes;        /**< Record bytes still referenced by the index */
+    uint64_t  dead_bytes;        /**< Superseded records and tombstones */
+    uint64_t  puts;
+    uint64_t  deletes;
+    uint64_t  gets;
+    uint64_t  bytes_written;     /**< Programmed by puts and deletes */
+    uint64_t  gc_bytes;          /**< Programmed by relocation */
+    uint64_t  gc_runs;           /**< Sectors collected */
+    uint64_t  fg_gc_runs;        /**< Puts that had to collect or erase first */
+    uint64_t  erases;
+    uint64_t  erase_wait_ns;     /**< Foreground time spent waiting for an erase */
+    uint64_t  crc_errors;        /**< Records skipped or rejected for a bad CRC */
+    uint64_t  mount_ns;          /**< Time of the mount scan */
+    uint64_t  mount_bytes;       /**< Bytes read by the mount scan */
+    uint32_t  erase_min;         /**< Lowest per-sector erase count */
+    uint32_t  erase_max;         /**< Highest per-sector erase count */
+    double    erase_mean;
+} spm_kv_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Mount a store on an open flash device.
+ *
+ * Reads all sector headers in one message, then each used sector in
+ * one message, and rebuilds the in-RAM index from the records in log
+ * order. Records with a bad CRC (torn writes) are skipped. Blank
+ * sectors are used as they are; sectors holding anything else are
+ * queued for erase.
+ *
+ * @param dev     Device handle (SPI mode 0)
+ * @param cfg     Configuration (must not be NULL: sectors is required)
+ * @param out_kv  Output: store handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_kv_create(
+    spm_device_t *dev,
+    const spm_kv_cfg_t *cfg,
+    spm_kv_t **out_kv
+);
+
+/**
+ * @brief Stop background work and free a store (the device stays open).
+ *
+ * An erase in progress is waited for.
+ *
+ * @param kv  Store handle (may be NULL)
+ */
+void spm_kv_destroy(
+    spm_kv_t *kv
+);
+
+/**
+ * @brief Erase every sector and drop all keys.
+ *
+ * @param kv  Store handle
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_kv_format(
+    spm_kv_t *kv
+);
+
+/* ====================================================== */
+/* ====================== Records ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Store a value.
+ *
+ * Appends one CRC-protected record. If no erased sector is left the
+ * call collects and erases one itself (counted in fg_gc_runs).
+ *
+ * @param kv   Store handle
+ * @param key  NUL-terminated key (1..SPM_KV_MAX_KEY bytes)
+ * @param val  Value bytes (may be NULL if len is 0)
+ * @param len  Value size (the record must fit in one sector)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ENOMEM if live data fills the store
+ */
+spm_ecode_t spm_kv_put(
+    spm_kv_t *kv,
+    const char *key,
+    const void *val,
+    size_t len
+);
+
+/**
+ * @brief Read a value.
+ *
+ * @param kv       Store handle
+ * @param key      NUL-terminated key
+ * @param out      Destination (may be NULL if cap is 0)
+ * @param cap      Destination size
+ * @param out_len  Output: value size (may be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM if the key is not stored, SPM_ENOMEM if
+ *         cap is too small (out_len still set), SPM_ECRC
+ */
+spm_ecode_t spm_kv_get(
+    spm_kv_t *kv,
+    const char *key,
+    void *out,
+    size_t cap,
+    size_t *out_len
+);
+
+/**
+ * @brief Remove a key by appending a tombstone.
+ *
+ * @param kv   Store handle
+ * @param key  NUL-terminated key
+ *
+ * @return SPM_OK, SPM_EPARAM if the key is not stored, SPM_ENOMEM
+ */
+spm_ecode_t spm_kv_delete(
+    spm_kv_t *kv,
+    const char *key
+);
+
+/* ====================================================== */
+/* ==================== Maintenance ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Start the background maintenance thread.
+ *
+ * Once no store call has been made for idle_us, the thread erases
+ * collected sectors and, while fewer than gc_free sectors are erased
+ * and enough garbage has built up, collects the oldest sector. An
+ * erase is started and then polled without holding the store, so
+ * calls arriving meanwhile wait only for the erase still running.
+ *
+ * @param kv  Store handle
+ *
+ * @return SPM_OK, SPM_ESTATE if already started
+ */
+spm_ecode_t spm_kv_start(
+    spm_kv_t *kv
+);
+
+/**
+ * @brief Stop the background thread (an erase in progress completes).
+ *
+ * @param kv  Store handle
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_kv_stop(
+    spm_kv_t *kv
+);
+
+/**
+ * @brief Do one unit of background work now.
+ *
+ * For callers that schedule flash maintenance into their own idle
+ * slots: erases one collected sector or collects one, waiting for it.
+ *
+ * @param kv        Store handle
+ * @param out_more  Output: work remains (may be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_kv_maintain(
+    spm_kv_t *kv,
+    bool *out_more
+);
+
+/**
+ * @brief Snapshot of the store counters.
+ *
+ * @param kv         Store handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_kv_get_stats(
+    spm_kv_t *kv,
+    spm_kv_stats_t *out_stats
+);
+
+/**
+ * @brief Per-sector erase counts.
+ *
+ * @param kv          Store handle
+ * @param out_counts  Output: one count per sector
+ * @param count       Entries in out_counts (must equal cfg.sectors)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_kv_get_erase_counts(
+    spm_kv_t *kv,
+    uint32_t *out_counts,
+    size_t count
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMKV_H */
@@ -0,0 +1,229 @@
+#ifndef SPMLIVE_H
+#define SPMLIVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+#define SPM_LIVE_SLOTS      32      /**< Devices per process */
+#define SPM_LIVE_BUCKETS    32      /**< Latency buckets: b counts ioctl times in [2^b, 2^(b+1)) ns */
+#define SPM_LIVE_NAME_MAX   32
+#define SPM_LIVE_SHM_PREFIX "spm-live."  /**< Segment name is the prefix and the pid */
+
+typedef struct spm_live_slot spm_live_slot_t;
+typedef struct spm_live_view spm_live_view_t;
+
+/**
+ * @brief Publishing process, as stored in its segment.
+ */
+typedef struct {
+    pid_t     pid;
+    char      name[SPM_LIVE_NAME_MAX];
+    uint64_t  start_ns;                 /**< CLOCK_MONOTONIC at spm_live_start() */
+} spm_live_proc_t;
+
+/**
+ * @brief Counters of one published device.
+ *
+ * Counters are totals since the device was attached; a monitor takes
+ * rates and percentiles from the difference of two reads.
+ */
+typedef struct {
+    char      path[SPM_PATH_MAX];
+    uint64_t  messages;                 /**< Data messages, one syscall each */
+    uint64_t  xfers;
+    uint64_t  bytes;                    /**< Bytes clocked (each direction) */
+    uint64_t  errors;                   /**< Messages that failed */
+    uint64_t  wire_ns;                  /**< Estimated clock time */
+    uint64_t  ioctl_ns;                 /**< Measured time in the driver call */
+    uint64_t  hist[SPM_LIVE_BUCKETS];   /**< Driver call latency histogram */
+    uint32_t  inflight;                 /**< Callers inside the driver call now */
+    uint32_t  wc_pending;               /**< Writes waiting in the write-combining batch now */
+} spm_live_dev_t;
+
+/* ====================================================== */
+/* ===================== Publishing ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Create this process's stats segment.
+ *
+ * The segment is a POSIX shared-memory object named after the pid
+ * (/dev/shm/spm-live.<pid>). Devices appear in it once attached with
+ * spm_dev_set_live(). Segments left behind by processes that have
+ * exited are removed.
+ *
+ * @param name  Label shown by monitors (NULL = the program name)
+ *
+ * @return SPM_OK, SPM_ESTATE if already started, SPM_EIO if the segment
+ *         cannot be created
+ */
+spm_ecode_t spm_live_start(
+    const char *name
+);
+
+/**
+ * @brief Remove this process's stats segment.
+ *
+ * @return SPM_OK, SPM_ESTATE if not started or devices are still attached
+ */
+spm_ecode_t spm_live_stop(
+    void
+);
+
+/**
+ * @brief Claim a device slot (used by spm_dev_set_live()).
+ *
+ * @param path      Device path shown by monitors
+ * @param out_slot  Output: slot (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ESTATE if not started, SPM_ENOMEM if all
+ *         SPM_LIVE_SLOTS are taken
+ */
+spm_ecode_t spm_live_slot_claim(
+    const char *path,
+    spm_live_slot_t **out_slot
+);
+
+/**
+ * @brief Release a device slot.
+ *
+ * @param slot  Slot (may be NULL)
+ */
+void spm_live_slot_release(
+    spm_live_slot_t *slot
+);
+
+/**
+ * @brief Add one message to a slot.
+ *
+ * Writers serialize on the slot's sequence word, which readers also
+ * use to detect a torn copy; no lock is shared with the reader.
+ *
+ * @param slot      Slot
+ * @param xfers     Transfers in the message
+ * @param bytes     Bytes clocked
+ * @param wire_ns   Estimated clock time
+ * @param ioctl_ns  Measured driver call time
+ * @param failed    The message failed
+ */
+void spm_live_slot_record(
+    spm_live_slot_t *slot,
+    size_t xfers,
+    uint64_t bytes,
+    uint64_t wire_ns,
+    uint64_t ioctl_ns,
+    bool failed
+);
+
+/**
+ * @brief Adjust the in-flight gauge by +1 or -1.
+ */
+void spm_live_slot_inflight(
+    spm_live_slot_t *slot,
+    int delta
+);
+
+/**
+ * @brief Set the write-combining queue gauge.
+ */
+void spm_live_slot_set_pending(
+    spm_live_slot_t *slot,
+    uint32_t pending
+);
+
+/* ====================================================== */
+/* ====================== Reading ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Processes with a live stats segment.
+ *
+ * @param out_pids   Output: pids (may be NULL if cap is 0)
+ * @param cap        Entries in out_pids
+ * @param out_count  Output: number of publishing processes (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ENOMEM if cap is too small (the first cap
+ *         entries and out_count are set), SPM_EIO
+ */
+spm_ecode_t spm_live_list(
+    pid_t *out_pids,
+    size_t cap,
+    size_t *out_count
+);
+
+/**
+ * @brief Map a process's segment read-only.
+ *
+ * @param pid       Publishing process
+ * @param out_view  Output: view (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ENODEV if the process publishes nothing,
+ *         SPM_ECONFIG if the segment has another layout version
+ */
+spm_ecode_t spm_live_attach(
+    pid_t pid,
+    spm_live_view_t **out_view
+);
+
+/**
+ * @brief Unmap a view.
+ *
+ * @param view  View (may be NULL)
+ */
+void spm_live_detach(
+    spm_live_view_t *view
+);
+
+/**
+ * @brief Consistent snapshot of every attached device of a process.
+ *
+ * Each device is copied under its sequence word and retried while a
+ * writer is inside; the copy never blocks the writer.
+ *
+ * @param view      View
+ * @param out_proc  Output: process info (may be NULL)
+ * @param out_devs  Output: devices in slot order (may be NULL if cap is 0)
+ * @param cap       Entries in out_devs
+ * @param out_count Output: attached devices (must not be NULL)
+ *
+ * @return SPM_OK, SPM_ENOMEM if cap is too small, SPM_EAGAIN if a
+ *         slot stayed mid-update (its writer died), SPM_ENODEV if the
+ *         process has stopped publishing
+ */
+spm_ecode_t spm_live_read(
+    spm_live_view_t *view,
+    spm_live_proc_t *out_proc,
+    spm_live_dev_t *out_devs,
+    size_t cap,
+    size_t *out_count
+);
+
+/**
+ * @brief Latency percentile from a histogram (or a difference of two).
+ *
+ * @param hist  Bucket counts
+ * @param q     Quantile, 0..1
+ *
+ * @return Upper bound of the bucket holding the quantile in ns (0 if empty)
+ */
+uint64_t spm_live_percentile(
+    const uint64_t hist[SPM_LIVE_BUCKETS],
+    double q
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMLIVE_H */
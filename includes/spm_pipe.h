@@ -0,0 +1,215 @@
+#ifndef SPMPIPE_H
+#define SPMPIPE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+#include "spm_acq.h"
+#include "spm_reg.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_pipe spm_pipe_t;
+
+/**
+ * @brief Frame passed between stages.
+ *
+ * Frames are preallocated with frame_cap bytes and recycled; a stage
+ * owns a frame only for the duration of its callback.
+ */
+typedef struct {
+    uint8_t   *data;
+    size_t     len;     /**< Valid bytes */
+    size_t     cap;     /**< Capacity (frame_cap) */
+    uint64_t   seq;     /**< Source sequence number */
+    uint64_t   t_ns;    /**< CLOCK_MONOTONIC time the source produced it */
+} spm_pipe_frame_t;
+
+/**
+ * @brief Stage callback.
+ *
+ * Sources get in = NULL and fill out, sinks get out = NULL, transforms
+ * read in and fill out. Returning SPM_EAGAIN from a source produces no
+ * frame; any other error stops the pipeline.
+ */
+typedef spm_ecode_t (*spm_pipe_fn)(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out);
+
+/**
+ * @brief Stage declaration.
+ *
+ * Set fn, or process for an in-place transform (same signature as the
+ * acquisition hook, e.g. spm_filter_acq_process()).
+ */
+typedef struct {
+    const char         *name;
+    spm_pipe_fn         fn;
+    spm_acq_process_fn  process;
+    void               *ctx;
+    bool                pin;      /**< Pin the stage thread to cpu */
+    int                 cpu;
+} spm_pipe_stage_t;
+
+/**
+ * @brief Pipeline configuration.
+ */
+typedef struct {
+    size_t  frame_cap;       /**< Bytes per frame (must be > 0) */
+    size_t  depth;           /**< Frames per queue between two stages (0 = 4) */
+    bool    drop_when_full;  /**< Source drops frames instead of waiting on a full queue */
+} spm_pipe_cfg_t;
+
+/**
+ * @brief Per-stage counters.
+ */
+typedef struct {
+    uint64_t  frames;        /**< Frames produced or consumed */
+    uint64_t  busy_ns;       /**< Time inside the callback */
+    uint64_t  wait_in_ns;    /**< Time waiting for input */
+    uint64_t  wait_out_ns;   /**< Time waiting for a free output frame (backpressure) */
+    uint64_t  stalls;        /**< Times the output queue was full */
+    uint64_t  dropped;       /**< Frames dropped (source, drop_when_full) */
+    uint64_t  lat_ns_sum;    /**< Sum of source-to-here latency */
+    uint64_t  lat_ns_max;    /**< Max source-to-here latency */
+} spm_pipe_stats_t;
+
+/**
+ * @brief Context of spm_pipe_src_read().
+ */
+typedef struct {
+    spm_device_t *dev;
+    const void   *tx;    /**< Bytes to send (NULL = dummy) */
+    size_t        len;   /**< Bytes per frame */
+} spm_pipe_read_src_t;
+
+/**
+ * @brief Context of spm_pipe_src_plan().
+ */
+typedef struct {
+    spm_device_t   *dev;
+    spm_reg_plan_t *plan;
+    size_t          count;   /**< Registers in the plan (bytes per frame) */
+} spm_pipe_plan_src_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Build a linear pipeline.
+ *
+ * stages[0] is the source, stages[n - 1] the sink. Neighbouring stages
+ * are connected by lock-free single-producer/single-consumer queues of
+ * preallocated frames, one thread per stage.
+ *
+ * @param cfg       Configuration (must not be NULL)
+ * @param stages    Stage declarations (copied)
+ * @param nstages   Number of stages (>= 2)
+ * @param out_pipe  Output: pipeline handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_pipe_create(
+    const spm_pipe_cfg_t *cfg,
+    const spm_pipe_stage_t *stages,
+    size_t nstages,
+    spm_pipe_t **out_pipe
+);
+
+/**
+ * @brief Start all stage threads.
+ *
+ * @param pipe  Pipeline handle
+ *
+ * @return SPM_OK on success, SPM_ESTATE if running, SPM_EPARAM if a
+ *         pinned CPU does not exist
+ */
+spm_ecode_t spm_pipe_start(
+    spm_pipe_t *pipe
+);
+
+/**
+ * @brief Stop all stages and wait for their threads.
+ *
+ * Frames in flight are discarded.
+ *
+ * @param pipe  Pipeline handle
+ *
+ * @return SPM_OK, or the first error returned by a stage
+ */
+spm_ecode_t spm_pipe_stop(
+    spm_pipe_t *pipe
+);
+
+/**
+ * @brief Stop and free a pipeline.
+ *
+ * @param pipe  Pipeline handle (may be NULL)
+ */
+void spm_pipe_destroy(
+    spm_pipe_t *pipe
+);
+
+/**
+ * @brief Whether a stage has failed and the pipeline has stopped itself.
+ *
+ * @param pipe  Pipeline handle
+ *
+ * @return The first stage error, or SPM_OK
+ */
+spm_ecode_t spm_pipe_error(
+    spm_pipe_t *pipe
+);
+
+/**
+ * @brief Snapshot of one stage's counters.
+ *
+ * @param pipe       Pipeline handle
+ * @param stage      Stage index
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_pipe_get_stats(
+    spm_pipe_t *pipe,
+    size_t stage,
+    spm_pipe_stats_t *out_stats
+);
+
+/* ====================================================== */
+/* ====================== Sources ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Source: one spm_transfer() of ctx->len bytes per frame.
+ *
+ * @param ctx  spm_pipe_read_src_t
+ */
+spm_ecode_t spm_pipe_src_read(
+    void *ctx,
+    const spm_pipe_frame_t *in,
+    spm_pipe_frame_t *out
+);
+
+/**
+ * @brief Source: one spm_reg_plan_read() per frame.
+ *
+ * @param ctx  spm_pipe_plan_src_t
+ */
+spm_ecode_t spm_pipe_src_plan(
+    void *ctx,
+    const spm_pipe_frame_t *in,
+    spm_pipe_frame_t *out
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMPIPE_H */
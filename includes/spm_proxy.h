@@ -0,0 +1,152 @@
+#ifndef SPMPROXY_H
+#define SPMPROXY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spm_sys.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+/**
+ * @brief Client connection options.
+ */
+typedef struct {
+    bool      compress;       /**< PackBits-compress tx/rx payloads */
+    bool      pipeline;       /**< Send write-only calls without waiting for the reply */
+    uint32_t  max_inflight;   /**< Pipelined calls before a forced round trip (0 = 64) */
+    size_t    max_buffered;   /**< Buffered request bytes before sending (0 = 64 KiB) */
+} spm_proxy_opts_t;
+
+/**
+ * @brief Client counters.
+ */
+typedef struct {
+    uint64_t  requests;       /**< Requests sent */
+    uint64_t  pipelined;      /**< Requests sent without waiting */
+    uint64_t  round_trips;    /**< Times the client waited for replies */
+    uint64_t  bytes_tx;       /**< Bytes written to the socket */
+    uint64_t  bytes_rx;       /**< Bytes read from the socket */
+    uint64_t  payload_raw;    /**< Data bytes before compression (both directions) */
+    uint64_t  payload_wire;   /**< Data bytes on the wire (both directions) */
+} spm_proxy_stats_t;
+
+/**
+ * @brief Remote backend.
+ *
+ * Message-level sys ops that forward every open, config and transfer
+ * call over the connection established by spm_proxy_connect(). Pass
+ * it to spm_dev_open_sys_ops(); the bus/cs select the remote spidev.
+ */
+extern const spm_sys_ops_t SPM_SYS_PROXY;
+
+/* ====================================================== */
+/* ======================= Client ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Connect the remote backend to a proxy server.
+ *
+ * @param addr  "host:port" for TCP or "unix:/path" for a local socket
+ * @param opts  Options (NULL = pipelining on, compression off)
+ *
+ * @return SPM_OK on success, SPM_ENODEV if unreachable, SPM_ESTATE if
+ *         already connected
+ *
+ * @note One connection per process; the backend is serialized internally
+ */
+spm_ecode_t spm_proxy_connect(
+    const char *addr,
+    const spm_proxy_opts_t *opts
+);
+
+/**
+ * @brief Use an already connected stream socket.
+ *
+ * @param fd    Connected socket, owned by the proxy afterwards
+ * @param opts  Options (NULL = defaults)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_proxy_connect_fd(
+    int fd,
+    const spm_proxy_opts_t *opts
+);
+
+/**
+ * @brief Wait for all pipelined calls to complete.
+ *
+ * Pipelined calls return before the server has executed them; their
+ * failures are reported by the next waiting call or by this function.
+ *
+ * @return SPM_OK, or the first deferred error
+ */
+spm_ecode_t spm_proxy_flush(
+    void
+);
+
+/**
+ * @brief Flush and close the connection.
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_proxy_disconnect(
+    void
+);
+
+/**
+ * @brief Snapshot of the client counters.
+ *
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_proxy_get_stats(
+    spm_proxy_stats_t *out_stats
+);
+
+/* ====================================================== */
+/* ======================= Server ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Serve one client connection until it disconnects.
+ *
+ * Opens devices with spm_dev_open_sys_ops() on the given backend and
+ * executes requests in order. Replies to consecutive requests are
+ * coalesced into one write.
+ *
+ * @param fd    Connected stream socket (closed on return)
+ * @param sys   Backend for the real devices (NULL = SPM_SYS_DEFAULT)
+ *
+ * @return SPM_OK when the client disconnected cleanly, error code otherwise
+ */
+spm_ecode_t spm_proxy_serve_fd(
+    int fd,
+    const spm_sys_ops_t *sys
+);
+
+/**
+ * @brief Create a listening socket for spm_proxy_serve_fd().
+ *
+ * @param addr    "host:port", ":port" or "unix:/path"
+ * @param out_fd  Output: listening socket (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_proxy_listen(
+    const char *addr,
+    int *out_fd
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMPROXY_H */
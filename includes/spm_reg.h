@@ -0,0 +1,161 @@
+#ifndef SPMREG_H
+#define SPMREG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_reg_plan spm_reg_plan_t;
+
+/**
+ * @brief Register access protocol of a device.
+ *
+ * Describes the common "address byte, then data" framing used by
+ * sensors and converters with 8-bit registers. Each burst is one CS
+ * frame: the address byte (OR'ed with the masks below) followed by
+ * one data byte per register.
+ */
+typedef struct {
+    uint8_t   read_mask;       /**< OR'ed into the address for reads (e.g. 0x80) */
+    uint8_t   write_mask;      /**< OR'ed into the address for writes (e.g. 0x00) */
+    uint8_t   burst_mask;      /**< OR'ed into multi-register bursts (e.g. 0x40), 0 if none */
+    bool      auto_increment;  /**< Device advances the address within a CS frame */
+    uint8_t   max_gap;         /**< Read through holes of up to this many registers */
+    uint16_t  max_burst;       /**< Max registers per burst (0 = unlimited) */
+    size_t    bufsiz;          /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+} spm_reg_proto_t;
+
+/* ====================================================== */
+/* ===================== Read Plans ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Prepare a reusable multi-register read.
+ *
+ * Sorts the requested addresses, groups them into auto-increment
+ * bursts (reading through gaps of up to proto->max_gap registers) and
+ * pre-builds the batch descriptors and buffers. Executing the plan
+ * allocates nothing, which makes it suitable for periodic refreshes
+ * such as a register cache.
+ *
+ * @param proto     Register protocol (must not be NULL)
+ * @param addrs     Register addresses, any order, duplicates allowed
+ * @param count     Number of addresses (must be > 0)
+ * @param out_plan  Output: plan handle (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM or SPM_ENOMEM otherwise
+ *
+ * @note bufsiz must hold the longest burst rounded up to SPM_BUFSIZ_ALIGN
+ */
+spm_ecode_t spm_reg_plan_create(
+    const spm_reg_proto_t *proto,
+    const uint8_t *addrs,
+    size_t count,
+    spm_reg_plan_t **out_plan
+);
+
+/**
+ * @brief Execute a prepared read.
+ *
+ * Issues all bursts with spm_batch(), one ioctl per run of bursts
+ * whose tx and rx sums stay within proto->bufsiz as spidev counts them
+ * (at most SPM_MAX_BATCH_XFERS), and scatters the results back in the
+ * order of the plan's addresses.
+ *
+ * @param dev     Device handle
+ * @param plan    Plan handle (must not be NULL)
+ * @param values  Output: one byte per planned address (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_reg_plan_read(
+    spm_device_t *dev,
+    spm_reg_plan_t *plan,
+    uint8_t *values
+);
+
+/**
+ * @brief Number of bursts (CS frames) a plan issues.
+ *
+ * @param plan  Plan handle
+ *
+ * @return Burst count, 0 if plan is NULL
+ */
+size_t spm_reg_plan_bursts(
+    const spm_reg_plan_t *plan
+);
+
+/**
+ * @brief Free a plan.
+ *
+ * @param plan  Plan handle (may be NULL)
+ */
+void spm_reg_plan_destroy(
+    spm_reg_plan_t *plan
+);
+
+/* ====================================================== */
+/* ================== One-Shot Access =================== */
+/* ====================================================== */
+
+/**
+ * @brief Read several registers in one batch.
+ *
+ * Convenience wrapper: create a plan, execute it once, free it.
+ *
+ * @param dev     Device handle
+ * @param proto   Register protocol (must not be NULL)
+ * @param addrs   Register addresses (must not be NULL)
+ * @param values  Output: value of addrs[i] in values[i]
+ * @param count   Number of registers (must be > 0)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_reg_read_multi(
+    spm_device_t *dev,
+    const spm_reg_proto_t *proto,
+    const uint8_t *addrs,
+    uint8_t *values,
+    size_t count
+);
+
+/**
+ * @brief Write several registers in one batch.
+ *
+ * Contiguous addresses are merged into auto-increment bursts; gaps
+ * are never written through. Bursts are issued in ascending address
+ * order. Repeated writes to one address keep their relative order.
+ *
+ * @param dev     Device handle
+ * @param proto   Register protocol (must not be NULL)
+ * @param addrs   Register addresses (must not be NULL)
+ * @param values  Value to write to addrs[i] (must not be NULL)
+ * @param count   Number of registers (must be > 0)
+ *
+ * @return SPM_OK on success, error code otherwise
+ *
+ * @note Use spm_transfer() when the device requires a specific
+ *       write order across different registers
+ */
+spm_ecode_t spm_reg_write_multi(
+    spm_device_t *dev,
+    const spm_reg_proto_t *proto,
+    const uint8_t *addrs,
+    const uint8_t *values,
+    size_t count
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMREG_H */
@@ -0,0 +1,218 @@
+#ifndef SPMSCHED_H
+#define SPMSCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+#include "spm_sim.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+#define SPM_SCHED_MAX_TICKS  65536
+
+typedef struct spm_sched spm_sched_t;
+
+/**
+ * @brief Completion callback of one task execution.
+ *
+ * Runs on the scheduler thread (or in spm_sched_step()) after the
+ * message carrying the task; rx buffers hold the results.
+ */
+typedef void (*spm_sched_done_fn)(void *ctx, spm_ecode_t rc, uint64_t tick);
+
+/**
+ * @brief Periodic transaction.
+ *
+ * The descriptors are copied; the buffers they point to must stay
+ * valid for the life of the schedule.
+ */
+typedef struct {
+    spm_device_t            *dev;
+    const spm_batch_xfer_t  *xfers;      /**< Prepared transaction (one or more CS frames) */
+    size_t                   count;      /**< 1..SPM_MAX_BATCH_XFERS */
+    uint32_t                 period_us;  /**< Multiple of the tick */
+    spm_sched_done_fn        done;       /**< May be NULL */
+    void                    *ctx;
+} spm_sched_task_t;
+
+/**
+ * @brief Schedule configuration.
+ */
+typedef struct {
+    uint32_t                 tick_us;    /**< Minor cycle (0 = GCD of the periods) */
+    uint32_t                 budget_us;  /**< Max modeled bus time per tick (0 = tick_us) */
+    const spm_sim_timing_t  *timing;     /**< Wire-time model (NULL = defaults) */
+    size_t                   bufsiz;     /**< Max bytes per ioctl message, spidev bufsiz (0 = 4096) */
+} spm_sched_cfg_t;
+
+/**
+ * @brief Compiled schedule.
+ */
+typedef struct {
+    uint32_t  tick_us;
+    uint32_t  ticks;          /**< Ticks per hyperperiod */
+    uint32_t  messages;       /**< Messages per hyperperiod */
+    uint32_t  worst_tick;     /**< Tick with the most bus time */
+    uint64_t  max_tick_ns;    /**< Modeled bus time of worst_tick */
+    uint64_t  avg_tick_ns;    /**< Mean modeled bus time per tick */
+} spm_sched_info_t;
+
+/**
+ * @brief Execution counters.
+ */
+typedef struct {
+    uint64_t     ticks;       /**< Ticks executed */
+    uint64_t     messages;    /**< spm_batch() calls */
+    uint64_t     overruns;    /**< Ticks that ran past the next tick's start */
+    uint64_t     skipped;     /**< Ticks dropped to catch up after overruns */
+    uint64_t     errors;      /**< Failed messages */
+    spm_ecode_t  last_error;
+    uint64_t     max_exec_ns; /**< Longest tick execution */
+    uint64_t     max_late_ns; /**< Worst wake-up lateness */
+    double       avg_exec_ns;
+} spm_sched_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Compile a cyclic schedule.
+ *
+ * Tasks are placed rate-monotonically (shortest period first, then
+ * largest cost) at the phase offset that minimizes the peak bus time
+ * of the ticks they land on. Per tick, tasks of one device are packed
+ * into spm_batch() messages with CS released between tasks, each
+ * message holding at most SPM_MAX_BATCH_XFERS transfers and keeping
+ * its tx and rx sums (each transfer rounded up to SPM_BUFSIZ_ALIGN)
+ * within bufsiz. Every
+ * tick of the hyperperiod is checked against the budget with
+ * spm_sim_wire_ns() at each device's current speed.
+ *
+ * @param tasks      Tasks (must not be NULL)
+ * @param count      Number of tasks (must be > 0)
+ * @param cfg        Configuration (NULL = defaults)
+ * @param out_sched  Output: schedule handle (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM (also if a task alone exceeds bufsiz),
+ *         SPM_ECONFIG if a period is not a tick
+ *         multiple, the hyperperiod exceeds SPM_SCHED_MAX_TICKS or a
+ *         tick exceeds the budget, SPM_ENOMEM
+ */
+spm_ecode_t spm_sched_create(
+    const spm_sched_task_t *tasks,
+    size_t count,
+    const spm_sched_cfg_t *cfg,
+    spm_sched_t **out_sched
+);
+
+/**
+ * @brief Stop and free a schedule.
+ *
+ * @param sched  Schedule handle (may be NULL)
+ */
+void spm_sched_destroy(
+    spm_sched_t *sched
+);
+
+/* ====================================================== */
+/* ===================== Execution ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Run the schedule on a timer thread.
+ *
+ * Ticks start at absolute CLOCK_MONOTONIC times. A tick that finishes
+ * after the next tick's start counts as an overrun; ticks whose start
+ * has already passed by then are skipped so the schedule keeps its
+ * phase. While running, the thread owns the devices.
+ *
+ * @param sched  Schedule handle
+ *
+ * @return SPM_OK, SPM_ESTATE if running, SPM_ENOMEM
+ */
+spm_ecode_t spm_sched_start(
+    spm_sched_t *sched
+);
+
+/**
+ * @brief Stop the timer thread.
+ *
+ * @param sched  Schedule handle
+ *
+ * @return SPM_OK, SPM_EPARAM
+ */
+spm_ecode_t spm_sched_stop(
+    spm_sched_t *sched
+);
+
+/**
+ * @brief Execute the next tick now, without timing.
+ *
+ * For external timers and tests.
+ *
+ * @param sched  Schedule handle
+ *
+ * @return SPM_OK, the tick's first message error, SPM_ESTATE if running
+ */
+spm_ecode_t spm_sched_step(
+    spm_sched_t *sched
+);
+
+/* ====================================================== */
+/* ===================== Statistics ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Properties of the compiled schedule.
+ *
+ * @param sched     Schedule handle
+ * @param out_info  Output: schedule properties (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_sched_get_info(
+    const spm_sched_t *sched,
+    spm_sched_info_t *out_info
+);
+
+/**
+ * @brief Task phase offset chosen by the balancer.
+ *
+ * @param sched       Schedule handle
+ * @param task        Task index as passed to spm_sched_create()
+ * @param out_offset  Output: first tick of the task (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_sched_get_offset(
+    const spm_sched_t *sched,
+    size_t task,
+    uint32_t *out_offset
+);
+
+/**
+ * @brief Snapshot of the execution counters.
+ *
+ * @param sched      Schedule handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_sched_get_stats(
+    spm_sched_t *sched,
+    spm_sched_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMSCHED_H */
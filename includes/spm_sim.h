@@ -0,0 +1,178 @@
+#ifndef SPMSIM_H
+#define SPMSIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <linux/spi/spidev.h>
+
+#include "spm_sys.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+#define SPM_SIM_MAX_DEVICES  64
+
+/**
+ * @brief Peripheral model.
+ *
+ * Sees every message sent to its device node and may fill rx buffers.
+ * Called with the simulator lock held; must not call back into spm_sim.
+ */
+typedef void (*spm_sim_xfer_fn)(const struct spi_ioc_transfer *trs, size_t n, void *ctx);
+
+/**
+ * @brief Wire-time model.
+ *
+ * A message costs msg_overhead_ns plus, per transfer, xfer_overhead_ns,
+ * the clocked bits at the transfer's speed and its delay_usecs.
+ */
+typedef struct {
+    uint32_t  msg_overhead_ns;   /**< Syscall, driver and controller setup per message (0 = 15000) */
+    uint32_t  xfer_overhead_ns;  /**< CS and DMA setup per transfer (0 = 1000) */
+    bool      realtime;          /**< Busy-wait the modeled time so wall-clock measurements see it */
+} spm_sim_timing_t;
+
+/**
+ * @brief Simulator counters (per device or totals).
+ */
+typedef struct {
+    uint64_t  syscalls;     /**< ioctl_/transfer_ calls, including config */
+    uint64_t  messages;     /**< Data messages */
+    uint64_t  xfers;        /**< Transfers */
+    uint64_t  bytes;        /**< Bytes clocked */
+    uint64_t  wire_ns;      /**< Modeled bus time */
+    uint64_t  errors;       /**< Failed calls */
+} spm_sim_stats_t;
+
+/** ioctl-level simulator backend (SPI_IOC_MESSAGE and mode/bits/speed ioctls) */
+extern const spm_sys_ops_t SPM_SYS_SIM;
+
+/** Message-level simulator backend (transfer_, no ioctl_) */
+extern const spm_sys_ops_t SPM_SYS_SIM_MSG;
+
+/* ====================================================== */
+/* ====================== Devices ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Remove all devices and restore default timing and bufsiz.
+ */
+void spm_sim_reset(
+    void
+);
+
+/**
+ * @brief Register a simulated device node.
+ *
+ * @param path          Node path as passed to open_ (e.g. "/dev/spidev0.0")
+ * @param max_speed_hz  Initial speed (0 = 1 MHz)
+ * @param fn            Peripheral model (may be NULL: rx reads as zero)
+ * @param ctx           Model context
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ESTATE if the path exists, SPM_ENOMEM if full
+ */
+spm_ecode_t spm_sim_add(
+    const char *path,
+    uint32_t max_speed_hz,
+    spm_sim_xfer_fn fn,
+    void *ctx
+);
+
+/**
+ * @brief Whether a path names a simulated device.
+ *
+ * @param path  Node path
+ *
+ * @return true if registered
+ */
+bool spm_sim_has(
+    const char *path
+);
+
+/* ====================================================== */
+/* ====================== Timing ======================== */
+/* ====================================================== */
+
+/**
+ * @brief Set the wire-time model.
+ *
+ * @param timing  Model (NULL = defaults)
+ */
+void spm_sim_set_timing(
+    const spm_sim_timing_t *timing
+);
+
+/**
+ * @brief Modeled bus time of one message.
+ *
+ * Zero speed_hz/bits_per_word in a descriptor fall back to the
+ * arguments, as in spm_batch().
+ *
+ * @param timing         Model (NULL = current)
+ * @param xfers          Descriptors
+ * @param count          Number of descriptors
+ * @param speed_hz       Device speed
+ * @param bits_per_word  Device word size (0 = 8)
+ *
+ * @return Nanoseconds (0 if speed_hz is 0 and no descriptor sets one)
+ */
+uint64_t spm_sim_wire_ns(
+    const spm_sim_timing_t *timing,
+    const spm_batch_xfer_t *xfers,
+    size_t count,
+    uint32_t speed_hz,
+    uint8_t bits_per_word
+);
+
+/* ====================================================== */
+/* ====================== Limits ======================== */
+/* ====================================================== */
+
+/**
+ * @brief Set the per-message byte limit, like spidev's bufsiz.
+ *
+ * A data message whose tx or rx bytes, each transfer rounded up to
+ * SPM_BUFSIZ_ALIGN, add up to more than bufsiz fails with EMSGSIZE
+ * (SPM_EPARAM) and reaches no model. So does a transfer_ message of
+ * more than SPM_MAX_BATCH_XFERS transfers.
+ *
+ * @param bufsiz  Limit in bytes (0 = SPM_BUFSIZ_DEFAULT)
+ */
+void spm_sim_set_bufsiz(
+    size_t bufsiz
+);
+
+/* ====================================================== */
+/* ===================== Statistics ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Counters of one device or of all devices.
+ *
+ * @param path       Node path (NULL = totals)
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK, SPM_EPARAM if the path is unknown
+ */
+spm_ecode_t spm_sim_get_stats(
+    const char *path,
+    spm_sim_stats_t *out_stats
+);
+
+/**
+ * @brief Zero all counters.
+ */
+void spm_sim_reset_stats(
+    void
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMSIM_H */
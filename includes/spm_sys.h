@@ -5,10 +5,38 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
+#include "spi_monkey.h"
+
+/* spm_sys_msg_t flags */
+#define SPM_SYS_MSG_CFG_WRITE  0x1u   /* apply *cfg, no transfers */
+#define SPM_SYS_MSG_CFG_READ   0x2u   /* fill *out_cfg from backend state */
+
+/*
+ * Message handed to transfer_. Data messages carry the validated
+ * descriptor list; zero speed_hz/bits_per_word mean "use cfg".
+ * Config-only messages carry no descriptors. cfg is the device's
+ * cached config and read-only; only a config read writes, to out_cfg.
+ */
+typedef struct spm_sys_msg {
+    const spm_batch_xfer_t *xfers;
+    size_t                  count;
+    const spm_cfg_t        *cfg;
+    spm_cfg_t              *out_cfg;
+    unsigned                flags;
+} spm_sys_msg_t;
+
+/*
+ * Backend operations. transfer_ is optional: when set it replaces
+ * ioctl_ for data and config traffic, and ioctl_ may be NULL.
+ * Both return < 0 and set errno on failure.
+ */
 typedef struct spm_sys_ops {
     int  (*open_)(const char *path, int flags);
     int  (*close_)(int fd);
     int  (*ioctl_)(int fd, unsigned long req, void *arg);
+    int  (*transfer_)(int fd, spm_sys_msg_t *msg);
 } spm_sys_ops_t;
 
 extern const spm_sys_ops_t SPM_SYS_DEFAULT;
@@ -0,0 +1,179 @@
+#ifndef SPMTARGET_H
+#define SPMTARGET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_monkey.h"
+
+/* ====================================================== */
+/* ======================= Types ======================== */
+/* ====================================================== */
+
+typedef struct spm_target spm_target_t;
+
+/**
+ * @brief Target (slave) mode configuration.
+ *
+ * The device must be a spidev node on a controller running in target
+ * mode: every data message then blocks until the host clocks it. A
+ * dedicated thread keeps one message armed at all times, loaded with
+ * the oldest queued response, and re-arms as soon as a frame completes.
+ */
+typedef struct {
+    size_t   frame_len;     /**< Bytes per host transaction (must be > 0) */
+    size_t   tx_depth;      /**< Queued responses (0 = 4) */
+    size_t   rx_depth;      /**< Received frames buffered for spm_target_recv() (0 = 8) */
+    uint8_t  fill;          /**< Byte clocked out on underrun and after short responses */
+    bool     overwrite;     /**< On overrun drop the oldest received frame instead of the new one */
+    int      abort_signal;  /**< Signal that interrupts the armed message on stop (0 = SIGUSR2) */
+} spm_target_cfg_t;
+
+/**
+ * @brief One frame clocked by the host.
+ */
+typedef struct {
+    uint64_t  seq;          /**< Frame number; gaps mean overruns */
+    bool      underrun;     /**< No response was queued: the host got fill bytes */
+    uint64_t  done_ns;      /**< CLOCK_MONOTONIC completion time */
+} spm_target_frame_t;
+
+/**
+ * @brief Target counters.
+ */
+typedef struct {
+    uint64_t  frames;              /**< Host transactions completed */
+    uint64_t  bytes;               /**< Bytes clocked (each direction) */
+    uint64_t  underruns;           /**< Frames answered with fill bytes */
+    uint64_t  overruns;            /**< Received frames dropped, rx queue full */
+    uint64_t  errors;              /**< Failed messages other than stop */
+    uint64_t  resp_latency_max_ns; /**< spm_target_send() to the frame carrying it */
+    double    resp_latency_avg_ns;
+    uint64_t  rearm_max_ns;        /**< Frame completion to next message armed */
+    double    rearm_avg_ns;
+    double    frames_per_s;        /**< Since spm_target_start() */
+    double    kbps;                /**< KiB/s each direction since spm_target_start() */
+} spm_target_stats_t;
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+/**
+ * @brief Create a target endpoint on an open device.
+ *
+ * @param dev      Device handle (spidev on a target-mode controller)
+ * @param cfg      Configuration (must not be NULL: frame_len is required)
+ * @param out_tgt  Output: target handle (must not be NULL)
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_target_create(
+    spm_device_t *dev,
+    const spm_target_cfg_t *cfg,
+    spm_target_t **out_tgt
+);
+
+/**
+ * @brief Stop and free a target endpoint (the device stays open).
+ *
+ * @param tgt  Target handle (may be NULL)
+ */
+void spm_target_destroy(
+    spm_target_t *tgt
+);
+
+/**
+ * @brief Start the transfer thread and arm the first message.
+ *
+ * Installs a no-op handler for abort_signal if it has none, so the
+ * signal interrupts the blocked message instead of ending the process.
+ *
+ * @param tgt  Target handle
+ *
+ * @return SPM_OK, SPM_ESTATE if already started
+ */
+spm_ecode_t spm_target_start(
+    spm_target_t *tgt
+);
+
+/**
+ * @brief Stop the transfer thread.
+ *
+ * The armed message is interrupted with abort_signal; a response it
+ * carried stays at the head of the queue.
+ *
+ * @param tgt  Target handle
+ *
+ * @return SPM_OK on success, error code otherwise
+ */
+spm_ecode_t spm_target_stop(
+    spm_target_t *tgt
+);
+
+/* ====================================================== */
+/* ======================= Frames ======================= */
+/* ====================================================== */
+
+/**
+ * @brief Queue a response for an upcoming host transaction.
+ *
+ * Responses go out in order, one per frame; shorter ones are padded
+ * with fill. While the thread runs, the head of the queue is already
+ * armed for the next frame.
+ *
+ * @param tgt         Target handle
+ * @param data        Response bytes
+ * @param len         Byte count (<= frame_len)
+ * @param timeout_ms  Max wait for queue space (-1 = forever, 0 = poll)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ETIMEOUT
+ */
+spm_ecode_t spm_target_send(
+    spm_target_t *tgt,
+    const void *data,
+    size_t len,
+    int timeout_ms
+);
+
+/**
+ * @brief Take the oldest frame received from the host.
+ *
+ * @param tgt         Target handle
+ * @param out         Destination (frame_len bytes)
+ * @param cap         Destination size (>= frame_len)
+ * @param out_frame   Output: frame info (may be NULL)
+ * @param timeout_ms  Max wait (-1 = forever, 0 = poll)
+ *
+ * @return SPM_OK, SPM_EPARAM, SPM_ETIMEOUT
+ */
+spm_ecode_t spm_target_recv(
+    spm_target_t *tgt,
+    void *out,
+    size_t cap,
+    spm_target_frame_t *out_frame,
+    int timeout_ms
+);
+
+/**
+ * @brief Snapshot of the target counters.
+ *
+ * @param tgt        Target handle
+ * @param out_stats  Output: counters (must not be NULL)
+ *
+ * @return SPM_OK on success, SPM_EPARAM otherwise
+ */
+spm_ecode_t spm_target_get_stats(
+    spm_target_t *tgt,
+    spm_target_stats_t *out_stats
+);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPMTARGET_H */
@@ -1,11 +1,14 @@
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "spm_sys.h"
 #include "spi_monkey.h"
+#include "spm_live.h"
 
 /**
  * @brief SPIMonkey device
@@ -16,11 +19,25 @@ struct spm_device {
     char                path[32];
     spm_error_t         err;
     const spm_sys_ops_t *sys;
+    spm_validation_t    validation;
+    spm_cfg_policy_t    cfg_policy;
+    struct spm_wc       *wc;          /* NULL unless write combining is on */
+    struct spm_hooks    *hooks;       /* NULL unless interceptors are attached */
+    struct spm_tags     *tags;        /* NULL unless tag accounting is on */
+    spm_live_slot_t     *live;        /* NULL unless published to the live segment */
+    uint8_t             tag;          /* tag of untagged calls */
 };
 
 #define SPM_MIN_BPW_VALUE         8
 #define SPM_MAX_BPW_VALUE         32  
 #define SPM_BATCH_STACK_THRESHOLD 32
+#define SPM_WC_DEFAULT_BYTES      4096
+#define SPM_WC_DEFAULT_XFERS      64
+
+/* Build-time default, e.g. -DSPM_VALIDATION_DEFAULT=SPM_VALIDATE_NONE */
+#ifndef SPM_VALIDATION_DEFAULT
+#define SPM_VALIDATION_DEFAULT    SPM_VALIDATE_FULL
+#endif
 
 /* ====================================================== */
 /* ====================== Validation ==================== */
@@ -28,7 +45,7 @@ struct spm_device {
 
 static bool v_sys_is_valid(const spm_sys_ops_t *s) 
 {
-    return s && s->open_ && s->close_ && s->ioctl_;
+    return s && s->open_ && s->close_ && (s->ioctl_ || s->transfer_);
 }
 
 static bool v_fd_is_valid(int fd)
@@ -45,6 +62,25 @@ static bool v_dev_is_valid(const spm_device_t *dev)
     return true;
 }
 
+static inline bool v_checks_enabled(const spm_device_t *dev)
+{
+#ifdef NDEBUG
+    return dev->validation == SPM_VALIDATE_FULL;
+#else
+    return dev->validation != SPM_VALIDATE_NONE;
+#endif
+}
+
+static bool v_batch_xfers_are_valid(const spm_batch_xfer_t *xfers, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const spm_batch_xfer_t *x = &xfers[i];
+        if (!x->tx && !x->rx)                return false;
+        if (x->len == 0 || x->len > UINT32_MAX) return false;
+    }
+    return true;
+}
+
 static spm_ecode_t validate_open_parameters(const spm_sys_ops_t **sys, spm_device_t **out_dev)
 {
     if (!out_dev)              return SPM_EPARAM;
@@ -61,6 +97,18 @@ static spm_ecode_t validate_open_parameters(const spm_sys_ops_t **sys, spm_devic
         } \
     } while(0)
 
+/* Data path: NULL handles are always rejected, the rest depends on level */
+#define VALIDATE_XFER_DEV(dev) \
+    do { \
+        if (!(dev)) return SPM_ESTATE; \
+        if (v_checks_enabled(dev) && !v_dev_is_valid(dev)) return SPM_ESTATE; \
+    } while(0)
+
+#define VALIDATE_XFER_PARAM(cond, dev) \
+    do { \
+        if (v_checks_enabled(dev)) VALIDATE_PARAM(cond, dev); \
+    } while(0)
+
 /* ====================================================== */
 /* ============ Low Level Config Helpers ================ */
 /* ====================================================== */
@@ -210,23 +258,70 @@ static int ioctl_write_config(const spm_device_t *dev, const spm_cfg_t *cfg)
     return 0;
 }
 
-static spm_ecode_t ioctl_build_kernel_transfers(spm_device_t *dev,
-                                          const spm_batch_xfer_t *xfers,
-                                          size_t count,
-                                          struct spi_ioc_transfer *trs)
+/* ====================================================== */
+/* ================= Message-Level Ops ================== */
+/* ====================================================== */
+
+static int msg_config_write(const spm_device_t *dev, const spm_cfg_t *cfg)
 {
-    for (size_t i = 0; i < count; i++) {
-        const spm_batch_xfer_t *x = &xfers[i];
+    spm_sys_msg_t msg = { .cfg = cfg, .flags = SPM_SYS_MSG_CFG_WRITE };
+    return dev->sys->transfer_(dev->fd, &msg);
+}
 
-        if (!x->tx && !x->rx) {
-            SPM_ERROR(&dev->err, SPM_EPARAM);
-            return dev->err.code;
-        }
+static int msg_config_read(const spm_device_t *dev, spm_cfg_t *out_cfg)
+{
+    spm_sys_msg_t msg = { .cfg = &dev->cfg, .out_cfg = out_cfg, .flags = SPM_SYS_MSG_CFG_READ };
+    return dev->sys->transfer_(dev->fd, &msg);
+}
 
-        if (x->len == 0 || x->len > UINT32_MAX) {
-            SPM_ERROR(&dev->err, SPM_EPARAM);
-            return dev->err.code;
-        }
+static int sys_read_config(const spm_device_t *dev, uint32_t *mode, uint8_t *bpw, uint32_t *hz)
+{
+    if (!dev->sys->transfer_) return ioctl_read_config(dev, mode, bpw, hz);
+
+    spm_cfg_t cur = dev->cfg;
+    if (msg_config_read(dev, &cur) < 0) return -1;
+
+    *mode = cfg_to_mode_mask(&cur);
+    *bpw  = cur.bits_per_word;
+    *hz   = cur.speed_hz;
+    clamp_bpw(bpw);
+    return 0;
+}
+
+static int sys_read_mode(const spm_device_t *dev, uint32_t *mode)
+{
+    if (!dev->sys->transfer_) return ioctl_read_mode(dev, mode);
+
+    uint8_t  bpw;
+    uint32_t hz;
+    return sys_read_config(dev, mode, &bpw, &hz);
+}
+
+static int sys_write_config(const spm_device_t *dev, const spm_cfg_t *cfg)
+{
+    if (!dev->sys->transfer_) return ioctl_write_config(dev, cfg);
+
+    return msg_config_write(dev, cfg);
+}
+
+static int sys_write_mode(const spm_device_t *dev, const spm_cfg_t *cfg)
+{
+    if (!dev->sys->transfer_) return ioctl_write_mode(dev, cfg_to_mode_mask(cfg));
+
+    /* Per-transfer policy: speed/bpw travel with the data anyway */
+    spm_cfg_t tmp = *cfg;
+    tmp.speed_hz      = dev->cfg.speed_hz;
+    tmp.bits_per_word = dev->cfg.bits_per_word;
+    return msg_config_write(dev, &tmp);
+}
+
+static void ioctl_build_kernel_transfers(const spm_device_t *dev,
+                                         const spm_batch_xfer_t *xfers,
+                                         size_t count,
+                                         struct spi_ioc_transfer *trs)
+{
+    for (size_t i = 0; i < count; i++) {
+        const spm_batch_xfer_t *x = &xfers[i];
 
         trs[i] = (struct spi_ioc_transfer){
             .tx_buf        = (uintptr_t)x->tx,
@@ -242,10 +337,190 @@ static spm_ecode_t ioctl_build_kernel_transfers(spm_device_t *dev,
             .cs_change     = x->cs_change ? 1 : 0,
         };
     }
+}
+
+static spm_ecode_t sys_submit_raw(spm_device_t *dev, const spm_batch_xfer_t *xfers, size_t count)
+{
+    if (dev->sys->transfer_) {
+        spm_sys_msg_t msg = { .xfers = xfers, .count = count, .cfg = &dev->cfg };
+        return dev->sys->transfer_(dev->fd, &msg) < 0 ? spm_map_errno() : SPM_OK;
+    }
+
+    struct spi_ioc_transfer *trs = NULL;
+    struct spi_ioc_transfer *heap_trs = NULL;
+
+    /* Allocate kernel transfer array */
+    if (count <= SPM_BATCH_STACK_THRESHOLD) {
+        trs = alloca(count * sizeof(*trs));
+    } else {
+        heap_trs = calloc(count, sizeof(*trs));
+        if (!heap_trs) return SPM_ENOMEM;
+        trs = heap_trs;
+    }
+
+    ioctl_build_kernel_transfers(dev, xfers, count, trs);
+
+    int ret = dev->sys->ioctl_(dev->fd, SPI_IOC_MESSAGE(count), trs);
+    spm_ecode_t rc = ret < 0 ? spm_map_errno() : SPM_OK;
+
+    if (heap_trs) free(heap_trs);
+    return rc;
+}
+
+/* ====================================================== */
+/* ================= Tag Accounting ===================== */
+/* ====================================================== */
+
+/**
+ * @brief Per-tag counters of one device
+ *
+ * Locked because write-combining flushes may be accounted from the
+ * timer thread while the caller reads or submits.
+ */
+struct spm_tags {
+    pthread_mutex_t   lock;
+    spm_tag_stats_t   stat[SPM_MAX_TAGS];
+};
 
+static uint64_t wc_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Clock time of the data alone, without controller or syscall overhead */
+static uint64_t tags_wire_ns(const spm_device_t *dev, const spm_batch_xfer_t *xfers, size_t count)
+{
+    uint64_t ns = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t hz  = xfers[i].speed_hz ? xfers[i].speed_hz : dev->cfg.speed_hz;
+        uint8_t  bpw = xfers[i].bits_per_word ? xfers[i].bits_per_word : dev->cfg.bits_per_word;
+        if (!bpw) bpw = 8;
+        uint64_t words = xfers[i].len / ((bpw + 7u) / 8u);
+        if (hz) ns += (words * bpw * 1000000000ull + hz - 1) / hz;
+        ns += (uint64_t)xfers[i].delay_usecs * 1000u;
+    }
+    return ns;
+}
+
+static void tags_account(spm_device_t *dev, uint8_t tag, size_t count, uint64_t bytes,
+                         uint64_t wire, uint64_t ioctl_ns, spm_ecode_t rc)
+{
+    struct spm_tags *t = dev->tags;
+
+    pthread_mutex_lock(&t->lock);
+    spm_tag_stats_t *s = &t->stat[tag];
+    s->messages++;
+    s->xfers    += count;
+    s->bytes    += bytes;
+    s->wire_ns  += wire;
+    s->ioctl_ns += ioctl_ns;
+    if (ioctl_ns > s->ioctl_max_ns) s->ioctl_max_ns = ioctl_ns;
+    if (rc != SPM_OK) s->errors++;
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* Timed path, taken while tag accounting or live stats are on */
+static spm_ecode_t sys_submit_timed(spm_device_t *dev, uint8_t tag,
+                                    const spm_batch_xfer_t *xfers, size_t count)
+{
+    spm_live_slot_t *live = dev->live;
+    if (live) spm_live_slot_inflight(live, 1);
+    uint64_t t0 = wc_now_ns();
+    spm_ecode_t rc = sys_submit_raw(dev, xfers, count);
+    uint64_t ioctl_ns = wc_now_ns() - t0;
+    if (live) spm_live_slot_inflight(live, -1);
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; i++) bytes += xfers[i].len;
+    uint64_t wire = tags_wire_ns(dev, xfers, count);
+
+    if (dev->tags) tags_account(dev, tag, count, bytes, wire, ioctl_ns, rc);
+    if (live)      spm_live_slot_record(live, count, bytes, wire, ioctl_ns, rc != SPM_OK);
+    return rc;
+}
+
+static void tags_clear(struct spm_tags *t)
+{
+    pthread_mutex_lock(&t->lock);
+    memset(t->stat, 0, sizeof t->stat);
+    for (size_t i = 0; i < SPM_MAX_TAGS; i++) t->stat[i].tag = (uint8_t)i;
+    pthread_mutex_unlock(&t->lock);
+}
+
+static void tags_destroy(struct spm_tags *t)
+{
+    if (!t) return;
+    pthread_mutex_destroy(&t->lock);
+    free(t);
+}
+
+/* ====================================================== */
+/* ==================== Interceptors ==================== */
+/* ====================================================== */
+
+/**
+ * @brief Attached interceptors of one device
+ *
+ * Replaced as a whole on add/remove (under the wc lock when write
+ * combining is on) so a running chain never sees a partial update.
+ */
+struct spm_hooks {
+    size_t      count;
+    spm_hook_t  hook[SPM_MAX_HOOKS];
+};
+
+/* Runs pre callbacks; *entered is the number whose post must run */
+static spm_ecode_t hooks_pre(spm_device_t *dev, const struct spm_hooks *h,
+                             const spm_hook_call_t *call, size_t *entered)
+{
+    for (size_t i = 0; i < h->count; i++) {
+        const spm_hook_t *k = &h->hook[i];
+        spm_ecode_t rc = k->pre ? k->pre(dev, call, k->ctx) : SPM_OK;
+        if (rc != SPM_OK) {
+            *entered = i;
+            return rc;
+        }
+    }
+    *entered = h->count;
     return SPM_OK;
 }
 
+static spm_ecode_t hooks_post(spm_device_t *dev, const struct spm_hooks *h,
+                              const spm_hook_call_t *call, size_t entered, spm_ecode_t rc)
+{
+    while (entered--) {
+        const spm_hook_t *k = &h->hook[entered];
+        if (k->post) rc = k->post(dev, call, rc, k->ctx);
+    }
+    return rc;
+}
+
+static spm_ecode_t sys_submit_hooked(spm_device_t *dev, uint8_t tag, spm_hook_op_t op,
+                                     const spm_batch_xfer_t *xfers, size_t count)
+{
+    const struct spm_hooks *h = dev->hooks;
+    spm_hook_call_t call = { .op = op, .xfers = xfers, .count = count, .cfg = &dev->cfg };
+
+    size_t entered;
+    spm_ecode_t rc = hooks_pre(dev, h, &call, &entered);
+    if (rc == SPM_OK) {
+        rc = (dev->tags || dev->live) ? sys_submit_timed(dev, tag, xfers, count)
+                                      : sys_submit_raw(dev, xfers, count);
+    }
+    return hooks_post(dev, h, &call, entered, rc);
+}
+
+/* Issues one message; leaves dev->err alone (also used by the wc timer) */
+static spm_ecode_t sys_submit(spm_device_t *dev, uint8_t tag, spm_hook_op_t op,
+                              const spm_batch_xfer_t *xfers, size_t count)
+{
+    if (dev->hooks) return sys_submit_hooked(dev, tag, op, xfers, count);
+    if (dev->tags || dev->live) return sys_submit_timed(dev, tag, xfers, count);
+    return sys_submit_raw(dev, xfers, count);
+}
+
 /* ====================================================== */
 /* ============= High Level Config Helpers ============== */
 /* ====================================================== */
@@ -265,19 +540,42 @@ static spm_ecode_t read_device_config(const spm_device_t *dev, spm_cfg_t *cfg)
     uint32_t hz;
     uint32_t mode_mask;
     
-    if (ioctl_read_config(dev, &mode_mask, &bpw, &hz) < 0) return spm_map_errno();
+    if (dev->cfg_policy == SPM_CFG_PER_TRANSFER) {
+        /* Speed and bpw only exist in the cached config */
+        if (sys_read_mode(dev, &mode_mask) < 0) return spm_map_errno();
+        fill_config(cfg, mode_mask, dev->cfg.bits_per_word, dev->cfg.speed_hz);
+        return SPM_OK;
+    }
+
+    if (sys_read_config(dev, &mode_mask, &bpw, &hz) < 0) return spm_map_errno();
     fill_config(cfg, mode_mask, bpw, hz);
     
     return SPM_OK;
 }
 
-static spm_ecode_t write_device_config(const spm_device_t *dev, spm_cfg_t *cfg) 
+static spm_ecode_t write_device_mode(const spm_device_t *dev, spm_cfg_t *cfg) 
+{
+    uint32_t mode_mask = cfg_to_mode_mask(cfg);
+    if (mode_mask == cfg_to_mode_mask(&dev->cfg)) return SPM_OK;
+
+    if (sys_write_mode(dev, cfg) < 0) return spm_map_errno();
+    if (sys_read_mode(dev, &mode_mask) < 0) return spm_map_errno();
+
+    fill_config(cfg, mode_mask, cfg->bits_per_word, cfg->speed_hz);
+    return SPM_OK;
+}
+
+static spm_ecode_t write_device_config_raw(const spm_device_t *dev, spm_cfg_t *cfg) 
 {
-    if (ioctl_write_config(dev, cfg) < 0) {
+    if (dev->cfg_policy == SPM_CFG_PER_TRANSFER) {
+        return write_device_mode(dev, cfg);
+    }
+
+    if (sys_write_config(dev, cfg) < 0) {
         return spm_map_errno();
     }
     
-    spm_cfg_t actual_cfg;
+    spm_cfg_t actual_cfg = *cfg;
     spm_ecode_t rc = read_device_config(dev, &actual_cfg);
     if (rc != SPM_OK) {
         return rc;
@@ -287,12 +585,236 @@ static spm_ecode_t write_device_config(const spm_device_t *dev, spm_cfg_t *cfg)
     return SPM_OK;
 }
 
+/* On success cfg holds what the driver accepted, which post hooks see */
+static spm_ecode_t write_device_config(spm_device_t *dev, spm_cfg_t *cfg)
+{
+    if (!dev->hooks) return write_device_config_raw(dev, cfg);
+
+    const struct spm_hooks *h = dev->hooks;
+    spm_hook_call_t call = { .op = SPM_HOOK_CONFIG, .cfg = cfg };
+
+    size_t entered;
+    spm_ecode_t rc = hooks_pre(dev, h, &call, &entered);
+    if (rc == SPM_OK) rc = write_device_config_raw(dev, cfg);
+    return hooks_post(dev, h, &call, entered, rc);
+}
+
 /* ====================================================== */
-/* ===================== Public API ===================== */
+/* ================== Write Combining =================== */
 /* ====================================================== */
 
-spm_ecode_t spm_dev_open_sys_ops(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg,
-                                  const spm_sys_ops_t *sys, spm_device_t **out_dev)
+/**
+ * @brief Pending write-only transfers of one device
+ *
+ * Tx data is copied into buf so callers may reuse their buffers. The
+ * timer thread only exists when a time bound is configured.
+ */
+struct spm_wc {
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    pthread_t         thread;
+    bool              has_thread;
+    bool              stop;
+    spm_wc_cfg_t      cfg;
+    uint8_t          *buf;
+    size_t            used;
+    spm_batch_xfer_t *xfers;
+    size_t            count;
+    uint64_t          first_ns;    /* enqueue time of the oldest pending write */
+    spm_ecode_t       deferred;    /* error of a flush nobody waited for */
+    uint8_t           tag;         /* accounting tag of the pending writes */
+    spm_wc_stats_t    stats;
+};
+
+static spm_ecode_t wc_flush_locked(spm_device_t *dev)
+{
+    struct spm_wc *wc = dev->wc;
+    if (wc->count == 0) return SPM_OK;
+
+    /*
+     * Separate writes each had their own CS assertion: toggle CS between
+     * them unless the config keeps CS asserted across messages, in which
+     * case the inverse holds. The last transfer ends like a single write.
+     */
+    for (size_t i = 0; i < wc->count; i++) {
+        wc->xfers[i].cs_change = (i + 1 < wc->count) ? !dev->cfg.cs_change : dev->cfg.cs_change;
+    }
+
+    spm_ecode_t rc = sys_submit(dev, wc->tag, SPM_HOOK_BATCH, wc->xfers, wc->count);
+    wc->stats.writes += wc->count;
+    wc->stats.flushes++;
+    wc->count = 0;
+    wc->used = 0;
+    if (dev->live) spm_live_slot_set_pending(dev->live, 0);
+    return rc;
+}
+
+/* Flushes and returns the first pending error; used before ordered calls */
+static spm_ecode_t wc_flush(spm_device_t *dev)
+{
+    struct spm_wc *wc = dev->wc;
+
+    pthread_mutex_lock(&wc->lock);
+    spm_ecode_t rc = wc_flush_locked(dev);
+    if (wc->deferred != SPM_OK) {
+        if (rc == SPM_OK) rc = wc->deferred;
+        wc->deferred = SPM_OK;
+    }
+    pthread_mutex_unlock(&wc->lock);
+
+    if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
+    return rc;
+}
+
+static spm_ecode_t wc_write(spm_device_t *dev, uint8_t tag, const void *tx, size_t len)
+{
+    struct spm_wc *wc = dev->wc;
+
+    /* Too large to buffer: keep order and send it on its own */
+    if (len > wc->cfg.max_bytes) {
+        spm_ecode_t rc = wc_flush(dev);
+        if (rc != SPM_OK) return rc;
+
+        spm_batch_xfer_t x = {
+            .tx = tx, .len = len,
+            .delay_usecs = dev->cfg.delay_usecs, .cs_change = dev->cfg.cs_change,
+        };
+        rc = sys_submit(dev, tag, SPM_HOOK_TRANSFER, &x, 1);
+        if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
+        return rc;
+    }
+
+    pthread_mutex_lock(&wc->lock);
+    spm_ecode_t rc = wc->deferred;
+    wc->deferred = SPM_OK;
+
+    /* One owner per message when accounting: another tag starts a new batch */
+    if (wc->used + len > wc->cfg.max_bytes || (dev->tags && wc->count && wc->tag != tag)) {
+        spm_ecode_t frc = wc_flush_locked(dev);
+        if (rc == SPM_OK) rc = frc;
+    }
+
+    memcpy(wc->buf + wc->used, tx, len);
+    wc->xfers[wc->count++] = (spm_batch_xfer_t){
+        .tx            = wc->buf + wc->used,
+        .len           = len,
+        .speed_hz      = dev->cfg.speed_hz,
+        .bits_per_word = dev->cfg.bits_per_word,
+        .delay_usecs   = dev->cfg.delay_usecs,
+    };
+    wc->used += len;
+
+    if (wc->count == 1) {
+        wc->tag = tag;
+        wc->first_ns = wc_now_ns();
+        if (wc->has_thread) pthread_cond_signal(&wc->cond);
+    }
+
+    if (wc->count >= wc->cfg.max_xfers || wc->used >= wc->cfg.max_bytes) {
+        spm_ecode_t frc = wc_flush_locked(dev);
+        if (rc == SPM_OK) rc = frc;
+    }
+    if (dev->live) spm_live_slot_set_pending(dev->live, (uint32_t)wc->count);
+    pthread_mutex_unlock(&wc->lock);
+
+    if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
+    return rc;
+}
+
+static void *wc_timer_main(void *arg)
+{
+    spm_device_t *dev = arg;
+    struct spm_wc *wc = dev->wc;
+    const uint64_t bound_ns = (uint64_t)wc->cfg.max_delay_us * 1000u;
+
+    pthread_mutex_lock(&wc->lock);
+    while (!wc->stop) {
+        if (wc->count == 0) {
+            pthread_cond_wait(&wc->cond, &wc->lock);
+            continue;
+        }
+
+        uint64_t deadline = wc->first_ns + bound_ns;
+        if (wc_now_ns() >= deadline) {
+            spm_ecode_t rc = wc_flush_locked(dev);
+            wc->stats.timed_flushes++;
+            if (rc != SPM_OK && wc->deferred == SPM_OK) wc->deferred = rc;
+            continue;
+        }
+
+        struct timespec ts = {
+            .tv_sec  = (time_t)(deadline / 1000000000ull),
+            .tv_nsec = (long)(deadline % 1000000000ull),
+        };
+        pthread_cond_timedwait(&wc->cond, &wc->lock, &ts);
+    }
+    pthread_mutex_unlock(&wc->lock);
+    return NULL;
+}
+
+static void wc_destroy(struct spm_wc *wc)
+{
+    if (!wc) return;
+
+    if (wc->has_thread) {
+        pthread_mutex_lock(&wc->lock);
+        wc->stop = true;
+        pthread_cond_signal(&wc->cond);
+        pthread_mutex_unlock(&wc->lock);
+        pthread_join(wc->thread, NULL);
+    }
+
+    pthread_cond_destroy(&wc->cond);
+    pthread_mutex_destroy(&wc->lock);
+    free(wc->xfers);
+    free(wc->buf);
+    free(wc);
+}
+
+static spm_ecode_t wc_create(const spm_wc_cfg_t *cfg, struct spm_wc **out_wc)
+{
+    struct spm_wc *wc = calloc(1, sizeof(*wc));
+    if (!wc) return SPM_ENOMEM;
+
+    wc->cfg = *cfg;
+    if (!wc->cfg.max_bytes) wc->cfg.max_bytes = SPM_WC_DEFAULT_BYTES;
+    if (!wc->cfg.max_xfers) wc->cfg.max_xfers = SPM_WC_DEFAULT_XFERS;
+
+    wc->buf   = malloc(wc->cfg.max_bytes);
+    wc->xfers = calloc(wc->cfg.max_xfers, sizeof(*wc->xfers));
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&wc->lock, NULL);
+    pthread_cond_init(&wc->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    if (!wc->buf || !wc->xfers) {
+        wc_destroy(wc);
+        return SPM_ENOMEM;
+    }
+    *out_wc = wc;
+    return SPM_OK;
+}
+
+/* Pending combined writes go out before anything that depends on order */
+#define WC_SYNC(dev) \
+    do { \
+        if ((dev)->wc) { \
+            spm_ecode_t wc_rc_ = wc_flush(dev); \
+            if (wc_rc_ != SPM_OK) return wc_rc_; \
+        } \
+    } while(0)
+
+/* ====================================================== */
+/* ====================== Opening ======================= */
+/* ====================================================== */
+
+/* Open, config write and read-back; phase_ns (may be NULL) gets their times */
+static spm_ecode_t dev_open_phased(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg,
+                                   const spm_sys_ops_t *sys, spm_device_t **out_dev,
+                                   uint64_t phase_ns[3])
 {
     spm_ecode_t rc = validate_open_parameters(&sys, out_dev);
     if (rc != SPM_OK) return rc;
@@ -300,7 +822,10 @@ spm_ecode_t spm_dev_open_sys_ops(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg,
     char path[32];
     snprintf(path, sizeof(path), "/dev/spidev%u.%u", bus, cs);
 
+    uint64_t t0 = wc_now_ns();
     int fd = sys->open_(path, O_RDWR);
+    uint64_t t1 = wc_now_ns();
+    if (phase_ns) phase_ns[0] = t1 - t0;
     if (fd < 0) return spm_map_errno();
 
     spm_device_t *dev = calloc(1, sizeof(*dev));
@@ -311,12 +836,29 @@ spm_ecode_t spm_dev_open_sys_ops(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg,
 
     dev->fd = fd;
     dev->sys = sys;
+    dev->validation = SPM_VALIDATION_DEFAULT;
+    dev->cfg_policy = SPM_CFG_DRIVER;
     snprintf(dev->path, sizeof(dev->path), "%s", path);
     dev->cfg = cfg ? *cfg : get_default_cfg();
     sanitize_cfg(&dev->cfg);
 
-    rc = write_device_config(dev, &dev->cfg);
+    /* write_device_config() split so each half can be timed */
+    t0 = wc_now_ns();
+    if (sys_write_config(dev, &dev->cfg) < 0) {
+        rc = spm_map_errno();
+        goto fail;
+    }
+    t1 = wc_now_ns();
+
+    spm_cfg_t actual_cfg = dev->cfg;
+    rc = read_device_config(dev, &actual_cfg);
+    uint64_t t2 = wc_now_ns();
+    if (phase_ns) {
+        phase_ns[1] = t1 - t0;
+        phase_ns[2] = t2 - t1;
+    }
     if (rc != SPM_OK) goto fail;
+    dev->cfg = actual_cfg;
 
     *out_dev = dev;
     return SPM_OK;
@@ -328,6 +870,77 @@ fail:
     return rc;
 }
 
+typedef struct {
+    spm_open_entry_t     *entries;
+    size_t                count;
+    const spm_sys_ops_t  *sys;
+    const uint8_t        *buses;    /* distinct buses, first-seen order */
+    size_t                nbuses;
+    size_t                next;     /* next bus to claim */
+    pthread_mutex_t       lock;
+} bulk_open_t;
+
+static void bulk_open_bus(bulk_open_t *b, uint8_t bus)
+{
+    for (size_t i = 0; i < b->count; i++) {
+        spm_open_entry_t *e = &b->entries[i];
+        if (e->bus != bus) continue;
+
+        uint64_t ph[3] = {0};
+        e->rc = dev_open_phased(e->bus, e->cs, e->cfg, b->sys, &e->dev, ph);
+        e->open_ns      = ph[0];
+        e->cfg_write_ns = ph[1];
+        e->probe_ns     = ph[2];
+    }
+}
+
+static void *bulk_open_main(void *arg)
+{
+    bulk_open_t *b = arg;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        size_t k = b->next < b->nbuses ? b->next++ : b->nbuses;
+        pthread_mutex_unlock(&b->lock);
+
+        if (k == b->nbuses) return NULL;
+        bulk_open_bus(b, b->buses[k]);
+    }
+}
+
+/* ====================================================== */
+/* ==================== Memory Reads ==================== */
+/* ====================================================== */
+
+#define MEM_HDR_MAX   (1 + 4 + SPM_MEM_MAX_DUMMY)
+#define MEM_FRAMES    (SPM_MAX_BATCH_XFERS / 2)
+
+typedef struct {
+    spm_batch_xfer_t  x[SPM_MAX_BATCH_XFERS];
+    uint8_t           hdr[MEM_FRAMES][MEM_HDR_MAX];
+    size_t            n;        /* transfers */
+    size_t            tx, rx;   /* bufsiz cost so far */
+} mem_msg_t;
+
+static spm_ecode_t mem_flush(spm_device_t *dev, mem_msg_t *m, uint64_t *out_msgs)
+{
+    if (!m->n) return SPM_OK;
+    m->x[m->n - 1].cs_change = false;
+    spm_ecode_t rc = spm_batch(dev, m->x, m->n);
+    if (rc == SPM_OK && out_msgs) (*out_msgs)++;
+    m->n = m->tx = m->rx = 0;
+    return rc;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_dev_open_sys_ops(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg,
+                                  const spm_sys_ops_t *sys, spm_device_t **out_dev)
+{
+    return dev_open_phased(bus, cs, cfg, sys, out_dev, NULL);
+}
+
 spm_ecode_t spm_dev_open(uint8_t bus, uint8_t cs, const spm_cfg_t *cfg, spm_device_t **out_dev) {
     return spm_dev_open_sys_ops(bus, cs, cfg, &SPM_SYS_DEFAULT, out_dev);
 }
@@ -336,6 +949,12 @@ spm_ecode_t spm_dev_close(spm_device_t *dev) {
     if (!dev) return SPM_EPARAM;
     
     spm_ecode_t rc = SPM_OK;
+    if (dev->wc) {
+        rc = wc_flush(dev);
+        wc_destroy(dev->wc);
+        dev->wc = NULL;
+    }
+
     if (v_sys_is_valid(dev->sys) && dev->fd >= 0) {
         if (dev->sys->close_(dev->fd) < 0) {
             rc = spm_map_errno();
@@ -343,14 +962,110 @@ spm_ecode_t spm_dev_close(spm_device_t *dev) {
         }
     }
     
+    tags_destroy(dev->tags);
+    spm_live_slot_release(dev->live);
+    free(dev->hooks);
     free(dev);
     return rc;
 }
 
-spm_ecode_t spm_transfer(spm_device_t *dev, const void *tx, void *rx, size_t len) {
-    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
-    VALIDATE_PARAM(tx || rx, dev);
-    VALIDATE_PARAM(len > 0 && len <= UINT32_MAX, dev);
+spm_ecode_t spm_dev_open_bulk(spm_open_entry_t *entries, size_t count, const spm_sys_ops_t *sys,
+                              size_t max_threads, spm_open_report_t *out_report)
+{
+    if (!entries || count == 0) return SPM_EPARAM;
+    if (sys && !v_sys_is_valid(sys)) return SPM_EPARAM;
+
+    uint64_t t0 = wc_now_ns();
+
+    uint8_t buses[256];
+    bool seen[256] = {false};
+    size_t nbuses = 0;
+    for (size_t i = 0; i < count; i++) {
+        entries[i].dev = NULL;
+        entries[i].rc = SPM_OK;
+        if (!seen[entries[i].bus]) {
+            seen[entries[i].bus] = true;
+            buses[nbuses++] = entries[i].bus;
+        }
+    }
+
+    bulk_open_t b = {
+        .entries = entries, .count = count, .sys = sys,
+        .buses = buses, .nbuses = nbuses,
+    };
+    pthread_mutex_init(&b.lock, NULL);
+
+    size_t nthreads = max_threads && max_threads < nbuses ? max_threads : nbuses;
+    pthread_t threads[256];
+    size_t started = 0;
+    if (nthreads > 1) {
+        while (started + 1 < nthreads &&
+               pthread_create(&threads[started], NULL, bulk_open_main, &b) == 0) {
+            started++;
+        }
+    }
+
+    /* The caller works too; it alone covers a single bus or thread failures */
+    bulk_open_main(&b);
+    for (size_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&b.lock);
+
+    spm_open_report_t r = { .buses = nbuses, .threads = started + 1 };
+    spm_ecode_t rc = SPM_OK;
+    for (size_t i = 0; i < count; i++) {
+        const spm_open_entry_t *e = &entries[i];
+        r.open_ns      += e->open_ns;
+        r.cfg_write_ns += e->cfg_write_ns;
+        r.probe_ns     += e->probe_ns;
+        if (e->rc == SPM_OK) {
+            r.opened++;
+        } else {
+            r.failed++;
+            if (rc == SPM_OK) rc = e->rc;
+        }
+    }
+    r.total_ns = wc_now_ns() - t0;
+
+    if (out_report) *out_report = r;
+    return rc;
+}
+
+static inline spm_ecode_t dev_transfer(spm_device_t *dev, uint8_t tag, const void *tx, void *rx, size_t len)
+{
+    if (dev->wc) {
+        if (!rx) return wc_write(dev, tag, tx, len);
+        WC_SYNC(dev);
+    }
+
+    if (dev->hooks || dev->tags || dev->live) {
+        spm_batch_xfer_t x = {
+            .tx          = tx,
+            .rx          = rx,
+            .len         = len,
+            .delay_usecs = dev->cfg.delay_usecs,
+            .cs_change   = dev->cfg.cs_change,
+        };
+        spm_ecode_t rc = sys_submit(dev, tag, SPM_HOOK_TRANSFER, &x, 1);
+        if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
+        return rc;
+    }
+
+    if (dev->sys->transfer_) {
+        spm_batch_xfer_t x = {
+            .tx          = tx,
+            .rx          = rx,
+            .len         = len,
+            .delay_usecs = dev->cfg.delay_usecs,
+            .cs_change   = dev->cfg.cs_change,
+        };
+        spm_sys_msg_t msg = { .xfers = &x, .count = 1, .cfg = &dev->cfg };
+
+        if (dev->sys->transfer_(dev->fd, &msg) < 0) {
+            SPM_ERROR(&dev->err, spm_map_errno());
+            return dev->err.code;
+        }
+        return SPM_OK;
+    }
 
     struct spi_ioc_transfer tr = {
         .tx_buf        = (uintptr_t)tx,
@@ -370,57 +1085,130 @@ spm_ecode_t spm_transfer(spm_device_t *dev, const void *tx, void *rx, size_t len
     return SPM_OK;
 }
 
-spm_ecode_t spm_batch(spm_device_t *dev, const spm_batch_xfer_t *xfers, size_t count) {
-    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
-    VALIDATE_PARAM(xfers && count > 0 && count <= SPM_MAX_BATCH_XFERS, dev);
+static inline spm_ecode_t dev_batch(spm_device_t *dev, uint8_t tag, const spm_batch_xfer_t *xfers, size_t count)
+{
+    WC_SYNC(dev);
 
-    struct spi_ioc_transfer *trs = NULL;
-    struct spi_ioc_transfer *heap_trs = NULL;
+    spm_ecode_t rc = sys_submit(dev, tag, SPM_HOOK_BATCH, xfers, count);
+    if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
+    return rc;
+}
 
-    /* Allocate kernel transfer array */
-    if (count <= SPM_BATCH_STACK_THRESHOLD) {
-        trs = alloca(count * sizeof(*trs));
-    } else {
-        heap_trs = calloc(count, sizeof(*trs));
-        if (!heap_trs) {
-            SPM_ERROR(&dev->err, SPM_ENOMEM);
-            return SPM_ENOMEM;
-        }
-        trs = heap_trs;
-    }
+spm_ecode_t spm_transfer_unchecked(spm_device_t *dev, const void *tx, void *rx, size_t len) {
+    return dev_transfer(dev, dev->tag, tx, rx, len);
+}
 
-    spm_ecode_t rc = ioctl_build_kernel_transfers(dev, xfers, count, trs);
-    if (rc != SPM_OK) {
-        if (heap_trs) free(heap_trs);
-        return rc;
-    }
+spm_ecode_t spm_transfer(spm_device_t *dev, const void *tx, void *rx, size_t len) {
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(tx || rx, dev);
+    VALIDATE_XFER_PARAM(len > 0 && len <= UINT32_MAX, dev);
+    return spm_transfer_unchecked(dev, tx, rx, len);
+}
 
-    int ret = dev->sys->ioctl_(dev->fd, SPI_IOC_MESSAGE(count), trs);
-    
-    if (heap_trs) free(heap_trs);
-    if (ret < 0) {
-        SPM_ERROR(&dev->err, spm_map_errno());
-        return dev->err.code;
-    }
+spm_ecode_t spm_batch_unchecked(spm_device_t *dev, const spm_batch_xfer_t *xfers, size_t count) {
+    return dev_batch(dev, dev->tag, xfers, count);
+}
 
-    return SPM_OK;
+spm_ecode_t spm_batch(spm_device_t *dev, const spm_batch_xfer_t *xfers, size_t count) {
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(xfers && count > 0 && count <= SPM_MAX_BATCH_XFERS, dev);
+    VALIDATE_XFER_PARAM(v_batch_xfers_are_valid(xfers, count), dev);
+    return spm_batch_unchecked(dev, xfers, count);
+}
+
+spm_ecode_t spm_transfer_tagged(spm_device_t *dev, uint8_t tag, const void *tx, void *rx, size_t len) {
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(tag < SPM_MAX_TAGS, dev);
+    VALIDATE_XFER_PARAM(tx || rx, dev);
+    VALIDATE_XFER_PARAM(len > 0 && len <= UINT32_MAX, dev);
+    return dev_transfer(dev, tag, tx, rx, len);
+}
+
+spm_ecode_t spm_batch_tagged(spm_device_t *dev, uint8_t tag, const spm_batch_xfer_t *xfers, size_t count) {
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(tag < SPM_MAX_TAGS, dev);
+    VALIDATE_XFER_PARAM(xfers && count > 0 && count <= SPM_MAX_BATCH_XFERS, dev);
+    VALIDATE_XFER_PARAM(v_batch_xfers_are_valid(xfers, count), dev);
+    return dev_batch(dev, tag, xfers, count);
+}
+
+spm_ecode_t spm_write_unchecked(spm_device_t *dev, const void *tx, size_t len) {
+    return spm_transfer_unchecked(dev, tx, NULL, len);
 }
 
 spm_ecode_t spm_write(spm_device_t *dev, const void *tx, size_t len) {
-    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
-    VALIDATE_PARAM(tx && len > 0, dev);
-    return spm_transfer(dev, tx, NULL, len);
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(tx && len > 0 && len <= UINT32_MAX, dev);
+    return spm_transfer_unchecked(dev, tx, NULL, len);
+}
+
+spm_ecode_t spm_read_unchecked(spm_device_t *dev, void *rx, size_t len) {
+    return spm_transfer_unchecked(dev, NULL, rx, len);
 }
 
 spm_ecode_t spm_read(spm_device_t *dev, void *rx, size_t len) {
-    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
-    VALIDATE_PARAM(rx && len > 0, dev);
-    return spm_transfer(dev, NULL, rx, len);
+    VALIDATE_XFER_DEV(dev);
+    VALIDATE_XFER_PARAM(rx && len > 0 && len <= UINT32_MAX, dev);
+    return spm_transfer_unchecked(dev, NULL, rx, len);
+}
+
+spm_ecode_t spm_mem_read(spm_device_t *dev, const spm_mem_cfg_t *cfg, const spm_mem_range_t *ranges,
+                         size_t count, uint64_t *out_msgs)
+{
+    if (!ranges || count == 0) return SPM_EPARAM;
+    spm_mem_cfg_t c = cfg ? *cfg : (spm_mem_cfg_t){0};
+    if (!c.read_cmd)   c.read_cmd   = 0x03;
+    if (!c.addr_bytes) c.addr_bytes = 3;
+    if (!c.bufsiz)     c.bufsiz     = SPM_BUFSIZ_DEFAULT;
+    if (c.addr_bytes > 4 || c.dummy_bytes > SPM_MEM_MAX_DUMMY) return SPM_EPARAM;
+    if (c.bufsiz < SPM_BUFSIZ_ALIGN)                            return SPM_EPARAM;
+    for (size_t i = 0; i < count; i++) {
+        if (!ranges[i].dst || ranges[i].len == 0)             return SPM_EPARAM;
+    }
+
+    const size_t hl    = 1u + c.addr_bytes + c.dummy_bytes;
+    const size_t chunk = c.bufsiz & ~(size_t)(SPM_BUFSIZ_ALIGN - 1);
+
+    mem_msg_t *m = malloc(sizeof(*m));
+    if (!m) return SPM_ENOMEM;
+    m->n = m->tx = m->rx = 0;
+
+    spm_ecode_t rc = SPM_OK;
+    for (size_t i = 0; i < count && rc == SPM_OK; i++) {
+        uint32_t addr = ranges[i].addr;
+        uint8_t *p = ranges[i].dst;
+        for (size_t left = ranges[i].len; left && rc == SPM_OK; ) {
+            size_t len = left < chunk ? left : chunk;
+            if (m->n == SPM_MAX_BATCH_XFERS || m->tx + SPM_BUFSIZ_COST(hl) > c.bufsiz ||
+                m->rx + SPM_BUFSIZ_COST(len) > c.bufsiz) {
+                rc = mem_flush(dev, m, out_msgs);
+                if (rc != SPM_OK) break;
+            }
+
+            uint8_t *h = m->hdr[m->n / 2];
+            h[0] = c.read_cmd;
+            for (unsigned k = 0; k < c.addr_bytes; k++) h[1 + k] = (uint8_t)(addr >> (8 * (c.addr_bytes - 1 - k)));
+            memset(h + 1 + c.addr_bytes, 0, c.dummy_bytes);
+
+            m->x[m->n++] = (spm_batch_xfer_t){ .tx = h, .len = hl };
+            m->x[m->n++] = (spm_batch_xfer_t){ .rx = p, .len = len, .cs_change = true };
+            m->tx += SPM_BUFSIZ_COST(hl);
+            m->rx += SPM_BUFSIZ_COST(len);
+
+            addr += (uint32_t)len;
+            p    += len;
+            left -= len;
+        }
+    }
+    if (rc == SPM_OK) rc = mem_flush(dev, m, out_msgs);
+    free(m);
+    return rc;
 }
 
 spm_ecode_t spm_dev_get_cfg(spm_device_t *dev, spm_cfg_t *out_cfg) {
     if (!v_dev_is_valid(dev)) return SPM_ESTATE;
     VALIDATE_PARAM(out_cfg, dev);
+    WC_SYNC(dev);
     
     spm_ecode_t rc = read_device_config(dev, out_cfg);
     if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
@@ -430,6 +1218,7 @@ spm_ecode_t spm_dev_get_cfg(spm_device_t *dev, spm_cfg_t *out_cfg) {
 spm_ecode_t spm_dev_set_cfg(spm_device_t *dev, const spm_cfg_t *cfg) {
     if (!v_dev_is_valid(dev)) return SPM_ESTATE;
     VALIDATE_PARAM(cfg, dev);
+    WC_SYNC(dev);
 
     spm_cfg_t tmp = *cfg;
     sanitize_cfg(&tmp);
@@ -446,6 +1235,7 @@ spm_ecode_t spm_dev_set_cfg(spm_device_t *dev, const spm_cfg_t *cfg) {
 
 spm_ecode_t spm_dev_refresh_cfg(spm_device_t *dev) {
     if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    WC_SYNC(dev);
     
     spm_ecode_t rc = read_device_config(dev, &dev->cfg);
     if (rc != SPM_OK) SPM_ERROR(&dev->err, rc);
@@ -477,6 +1267,270 @@ spm_ecode_t spm_dev_set_bpw(spm_device_t *dev, uint8_t bpw) {
     return spm_dev_set_cfg(dev, &cfg);
 }
 
+spm_ecode_t spm_dev_set_validation(spm_device_t *dev, spm_validation_t level) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    VALIDATE_PARAM(level >= SPM_VALIDATE_NONE && level <= SPM_VALIDATE_FULL, dev);
+
+    dev->validation = level;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_get_validation(const spm_device_t *dev, spm_validation_t *out_level) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!out_level) return SPM_EPARAM;
+    *out_level = dev->validation;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_set_cfg_policy(spm_device_t *dev, spm_cfg_policy_t policy) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    VALIDATE_PARAM(policy == SPM_CFG_DRIVER || policy == SPM_CFG_PER_TRANSFER, dev);
+
+    if (policy == dev->cfg_policy) return SPM_OK;
+    WC_SYNC(dev);
+
+    /* Leaving per-transfer mode: bring driver state back in sync */
+    if (policy == SPM_CFG_DRIVER) {
+        spm_cfg_t tmp = dev->cfg;
+        dev->cfg_policy = SPM_CFG_DRIVER;
+
+        spm_ecode_t rc = write_device_config(dev, &tmp);
+        if (rc != SPM_OK) {
+            dev->cfg_policy = SPM_CFG_PER_TRANSFER;
+            SPM_ERROR(&dev->err, rc);
+            return rc;
+        }
+        dev->cfg = tmp;
+        return SPM_OK;
+    }
+
+    dev->cfg_policy = policy;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_get_cfg_policy(const spm_device_t *dev, spm_cfg_policy_t *out_policy) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!out_policy) return SPM_EPARAM;
+    *out_policy = dev->cfg_policy;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_set_write_combining(spm_device_t *dev, const spm_wc_cfg_t *cfg) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (cfg) VALIDATE_PARAM(cfg->max_xfers <= SPM_MAX_BATCH_XFERS && cfg->max_bytes <= UINT32_MAX, dev);
+
+    /* Reconfiguring drains the old batch and timer first */
+    spm_ecode_t rc = SPM_OK;
+    if (dev->wc) {
+        rc = wc_flush(dev);
+        wc_destroy(dev->wc);
+        dev->wc = NULL;
+    }
+    if (!cfg) return rc;
+
+    struct spm_wc *wc = NULL;
+    spm_ecode_t crc = wc_create(cfg, &wc);
+    if (crc != SPM_OK) {
+        SPM_ERROR(&dev->err, crc);
+        return crc;
+    }
+
+    dev->wc = wc;
+    if (wc->cfg.max_delay_us) {
+        if (pthread_create(&wc->thread, NULL, wc_timer_main, dev) != 0) {
+            dev->wc = NULL;
+            wc_destroy(wc);
+            SPM_ERROR(&dev->err, SPM_ENOMEM);
+            return SPM_ENOMEM;
+        }
+        wc->has_thread = true;
+    }
+    return rc;
+}
+
+spm_ecode_t spm_dev_flush(spm_device_t *dev) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    WC_SYNC(dev);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_get_wc_stats(spm_device_t *dev, spm_wc_stats_t *out_stats) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!out_stats) return SPM_EPARAM;
+
+    if (!dev->wc) {
+        memset(out_stats, 0, sizeof(*out_stats));
+        return SPM_OK;
+    }
+
+    pthread_mutex_lock(&dev->wc->lock);
+    *out_stats = dev->wc->stats;
+    pthread_mutex_unlock(&dev->wc->lock);
+
+    out_stats->avg_combine = out_stats->flushes
+                             ? (double)out_stats->writes / (double)out_stats->flushes
+                             : 0.0;
+    return SPM_OK;
+}
+
+/* Publishes the counters; the wc timer only reads them under the wc lock */
+static void tags_swap(spm_device_t *dev, struct spm_tags *next)
+{
+    struct spm_tags *prev = dev->tags;
+    if (dev->wc) pthread_mutex_lock(&dev->wc->lock);
+    dev->tags = next;
+    if (dev->wc) pthread_mutex_unlock(&dev->wc->lock);
+    tags_destroy(prev);
+}
+
+spm_ecode_t spm_dev_set_tag_accounting(spm_device_t *dev, bool enable) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!enable) {
+        tags_swap(dev, NULL);
+        return SPM_OK;
+    }
+
+    struct spm_tags *next = malloc(sizeof(*next));
+    if (!next) return SPM_ENOMEM;
+    pthread_mutex_init(&next->lock, NULL);
+    tags_clear(next);
+    tags_swap(dev, next);
+    return SPM_OK;
+}
+
+/* Same publication rule as tags_swap() */
+static void live_swap(spm_device_t *dev, spm_live_slot_t *next)
+{
+    spm_live_slot_t *prev = dev->live;
+    if (dev->wc) pthread_mutex_lock(&dev->wc->lock);
+    dev->live = next;
+    if (next && dev->wc) spm_live_slot_set_pending(next, (uint32_t)dev->wc->count);
+    if (dev->wc) pthread_mutex_unlock(&dev->wc->lock);
+    spm_live_slot_release(prev);
+}
+
+spm_ecode_t spm_dev_set_live(spm_device_t *dev, bool enable) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!enable) {
+        live_swap(dev, NULL);
+        return SPM_OK;
+    }
+    if (dev->live) return SPM_OK;
+
+    spm_live_slot_t *slot;
+    spm_ecode_t rc = spm_live_slot_claim(dev->path, &slot);
+    if (rc != SPM_OK) return rc;
+    live_swap(dev, slot);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_set_tag(spm_device_t *dev, uint8_t tag) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    VALIDATE_PARAM(tag < SPM_MAX_TAGS, dev);
+    dev->tag = tag;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_get_tag(const spm_device_t *dev, uint8_t *out_tag) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!out_tag) return SPM_EPARAM;
+    *out_tag = dev->tag;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_get_tag_stats(spm_device_t *dev, spm_tag_stats_t *out_stats, size_t cap,
+                                  size_t *out_count) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!out_count || (!out_stats && cap)) return SPM_EPARAM;
+    *out_count = 0;
+    if (!dev->tags) return SPM_ESTATE;
+
+    spm_tag_stats_t snap[SPM_MAX_TAGS];
+    pthread_mutex_lock(&dev->tags->lock);
+    memcpy(snap, dev->tags->stat, sizeof snap);
+    pthread_mutex_unlock(&dev->tags->lock);
+
+    uint64_t wire = 0;
+    for (size_t i = 0; i < SPM_MAX_TAGS; i++) wire += snap[i].wire_ns;
+
+    size_t n = 0;
+    for (size_t i = 0; i < SPM_MAX_TAGS; i++) {
+        if (!snap[i].messages) continue;
+        snap[i].wire_share = wire ? (double)snap[i].wire_ns / (double)wire : 0.0;
+        if (n < cap) out_stats[n] = snap[i];
+        n++;
+    }
+    *out_count = n;
+    return n > cap ? SPM_ENOMEM : SPM_OK;
+}
+
+spm_ecode_t spm_dev_reset_tag_stats(spm_device_t *dev) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    if (!dev->tags) return SPM_ESTATE;
+    tags_clear(dev->tags);
+    return SPM_OK;
+}
+
+static bool hook_equals(const spm_hook_t *a, const spm_hook_t *b)
+{
+    return a->pre == b->pre && a->post == b->post && a->ctx == b->ctx;
+}
+
+/* Publishes a new chain; the wc timer only reads it under the wc lock */
+static void hooks_swap(spm_device_t *dev, struct spm_hooks *next)
+{
+    struct spm_hooks *prev = dev->hooks;
+    if (dev->wc) pthread_mutex_lock(&dev->wc->lock);
+    dev->hooks = next;
+    if (dev->wc) pthread_mutex_unlock(&dev->wc->lock);
+    free(prev);
+}
+
+spm_ecode_t spm_dev_add_hook(spm_device_t *dev, const spm_hook_t *hook) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    VALIDATE_PARAM(hook && (hook->pre || hook->post), dev);
+
+    size_t n = dev->hooks ? dev->hooks->count : 0;
+    for (size_t i = 0; i < n; i++) {
+        if (hook_equals(&dev->hooks->hook[i], hook)) return SPM_ESTATE;
+    }
+    if (n == SPM_MAX_HOOKS) return SPM_ENOMEM;
+
+    struct spm_hooks *next = malloc(sizeof(*next));
+    if (!next) return SPM_ENOMEM;
+
+    if (dev->hooks) *next = *dev->hooks;
+    next->hook[n] = *hook;
+    next->count = n + 1;
+    hooks_swap(dev, next);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dev_remove_hook(spm_device_t *dev, const spm_hook_t *hook) {
+    if (!v_dev_is_valid(dev)) return SPM_ESTATE;
+    VALIDATE_PARAM(hook, dev);
+
+    size_t n = dev->hooks ? dev->hooks->count : 0;
+    size_t at = n;
+    for (size_t i = 0; i < n; i++) {
+        if (hook_equals(&dev->hooks->hook[i], hook)) at = i;
+    }
+    if (at == n) return SPM_EPARAM;
+
+    /* Last hook gone: back to the unhooked fast path */
+    struct spm_hooks *next = NULL;
+    if (n > 1) {
+        next = malloc(sizeof(*next));
+        if (!next) return SPM_ENOMEM;
+
+        *next = *dev->hooks;
+        memmove(&next->hook[at], &next->hook[at + 1], (n - at - 1) * sizeof(next->hook[0]));
+        next->count = n - 1;
+    }
+    hooks_swap(dev, next);
+    return SPM_OK;
+}
+
 spm_ecode_t spm_dev_get_path(const spm_device_t *dev, char *out_path, size_t size) {
     if (!v_dev_is_valid(dev)) return SPM_ESTATE;
     if (!out_path || size == 0) return SPM_EPARAM;
@@ -0,0 +1,551 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_acq.h"
+
+#define SPM_ACQ_TUNE_DECAY    0.95    /* weight kept by older fill samples */
+#define SPM_ACQ_TUNE_PROBE    8u      /* one fill in this many runs at another depth */
+
+typedef enum {
+    BUF_FREE = 0,
+    BUF_FILLING,
+    BUF_READY,
+    BUF_HELD,
+} buf_state_t;
+
+typedef struct {
+    uint8_t          *data;
+    spm_batch_xfer_t *xfers;
+    size_t            len;        /* valid bytes after processing */
+    uint64_t          seq;
+    buf_state_t       state;
+} acq_buf_t;
+
+/**
+ * @brief Depth autotuner
+ *
+ * Exponentially decayed least-squares fit of fill time against depth.
+ * Probing another depth now and then keeps both terms observable, and
+ * the decay lets the fit follow speed or load changes.
+ */
+typedef struct {
+    double    s, sx, sy, sxx, sxy;
+    double    overhead_ns;
+    double    xfer_ns;
+    uint32_t  depth;
+    uint32_t  max_depth;
+    uint64_t  fills;
+} acq_tuner_t;
+
+/**
+ * @brief Ping-pong acquisition
+ */
+struct spm_acq {
+    spm_device_t     *dev;
+    spm_acq_cfg_t     cfg;
+    size_t            nxfers;     /* transfers per block */
+    size_t           *msg_end;    /* transfer index ending each message */
+    size_t            nmsgs;      /* messages per block */
+    acq_tuner_t       tuner;      /* used when cfg.latency_us is set */
+    acq_buf_t        *bufs;
+    uint8_t          *tx_frame;   /* tx template shared by all frames */
+
+    int              *ready;      /* FIFO of ready buffer indices */
+    size_t            ready_head;
+    size_t            ready_count;
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond_ready;
+    pthread_cond_t    cond_free;
+    bool              started;    /* thread needs joining */
+    bool              running;
+    bool              stop;
+    spm_ecode_t       fill_err;
+    uint64_t          next_seq;
+    spm_acq_stats_t   stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void deadline_after_ms(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool v_cfg_is_valid(const spm_acq_cfg_t *cfg)
+{
+    if (!cfg || cfg->block_len == 0)                          return false;
+    if (cfg->nbufs == 1)                                      return false;
+    if (cfg->block_len > UINT32_MAX)                          return false;
+    if (cfg->frame_len && cfg->block_len % cfg->frame_len)    return false;
+    if (cfg->frame_len > UINT32_MAX)                          return false;
+    if (!cfg->frame_len && cfg->tx_frame)                     return false;
+
+    size_t bufsiz = cfg->bufsiz ? cfg->bufsiz : SPM_BUFSIZ_DEFAULT;
+    size_t step   = cfg->frame_len ? cfg->frame_len : cfg->chunk_len;
+    if (bufsiz < SPM_BUFSIZ_ALIGN)                            return false;
+    if (SPM_BUFSIZ_COST(step) > bufsiz)                       return false;
+    return true;
+}
+
+static void ready_push(spm_acq_t *acq, int idx)
+{
+    size_t tail = (acq->ready_head + acq->ready_count) % acq->cfg.nbufs;
+    acq->ready[tail] = idx;
+    acq->ready_count++;
+}
+
+static int ready_pop(spm_acq_t *acq)
+{
+    int idx = acq->ready[acq->ready_head];
+    acq->ready_head = (acq->ready_head + 1) % acq->cfg.nbufs;
+    acq->ready_count--;
+    return idx;
+}
+
+static int find_free(const spm_acq_t *acq)
+{
+    for (size_t i = 0; i < acq->cfg.nbufs; i++) {
+        if (acq->bufs[i].state == BUF_FREE) return (int)i;
+    }
+    return -1;
+}
+
+static size_t xfer_len(const spm_acq_t *acq, size_t k)
+{
+    const spm_acq_cfg_t *cfg = &acq->cfg;
+    size_t step = cfg->frame_len ? cfg->frame_len : cfg->chunk_len;
+    size_t off  = k * step;
+    return cfg->block_len - off < step ? cfg->block_len - off : step;
+}
+
+/* Cut the block's transfers into messages spidev accepts; returns count */
+static size_t split_messages(const spm_acq_t *acq, size_t *msg_end)
+{
+    size_t nmsgs = 0, n = 0, tx = 0, rx = 0;
+
+    for (size_t k = 0; k < acq->nxfers; k++) {
+        size_t cost = SPM_BUFSIZ_COST(xfer_len(acq, k));
+        size_t tx_cost = acq->tx_frame ? cost : 0;
+
+        if (n && (n == SPM_MAX_BATCH_XFERS || tx + tx_cost > acq->cfg.bufsiz ||
+                  rx + cost > acq->cfg.bufsiz)) {
+            if (msg_end) msg_end[nmsgs] = k;
+            nmsgs++;
+            n = tx = rx = 0;
+        }
+        n++;
+        tx += tx_cost;
+        rx += cost;
+    }
+    if (msg_end) msg_end[nmsgs] = acq->nxfers;
+    return nmsgs + 1;
+}
+
+/* Prepared batch of one block: frames with CS toggles or plain chunks */
+static void build_xfers(spm_acq_t *acq, acq_buf_t *buf)
+{
+    const spm_acq_cfg_t *cfg = &acq->cfg;
+    size_t step = cfg->frame_len ? cfg->frame_len : cfg->chunk_len;
+
+    for (size_t k = 0; k < acq->nxfers; k++) {
+        buf->xfers[k] = (spm_batch_xfer_t){
+            .tx          = acq->tx_frame,
+            .rx          = buf->data + k * step,
+            .len         = xfer_len(acq, k),
+            .delay_usecs = cfg->frame_len ? cfg->frame_delay_usecs : 0,
+            .cs_change   = cfg->frame_len != 0,
+        };
+    }
+
+    /* cs_change on the last transfer of a message would keep CS asserted */
+    for (size_t m = 0; m < acq->nmsgs; m++) {
+        buf->xfers[acq->msg_end[m] - 1].cs_change = false;
+    }
+}
+
+static spm_ecode_t fill_block(spm_acq_t *acq, acq_buf_t *buf)
+{
+    size_t k = 0;
+    for (size_t m = 0; m < acq->nmsgs; m++) {
+        spm_ecode_t rc = spm_batch(acq->dev, buf->xfers + k, acq->msg_end[m] - k);
+        if (rc != SPM_OK) return rc;
+        k = acq->msg_end[m];
+    }
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ===================== Autotuning ===================== */
+/* ====================================================== */
+
+/* max_depth: transfers in the block's first message */
+static void tuner_init(acq_tuner_t *t, size_t max_depth)
+{
+    memset(t, 0, sizeof(*t));
+    t->max_depth = (uint32_t)max_depth;
+    t->depth = 1;
+}
+
+static uint32_t tuner_pick(const acq_tuner_t *t)
+{
+    if (t->fills % SPM_ACQ_TUNE_PROBE != 1 || t->max_depth < 2) return t->depth;
+    return t->depth > 1 ? t->depth / 2 : 2;
+}
+
+static void tuner_update(acq_tuner_t *t, uint32_t depth, uint64_t ns, uint32_t latency_us)
+{
+    const double d = depth, y = (double)ns, k = SPM_ACQ_TUNE_DECAY;
+    t->s   = k * t->s   + 1.0;
+    t->sx  = k * t->sx  + d;
+    t->sy  = k * t->sy  + y;
+    t->sxx = k * t->sxx + d * d;
+    t->sxy = k * t->sxy + d * y;
+    t->fills++;
+
+    /* Needs two distinct depths in the window */
+    double den = t->s * t->sxx - t->sx * t->sx;
+    if (den < 1e-6 * t->s * t->s) return;
+
+    double w = (t->s * t->sxy - t->sx * t->sy) / den;
+    double o = (t->sy - w * t->sx) / t->s;
+    t->xfer_ns     = w > 1.0 ? w : 1.0;
+    t->overhead_ns = o > 0.0 ? o : 0.0;
+
+    double target = ((double)latency_us * 1000.0 - t->overhead_ns) / t->xfer_ns;
+    if (target < 1.0)            t->depth = 1;
+    else if (target > t->max_depth) t->depth = t->max_depth;
+    else                         t->depth = (uint32_t)target;
+}
+
+/* One message of depth transfers from the block's start */
+static spm_ecode_t fill_tuned(spm_acq_t *acq, acq_buf_t *buf, uint32_t depth)
+{
+    /* The message's last transfer must release CS like a block end */
+    spm_batch_xfer_t *last = &buf->xfers[depth - 1];
+    bool cs = last->cs_change;
+    last->cs_change = false;
+    spm_ecode_t rc = spm_batch(acq->dev, buf->xfers, depth);
+    last->cs_change = cs;
+    return rc;
+}
+
+/* ====================================================== */
+/* ==================== Fill Thread ===================== */
+/* ====================================================== */
+
+/* Called with lock held; returns a buffer to fill or -1 on stop */
+static int claim_buffer(spm_acq_t *acq)
+{
+    bool counted = false;
+
+    for (;;) {
+        if (acq->stop) return -1;
+
+        int idx = find_free(acq);
+        if (idx >= 0) return idx;
+
+        if (!counted) {
+            acq->stats.overruns++;
+            counted = true;
+        }
+
+        if (acq->cfg.overwrite && acq->ready_count > 0) {
+            idx = ready_pop(acq);
+            acq->stats.dropped++;
+            return idx;
+        }
+
+        pthread_cond_wait(&acq->cond_free, &acq->lock);
+    }
+}
+
+static void *fill_thread(void *arg)
+{
+    spm_acq_t *acq = arg;
+
+    pthread_mutex_lock(&acq->lock);
+    for (;;) {
+        int idx = claim_buffer(acq);
+        if (idx < 0) break;
+
+        acq_buf_t *buf = &acq->bufs[idx];
+        buf->state = BUF_FILLING;
+        pthread_mutex_unlock(&acq->lock);
+
+        const size_t step = acq->cfg.frame_len ? acq->cfg.frame_len : acq->cfg.chunk_len;
+        uint32_t depth = 0;
+        uint64_t msgs;
+
+        uint64_t t0 = now_ns();
+        spm_ecode_t rc;
+        if (acq->cfg.latency_us) {
+            depth = tuner_pick(&acq->tuner);
+            rc = fill_tuned(acq, buf, depth);
+            msgs = 1;
+        } else {
+            rc = fill_block(acq, buf);
+            msgs = acq->nmsgs;
+        }
+        uint64_t t1 = now_ns();
+
+        buf->len = acq->cfg.block_len;
+        if (depth) {
+            if (rc == SPM_OK) tuner_update(&acq->tuner, depth, t1 - t0, acq->cfg.latency_us);
+            if ((size_t)depth * step < buf->len) buf->len = (size_t)depth * step;
+        }
+        if (rc == SPM_OK && acq->cfg.process) {
+            size_t filled = buf->len;
+            rc = acq->cfg.process(acq->cfg.process_ctx, buf->data, &buf->len);
+            if (buf->len > filled) rc = SPM_EPARAM;
+        }
+        uint64_t t2 = acq->cfg.process ? now_ns() : t1;
+
+        pthread_mutex_lock(&acq->lock);
+        acq->stats.fill_ns += t1 - t0;
+        acq->stats.process_ns += t2 - t1;
+        acq->stats.messages += msgs;
+        if (depth) {
+            const acq_tuner_t *t = &acq->tuner;
+            acq->stats.depth           = t->depth;
+            acq->stats.msg_overhead_ns = t->overhead_ns;
+            acq->stats.xfer_ns         = t->xfer_ns;
+            acq->stats.est_latency_ns  = t->overhead_ns + t->depth * t->xfer_ns;
+            acq->stats.est_xfers_per_s = acq->stats.est_latency_ns > 0.0
+                                         ? t->depth * 1e9 / acq->stats.est_latency_ns : 0.0;
+        }
+
+        if (rc != SPM_OK) {
+            buf->state = BUF_FREE;
+            acq->stats.errors++;
+            acq->fill_err = rc;
+            break;
+        }
+
+        buf->seq = acq->next_seq++;
+        buf->state = BUF_READY;
+        ready_push(acq, idx);
+        acq->stats.blocks++;
+        pthread_cond_signal(&acq->cond_ready);
+    }
+
+    acq->running = false;
+    pthread_cond_broadcast(&acq->cond_ready);
+    pthread_mutex_unlock(&acq->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_acq_create(spm_device_t *dev, const spm_acq_cfg_t *cfg, spm_acq_t **out_acq)
+{
+    if (!out_acq) return SPM_EPARAM;
+    *out_acq = NULL;
+    if (!dev || !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_acq_t *acq = calloc(1, sizeof(*acq));
+    if (!acq) return SPM_ENOMEM;
+
+    acq->dev = dev;
+    acq->cfg = *cfg;
+    if (acq->cfg.nbufs == 0)     acq->cfg.nbufs = 2;
+    if (acq->cfg.bufsiz == 0)    acq->cfg.bufsiz = SPM_BUFSIZ_DEFAULT;
+    if (acq->cfg.chunk_len == 0) acq->cfg.chunk_len = acq->cfg.bufsiz & ~(size_t)(SPM_BUFSIZ_ALIGN - 1);
+
+    size_t step = acq->cfg.frame_len ? acq->cfg.frame_len : acq->cfg.chunk_len;
+    acq->nxfers = (acq->cfg.block_len + step - 1) / step;
+
+    acq->bufs  = calloc(acq->cfg.nbufs, sizeof(*acq->bufs));
+    acq->ready = calloc(acq->cfg.nbufs, sizeof(*acq->ready));
+    if (!acq->bufs || !acq->ready) goto nomem;
+
+    if (cfg->tx_frame) {
+        acq->tx_frame = malloc(cfg->frame_len);
+        if (!acq->tx_frame) goto nomem;
+        memcpy(acq->tx_frame, cfg->tx_frame, cfg->frame_len);
+    }
+
+    acq->nmsgs   = split_messages(acq, NULL);
+    acq->msg_end = malloc(acq->nmsgs * sizeof(*acq->msg_end));
+    if (!acq->msg_end) goto nomem;
+    split_messages(acq, acq->msg_end);
+
+    tuner_init(&acq->tuner, acq->msg_end[0]);
+    acq->stats.depth = acq->cfg.latency_us ? 1 : acq->tuner.max_depth;
+
+    for (size_t i = 0; i < acq->cfg.nbufs; i++) {
+        acq->bufs[i].data  = calloc(1, acq->cfg.block_len);
+        acq->bufs[i].xfers = calloc(acq->nxfers, sizeof(spm_batch_xfer_t));
+        if (!acq->bufs[i].data || !acq->bufs[i].xfers) goto nomem;
+        build_xfers(acq, &acq->bufs[i]);
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&acq->lock, NULL);
+    pthread_cond_init(&acq->cond_ready, &ca);
+    pthread_cond_init(&acq->cond_free, &ca);
+    pthread_condattr_destroy(&ca);
+
+    *out_acq = acq;
+    return SPM_OK;
+
+nomem:
+    if (acq->bufs) {
+        for (size_t i = 0; i < acq->cfg.nbufs; i++) {
+            free(acq->bufs[i].data);
+            free(acq->bufs[i].xfers);
+        }
+    }
+    free(acq->bufs);
+    free(acq->ready);
+    free(acq->tx_frame);
+    free(acq->msg_end);
+    free(acq);
+    return SPM_ENOMEM;
+}
+
+spm_ecode_t spm_acq_start(spm_acq_t *acq)
+{
+    if (!acq) return SPM_EPARAM;
+
+    pthread_mutex_lock(&acq->lock);
+    if (acq->started) {
+        pthread_mutex_unlock(&acq->lock);
+        return SPM_ESTATE;
+    }
+    acq->running  = true;
+    acq->stop     = false;
+    acq->fill_err = SPM_OK;
+    pthread_mutex_unlock(&acq->lock);
+
+    if (pthread_create(&acq->thread, NULL, fill_thread, acq) != 0) {
+        pthread_mutex_lock(&acq->lock);
+        acq->running = false;
+        pthread_mutex_unlock(&acq->lock);
+        return SPM_ENOMEM;
+    }
+    acq->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_acq_stop(spm_acq_t *acq)
+{
+    if (!acq) return SPM_EPARAM;
+
+    if (!acq->started) return SPM_OK;
+
+    pthread_mutex_lock(&acq->lock);
+    acq->stop = true;
+    pthread_cond_broadcast(&acq->cond_free);
+    pthread_mutex_unlock(&acq->lock);
+
+    pthread_join(acq->thread, NULL);
+    acq->started = false;
+    return SPM_OK;
+}
+
+void spm_acq_destroy(spm_acq_t *acq)
+{
+    if (!acq) return;
+    spm_acq_stop(acq);
+
+    for (size_t i = 0; i < acq->cfg.nbufs; i++) {
+        free(acq->bufs[i].data);
+        free(acq->bufs[i].xfers);
+    }
+    pthread_cond_destroy(&acq->cond_ready);
+    pthread_cond_destroy(&acq->cond_free);
+    pthread_mutex_destroy(&acq->lock);
+    free(acq->bufs);
+    free(acq->ready);
+    free(acq->tx_frame);
+    free(acq->msg_end);
+    free(acq);
+}
+
+spm_ecode_t spm_acq_acquire(spm_acq_t *acq, int timeout_ms, spm_acq_block_t *out_blk)
+{
+    if (!acq || !out_blk) return SPM_EPARAM;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) deadline_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&acq->lock);
+    if (acq->ready_count == 0 && acq->running) acq->stats.consumer_waits++;
+
+    while (acq->ready_count == 0) {
+        spm_ecode_t rc = SPM_OK;
+        if (!acq->running) rc = acq->fill_err != SPM_OK ? acq->fill_err : SPM_ESTATE;
+        else if (timeout_ms == 0) rc = SPM_ETIMEOUT;
+        else if (timeout_ms < 0) pthread_cond_wait(&acq->cond_ready, &acq->lock);
+        else if (pthread_cond_timedwait(&acq->cond_ready, &acq->lock, &deadline) != 0
+                 && acq->ready_count == 0 && acq->running) rc = SPM_ETIMEOUT;
+
+        if (rc != SPM_OK) {
+            pthread_mutex_unlock(&acq->lock);
+            return rc;
+        }
+    }
+
+    int idx = ready_pop(acq);
+    acq_buf_t *buf = &acq->bufs[idx];
+    buf->state = BUF_HELD;
+
+    *out_blk = (spm_acq_block_t){
+        .data  = buf->data,
+        .len   = buf->len,
+        .seq   = buf->seq,
+        .index = idx,
+    };
+    pthread_mutex_unlock(&acq->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_acq_release(spm_acq_t *acq, const spm_acq_block_t *blk)
+{
+    if (!acq || !blk) return SPM_EPARAM;
+    if (blk->index < 0 || (size_t)blk->index >= acq->cfg.nbufs) return SPM_EPARAM;
+
+    pthread_mutex_lock(&acq->lock);
+    acq_buf_t *buf = &acq->bufs[blk->index];
+    if (buf->state != BUF_HELD || buf->data != blk->data) {
+        pthread_mutex_unlock(&acq->lock);
+        return SPM_EPARAM;
+    }
+    buf->state = BUF_FREE;
+    pthread_cond_signal(&acq->cond_free);
+    pthread_mutex_unlock(&acq->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_acq_get_stats(spm_acq_t *acq, spm_acq_stats_t *out_stats)
+{
+    if (!acq || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&acq->lock);
+    *out_stats = acq->stats;
+    pthread_mutex_unlock(&acq->lock);
+    return SPM_OK;
+}
@@ -0,0 +1,647 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_asset.h"
+
+#define SPM_ASSET_DEFAULT_CMD     0x03
+#define SPM_ASSET_DEFAULT_ADDR    3u
+#define SPM_ASSET_MAX_DUMMY       8u
+
+/*
+ * Packed layout (little-endian): a 20-byte header holding magic, block
+ * size, uncompressed size, block count and a CRC-32 over the first 16
+ * header bytes and the index; then blocks + 1 index words, each the
+ * offset of a block from the end of the index with bit 31 set when the
+ * block is stored raw, the last one giving the end; then the blocks.
+ */
+#define HDR_MAGIC      0x315A4C53u   /* "SLZ1" */
+#define HDR_SIZE       20u
+#define IDX_RAW        0x80000000u
+#define IDX_OFF_MASK   0x7FFFFFFFu
+
+/* LZ4 block format */
+#define LZ4_MINMATCH       4u
+#define LZ4_LASTLITERALS   5u
+#define LZ4_MFLIMIT        12u
+#define LZ4_MAX_DISTANCE   65535u
+#define LZ4_HASH_LOG       12
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_QUEUED,      /* waiting for the prefetch thread */
+    SLOT_READY,       /* read finished, rc says how */
+} slot_state_t;
+
+typedef struct {
+    slot_state_t  state;
+    uint32_t      block;
+    spm_ecode_t   rc;
+    uint8_t      *buf;        /* one packed block */
+} asset_slot_t;
+
+/**
+ * @brief Packed asset reader
+ *
+ * Two slot buffers alternate between the prefetch thread and the
+ * caller: the thread reads slot s ^ 1 while the caller decodes slot s.
+ * Both sides take slots in the same order, so a single toggle on each
+ * side keeps them paired.
+ */
+struct spm_asset {
+    spm_device_t     *dev;
+    spm_asset_cfg_t   cfg;
+    uint32_t          addr;
+    uint32_t          data_addr;  /* first block */
+    uint32_t          size;
+    uint32_t          block_size;
+    uint32_t          blocks;
+    uint32_t          packed_size;
+    uint32_t         *index;      /* blocks + 1 words */
+
+    asset_slot_t      slot[2];
+    unsigned          head;       /* caller's next slot */
+    unsigned          tail;       /* prefetch thread's next slot */
+    uint8_t          *cache;      /* last partially used block */
+    int64_t           cached;     /* its number (-1 = none) */
+
+    pthread_t         thread;
+    pthread_mutex_t   read_lock;  /* one spm_asset_read() at a time */
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    bool              started;    /* thread needs joining */
+    bool              stop;
+
+    spm_asset_stats_t stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+    }
+    return ~crc;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static bool v_cfg_is_valid(const spm_asset_cfg_t *cfg)
+{
+    if (!cfg) return true;
+    if (cfg->addr_bytes && cfg->addr_bytes != 3 && cfg->addr_bytes != 4) return false;
+    if (cfg->dummy_bytes > SPM_ASSET_MAX_DUMMY) return false;
+    if (cfg->bufsiz && cfg->bufsiz < SPM_BUFSIZ_ALIGN) return false;
+    return true;
+}
+
+static uint32_t block_len(const spm_asset_t *a, uint32_t b)
+{
+    uint32_t start = b * a->block_size;
+    return a->size - start < a->block_size ? a->size - start : a->block_size;
+}
+
+static uint32_t block_off(const spm_asset_t *a, uint32_t b)
+{
+    return a->index[b] & IDX_OFF_MASK;
+}
+
+static uint32_t block_packed(const spm_asset_t *a, uint32_t b)
+{
+    return block_off(a, b + 1) - block_off(a, b);
+}
+
+/* ====================================================== */
+/* ======================== LZ4 ========================= */
+/* ====================================================== */
+
+static uint32_t lz4_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+static uint8_t *lz4_put_len(uint8_t *op, size_t r)
+{
+    while (r >= 255) { *op++ = 255; r -= 255; }
+    *op++ = (uint8_t)r;
+    return op;
+}
+
+/* One sequence: literals, then a match unless ml is 0 (the last one). */
+static uint8_t *lz4_emit(uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t nlit,
+                         size_t off, size_t ml)
+{
+    size_t need = 1 + (nlit >= 15 ? (nlit - 15) / 255 + 1 : 0) + nlit;
+    if (ml) need += 2 + (ml - LZ4_MINMATCH >= 15 ? (ml - LZ4_MINMATCH - 15) / 255 + 1 : 0);
+    if (need > (size_t)(oend - op)) return NULL;
+
+    uint8_t *tok = op++;
+    *tok = (uint8_t)((nlit < 15 ? nlit : 15) << 4);
+    if (nlit >= 15) op = lz4_put_len(op, nlit - 15);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (ml) {
+        size_t m = ml - LZ4_MINMATCH;
+        *op++ = (uint8_t)off;
+        *op++ = (uint8_t)(off >> 8);
+        *tok |= (uint8_t)(m < 15 ? m : 15);
+        if (m >= 15) op = lz4_put_len(op, m - 15);
+    }
+    return op;
+}
+
+/* Greedy single-probe compressor; returns 0 if the output exceeds cap. */
+static size_t lz4_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap)
+{
+    uint32_t table[1u << LZ4_HASH_LOG];   /* position + 1, 0 = empty */
+    uint8_t *op = dst, *oend = dst + cap;
+    size_t ip = 0, anchor = 0;
+
+    memset(table, 0, sizeof table);
+    if (n > LZ4_MFLIMIT) {
+        size_t limit = n - LZ4_MFLIMIT, mlimit = n - LZ4_LASTLITERALS;
+        while (ip < limit) {
+            uint32_t seq = read32(src + ip), h = lz4_hash(seq);
+            size_t ref = table[h];
+            table[h] = (uint32_t)ip + 1;
+            if (!ref || ip - (ref - 1) > LZ4_MAX_DISTANCE || read32(src + ref - 1) != seq) {
+                ip++;
+                continue;
+            }
+            ref--;
+            size_t ml = LZ4_MINMATCH;
+            while (ip + ml < mlimit && src[ref + ml] == src[ip + ml]) ml++;
+            op = lz4_emit(op, oend, src + anchor, ip - anchor, ip - ref, ml);
+            if (!op) return 0;
+            ip += ml;
+            anchor = ip;
+        }
+    }
+    op = lz4_emit(op, oend, src + anchor, n - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+static bool lz4_read_len(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    uint8_t b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/* Decode exactly out_len bytes from exactly n input bytes. */
+static bool lz4_decode(const uint8_t *src, size_t n, uint8_t *dst, size_t out_len)
+{
+    const uint8_t *ip = src, *iend = src + n;
+    uint8_t *op = dst, *oend = dst + out_len;
+
+    while (ip < iend) {
+        unsigned tok = *ip++;
+        size_t lit = tok >> 4;
+        if (lit == 15 && !lz4_read_len(&ip, iend, &lit)) return false;
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return false;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t off = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (!off || off > (size_t)(op - dst)) return false;
+        size_t ml = tok & 15u;
+        if (ml == 15 && !lz4_read_len(&ip, iend, &ml)) return false;
+        ml += LZ4_MINMATCH;
+        if (ml > (size_t)(oend - op)) return false;
+
+        const uint8_t *m = op - off;
+        if (off >= ml) {
+            memcpy(op, m, ml);
+        } else {
+            for (size_t i = 0; i < ml; i++) op[i] = m[i];
+        }
+        op += ml;
+    }
+    return op == oend;
+}
+
+/* ====================================================== */
+/* ======================= Flash ======================== */
+/* ====================================================== */
+
+/* One READ frame per message-sized piece, within bufsiz */
+static spm_ecode_t flash_read(spm_asset_t *a, uint32_t addr, void *out, size_t len, uint64_t *msgs)
+{
+    const spm_mem_cfg_t mc = {
+        .read_cmd    = a->cfg.read_cmd,
+        .addr_bytes  = a->cfg.addr_bytes,
+        .dummy_bytes = a->cfg.dummy_bytes,
+        .bufsiz      = a->cfg.bufsiz,
+    };
+    spm_mem_range_t r = { .addr = addr, .dst = out, .len = len };
+    return spm_mem_read(a->dev, &mc, &r, 1, msgs);
+}
+
+static spm_ecode_t load_index(spm_asset_t *a)
+{
+    uint8_t hdr[HDR_SIZE];
+    spm_ecode_t rc = flash_read(a, a->addr, hdr, sizeof hdr, NULL);
+    if (rc != SPM_OK) return rc;
+    if (get_le32(hdr) != HDR_MAGIC) return SPM_ECRC;
+
+    a->block_size = get_le32(hdr + 4);
+    a->size       = get_le32(hdr + 8);
+    a->blocks     = get_le32(hdr + 12);
+    if (!a->block_size || a->block_size > SPM_ASSET_MAX_BLOCK) return SPM_ECRC;
+    if (a->blocks != (uint32_t)(((uint64_t)a->size + a->block_size - 1) / a->block_size)) return SPM_ECRC;
+
+    size_t idx_len = ((size_t)a->blocks + 1) * 4;
+    uint8_t *raw = malloc(idx_len);
+    a->index = malloc(idx_len);
+    if (!raw || !a->index) {
+        free(raw);
+        return SPM_ENOMEM;
+    }
+    rc = flash_read(a, a->addr + HDR_SIZE, raw, idx_len, NULL);
+    if (rc == SPM_OK) {
+        uint32_t crc = crc32_update(crc32_update(0, hdr, 16), raw, idx_len);
+        if (crc != get_le32(hdr + 16)) rc = SPM_ECRC;
+    }
+    for (uint32_t i = 0; rc == SPM_OK && i <= a->blocks; i++) a->index[i] = get_le32(raw + 4 * i);
+    free(raw);
+    if (rc != SPM_OK) return rc;
+
+    /* the CRC covers torn or foreign data; this covers a bad packer */
+    if (block_off(a, 0) != 0) return SPM_ECRC;
+    for (uint32_t b = 0; b < a->blocks; b++) {
+        uint32_t lo = block_off(a, b), hi = block_off(a, b + 1), blen = block_len(a, b);
+        if (hi < lo) return SPM_ECRC;
+        if ((a->index[b] & IDX_RAW) ? hi - lo != blen : (hi == lo || hi - lo >= blen)) return SPM_ECRC;
+    }
+
+    uint64_t end = (uint64_t)a->addr + HDR_SIZE + idx_len + block_off(a, a->blocks);
+    uint64_t limit = 1ull << (8 * a->cfg.addr_bytes);
+    if (end > limit) return SPM_ECRC;
+    a->data_addr   = (uint32_t)(a->addr + HDR_SIZE + idx_len);
+    a->packed_size = (uint32_t)(end - a->addr);
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ====================== Pipeline ====================== */
+/* ====================================================== */
+
+static void *prefetch_thread(void *arg)
+{
+    spm_asset_t *a = arg;
+
+    pthread_mutex_lock(&a->lock);
+    for (;;) {
+        asset_slot_t *s = &a->slot[a->tail];
+        while (!a->stop && s->state != SLOT_QUEUED) pthread_cond_wait(&a->cond, &a->lock);
+        if (a->stop) break;
+        uint32_t b = s->block;
+        pthread_mutex_unlock(&a->lock);
+
+        uint64_t msgs = 0, t0 = now_ns();
+        spm_ecode_t rc = flash_read(a, a->data_addr + block_off(a, b), s->buf, block_packed(a, b), &msgs);
+        uint64_t dt = now_ns() - t0;
+
+        pthread_mutex_lock(&a->lock);
+        s->rc    = rc;
+        s->state = SLOT_READY;
+        a->stats.read_ns  += dt;
+        a->stats.messages += msgs;
+        if (rc == SPM_OK) a->stats.bytes_in += block_packed(a, b);
+        a->tail ^= 1u;
+        pthread_cond_broadcast(&a->cond);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return NULL;
+}
+
+static void queue_block(spm_asset_t *a, unsigned s, uint32_t b)
+{
+    pthread_mutex_lock(&a->lock);
+    a->slot[s].block = b;
+    a->slot[s].state = SLOT_QUEUED;
+    pthread_cond_broadcast(&a->cond);
+    pthread_mutex_unlock(&a->lock);
+}
+
+static spm_ecode_t take_block(spm_asset_t *a, unsigned s, uint64_t *stall_ns)
+{
+    uint64_t t0 = now_ns();
+    pthread_mutex_lock(&a->lock);
+    while (a->slot[s].state != SLOT_READY) pthread_cond_wait(&a->cond, &a->lock);
+    spm_ecode_t rc = a->slot[s].rc;
+    pthread_mutex_unlock(&a->lock);
+    *stall_ns += now_ns() - t0;
+    return rc;
+}
+
+static void release_block(spm_asset_t *a, unsigned s)
+{
+    pthread_mutex_lock(&a->lock);
+    a->slot[s].state = SLOT_FREE;
+    pthread_mutex_unlock(&a->lock);
+}
+
+/* Serial mode: read on the calling thread, counted like the prefetcher. */
+static spm_ecode_t read_block_now(spm_asset_t *a, uint32_t b, uint8_t *buf)
+{
+    uint64_t msgs = 0, t0 = now_ns();
+    spm_ecode_t rc = flash_read(a, a->data_addr + block_off(a, b), buf, block_packed(a, b), &msgs);
+    uint64_t dt = now_ns() - t0;
+
+    pthread_mutex_lock(&a->lock);
+    a->stats.read_ns  += dt;
+    a->stats.messages += msgs;
+    if (rc == SPM_OK) a->stats.bytes_in += block_packed(a, b);
+    pthread_mutex_unlock(&a->lock);
+    return rc;
+}
+
+/*
+ * Decode block b and copy its part of [offset, offset + len) to dst.
+ * A whole block decodes in place; a partial one goes through the cache.
+ */
+static spm_ecode_t deliver(spm_asset_t *a, uint32_t b, const uint8_t *packed,
+                           uint32_t offset, uint8_t *dst, size_t len, uint64_t *decode_ns)
+{
+    uint64_t start = (uint64_t)b * a->block_size, end = (uint64_t)offset + len;
+    uint32_t blen = block_len(a, b), plen = block_packed(a, b);
+    uint64_t lo = start > offset ? start : offset;
+    uint64_t hi = start + blen < end ? start + blen : end;
+    bool whole = lo == start && hi == start + blen;
+    uint8_t *out = whole ? dst + (start - offset) : a->cache;
+
+    uint64_t t0 = now_ns();
+    bool ok = true;
+    if (a->index[b] & IDX_RAW) {
+        memcpy(out, packed, blen);
+    } else {
+        ok = lz4_decode(packed, plen, out, blen);
+    }
+    *decode_ns += now_ns() - t0;
+
+    if (whole) return ok ? SPM_OK : SPM_ECRC;
+    a->cached = ok ? (int64_t)b : -1;
+    if (!ok) return SPM_ECRC;
+    memcpy(dst + (lo - offset), a->cache + (lo - start), (size_t)(hi - lo));
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+size_t spm_asset_pack_bound(size_t size, uint32_t block_size)
+{
+    if (!block_size || block_size > SPM_ASSET_MAX_BLOCK || size > IDX_OFF_MASK) return 0;
+    size_t blocks = (size + block_size - 1) / block_size;
+    return HDR_SIZE + (blocks + 1) * 4 + size;
+}
+
+spm_ecode_t spm_asset_pack(const void *src, size_t size, uint32_t block_size,
+                           void *out, size_t cap, size_t *out_len)
+{
+    if (out_len) *out_len = 0;
+    if ((!src && size) || !out || !out_len || !spm_asset_pack_bound(size, block_size)) return SPM_EPARAM;
+
+    uint32_t blocks = (uint32_t)((size + block_size - 1) / block_size);
+    size_t data = HDR_SIZE + ((size_t)blocks + 1) * 4;
+    if (cap < data) return SPM_ENOMEM;
+
+    const uint8_t *in = src;
+    uint8_t *o = out;
+    size_t pos = 0;
+    for (uint32_t b = 0; b < blocks; b++) {
+        size_t start = (size_t)b * block_size;
+        size_t blen = size - start < block_size ? size - start : block_size;
+        size_t room = cap - data - pos;
+        size_t c = lz4_compress(in + start, blen, o + data + pos, room < blen - 1 ? room : blen - 1);
+        uint32_t flag = 0;
+        if (!c) {
+            if (room < blen) return SPM_ENOMEM;
+            memcpy(o + data + pos, in + start, blen);
+            c = blen;
+            flag = IDX_RAW;
+        }
+        put_le32(o + HDR_SIZE + 4 * b, (uint32_t)pos | flag);
+        pos += c;
+    }
+    put_le32(o + HDR_SIZE + 4 * blocks, (uint32_t)pos);
+
+    put_le32(o, HDR_MAGIC);
+    put_le32(o + 4, block_size);
+    put_le32(o + 8, (uint32_t)size);
+    put_le32(o + 12, blocks);
+    uint32_t crc = crc32_update(0, o, 16);
+    put_le32(o + 16, crc32_update(crc, o + HDR_SIZE, ((size_t)blocks + 1) * 4));
+
+    *out_len = data + pos;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_asset_open(spm_device_t *dev, uint32_t addr, const spm_asset_cfg_t *cfg,
+                           spm_asset_t **out_asset)
+{
+    if (out_asset) *out_asset = NULL;
+    if (!dev || !out_asset || !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_asset_t *a = calloc(1, sizeof(*a));
+    if (!a) return SPM_ENOMEM;
+
+    a->dev = dev;
+    a->addr = addr;
+    if (cfg) a->cfg = *cfg;
+    if (!a->cfg.read_cmd)   a->cfg.read_cmd   = SPM_ASSET_DEFAULT_CMD;
+    if (!a->cfg.addr_bytes) a->cfg.addr_bytes = SPM_ASSET_DEFAULT_ADDR;
+    if (!a->cfg.bufsiz)     a->cfg.bufsiz     = SPM_BUFSIZ_DEFAULT;
+    a->cached = -1;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&a->read_lock, NULL);
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    spm_ecode_t rc = load_index(a);
+    if (rc == SPM_OK) {
+        a->cache       = malloc(a->block_size);
+        a->slot[0].buf = malloc(a->block_size);
+        a->slot[1].buf = a->cfg.serial ? NULL : malloc(a->block_size);
+        if (!a->cache || !a->slot[0].buf || (!a->cfg.serial && !a->slot[1].buf)) rc = SPM_ENOMEM;
+    }
+    if (rc == SPM_OK && !a->cfg.serial) {
+        if (pthread_create(&a->thread, NULL, prefetch_thread, a) != 0) rc = SPM_ENOMEM;
+        else a->started = true;
+    }
+    if (rc != SPM_OK) {
+        spm_asset_close(a);
+        return rc;
+    }
+
+    *out_asset = a;
+    return SPM_OK;
+}
+
+void spm_asset_close(spm_asset_t *a)
+{
+    if (!a) return;
+    if (a->started) {
+        pthread_mutex_lock(&a->lock);
+        a->stop = true;
+        pthread_cond_broadcast(&a->cond);
+        pthread_mutex_unlock(&a->lock);
+        pthread_join(a->thread, NULL);
+        a->started = false;
+    }
+
+    pthread_cond_destroy(&a->cond);
+    pthread_mutex_destroy(&a->lock);
+    pthread_mutex_destroy(&a->read_lock);
+    free(a->slot[1].buf);
+    free(a->slot[0].buf);
+    free(a->cache);
+    free(a->index);
+    free(a);
+}
+
+spm_ecode_t spm_asset_get_info(const spm_asset_t *a, spm_asset_info_t *out_info)
+{
+    if (!a || !out_info) return SPM_EPARAM;
+    out_info->size        = a->size;
+    out_info->block_size  = a->block_size;
+    out_info->blocks      = a->blocks;
+    out_info->packed_size = a->packed_size;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_asset_read(spm_asset_t *a, uint32_t offset, void *dst, size_t len)
+{
+    if (!a || (!dst && len)) return SPM_EPARAM;
+    if (offset > a->size || len > a->size - offset) return SPM_EPARAM;
+
+    pthread_mutex_lock(&a->read_lock);
+    uint64_t t0 = now_ns(), decode_ns = 0, stall_ns = 0, hits = 0, decoded = 0;
+    uint8_t *out = dst;
+    uint32_t off = offset;
+    size_t left = len;
+    spm_ecode_t rc = SPM_OK;
+
+    /* partial edge blocks still held from the previous call */
+    if (left && a->cached >= 0) {
+        uint32_t b = off / a->block_size, start = b * a->block_size, blen = block_len(a, b);
+        if ((int64_t)b == a->cached && (off != start || left < blen)) {
+            size_t n = start + blen - off < left ? start + blen - off : left;
+            memcpy(out, a->cache + (off - start), n);
+            out += n; off += (uint32_t)n; left -= n; hits++;
+        }
+    }
+    if (left && a->cached >= 0) {
+        uint32_t b = (uint32_t)((off + left - 1) / a->block_size), start = b * a->block_size;
+        if ((int64_t)b == a->cached && off + left < start + block_len(a, b) && off < start) {
+            memcpy(out + (start - off), a->cache, off + left - start);
+            left = start - off; hits++;
+        }
+    }
+
+    if (left) {
+        uint32_t first = off / a->block_size;
+        uint32_t last  = (uint32_t)((off + left - 1) / a->block_size);
+
+        if (a->cfg.serial) {
+            for (uint32_t b = first; b <= last && rc == SPM_OK; b++) {
+                rc = read_block_now(a, b, a->slot[0].buf);
+                if (rc == SPM_OK) rc = deliver(a, b, a->slot[0].buf, off, out, left, &decode_ns);
+                if (rc == SPM_OK) decoded++;
+            }
+        } else {
+            unsigned s = a->head;
+            queue_block(a, s, first);
+            for (uint32_t b = first; b <= last; b++) {
+                bool ahead = b < last;
+                if (ahead) queue_block(a, s ^ 1u, b + 1);
+                rc = take_block(a, s, &stall_ns);
+                if (rc == SPM_OK) rc = deliver(a, b, a->slot[s].buf, off, out, left, &decode_ns);
+                release_block(a, s);
+                s ^= 1u;
+                if (rc != SPM_OK) {
+                    if (ahead) {
+                        take_block(a, s, &stall_ns);
+                        release_block(a, s);
+                        s ^= 1u;
+                    }
+                    break;
+                }
+                decoded++;
+            }
+            a->head = s;
+        }
+    }
+
+    uint64_t dt = now_ns() - t0;
+    pthread_mutex_lock(&a->lock);
+    a->stats.reads++;
+    a->stats.blocks     += decoded;
+    a->stats.cache_hits += hits;
+    a->stats.decode_ns  += decode_ns;
+    a->stats.stall_ns   += stall_ns;
+    a->stats.total_ns   += dt;
+    if (rc == SPM_OK) a->stats.bytes_out += len;
+    pthread_mutex_unlock(&a->lock);
+    pthread_mutex_unlock(&a->read_lock);
+    return rc;
+}
+
+spm_ecode_t spm_asset_get_stats(spm_asset_t *a, spm_asset_stats_t *out_stats)
+{
+    if (!a || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&a->lock);
+    *out_stats = a->stats;
+    pthread_mutex_unlock(&a->lock);
+
+    double hidden = (double)out_stats->read_ns + (double)out_stats->decode_ns - (double)out_stats->total_ns;
+    out_stats->overlap = 0.0;
+    if (out_stats->decode_ns && hidden > 0.0) {
+        out_stats->overlap = hidden / (double)out_stats->decode_ns;
+        if (out_stats->overlap > 1.0) out_stats->overlap = 1.0;
+    }
+    return SPM_OK;
+}
@@ -0,0 +1,412 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spm_boot.h"
+
+#define SPM_BOOT_DEFAULT_BASE     0x08000000u
+#define SPM_BOOT_MAX_CHUNK        256u
+#define SPM_BOOT_DEFAULT_TIMEOUT  1000
+#define SPM_BOOT_ERASE_TIMEOUT    30000
+#define SPM_BOOT_MIN_WINDOW       2u
+#define SPM_BOOT_MAX_WINDOW       256u
+#define SPM_BOOT_SLEEP_MAX_US     2000u
+
+/* Protocol bytes (AN4286) */
+#define BL_SOF          0x5A
+#define BL_ACK          0x79
+#define BL_NACK         0x1F
+#define BL_CMD_READ     0x11
+#define BL_CMD_GO       0x21
+#define BL_CMD_WRITE    0x31
+#define BL_CMD_ERASE    0x44
+
+/* ACK latency differs per phase, so each keeps its own poll window */
+typedef enum {
+    ACK_CMD = 0,
+    ACK_ADDR,
+    ACK_DATA,
+    ACK_ERASE,
+    ACK_KINDS,
+} ack_kind_t;
+
+/**
+ * @brief Bootloader flasher
+ */
+struct spm_boot {
+    spm_device_t      *dev;
+    spm_boot_cfg_t     cfg;
+    bool               host_ack;            /* target waits for our ACK */
+    uint32_t           window[ACK_KINDS];   /* poll bytes appended to each phase */
+    uint8_t           *tx;
+    uint8_t           *rx;
+    spm_boot_stats_t   stats;
+};
+
+/* Scratch: host ACK + N-1 + data + checksum + dummy + window */
+#define SPM_BOOT_MSG_MAX  (1u + 1u + SPM_BOOT_MAX_CHUNK + 1u + 1u + SPM_BOOT_MAX_WINDOW)
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_us(uint32_t us)
+{
+    struct timespec ts = { us / 1000000u, (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+    }
+    return ~crc;
+}
+
+static uint8_t xor_sum(const uint8_t *p, size_t n)
+{
+    uint8_t x = 0;
+    for (size_t i = 0; i < n; i++) x ^= p[i];
+    return x;
+}
+
+static double kbps(size_t bytes, uint64_t ns)
+{
+    return ns ? (double)bytes / 1024.0 / ((double)ns / 1e9) : 0.0;
+}
+
+static bool v_cfg_is_valid(const spm_boot_cfg_t *cfg)
+{
+    if (cfg->chunk > SPM_BOOT_MAX_CHUNK)         return false;
+    if (cfg->chunk && (cfg->chunk < 4 || cfg->chunk % 4)) return false;
+    if (cfg->ack_timeout_ms < 0)                 return false;
+    if (cfg->erase_timeout_ms < 0)               return false;
+    return true;
+}
+
+/* ====================================================== */
+/* ====================== ACK Poll ====================== */
+/* ====================================================== */
+
+static spm_ecode_t xfer(spm_boot_t *b, size_t len)
+{
+    b->stats.messages++;
+    return spm_transfer(b->dev, b->tx, b->rx, len);
+}
+
+/* Size the next window from the bytes this ACK took, with some slack */
+static void adapt_window(spm_boot_t *b, ack_kind_t kind, size_t needed)
+{
+    size_t w = needed + needed / 4 + 1;
+    if (w < SPM_BOOT_MIN_WINDOW) w = SPM_BOOT_MIN_WINDOW;
+    if (w > SPM_BOOT_MAX_WINDOW) w = SPM_BOOT_MAX_WINDOW;
+    b->window[kind] = (uint32_t)w;
+}
+
+static int find_ack(const uint8_t *rx, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (rx[i] == BL_ACK || rx[i] == BL_NACK) return (int)i;
+    }
+    return -1;
+}
+
+/*
+ * Send one protocol phase and wait for its ACK. The host acknowledge
+ * owed for the previous ACK, the phase bytes, the dummy byte and a poll
+ * window all go out in one message; only slow ACKs (programming, erase)
+ * need further poll-only messages, backing off to sleeps.
+ */
+static spm_ecode_t phase(spm_boot_t *b, ack_kind_t kind, const uint8_t *payload, size_t n, int timeout_ms)
+{
+    size_t k = 0;
+    if (b->host_ack) b->tx[k++] = BL_ACK;
+    memcpy(b->tx + k, payload, n);
+    k += n;
+    b->tx[k++] = 0x00;
+
+    size_t at = k;
+    size_t w = b->window[kind];
+    memset(b->tx + k, 0x00, w);
+    k += w;
+
+    spm_ecode_t rc = xfer(b, k);
+    if (rc != SPM_OK) return rc;
+    b->host_ack = false;
+
+    uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ull;
+    size_t polled = 0;
+    unsigned misses = 0;
+
+    for (;;) {
+        int pos = find_ack(b->rx + at, w);
+        if (pos >= 0) {
+            polled += (size_t)pos + 1;
+            b->stats.poll_bytes += polled;
+            adapt_window(b, kind, polled);
+            b->host_ack = true;
+
+            if (b->rx[at + (size_t)pos] == BL_ACK) return SPM_OK;
+            b->stats.nacks++;
+            return SPM_EIO;
+        }
+
+        polled += w;
+        b->stats.poll_misses++;
+        if (now_ns() >= deadline) {
+            b->stats.poll_bytes += polled;
+            return SPM_ETIMEOUT;
+        }
+
+        if (++misses > 2) {
+            uint32_t us = 50u << (misses - 3 < 6 ? misses - 3 : 6);
+            sleep_us(us < SPM_BOOT_SLEEP_MAX_US ? us : SPM_BOOT_SLEEP_MAX_US);
+        }
+
+        w = w * 2 < SPM_BOOT_MAX_WINDOW ? w * 2 : SPM_BOOT_MAX_WINDOW;
+        at = 0;
+        memset(b->tx, 0x00, w);
+        rc = xfer(b, w);
+        if (rc != SPM_OK) return rc;
+    }
+}
+
+static spm_ecode_t command(spm_boot_t *b, uint8_t cmd)
+{
+    const uint8_t frame[3] = { BL_SOF, cmd, (uint8_t)~cmd };
+    return phase(b, ACK_CMD, frame, 3, b->cfg.ack_timeout_ms);
+}
+
+static spm_ecode_t address(spm_boot_t *b, uint32_t addr)
+{
+    uint8_t a[5] = { (uint8_t)(addr >> 24), (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr, 0 };
+    a[4] = xor_sum(a, 4);
+    return phase(b, ACK_ADDR, a, 5, b->cfg.ack_timeout_ms);
+}
+
+static spm_ecode_t write_chunk(spm_boot_t *b, uint32_t addr, const uint8_t *data, size_t n)
+{
+    uint8_t buf[1 + SPM_BOOT_MAX_CHUNK + 1];
+    size_t padded = (n + 3) & ~(size_t)3;
+
+    buf[0] = (uint8_t)(padded - 1);
+    memcpy(buf + 1, data, n);
+    memset(buf + 1 + n, 0xFF, padded - n);
+    buf[1 + padded] = xor_sum(buf, 1 + padded);
+
+    spm_ecode_t rc = command(b, BL_CMD_WRITE);
+    if (rc == SPM_OK) rc = address(b, addr);
+    if (rc == SPM_OK) rc = phase(b, ACK_DATA, buf, padded + 2, b->cfg.ack_timeout_ms);
+    if (rc == SPM_OK) b->stats.bytes_written += n;
+    return rc;
+}
+
+static spm_ecode_t read_chunk(spm_boot_t *b, uint32_t addr, uint8_t *out, size_t n)
+{
+    const uint8_t count[2] = { (uint8_t)(n - 1), (uint8_t)~(n - 1) };
+
+    spm_ecode_t rc = command(b, BL_CMD_READ);
+    if (rc == SPM_OK) rc = address(b, addr);
+    if (rc == SPM_OK) rc = phase(b, ACK_ADDR, count, 2, b->cfg.ack_timeout_ms);
+    if (rc != SPM_OK) return rc;
+
+    /* Host ACK, dummy byte, then the data */
+    memset(b->tx, 0x00, n + 2);
+    b->tx[0] = BL_ACK;
+    rc = xfer(b, n + 2);
+    if (rc != SPM_OK) return rc;
+    b->host_ack = false;
+
+    memcpy(out, b->rx + 2, n);
+    b->stats.bytes_read += n;
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_boot_create(spm_device_t *dev, const spm_boot_cfg_t *cfg, spm_boot_t **out_boot)
+{
+    if (!out_boot) return SPM_EPARAM;
+    *out_boot = NULL;
+
+    spm_boot_cfg_t c = cfg ? *cfg : (spm_boot_cfg_t){0};
+    if (!dev || !v_cfg_is_valid(&c)) return SPM_EPARAM;
+
+    if (!c.base)             c.base             = SPM_BOOT_DEFAULT_BASE;
+    if (!c.chunk)            c.chunk            = SPM_BOOT_MAX_CHUNK;
+    if (!c.ack_timeout_ms)   c.ack_timeout_ms   = SPM_BOOT_DEFAULT_TIMEOUT;
+    if (!c.erase_timeout_ms) c.erase_timeout_ms = SPM_BOOT_ERASE_TIMEOUT;
+
+    spm_boot_t *b = calloc(1, sizeof(*b));
+    if (!b) return SPM_ENOMEM;
+
+    b->dev = dev;
+    b->cfg = c;
+    b->tx  = malloc(SPM_BOOT_MSG_MAX);
+    b->rx  = malloc(SPM_BOOT_MSG_MAX);
+    if (!b->tx || !b->rx) {
+        free(b->tx);
+        free(b->rx);
+        free(b);
+        return SPM_ENOMEM;
+    }
+    for (int k = 0; k < ACK_KINDS; k++) b->window[k] = SPM_BOOT_MIN_WINDOW;
+
+    *out_boot = b;
+    return SPM_OK;
+}
+
+void spm_boot_destroy(spm_boot_t *boot)
+{
+    if (!boot) return;
+    if (boot->host_ack) {
+        boot->tx[0] = BL_ACK;
+        xfer(boot, 1);
+    }
+    free(boot->tx);
+    free(boot->rx);
+    free(boot);
+}
+
+spm_ecode_t spm_boot_sync(spm_boot_t *boot)
+{
+    if (!boot) return SPM_EPARAM;
+    const uint8_t sof = BL_SOF;
+    return phase(boot, ACK_CMD, &sof, 1, boot->cfg.ack_timeout_ms);
+}
+
+spm_ecode_t spm_boot_erase(spm_boot_t *boot)
+{
+    if (!boot) return SPM_EPARAM;
+    static const uint8_t mass[3] = { 0xFF, 0xFF, 0x00 };
+
+    uint64_t t0 = now_ns();
+    spm_ecode_t rc = command(boot, BL_CMD_ERASE);
+    if (rc == SPM_OK) rc = phase(boot, ACK_ERASE, mass, 3, boot->cfg.erase_timeout_ms);
+    boot->stats.erase_ns += now_ns() - t0;
+    return rc;
+}
+
+spm_ecode_t spm_boot_write(spm_boot_t *boot, uint32_t addr, const void *data, size_t len)
+{
+    if (!boot || (!data && len)) return SPM_EPARAM;
+    if ((uint64_t)addr + len > 0x100000000ull) return SPM_EPARAM;
+
+    const uint8_t *p = data;
+    for (size_t off = 0; off < len; off += boot->cfg.chunk) {
+        size_t n = len - off < boot->cfg.chunk ? len - off : boot->cfg.chunk;
+        spm_ecode_t rc = write_chunk(boot, addr + (uint32_t)off, p + off, n);
+        if (rc != SPM_OK) return rc;
+    }
+    return SPM_OK;
+}
+
+spm_ecode_t spm_boot_read(spm_boot_t *boot, uint32_t addr, void *out, size_t len)
+{
+    if (!boot || (!out && len)) return SPM_EPARAM;
+    if ((uint64_t)addr + len > 0x100000000ull) return SPM_EPARAM;
+
+    uint8_t *p = out;
+    for (size_t off = 0; off < len; off += boot->cfg.chunk) {
+        size_t n = len - off < boot->cfg.chunk ? len - off : boot->cfg.chunk;
+        spm_ecode_t rc = read_chunk(boot, addr + (uint32_t)off, p + off, n);
+        if (rc != SPM_OK) return rc;
+    }
+    return SPM_OK;
+}
+
+spm_ecode_t spm_boot_go(spm_boot_t *boot, uint32_t addr)
+{
+    if (!boot) return SPM_EPARAM;
+
+    spm_ecode_t rc = command(boot, BL_CMD_GO);
+    if (rc == SPM_OK) rc = address(boot, addr);
+    return rc;
+}
+
+spm_ecode_t spm_boot_flash(spm_boot_t *boot, const void *image, size_t len)
+{
+    if (!boot || !image || len == 0) return SPM_EPARAM;
+
+    boot->stats.image_crc = crc32_update(0, image, len);
+    boot->stats.readback_crc = 0;
+
+    spm_ecode_t rc = SPM_OK;
+    if (boot->cfg.mass_erase) rc = spm_boot_erase(boot);
+    if (rc != SPM_OK) return rc;
+
+    uint64_t t0 = now_ns();
+    rc = spm_boot_write(boot, boot->cfg.base, image, len);
+    uint64_t t1 = now_ns();
+    boot->stats.write_ns += t1 - t0;
+    boot->stats.write_kbps = kbps(len, t1 - t0);
+    if (rc != SPM_OK || !boot->cfg.verify) return rc;
+
+    /* Bulk read-back, compared chunk by chunk, CRC over the whole image */
+    const uint8_t *img = image;
+    uint8_t back[SPM_BOOT_MAX_CHUNK];
+    uint32_t crc = 0;
+    bool same = true;
+
+    for (size_t off = 0; off < len && rc == SPM_OK; off += boot->cfg.chunk) {
+        size_t n = len - off < boot->cfg.chunk ? len - off : boot->cfg.chunk;
+        rc = read_chunk(boot, boot->cfg.base + (uint32_t)off, back, n);
+        if (rc != SPM_OK) break;
+        crc = crc32_update(crc, back, n);
+        same = same && memcmp(back, img + off, n) == 0;
+    }
+    uint64_t t2 = now_ns();
+    boot->stats.verify_ns += t2 - t1;
+    boot->stats.verify_kbps = kbps(len, t2 - t1);
+    if (rc != SPM_OK) return rc;
+
+    boot->stats.readback_crc = crc;
+    return same ? SPM_OK : SPM_ECRC;
+}
+
+spm_ecode_t spm_boot_flash_file(spm_boot_t *boot, const char *path)
+{
+    if (!boot || !path) return SPM_EPARAM;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return SPM_ENODEV;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return SPM_ENODEV;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void *img = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (img == MAP_FAILED) return SPM_ENODEV;
+
+    madvise(img, len, MADV_SEQUENTIAL);
+    spm_ecode_t rc = spm_boot_flash(boot, img, len);
+    munmap(img, len);
+    return rc;
+}
+
+spm_ecode_t spm_boot_get_stats(const spm_boot_t *boot, spm_boot_stats_t *out_stats)
+{
+    if (!boot || !out_stats) return SPM_EPARAM;
+    *out_stats = boot->stats;
+    return SPM_OK;
+}
@@ -0,0 +1,624 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPM_CAM_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SPM_CAM_NEON 1
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_cam.h"
+
+#define SPM_CAM_DEFAULT_MAX_FRAME (384u * 1024u)
+#define SPM_CAM_DEFAULT_NBUFS     3u
+#define SPM_CAM_DEFAULT_POLL_US   500u
+#define SPM_CAM_DEFAULT_TIMEOUT   1000
+#define SPM_CAM_MAX_DUMMY         8u
+
+/* ArduCAM register map */
+#define CAM_REG_WRITE       0x80
+#define CAM_REG_FIFO        0x04    /* FIFO control */
+#define CAM_FIFO_CLEAR      0x01    /* clear capture-done flag */
+#define CAM_FIFO_START      0x02    /* start capture */
+#define CAM_REG_TRIG        0x41    /* status */
+#define CAM_TRIG_DONE       0x08
+#define CAM_REG_FIFO_SIZE1  0x42    /* size[7:0], then [15:8], [22:16] */
+#define CAM_CMD_BURST       0x3C
+
+#define JPEG_SOI            0xD8
+#define JPEG_EOI            0xD9
+
+typedef size_t (*scan_fn)(const uint8_t *p, size_t n, uint8_t marker);
+
+typedef enum {
+    BUF_FREE = 0,
+    BUF_FILLING,
+    BUF_READY,
+    BUF_HELD,
+} buf_state_t;
+
+typedef struct {
+    uint8_t          *data;
+    size_t            off;        /* SOI offset */
+    size_t            len;        /* JPEG bytes */
+    size_t            fifo_len;
+    uint64_t          seq;
+    uint64_t          t_ns;
+    buf_state_t       state;
+} cam_buf_t;
+
+/**
+ * @brief FIFO camera capture
+ */
+struct spm_cam {
+    spm_device_t     *dev;
+    spm_cam_cfg_t     cfg;
+    cam_buf_t        *bufs;
+    spm_batch_xfer_t *xfers;      /* burst read, one message per bufsiz bytes */
+    scan_fn           scan;
+
+    int              *ready;      /* FIFO of ready buffer indices */
+    size_t            ready_head;
+    size_t            ready_count;
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond_ready;
+    pthread_cond_t    cond_free;
+    bool              started;    /* thread needs joining */
+    bool              running;
+    bool              stop;
+    spm_ecode_t       cap_err;
+    uint64_t          next_seq;
+    uint64_t          t_start;
+    spm_cam_stats_t   stats;
+};
+
+/* ====================================================== */
+/* ==================== Scan Kernels ==================== */
+/* ====================================================== */
+
+/* Index of the first FF <marker> pair in p[0..n), or n */
+static size_t scan_scalar(const uint8_t *p, size_t n, uint8_t marker)
+{
+    for (size_t i = 0; i + 1 < n; i++) {
+        if (p[i] == 0xFF && p[i + 1] == marker) return i;
+    }
+    return n;
+}
+
+#ifdef SPM_CAM_X86
+
+__attribute__((target("sse2")))
+static size_t scan_sse2(const uint8_t *p, size_t n, uint8_t marker)
+{
+    const __m128i ff = _mm_set1_epi8((char)0xFF);
+    const __m128i mk = _mm_set1_epi8((char)marker);
+    size_t i = 0;
+    for (; i + 17 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(p + i + 1));
+        unsigned hit = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, ff),
+                                                                  _mm_cmpeq_epi8(b, mk)));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + scan_scalar(p + i, n - i, marker);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const uint8_t *p, size_t n, uint8_t marker)
+{
+    const __m256i ff = _mm256_set1_epi8((char)0xFF);
+    const __m256i mk = _mm256_set1_epi8((char)marker);
+    size_t i = 0;
+    for (; i + 33 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(const void *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(const void *)(p + i + 1));
+        unsigned hit = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, ff),
+                                                                        _mm256_cmpeq_epi8(b, mk)));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + scan_scalar(p + i, n - i, marker);
+}
+
+#endif /* SPM_CAM_X86 */
+
+#ifdef SPM_CAM_NEON
+
+static size_t scan_neon(const uint8_t *p, size_t n, uint8_t marker)
+{
+    const uint8x16_t ff = vdupq_n_u8(0xFF);
+    const uint8x16_t mk = vdupq_n_u8(marker);
+    size_t i = 0;
+    for (; i + 17 <= n; i += 16) {
+        uint8x16_t hit = vandq_u8(vceqq_u8(vld1q_u8(p + i), ff), vceqq_u8(vld1q_u8(p + i + 1), mk));
+        if (vmaxvq_u8(hit)) return i + scan_scalar(p + i, 17, marker);
+    }
+    return i + scan_scalar(p + i, n - i, marker);
+}
+
+#endif /* SPM_CAM_NEON */
+
+static scan_fn select_scan(void)
+{
+#if defined(SPM_CAM_X86)
+    if (__builtin_cpu_supports("avx2")) return scan_avx2;
+    if (__builtin_cpu_supports("sse2")) return scan_sse2;
+#elif defined(SPM_CAM_NEON)
+    return scan_neon;
+#endif
+    return scan_scalar;
+}
+
+static spm_ecode_t find_jpeg(scan_fn scan, const uint8_t *buf, size_t len, size_t *off, size_t *jlen)
+{
+    size_t soi = scan(buf, len, JPEG_SOI);
+    if (soi >= len) return SPM_EIO;
+
+    size_t eoi = soi + 2 + scan(buf + soi + 2, len - soi - 2, JPEG_EOI);
+    if (eoi >= len) return SPM_EIO;
+
+    *off  = soi;
+    *jlen = eoi + 2 - soi;
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void deadline_after_ms(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void sleep_us(uint32_t us)
+{
+    struct timespec ts = { us / 1000000u, (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static bool v_cfg_is_valid(const spm_cam_cfg_t *cfg)
+{
+    if (cfg->nbufs == 1)                           return false;
+    if (cfg->burst_dummy > SPM_CAM_MAX_DUMMY)      return false;
+    if (cfg->bufsiz && cfg->bufsiz < SPM_BUFSIZ_ALIGN) return false;
+    if (cfg->bufsiz > UINT32_MAX)                  return false;
+    if (cfg->timeout_ms < 0)                       return false;
+    return true;
+}
+
+static void ready_push(spm_cam_t *cam, int idx)
+{
+    size_t tail = (cam->ready_head + cam->ready_count) % cam->cfg.nbufs;
+    cam->ready[tail] = idx;
+    cam->ready_count++;
+}
+
+static int ready_pop(spm_cam_t *cam)
+{
+    int idx = cam->ready[cam->ready_head];
+    cam->ready_head = (cam->ready_head + 1) % cam->cfg.nbufs;
+    cam->ready_count--;
+    return idx;
+}
+
+static int find_free(const spm_cam_t *cam)
+{
+    for (size_t i = 0; i < cam->cfg.nbufs; i++) {
+        if (cam->bufs[i].state == BUF_FREE) return (int)i;
+    }
+    return -1;
+}
+
+/* ====================================================== */
+/* ===================== Bus Access ===================== */
+/* ====================================================== */
+
+/* Clear the done flag and start a capture in one message */
+static spm_ecode_t trigger(spm_cam_t *cam)
+{
+    static const uint8_t clear[2] = { CAM_REG_FIFO | CAM_REG_WRITE, CAM_FIFO_CLEAR };
+    static const uint8_t start[2] = { CAM_REG_FIFO | CAM_REG_WRITE, CAM_FIFO_START };
+    spm_batch_xfer_t x[3] = {
+        { .tx = clear, .len = 2, .cs_change = true },
+        { .tx = clear, .len = 2, .cs_change = true },   /* ArduCAM clears twice */
+        { .tx = start, .len = 2 },
+    };
+    return spm_batch(cam->dev, x, 3);
+}
+
+/* Poll status and FIFO length together until the capture is done */
+static spm_ecode_t wait_done(spm_cam_t *cam, size_t *fifo_len)
+{
+    static const uint8_t tx[4][2] = {
+        { CAM_REG_TRIG, 0 },
+        { CAM_REG_FIFO_SIZE1, 0 },
+        { CAM_REG_FIFO_SIZE1 + 1, 0 },
+        { CAM_REG_FIFO_SIZE1 + 2, 0 },
+    };
+    uint8_t rx[4][2];
+    spm_batch_xfer_t x[4];
+    for (int i = 0; i < 4; i++) {
+        x[i] = (spm_batch_xfer_t){ .tx = tx[i], .rx = rx[i], .len = 2, .cs_change = i < 3 };
+    }
+
+    uint64_t deadline = now_ns() + (uint64_t)cam->cfg.timeout_ms * 1000000ull;
+    for (;;) {
+        spm_ecode_t rc = spm_batch(cam->dev, x, 4);
+        if (rc != SPM_OK) return rc;
+
+        pthread_mutex_lock(&cam->lock);
+        cam->stats.polls++;
+        bool stop = cam->stop;
+        pthread_mutex_unlock(&cam->lock);
+
+        if (rx[0][1] & CAM_TRIG_DONE) {
+            *fifo_len = (size_t)rx[1][1] | (size_t)rx[2][1] << 8 | (size_t)(rx[3][1] & 0x7F) << 16;
+            return SPM_OK;
+        }
+        if (stop) return SPM_ESTATE;
+        if (now_ns() >= deadline) return SPM_ETIMEOUT;
+        sleep_us(cam->cfg.poll_us);
+    }
+}
+
+/*
+ * One burst FIFO read under a single CS assertion. spidev caps each
+ * message's tx and rx bytes at bufsiz, counting every transfer rounded
+ * up to SPM_BUFSIZ_ALIGN, so the read is split into messages of one
+ * aligned chunk whose last transfer sets cs_change to keep CS
+ * asserted. The command is the first message's only tx.
+ */
+static spm_ecode_t burst_read(spm_cam_t *cam, uint8_t *dst, size_t len)
+{
+    static const uint8_t cmd[1 + SPM_CAM_MAX_DUMMY] = { CAM_CMD_BURST };
+    const size_t room = cam->cfg.bufsiz & ~(size_t)(SPM_BUFSIZ_ALIGN - 1);
+    const size_t hdr = 1u + cam->cfg.burst_dummy;
+
+    spm_batch_xfer_t *x = cam->xfers;
+    size_t off = 0;
+    bool first = true;
+
+    while (off < len || first) {
+        size_t n = 0;
+        if (first) {
+            x[n++] = (spm_batch_xfer_t){ .tx = cmd, .len = hdr };
+            first = false;
+        }
+
+        size_t chunk = len - off < room ? len - off : room;
+        if (chunk) {
+            x[n++] = (spm_batch_xfer_t){ .rx = dst + off, .len = chunk };
+            off += chunk;
+        }
+        x[n - 1].cs_change = off < len;
+
+        spm_ecode_t rc = spm_batch(cam->dev, x, n);
+        if (rc != SPM_OK) return rc;
+    }
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* =================== Capture Thread =================== */
+/* ====================================================== */
+
+/* Called with lock held; returns a buffer to fill or -1 on stop */
+static int claim_buffer(spm_cam_t *cam)
+{
+    bool counted = false;
+
+    for (;;) {
+        if (cam->stop) return -1;
+
+        int idx = find_free(cam);
+        if (idx >= 0) return idx;
+
+        if (!counted) {
+            cam->stats.overruns++;
+            counted = true;
+        }
+
+        if (cam->cfg.overwrite && cam->ready_count > 0) {
+            idx = ready_pop(cam);
+            cam->stats.dropped++;
+            return idx;
+        }
+
+        pthread_cond_wait(&cam->cond_free, &cam->lock);
+    }
+}
+
+static void *capture_thread(void *arg)
+{
+    spm_cam_t *cam = arg;
+
+    pthread_mutex_lock(&cam->lock);
+    for (;;) {
+        int idx = claim_buffer(cam);
+        if (idx < 0) break;
+
+        cam_buf_t *buf = &cam->bufs[idx];
+        buf->state = BUF_FILLING;
+        pthread_mutex_unlock(&cam->lock);
+
+        size_t fifo_len = 0, rd_len = 0;
+        uint64_t t0 = 0, t1 = 0, t2 = 0;
+
+        spm_ecode_t rc = trigger(cam);
+        if (rc == SPM_OK) rc = wait_done(cam, &fifo_len);
+        if (rc == SPM_OK) {
+            rd_len = fifo_len < cam->cfg.max_frame ? fifo_len : cam->cfg.max_frame;
+            t0 = now_ns();
+            rc = burst_read(cam, buf->data, rd_len);
+            t1 = now_ns();
+        }
+
+        spm_ecode_t scan_rc = SPM_EIO;
+        if (rc == SPM_OK) {
+            scan_rc = find_jpeg(cam->scan, buf->data, rd_len, &buf->off, &buf->len);
+            t2 = now_ns();
+        }
+
+        pthread_mutex_lock(&cam->lock);
+        if (rc == SPM_ESTATE && cam->stop) {
+            buf->state = BUF_FREE;
+            break;
+        }
+        if (rc != SPM_OK) {
+            buf->state = BUF_FREE;
+            cam->stats.errors++;
+            cam->cap_err = rc;
+            break;
+        }
+
+        cam->stats.read_ns    += t1 - t0;
+        cam->stats.scan_ns    += t2 - t1;
+        cam->stats.fifo_bytes += rd_len;
+        if (fifo_len > cam->cfg.max_frame) cam->stats.truncated++;
+
+        if (scan_rc != SPM_OK) {
+            buf->state = BUF_FREE;
+            cam->stats.bad_frames++;
+            continue;
+        }
+
+        buf->fifo_len = fifo_len;
+        buf->t_ns = t1;
+        buf->seq = cam->next_seq++;
+        buf->state = BUF_READY;
+        ready_push(cam, idx);
+        cam->stats.frames++;
+        cam->stats.bytes += buf->len;
+        pthread_cond_signal(&cam->cond_ready);
+    }
+
+    cam->running = false;
+    pthread_cond_broadcast(&cam->cond_ready);
+    pthread_mutex_unlock(&cam->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_cam_create(spm_device_t *dev, const spm_cam_cfg_t *cfg, spm_cam_t **out_cam)
+{
+    if (!out_cam) return SPM_EPARAM;
+    *out_cam = NULL;
+
+    spm_cam_cfg_t c = cfg ? *cfg : (spm_cam_cfg_t){0};
+    if (!dev || !v_cfg_is_valid(&c)) return SPM_EPARAM;
+
+    if (!c.max_frame)  c.max_frame  = SPM_CAM_DEFAULT_MAX_FRAME;
+    if (!c.nbufs)      c.nbufs      = SPM_CAM_DEFAULT_NBUFS;
+    if (!c.bufsiz)     c.bufsiz     = SPM_BUFSIZ_DEFAULT;
+    if (!c.poll_us)    c.poll_us    = SPM_CAM_DEFAULT_POLL_US;
+    if (!c.timeout_ms) c.timeout_ms = SPM_CAM_DEFAULT_TIMEOUT;
+
+    spm_cam_t *cam = calloc(1, sizeof(*cam));
+    if (!cam) return SPM_ENOMEM;
+
+    cam->dev  = dev;
+    cam->cfg  = c;
+    cam->scan = select_scan();
+
+    cam->bufs  = calloc(c.nbufs, sizeof(*cam->bufs));
+    cam->ready = calloc(c.nbufs, sizeof(*cam->ready));
+    cam->xfers = calloc(2, sizeof(*cam->xfers));
+    if (!cam->bufs || !cam->ready || !cam->xfers) goto nomem;
+
+    for (size_t i = 0; i < c.nbufs; i++) {
+        cam->bufs[i].data = malloc(c.max_frame);
+        if (!cam->bufs[i].data) goto nomem;
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&cam->lock, NULL);
+    pthread_cond_init(&cam->cond_ready, &ca);
+    pthread_cond_init(&cam->cond_free, &ca);
+    pthread_condattr_destroy(&ca);
+
+    *out_cam = cam;
+    return SPM_OK;
+
+nomem:
+    if (cam->bufs) {
+        for (size_t i = 0; i < c.nbufs; i++) free(cam->bufs[i].data);
+    }
+    free(cam->bufs);
+    free(cam->ready);
+    free(cam->xfers);
+    free(cam);
+    return SPM_ENOMEM;
+}
+
+spm_ecode_t spm_cam_start(spm_cam_t *cam)
+{
+    if (!cam) return SPM_EPARAM;
+
+    pthread_mutex_lock(&cam->lock);
+    if (cam->started) {
+        pthread_mutex_unlock(&cam->lock);
+        return SPM_ESTATE;
+    }
+    cam->running = true;
+    cam->stop    = false;
+    cam->cap_err = SPM_OK;
+    cam->t_start = now_ns();
+    pthread_mutex_unlock(&cam->lock);
+
+    if (pthread_create(&cam->thread, NULL, capture_thread, cam) != 0) {
+        pthread_mutex_lock(&cam->lock);
+        cam->running = false;
+        pthread_mutex_unlock(&cam->lock);
+        return SPM_ENOMEM;
+    }
+    cam->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_cam_stop(spm_cam_t *cam)
+{
+    if (!cam) return SPM_EPARAM;
+
+    if (!cam->started) return SPM_OK;
+
+    pthread_mutex_lock(&cam->lock);
+    cam->stop = true;
+    pthread_cond_broadcast(&cam->cond_free);
+    pthread_mutex_unlock(&cam->lock);
+
+    pthread_join(cam->thread, NULL);
+    cam->started = false;
+    return SPM_OK;
+}
+
+void spm_cam_destroy(spm_cam_t *cam)
+{
+    if (!cam) return;
+    spm_cam_stop(cam);
+
+    for (size_t i = 0; i < cam->cfg.nbufs; i++) free(cam->bufs[i].data);
+    pthread_cond_destroy(&cam->cond_ready);
+    pthread_cond_destroy(&cam->cond_free);
+    pthread_mutex_destroy(&cam->lock);
+    free(cam->bufs);
+    free(cam->ready);
+    free(cam->xfers);
+    free(cam);
+}
+
+spm_ecode_t spm_cam_acquire(spm_cam_t *cam, int timeout_ms, spm_cam_frame_t *out_frame)
+{
+    if (!cam || !out_frame) return SPM_EPARAM;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) deadline_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&cam->lock);
+    while (cam->ready_count == 0) {
+        spm_ecode_t rc = SPM_OK;
+        if (!cam->running) rc = cam->cap_err != SPM_OK ? cam->cap_err : SPM_ESTATE;
+        else if (timeout_ms == 0) rc = SPM_ETIMEOUT;
+        else if (timeout_ms < 0) pthread_cond_wait(&cam->cond_ready, &cam->lock);
+        else if (pthread_cond_timedwait(&cam->cond_ready, &cam->lock, &deadline) != 0
+                 && cam->ready_count == 0 && cam->running) rc = SPM_ETIMEOUT;
+
+        if (rc != SPM_OK) {
+            pthread_mutex_unlock(&cam->lock);
+            return rc;
+        }
+    }
+
+    int idx = ready_pop(cam);
+    cam_buf_t *buf = &cam->bufs[idx];
+    buf->state = BUF_HELD;
+
+    *out_frame = (spm_cam_frame_t){
+        .data     = buf->data + buf->off,
+        .len      = buf->len,
+        .fifo_len = buf->fifo_len,
+        .seq      = buf->seq,
+        .t_ns     = buf->t_ns,
+        .index    = idx,
+    };
+    pthread_mutex_unlock(&cam->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_cam_release(spm_cam_t *cam, const spm_cam_frame_t *frame)
+{
+    if (!cam || !frame) return SPM_EPARAM;
+    if (frame->index < 0 || (size_t)frame->index >= cam->cfg.nbufs) return SPM_EPARAM;
+
+    pthread_mutex_lock(&cam->lock);
+    cam_buf_t *buf = &cam->bufs[frame->index];
+    if (buf->state != BUF_HELD || buf->data + buf->off != frame->data) {
+        pthread_mutex_unlock(&cam->lock);
+        return SPM_EPARAM;
+    }
+    buf->state = BUF_FREE;
+    pthread_cond_signal(&cam->cond_free);
+    pthread_mutex_unlock(&cam->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_cam_get_stats(spm_cam_t *cam, spm_cam_stats_t *out_stats)
+{
+    if (!cam || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&cam->lock);
+    *out_stats = cam->stats;
+    uint64_t t_start = cam->t_start;
+    pthread_mutex_unlock(&cam->lock);
+
+    if (t_start) {
+        double s = (double)(now_ns() - t_start) / 1e9;
+        if (s > 0) {
+            out_stats->fps         = (double)out_stats->frames / s;
+            out_stats->bytes_per_s = (double)out_stats->bytes / s;
+        }
+    }
+    return SPM_OK;
+}
+
+spm_ecode_t spm_cam_find_jpeg(const uint8_t *buf, size_t len, size_t *out_off, size_t *out_len)
+{
+    if (!buf || !out_off || !out_len) return SPM_EPARAM;
+    return find_jpeg(select_scan(), buf, len, out_off, out_len);
+}
+
+const char *spm_cam_kernel(void)
+{
+    scan_fn scan = select_scan();
+#if defined(SPM_CAM_X86)
+    if (scan == scan_avx2) return "avx2";
+    if (scan == scan_sse2) return "sse2";
+#elif defined(SPM_CAM_NEON)
+    if (scan == scan_neon) return "neon";
+#endif
+    (void)scan;
+    return "scalar";
+}
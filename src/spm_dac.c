@@ -0,0 +1,390 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_dac.h"
+
+#define SPM_DAC_DEFAULT_RING  4096u
+#define SPM_DAC_DEFAULT_MSG   64u
+
+/**
+ * @brief DAC playback engine
+ *
+ * The ring holds encoded command words. The playback thread sends
+ * contiguous runs straight from the ring (or the loop table), one CS
+ * frame per word, and frees the slots after the message completes.
+ */
+struct spm_dac {
+    spm_device_t     *dev;
+    spm_dac_cfg_t     cfg;
+    spm_batch_xfer_t *xfers;      /* samples_per_msg descriptors */
+    uint16_t          delay_usecs;
+    double            paced_rate_hz;
+
+    uint8_t          *ring;       /* ring_len encoded words */
+    size_t            head;       /* next word to send */
+    size_t            count;      /* words queued */
+
+    uint8_t          *loop;       /* encoded loop table, NULL = streaming */
+    size_t            loop_len;
+    size_t            loop_pos;
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond_data;
+    pthread_cond_t    cond_space;
+    bool              started;    /* thread needs joining */
+    bool              running;
+    bool              stop;
+    bool              starved;    /* ring empty, underrun already counted */
+    spm_ecode_t       err;
+    uint64_t          start_ns;
+    uint64_t          stop_ns;
+    spm_dac_stats_t   stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void deadline_after_ms(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Samples whose aligned words fit one message */
+static size_t max_samples_per_msg(const spm_dac_cfg_t *cfg)
+{
+    size_t bufsiz = cfg->bufsiz ? cfg->bufsiz : SPM_BUFSIZ_DEFAULT;
+    size_t n = bufsiz / SPM_BUFSIZ_COST(cfg->word_len);
+    return n < SPM_MAX_BATCH_XFERS ? n : SPM_MAX_BATCH_XFERS;
+}
+
+static bool v_cfg_is_valid(const spm_dac_cfg_t *cfg)
+{
+    if (!cfg)                                                 return false;
+    if (cfg->word_len < 1 || cfg->word_len > 4)               return false;
+    if (cfg->bits < 1 || cfg->bits > 32)                      return false;
+    if (cfg->data_shift + cfg->bits > 8u * cfg->word_len)     return false;
+    if (cfg->sample_rate_hz == 0)                             return false;
+    if (max_samples_per_msg(cfg) == 0)                        return false;
+    if (cfg->samples_per_msg > max_samples_per_msg(cfg))      return false;
+    return true;
+}
+
+static void encode(const spm_dac_cfg_t *cfg, const uint32_t *samples, size_t n, uint8_t *out)
+{
+    const uint32_t mask = cfg->bits == 32 ? UINT32_MAX : (1u << cfg->bits) - 1u;
+    const unsigned wl = cfg->word_len;
+
+    for (size_t i = 0; i < n; i++, out += wl) {
+        uint32_t w = cfg->cmd | ((samples[i] & mask) << cfg->data_shift);
+        for (unsigned b = 0; b < wl; b++) out[b] = (uint8_t)(w >> (8 * (wl - 1 - b)));
+    }
+}
+
+/* Delay after each word so that word time + delay matches the period */
+static void compute_pacing(spm_dac_t *dac, uint32_t speed_hz)
+{
+    double word_ns   = speed_hz ? 8.0 * dac->cfg.word_len * 1e9 / speed_hz : 0.0;
+    double period_ns = 1e9 / dac->cfg.sample_rate_hz;
+    double delay_us  = period_ns > word_ns ? (period_ns - word_ns) / 1000.0 + 0.5 : 0.0;
+
+    dac->delay_usecs   = delay_us > UINT16_MAX ? UINT16_MAX : (uint16_t)delay_us;
+    dac->paced_rate_hz = 1e9 / (word_ns + dac->delay_usecs * 1000.0);
+}
+
+static spm_ecode_t send_words(spm_dac_t *dac, const uint8_t *words, size_t n)
+{
+    const size_t wl = dac->cfg.word_len;
+
+    for (size_t i = 0; i < n; i++) {
+        dac->xfers[i] = (spm_batch_xfer_t){
+            .tx          = words + i * wl,
+            .len         = wl,
+            .delay_usecs = dac->delay_usecs,
+            .cs_change   = i + 1 < n,   /* one CS frame per sample */
+        };
+    }
+    return spm_batch(dac->dev, dac->xfers, n);
+}
+
+/* ====================================================== */
+/* ================== Playback Thread =================== */
+/* ====================================================== */
+
+/* Called with lock held; next contiguous run to send, 0 on stop */
+static size_t next_run(spm_dac_t *dac, const uint8_t **out_words)
+{
+    const size_t spm = dac->cfg.samples_per_msg;
+
+    for (;;) {
+        if (dac->stop) return 0;
+
+        if (dac->loop) {
+            size_t n = dac->loop_len - dac->loop_pos;
+            *out_words = dac->loop + dac->loop_pos * dac->cfg.word_len;
+            return n < spm ? n : spm;
+        }
+
+        if (dac->count > 0) {
+            size_t n = dac->cfg.ring_len - dac->head;
+            if (n > dac->count) n = dac->count;
+            dac->starved = false;
+            *out_words = dac->ring + dac->head * dac->cfg.word_len;
+            return n < spm ? n : spm;
+        }
+
+        if (!dac->starved && dac->stats.samples > 0) dac->stats.underruns++;
+        dac->starved = true;
+        pthread_cond_wait(&dac->cond_data, &dac->lock);
+    }
+}
+
+static void *play_thread(void *arg)
+{
+    spm_dac_t *dac = arg;
+
+    pthread_mutex_lock(&dac->lock);
+    for (;;) {
+        const uint8_t *words = NULL;
+        size_t n = next_run(dac, &words);
+        if (n == 0) break;
+        pthread_mutex_unlock(&dac->lock);
+
+        spm_ecode_t rc = send_words(dac, words, n);
+
+        pthread_mutex_lock(&dac->lock);
+        if (rc != SPM_OK) {
+            dac->stats.errors++;
+            dac->err = rc;
+            break;
+        }
+
+        if (dac->loop) {
+            dac->loop_pos = (dac->loop_pos + n) % dac->loop_len;
+        } else {
+            dac->head = (dac->head + n) % dac->cfg.ring_len;
+            dac->count -= n;
+            pthread_cond_broadcast(&dac->cond_space);
+        }
+        dac->stats.samples += n;
+        dac->stats.messages++;
+    }
+
+    dac->running = false;
+    dac->stop_ns = now_ns();
+    pthread_cond_broadcast(&dac->cond_space);
+    pthread_mutex_unlock(&dac->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_dac_create(spm_device_t *dev, const spm_dac_cfg_t *cfg, spm_dac_t **out_dac)
+{
+    if (!out_dac) return SPM_EPARAM;
+    *out_dac = NULL;
+    if (!dev || !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_cfg_t dcfg;
+    spm_ecode_t rc = spm_dev_get_cfg(dev, &dcfg);
+    if (rc != SPM_OK) return rc;
+
+    spm_dac_t *dac = calloc(1, sizeof(*dac));
+    if (!dac) return SPM_ENOMEM;
+
+    dac->dev = dev;
+    dac->cfg = *cfg;
+    if (dac->cfg.ring_len == 0)        dac->cfg.ring_len = SPM_DAC_DEFAULT_RING;
+    if (dac->cfg.samples_per_msg == 0) {
+        size_t max = max_samples_per_msg(&dac->cfg);
+        dac->cfg.samples_per_msg = (uint16_t)(max < SPM_DAC_DEFAULT_MSG ? max : SPM_DAC_DEFAULT_MSG);
+    }
+    compute_pacing(dac, dcfg.speed_hz);
+
+    dac->ring  = malloc(dac->cfg.ring_len * dac->cfg.word_len);
+    dac->xfers = calloc(dac->cfg.samples_per_msg, sizeof(*dac->xfers));
+    if (!dac->ring || !dac->xfers) {
+        free(dac->ring);
+        free(dac->xfers);
+        free(dac);
+        return SPM_ENOMEM;
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&dac->lock, NULL);
+    pthread_cond_init(&dac->cond_data, &ca);
+    pthread_cond_init(&dac->cond_space, &ca);
+    pthread_condattr_destroy(&ca);
+
+    *out_dac = dac;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dac_start(spm_dac_t *dac)
+{
+    if (!dac) return SPM_EPARAM;
+
+    pthread_mutex_lock(&dac->lock);
+    if (dac->started) {
+        pthread_mutex_unlock(&dac->lock);
+        return SPM_ESTATE;
+    }
+    dac->running  = true;
+    dac->stop     = false;
+    dac->starved  = false;
+    dac->err      = SPM_OK;
+    memset(&dac->stats, 0, sizeof dac->stats);
+    dac->start_ns = now_ns();
+    pthread_mutex_unlock(&dac->lock);
+
+    if (pthread_create(&dac->thread, NULL, play_thread, dac) != 0) {
+        pthread_mutex_lock(&dac->lock);
+        dac->running = false;
+        pthread_mutex_unlock(&dac->lock);
+        return SPM_ENOMEM;
+    }
+    dac->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dac_stop(spm_dac_t *dac)
+{
+    if (!dac) return SPM_EPARAM;
+
+    if (!dac->started) return SPM_OK;
+
+    pthread_mutex_lock(&dac->lock);
+    dac->stop = true;
+    pthread_cond_broadcast(&dac->cond_data);
+    pthread_mutex_unlock(&dac->lock);
+
+    pthread_join(dac->thread, NULL);
+    dac->started = false;
+    return dac->err;
+}
+
+void spm_dac_destroy(spm_dac_t *dac)
+{
+    if (!dac) return;
+    spm_dac_stop(dac);
+
+    pthread_cond_destroy(&dac->cond_data);
+    pthread_cond_destroy(&dac->cond_space);
+    pthread_mutex_destroy(&dac->lock);
+    free(dac->ring);
+    free(dac->loop);
+    free(dac->xfers);
+    free(dac);
+}
+
+spm_ecode_t spm_dac_write(spm_dac_t *dac, const uint32_t *samples, size_t n,
+                          int timeout_ms, size_t *out_written)
+{
+    if (out_written) *out_written = 0;
+    if (!dac || (!samples && n > 0)) return SPM_EPARAM;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) deadline_after_ms(&deadline, timeout_ms);
+
+    const size_t cap = dac->cfg.ring_len;
+    const size_t wl  = dac->cfg.word_len;
+    size_t done = 0;
+    spm_ecode_t rc = SPM_OK;
+
+    pthread_mutex_lock(&dac->lock);
+    while (done < n) {
+        if (dac->err != SPM_OK) {
+            rc = dac->err;
+            break;
+        }
+
+        if (dac->count == cap) {
+            if (timeout_ms == 0 || !dac->running) rc = SPM_ETIMEOUT;
+            else if (timeout_ms < 0) pthread_cond_wait(&dac->cond_space, &dac->lock);
+            else if (pthread_cond_timedwait(&dac->cond_space, &dac->lock, &deadline) != 0
+                     && dac->count == cap) rc = SPM_ETIMEOUT;
+
+            if (rc != SPM_OK) break;
+            continue;
+        }
+
+        /* Encode straight into the free, contiguous part of the ring */
+        size_t tail = (dac->head + dac->count) % cap;
+        size_t room = cap - dac->count;
+        if (room > cap - tail) room = cap - tail;
+        if (room > n - done)   room = n - done;
+
+        encode(&dac->cfg, samples + done, room, dac->ring + tail * wl);
+        dac->count += room;
+        done += room;
+        pthread_cond_signal(&dac->cond_data);
+    }
+    pthread_mutex_unlock(&dac->lock);
+
+    if (out_written) *out_written = done;
+    return rc;
+}
+
+spm_ecode_t spm_dac_load_loop(spm_dac_t *dac, const uint32_t *samples, size_t n)
+{
+    if (!dac) return SPM_EPARAM;
+    if (dac->started) return SPM_ESTATE;
+    if (samples && n == 0) return SPM_EPARAM;
+
+    uint8_t *loop = NULL;
+    if (samples) {
+        loop = malloc(n * dac->cfg.word_len);
+        if (!loop) return SPM_ENOMEM;
+        encode(&dac->cfg, samples, n, loop);
+    }
+
+    free(dac->loop);
+    dac->loop     = loop;
+    dac->loop_len = samples ? n : 0;
+    dac->loop_pos = 0;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dac_encode(const spm_dac_cfg_t *cfg, const uint32_t *samples, size_t n, uint8_t *out)
+{
+    if (!v_cfg_is_valid(cfg) || ((!samples || !out) && n > 0)) return SPM_EPARAM;
+
+    encode(cfg, samples, n, out);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_dac_get_stats(spm_dac_t *dac, spm_dac_stats_t *out_stats)
+{
+    if (!dac || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&dac->lock);
+    *out_stats = dac->stats;
+    uint64_t end = dac->running ? now_ns() : dac->stop_ns;
+    uint64_t elapsed = end > dac->start_ns ? end - dac->start_ns : 0;
+    pthread_mutex_unlock(&dac->lock);
+
+    out_stats->delay_usecs   = dac->delay_usecs;
+    out_stats->paced_rate_hz = dac->paced_rate_hz;
+    out_stats->rate_hz       = elapsed ? out_stats->samples * 1e9 / elapsed : 0.0;
+    return SPM_OK;
+}
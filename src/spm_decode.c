@@ -0,0 +1,266 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPM_DECODE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SPM_DECODE_NEON 1
+#endif
+
+#include "spm_decode.h"
+
+#define SPM_DECODE_BLOCK 256   /* samples per deinterleave block */
+
+/**
+ * @brief Precomputed decode parameters
+ *
+ * Samples are assembled as raw << (32 - 8 * container) ("lane"), then
+ * shifted left by lshift so the sample's MSB lands in bit 31 and right
+ * by rshift (arithmetic when signed).
+ */
+typedef struct {
+    unsigned  c;          /* container bytes */
+    unsigned  lshift;     /* 8c - shift - bits */
+    unsigned  rshift;     /* 32 - bits */
+    bool      le;
+    bool      sgn;
+    uint8_t   shuf[16];   /* byte gather into lanes, 0x80 = zero */
+} dec_t;
+
+typedef void (*run_fn)(const dec_t *d, const uint8_t *src, size_t n, int32_t *dst);
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static bool v_fmt_is_valid(const spm_fmt_t *fmt)
+{
+    if (!fmt)                                             return false;
+    if (fmt->container < 1 || fmt->container > 4)         return false;
+    if (fmt->bits < 1 || fmt->bits > 32)                  return false;
+    if (fmt->shift + fmt->bits > 8u * fmt->container)     return false;
+
+    size_t packed = (size_t)fmt->header_len + (size_t)(fmt->channels ? fmt->channels : 1) * fmt->container;
+    if (fmt->stride && fmt->stride < packed)              return false;
+    return true;
+}
+
+static void dec_setup(dec_t *d, const spm_fmt_t *fmt)
+{
+    d->c      = fmt->container;
+    d->lshift = 8u * fmt->container - fmt->shift - fmt->bits;
+    d->rshift = 32u - fmt->bits;
+    d->le     = fmt->little_endian;
+    d->sgn    = fmt->is_signed;
+
+    /* Lane byte (4 - c + j) holds raw byte j, counted from the LSB */
+    for (unsigned lane = 0; lane < 4; lane++) {
+        for (unsigned b = 0; b < 4; b++) {
+            uint8_t idx = 0x80;
+            if (b >= 4 - d->c) {
+                unsigned j = b - (4 - d->c);
+                idx = (uint8_t)(lane * d->c + (d->le ? j : d->c - 1 - j));
+            }
+            d->shuf[lane * 4 + b] = idx;
+        }
+    }
+}
+
+static inline uint32_t load_raw(const uint8_t *p, unsigned c, bool le)
+{
+    uint32_t v = 0;
+    if (le) {
+        for (unsigned i = c; i-- > 0;) v = (v << 8) | p[i];
+    } else {
+        for (unsigned i = 0; i < c; i++) v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/* ====================================================== */
+/* ====================== Kernels ======================= */
+/* ====================================================== */
+
+static void run_scalar(const dec_t *d, const uint8_t *src, size_t n, int32_t *dst)
+{
+    const unsigned lane_shift = 32u - 8u * d->c + d->lshift;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x = load_raw(src + i * d->c, d->c, d->le) << lane_shift;
+        dst[i] = d->sgn ? (int32_t)x >> d->rshift : (int32_t)(x >> d->rshift);
+    }
+}
+
+#ifdef SPM_DECODE_X86
+
+__attribute__((target("ssse3")))
+static void run_ssse3(const dec_t *d, const uint8_t *src, size_t n, int32_t *dst)
+{
+    const size_t c = d->c;
+    const __m128i mask = _mm_loadu_si128((const __m128i *)d->shuf);
+    const __m128i ls = _mm_cvtsi32_si128((int)d->lshift);
+    const __m128i rs = _mm_cvtsi32_si128((int)d->rshift);
+
+    size_t i = 0;
+    for (; i + 4 <= n && (i * c) + 16 <= n * c; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i * c));
+        v = _mm_shuffle_epi8(v, mask);
+        v = _mm_sll_epi32(v, ls);
+        v = d->sgn ? _mm_sra_epi32(v, rs) : _mm_srl_epi32(v, rs);
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    run_scalar(d, src + i * c, n - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+static void run_avx2(const dec_t *d, const uint8_t *src, size_t n, int32_t *dst)
+{
+    const size_t c = d->c;
+    const __m128i m128 = _mm_loadu_si128((const __m128i *)d->shuf);
+    const __m256i mask = _mm256_inserti128_si256(_mm256_castsi128_si256(m128), m128, 1);
+    const __m128i ls = _mm_cvtsi32_si128((int)d->lshift);
+    const __m128i rs = _mm_cvtsi32_si128((int)d->rshift);
+
+    /* vpshufb works per 128-bit lane: feed 4 samples to each half */
+    size_t i = 0;
+    for (; i + 8 <= n && (i * c) + 4 * c + 16 <= n * c; i += 8) {
+        const uint8_t *p = src + i * c;
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+            _mm_loadu_si128((const __m128i *)(p + 4 * c)), 1);
+        v = _mm256_shuffle_epi8(v, mask);
+        v = _mm256_sll_epi32(v, ls);
+        v = d->sgn ? _mm256_sra_epi32(v, rs) : _mm256_srl_epi32(v, rs);
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    run_ssse3(d, src + i * c, n - i, dst + i);
+}
+
+#endif /* SPM_DECODE_X86 */
+
+#ifdef SPM_DECODE_NEON
+
+static void run_neon(const dec_t *d, const uint8_t *src, size_t n, int32_t *dst)
+{
+    const size_t c = d->c;
+    const uint8x16_t mask = vld1q_u8(d->shuf);   /* 0x80 is out of range -> 0 */
+    const int32x4_t ls = vdupq_n_s32((int32_t)d->lshift);
+    const int32x4_t rs = vdupq_n_s32(-(int32_t)d->rshift);
+
+    size_t i = 0;
+    for (; i + 4 <= n && (i * c) + 16 <= n * c; i += 4) {
+        uint8x16_t b = vqtbl1q_u8(vld1q_u8(src + i * c), mask);
+        uint32x4_t v = vshlq_u32(vreinterpretq_u32_u8(b), ls);
+        int32x4_t  r = d->sgn ? vshlq_s32(vreinterpretq_s32_u32(v), rs)
+                              : vreinterpretq_s32_u32(vshlq_u32(v, rs));
+        vst1q_s32(dst + i, r);
+    }
+    run_scalar(d, src + i * c, n - i, dst + i);
+}
+
+#endif /* SPM_DECODE_NEON */
+
+static run_fn select_run(void)
+{
+#if defined(SPM_DECODE_X86)
+    if (__builtin_cpu_supports("avx2"))  return run_avx2;
+    if (__builtin_cpu_supports("ssse3")) return run_ssse3;
+#elif defined(SPM_DECODE_NEON)
+    return run_neon;
+#endif
+    return run_scalar;
+}
+
+/* ====================================================== */
+/* ====================== Frames ======================== */
+/* ====================================================== */
+
+static spm_ecode_t decode(const spm_fmt_t *fmt, const void *src, size_t nframes,
+                          int32_t *const *iout, float *const *fout, float scale, float offset)
+{
+    if (!v_fmt_is_valid(fmt) || !src || (!iout && !fout)) return SPM_EPARAM;
+    if (nframes == 0) return SPM_OK;
+
+    const size_t ch     = fmt->channels ? fmt->channels : 1;
+    const size_t stride = spm_fmt_frame_len(fmt);
+    for (size_t c = 0; c < ch; c++) {
+        if (iout ? !iout[c] : !fout[c]) return SPM_EPARAM;
+    }
+
+    dec_t d;
+    dec_setup(&d, fmt);
+
+    const uint8_t *p = src;
+    const bool packed = fmt->header_len == 0 && stride == ch * fmt->container;
+    run_fn run = packed ? select_run() : run_scalar;
+
+    /* Single channel straight into the caller's array */
+    if (packed && ch == 1 && iout) {
+        run(&d, p, nframes, iout[0]);
+        return SPM_OK;
+    }
+
+    int32_t tmp[SPM_DECODE_BLOCK];
+    const size_t fb = SPM_DECODE_BLOCK / ch;
+
+    for (size_t f0 = 0; f0 < nframes; f0 += fb) {
+        size_t nf = nframes - f0 < fb ? nframes - f0 : fb;
+        const uint8_t *fp = p + f0 * stride;
+
+        if (packed) {
+            run(&d, fp, nf * ch, tmp);
+        } else {
+            for (size_t j = 0; j < nf; j++) {
+                run_scalar(&d, fp + j * stride + fmt->header_len, ch, tmp + j * ch);
+            }
+        }
+
+        for (size_t c = 0; c < ch; c++) {
+            if (iout) {
+                int32_t *o = iout[c] + f0;
+                for (size_t j = 0; j < nf; j++) o[j] = tmp[j * ch + c];
+            } else {
+                float *o = fout[c] + f0;
+                for (size_t j = 0; j < nf; j++) o[j] = (float)tmp[j * ch + c] * scale + offset;
+            }
+        }
+    }
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+size_t spm_fmt_frame_len(const spm_fmt_t *fmt)
+{
+    if (!fmt) return 0;
+    if (fmt->stride) return fmt->stride;
+    return (size_t)fmt->header_len + (size_t)(fmt->channels ? fmt->channels : 1) * fmt->container;
+}
+
+spm_ecode_t spm_decode_i32(const spm_fmt_t *fmt, const void *src, size_t nframes,
+                           int32_t *const *out)
+{
+    if (!out) return SPM_EPARAM;
+    return decode(fmt, src, nframes, out, NULL, 0.0f, 0.0f);
+}
+
+spm_ecode_t spm_decode_f32(const spm_fmt_t *fmt, const void *src, size_t nframes,
+                           float *const *out, float scale, float offset)
+{
+    if (!out) return SPM_EPARAM;
+    return decode(fmt, src, nframes, NULL, out, scale, offset);
+}
+
+const char *spm_decode_kernel(void)
+{
+    run_fn run = select_run();
+#if defined(SPM_DECODE_X86)
+    if (run == run_avx2)  return "avx2";
+    if (run == run_ssse3) return "ssse3";
+#elif defined(SPM_DECODE_NEON)
+    if (run == run_neon)  return "neon";
+#endif
+    (void)run;
+    return "scalar";
+}
@@ -22,6 +22,7 @@ spm_ecode_t spm_map_errno(void)
         case EACCES:      return SPM_ESTATE;
         case EPERM:       return SPM_ESTATE;
         case EBADF:       return SPM_ESTATE;
+        case EMSGSIZE:    return SPM_EPARAM;
         case EPROTO:      return SPM_EBUS;
         default:          return SPM_EBUS;
     }
@@ -0,0 +1,456 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPM_FILTER_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SPM_FILTER_NEON 1
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_filter.h"
+
+#define SPM_FILTER_MAX_STAGES 6
+
+typedef float (*dot_fn)(const float *a, const float *b, size_t n);
+
+/**
+ * @brief Decimating filter
+ *
+ * All channels share the decimation phase. FIR history is kept as the
+ * last ntaps - 1 inputs per channel and prepended to each new block in
+ * a float work buffer, so every output is one contiguous dot product
+ * against the reversed (and pre-scaled) taps.
+ */
+struct spm_filter {
+    spm_filter_cfg_t  cfg;
+    spm_fmt_t         fmt;
+    bool              has_fmt;
+    unsigned          ch;
+    uint32_t          decim;
+    uint32_t          phase;      /* inputs since the last output */
+    float             scale;
+
+    /* moving average */
+    int64_t          *sum;        /* ch */
+    int32_t          *hist;       /* ch * len */
+    uint32_t          hpos;
+
+    /* CIC */
+    uint64_t         *integ;      /* ch * stages, modular arithmetic */
+    uint64_t         *comb;       /* ch * stages */
+    float             cic_norm;
+
+    /* FIR */
+    float            *rtaps;      /* reversed taps * scale */
+    float            *fhist;      /* ch * (ntaps - 1) */
+    float            *work;
+    size_t            work_cap;
+    dot_fn            dot;
+
+    /* acquisition hook scratch */
+    int32_t          *dec;
+    float            *fout;
+    size_t            scratch_cap;
+
+    spm_filter_stats_t stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool v_cfg_is_valid(const spm_filter_cfg_t *cfg)
+{
+    if (!cfg) return false;
+
+    uint64_t r = cfg->decim ? cfg->decim : 1;
+    switch (cfg->type) {
+        case SPM_FILTER_MOVAVG:
+            return true;
+
+        case SPM_FILTER_CIC: {
+            unsigned n = cfg->stages ? cfg->stages : 3;
+            if (n > SPM_FILTER_MAX_STAGES) return false;
+
+            /* Register growth N * log2(R) must stay within 32 bits */
+            uint64_t gain = 1;
+            for (unsigned i = 0; i < n; i++) {
+                gain *= r;
+                if (gain > (1ull << 32)) return false;
+            }
+            return true;
+        }
+
+        case SPM_FILTER_FIR:
+            return cfg->taps && cfg->ntaps > 0;
+
+        default:
+            return false;
+    }
+}
+
+/* ====================================================== */
+/* ==================== Dot Kernels ===================== */
+/* ====================================================== */
+
+static float dot_scalar(const float *a, const float *b, size_t n)
+{
+    float acc = 0.0f;
+    for (size_t i = 0; i < n; i++) acc += a[i] * b[i];
+    return acc;
+}
+
+#ifdef SPM_FILTER_X86
+
+__attribute__((target("sse")))
+static float dot_sse(const float *a, const float *b, size_t n)
+{
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *a, const float *b, size_t n)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i),     _mm256_loadu_ps(b + i),     acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, s);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_scalar(a + i, b + i, n - i);
+}
+
+#endif /* SPM_FILTER_X86 */
+
+#ifdef SPM_FILTER_NEON
+
+static float dot_neon(const float *a, const float *b, size_t n)
+{
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = vfmaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    return vaddvq_f32(acc) + dot_scalar(a + i, b + i, n - i);
+}
+
+#endif /* SPM_FILTER_NEON */
+
+static dot_fn select_dot(void)
+{
+#if defined(SPM_FILTER_X86)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return dot_avx2;
+    if (__builtin_cpu_supports("sse")) return dot_sse;
+#elif defined(SPM_FILTER_NEON)
+    return dot_neon;
+#endif
+    return dot_scalar;
+}
+
+/* ====================================================== */
+/* ====================== Filters ======================= */
+/* ====================================================== */
+
+static size_t run_movavg(spm_filter_t *f, unsigned c, const int32_t *in, size_t n, float *out)
+{
+    const uint32_t len = f->cfg.len;
+    const float k = f->scale / (float)len;
+    int32_t *hist = f->hist + (size_t)c * len;
+    int64_t sum = f->sum[c];
+    uint32_t pos = f->hpos, phase = f->phase;
+    size_t o = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        sum += (int64_t)in[i] - hist[pos];
+        hist[pos] = in[i];
+        if (++pos == len) pos = 0;
+        if (++phase == f->decim) {
+            phase = 0;
+            out[o++] = (float)sum * k;
+        }
+    }
+
+    f->sum[c] = sum;
+    return o;
+}
+
+static size_t run_cic(spm_filter_t *f, unsigned c, const int32_t *in, size_t n, float *out)
+{
+    const unsigned ns = f->cfg.stages;
+    uint64_t *integ = f->integ + (size_t)c * ns;
+    uint64_t *comb  = f->comb + (size_t)c * ns;
+    uint32_t phase = f->phase;
+    size_t o = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = (uint64_t)(int64_t)in[i];
+        for (unsigned s = 0; s < ns; s++) v = integ[s] += v;
+
+        if (++phase == f->decim) {
+            phase = 0;
+            for (unsigned s = 0; s < ns; s++) {
+                uint64_t d = v - comb[s];
+                comb[s] = v;
+                v = d;
+            }
+            out[o++] = (float)(int64_t)v * f->cic_norm;
+        }
+    }
+    return o;
+}
+
+static size_t run_fir(spm_filter_t *f, unsigned c, const int32_t *in, size_t n, float *out)
+{
+    const size_t nh = f->cfg.ntaps - 1;
+    float *hist = f->fhist + (size_t)c * nh;
+    float *w = f->work;
+    uint32_t phase = f->phase;
+    size_t o = 0;
+
+    memcpy(w, hist, nh * sizeof(float));
+    for (size_t i = 0; i < n; i++) w[nh + i] = (float)in[i];
+
+    for (size_t i = 0; i < n; i++) {
+        if (++phase == f->decim) {
+            phase = 0;
+            out[o++] = f->dot(f->rtaps, w + i, f->cfg.ntaps);
+        }
+    }
+
+    memcpy(hist, w + n, nh * sizeof(float));
+    return o;
+}
+
+static bool ensure_work(spm_filter_t *f, size_t n)
+{
+    size_t need = f->cfg.ntaps - 1 + n;
+    if (need <= f->work_cap) return true;
+
+    float *w = realloc(f->work, need * sizeof(float));
+    if (!w) return false;
+    f->work = w;
+    f->work_cap = need;
+    return true;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_filter_create(const spm_filter_cfg_t *cfg, spm_filter_t **out_f)
+{
+    if (!out_f) return SPM_EPARAM;
+    *out_f = NULL;
+    if (!v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_filter_t *f = calloc(1, sizeof(*f));
+    if (!f) return SPM_ENOMEM;
+
+    f->cfg   = *cfg;
+    f->ch    = cfg->channels ? cfg->channels : 1;
+    f->decim = cfg->decim ? cfg->decim : 1;
+    f->scale = cfg->scale != 0.0f ? cfg->scale : 1.0f;
+    f->cfg.taps = NULL;
+    f->cfg.fmt  = NULL;
+    if (cfg->fmt) {
+        f->fmt = *cfg->fmt;
+        f->has_fmt = true;
+    }
+
+    bool ok = true;
+    switch (cfg->type) {
+        case SPM_FILTER_MOVAVG:
+            if (!f->cfg.len) f->cfg.len = f->decim;
+            f->sum  = calloc(f->ch, sizeof(*f->sum));
+            f->hist = calloc((size_t)f->ch * f->cfg.len, sizeof(*f->hist));
+            ok = f->sum && f->hist;
+            break;
+
+        case SPM_FILTER_CIC: {
+            if (!f->cfg.stages) f->cfg.stages = 3;
+            double gain = 1.0;
+            for (unsigned i = 0; i < f->cfg.stages; i++) gain *= f->decim;
+            f->cic_norm = (float)(f->scale / gain);
+            f->integ = calloc((size_t)f->ch * f->cfg.stages, sizeof(*f->integ));
+            f->comb  = calloc((size_t)f->ch * f->cfg.stages, sizeof(*f->comb));
+            ok = f->integ && f->comb;
+            break;
+        }
+
+        case SPM_FILTER_FIR:
+            f->rtaps = malloc(cfg->ntaps * sizeof(float));
+            f->fhist = calloc((size_t)f->ch * (cfg->ntaps - 1) + 1, sizeof(float));
+            ok = f->rtaps && f->fhist;
+            if (ok) {
+                for (size_t i = 0; i < cfg->ntaps; i++) {
+                    f->rtaps[i] = cfg->taps[cfg->ntaps - 1 - i] * f->scale;
+                }
+            }
+            f->dot = select_dot();
+            break;
+    }
+
+    if (!ok) {
+        spm_filter_destroy(f);
+        return SPM_ENOMEM;
+    }
+
+    *out_f = f;
+    return SPM_OK;
+}
+
+void spm_filter_reset(spm_filter_t *f)
+{
+    if (!f) return;
+
+    f->phase = 0;
+    f->hpos  = 0;
+    if (f->sum)   memset(f->sum, 0, f->ch * sizeof(*f->sum));
+    if (f->hist)  memset(f->hist, 0, (size_t)f->ch * f->cfg.len * sizeof(*f->hist));
+    if (f->integ) memset(f->integ, 0, (size_t)f->ch * f->cfg.stages * sizeof(*f->integ));
+    if (f->comb)  memset(f->comb, 0, (size_t)f->ch * f->cfg.stages * sizeof(*f->comb));
+    if (f->fhist) memset(f->fhist, 0, (size_t)f->ch * (f->cfg.ntaps - 1) * sizeof(float));
+}
+
+void spm_filter_destroy(spm_filter_t *f)
+{
+    if (!f) return;
+
+    free(f->sum);
+    free(f->hist);
+    free(f->integ);
+    free(f->comb);
+    free(f->rtaps);
+    free(f->fhist);
+    free(f->work);
+    free(f->dec);
+    free(f->fout);
+    free(f);
+}
+
+spm_ecode_t spm_filter_process(spm_filter_t *f, const int32_t *const *in, size_t n,
+                               float *const *out, size_t *out_n)
+{
+    if (!f || !in || !out || !out_n) return SPM_EPARAM;
+    *out_n = 0;
+    for (unsigned c = 0; c < f->ch; c++) {
+        if (!in[c] || !out[c]) return SPM_EPARAM;
+    }
+    if (n == 0) return SPM_OK;
+    if (f->cfg.type == SPM_FILTER_FIR && !ensure_work(f, n)) return SPM_ENOMEM;
+
+    uint64_t t0 = now_ns();
+
+    /* Channels see the same phase; it is committed once at the end */
+    size_t o = 0;
+    for (unsigned c = 0; c < f->ch; c++) {
+        switch (f->cfg.type) {
+            case SPM_FILTER_MOVAVG: o = run_movavg(f, c, in[c], n, out[c]); break;
+            case SPM_FILTER_CIC:    o = run_cic(f, c, in[c], n, out[c]);    break;
+            case SPM_FILTER_FIR:    o = run_fir(f, c, in[c], n, out[c]);    break;
+        }
+    }
+
+    f->phase = (uint32_t)((f->phase + n) % f->decim);
+    if (f->cfg.type == SPM_FILTER_MOVAVG) f->hpos = (uint32_t)((f->hpos + n) % f->cfg.len);
+
+    f->stats.calls++;
+    f->stats.in_samples  += (uint64_t)n * f->ch;
+    f->stats.out_samples += (uint64_t)o * f->ch;
+    f->stats.ns += now_ns() - t0;
+
+    *out_n = o;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_filter_acq_process(void *ctx, uint8_t *data, size_t *len)
+{
+    spm_filter_t *f = ctx;
+    if (!f || !f->has_fmt || !data || !len) return SPM_EPARAM;
+
+    const size_t ch = f->ch;
+    const size_t nframes = *len / spm_fmt_frame_len(&f->fmt);
+    if ((f->fmt.channels ? f->fmt.channels : 1) != ch) return SPM_EPARAM;
+
+    /* Output: nframes / decim (+1 for phase carry) interleaved floats */
+    const size_t max_out = nframes / f->decim + 1;
+    if ((nframes / f->decim) * ch * sizeof(float) > *len) return SPM_EPARAM;
+
+    if (nframes > f->scratch_cap) {
+        int32_t *dec  = realloc(f->dec, nframes * ch * sizeof(*dec));
+        if (dec) f->dec = dec;
+        float   *fout = realloc(f->fout, (nframes + 1) * ch * sizeof(*fout));
+        if (fout) f->fout = fout;
+        if (!dec || !fout) return SPM_ENOMEM;
+        f->scratch_cap = nframes;
+    }
+
+    int32_t *din[256];
+    float   *fo[256];
+    for (size_t c = 0; c < ch; c++) {
+        din[c] = f->dec + c * nframes;
+        fo[c]  = f->fout + c * max_out;
+    }
+
+    uint64_t t0 = now_ns();
+    spm_ecode_t rc = spm_decode_i32(&f->fmt, data, nframes, din);
+    f->stats.decode_ns += now_ns() - t0;
+    if (rc != SPM_OK) return rc;
+
+    size_t on = 0;
+    rc = spm_filter_process(f, (const int32_t *const *)din, nframes, fo, &on);
+    if (rc != SPM_OK) return rc;
+    if (on * ch * sizeof(float) > *len) return SPM_EPARAM;
+
+    float *dst = (float *)(void *)data;
+    for (size_t j = 0; j < on; j++) {
+        for (size_t c = 0; c < ch; c++) dst[j * ch + c] = fo[c][j];
+    }
+    *len = on * ch * sizeof(float);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_filter_get_stats(const spm_filter_t *f, spm_filter_stats_t *out_stats)
+{
+    if (!f || !out_stats) return SPM_EPARAM;
+    *out_stats = f->stats;
+    return SPM_OK;
+}
+
+const char *spm_filter_kernel(void)
+{
+    dot_fn dot = select_dot();
+#if defined(SPM_FILTER_X86)
+    if (dot == dot_avx2) return "avx2";
+    if (dot == dot_sse)  return "sse";
+#elif defined(SPM_FILTER_NEON)
+    if (dot == dot_neon) return "neon";
+#endif
+    (void)dot;
+    return "scalar";
+}
@@ -0,0 +1,380 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_gather.h"
+
+#define GATHER_DEFAULT_CMD       0x03
+#define GATHER_DEFAULT_ADDR      3
+#define GATHER_DEFAULT_FRAME_NS  1000u
+#define GATHER_MAX_DUMMY         16
+#define GATHER_MAX_HDR           (1 + 4 + GATHER_MAX_DUMMY)
+#define GATHER_DIRECT            SIZE_MAX
+#define GATHER_CAL_FRAMES        8
+#define GATHER_CAL_BYTES         16
+#define GATHER_CAL_ROUNDS        16
+
+/**
+ * @brief Prepared sparse read
+ *
+ * Each frame is two descriptors: the header from hdr, then the data
+ * into the caller's buffer (single-request spans) or into buf.
+ */
+struct spm_gather_plan {
+    size_t             count;
+    spm_gather_req_t  *reqs;       /* caller order */
+    size_t            *copy_off;   /* per request: offset in buf, GATHER_DIRECT if read in place */
+    uint8_t           *buf;
+    uint8_t           *hdr;        /* hdr_len bytes per frame */
+    spm_batch_xfer_t  *xfers;
+    size_t            *msg_end;    /* descriptor index one past each message */
+    spm_gather_info_t  info;
+};
+
+typedef struct {
+    uint32_t  addr;
+    size_t    len;
+    size_t    idx;     /* caller index */
+} sorted_req_t;
+
+typedef struct {
+    uint32_t  addr;
+    size_t    len;
+    size_t    first;   /* first sorted request */
+    size_t    nreqs;
+    size_t    buf_off; /* GATHER_DIRECT: read into the request's dst */
+} span_t;
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool v_cfg_is_valid(const spm_gather_cfg_t *c)
+{
+    if (c->addr_bytes > 4)                                   return false;
+    if (c->dummy_bytes > GATHER_MAX_DUMMY)                   return false;
+    return true;
+}
+
+static spm_gather_cfg_t cfg_or_default(const spm_gather_cfg_t *cfg)
+{
+    spm_gather_cfg_t c = cfg ? *cfg : (spm_gather_cfg_t){0};
+    if (!c.read_cmd)   c.read_cmd   = GATHER_DEFAULT_CMD;
+    if (!c.addr_bytes) c.addr_bytes = GATHER_DEFAULT_ADDR;
+    if (!c.frame_ns)   c.frame_ns   = GATHER_DEFAULT_FRAME_NS;
+    if (!c.max_msg)    c.max_msg    = SPM_BUFSIZ_DEFAULT;
+    return c;
+}
+
+static size_t hdr_len(const spm_gather_cfg_t *c)
+{
+    return (c->addr_only ? 0u : 1u) + c->addr_bytes + c->dummy_bytes;
+}
+
+static void hdr_build(const spm_gather_cfg_t *c, uint32_t addr, uint8_t *out)
+{
+    size_t p = 0;
+    uint32_t a = addr | c->addr_mask;
+    if (!c->addr_only) out[p++] = c->read_cmd;
+    for (unsigned i = 0; i < c->addr_bytes; i++) out[p++] = (uint8_t)(a >> (8 * (c->addr_bytes - 1 - i)));
+    memset(out + p, 0, c->dummy_bytes);
+}
+
+/* Clock time of one byte at the device's speed */
+static spm_ecode_t byte_ns_of(spm_device_t *dev, double *out)
+{
+    spm_cfg_t dc;
+    spm_ecode_t rc = spm_dev_get_cfg(dev, &dc);
+    if (rc != SPM_OK) return rc;
+    *out = dc.speed_hz ? 8e9 / (double)dc.speed_hz : 0.0;
+    return SPM_OK;
+}
+
+static int cmp_req(const void *a, const void *b)
+{
+    const sorted_req_t *x = a, *y = b;
+    if (x->addr != y->addr) return x->addr < y->addr ? -1 : 1;
+    return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+static size_t frames_of(size_t len, size_t cap)
+{
+    return (len + cap - 1) / cap;
+}
+
+static void plan_free(spm_gather_plan_t *plan)
+{
+    if (!plan) return;
+    free(plan->reqs);
+    free(plan->copy_off);
+    free(plan->buf);
+    free(plan->hdr);
+    free(plan->xfers);
+    free(plan->msg_end);
+    free(plan);
+}
+
+/*
+ * Reading through a gap of g bytes costs g byte times; a new frame
+ * costs its header bytes and frame_ns. Merge while the first is not
+ * more.
+ */
+static size_t span_requests(const sorted_req_t *s, size_t count, uint64_t max_gap, span_t *spans)
+{
+    size_t n = 0;
+    uint64_t end = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (n && s[k].addr <= end + max_gap) {
+            span_t *sp = &spans[n - 1];
+            uint64_t e = (uint64_t)s[k].addr + s[k].len;
+            if (e > end) end = e;
+            sp->len = (size_t)(end - sp->addr);
+            sp->nreqs++;
+            continue;
+        }
+        spans[n++] = (span_t){ .addr = s[k].addr, .len = s[k].len, .first = k, .nreqs = 1 };
+        end = (uint64_t)s[k].addr + s[k].len;
+    }
+    return n;
+}
+
+static spm_ecode_t plan_build(const spm_gather_cfg_t *c, double byte_ns, const spm_gather_req_t *reqs,
+                              size_t count, spm_gather_plan_t **out_plan)
+{
+    const size_t hl  = hdr_len(c);
+    const size_t cap = c->max_msg & ~(size_t)(SPM_BUFSIZ_ALIGN - 1);
+    const uint64_t max_gap = byte_ns > 0.0 ? hl + (uint64_t)((double)c->frame_ns / byte_ns) : UINT64_MAX;
+
+    spm_gather_plan_t *plan = calloc(1, sizeof(*plan));
+    sorted_req_t *s = malloc(count * sizeof(*s));
+    span_t *spans = malloc(count * sizeof(*spans));
+    if (!plan || !s || !spans) goto nomem;
+
+    for (size_t i = 0; i < count; i++) s[i] = (sorted_req_t){ reqs[i].addr, reqs[i].len, i };
+    qsort(s, count, sizeof(*s), cmp_req);
+    size_t nspans = span_requests(s, count, max_gap, spans);
+
+    /* Pass 1: sizes */
+    size_t nframes = 0, buf_len = 0;
+    for (size_t i = 0; i < nspans; i++) {
+        nframes += frames_of(spans[i].len, cap);
+        spans[i].buf_off = GATHER_DIRECT;
+        if (spans[i].nreqs > 1) {
+            spans[i].buf_off = buf_len;
+            buf_len += spans[i].len;
+        }
+    }
+
+    plan->count    = count;
+    plan->reqs     = malloc(count * sizeof(*plan->reqs));
+    plan->copy_off = malloc(count * sizeof(*plan->copy_off));
+    plan->buf      = buf_len ? malloc(buf_len) : NULL;
+    plan->hdr      = malloc(nframes * hl);
+    plan->xfers    = calloc(2 * nframes, sizeof(*plan->xfers));
+    plan->msg_end  = malloc(nframes * sizeof(*plan->msg_end));
+    if (!plan->reqs || !plan->copy_off || (buf_len && !plan->buf) || !plan->hdr ||
+        !plan->xfers || !plan->msg_end) goto nomem;
+    memcpy(plan->reqs, reqs, count * sizeof(*reqs));
+
+    /*
+     * Pass 2: frames, cut into messages spidev accepts: headers are tx
+     * and data is rx, each transfer counted rounded up to
+     * SPM_BUFSIZ_ALIGN, and neither sum may pass max_msg.
+     */
+    size_t f = 0, nmsgs = 0, msg_first = 0, msg_tx = 0, msg_rx = 0;
+    uint64_t est = 0;
+    for (size_t i = 0; i < nspans; i++) {
+        const span_t *sp = &spans[i];
+        uint8_t *rx = sp->buf_off == GATHER_DIRECT ? reqs[s[sp->first].idx].dst : plan->buf + sp->buf_off;
+
+        for (size_t off = 0; off < sp->len; off += cap, f++) {
+            size_t len = sp->len - off < cap ? sp->len - off : cap;
+            if (2 * f > msg_first &&
+                (msg_tx + SPM_BUFSIZ_COST(hl) > c->max_msg || msg_rx + SPM_BUFSIZ_COST(len) > c->max_msg ||
+                 2 * f + 2 - msg_first > SPM_MAX_BATCH_XFERS)) {
+                plan->xfers[2 * f - 1].cs_change = false;
+                plan->msg_end[nmsgs++] = 2 * f;
+                msg_first = 2 * f;
+                msg_tx = msg_rx = 0;
+            }
+
+            uint8_t *h = plan->hdr + f * hl;
+            hdr_build(c, sp->addr + (uint32_t)off, h);
+            plan->xfers[2 * f]     = (spm_batch_xfer_t){ .tx = h, .len = hl };
+            plan->xfers[2 * f + 1] = (spm_batch_xfer_t){ .rx = rx + off, .len = len, .cs_change = true };
+            msg_tx += SPM_BUFSIZ_COST(hl);
+            msg_rx += SPM_BUFSIZ_COST(len);
+            est += (uint64_t)((double)(hl + len) * byte_ns) + c->frame_ns;
+        }
+    }
+    plan->xfers[2 * nframes - 1].cs_change = false;
+    plan->msg_end[nmsgs++] = 2 * nframes;
+
+    /* Pass 3: where each request's bytes land */
+    for (size_t i = 0; i < nspans; i++) {
+        const span_t *sp = &spans[i];
+        for (size_t k = sp->first; k < sp->first + sp->nreqs; k++) {
+            plan->copy_off[s[k].idx] = sp->buf_off == GATHER_DIRECT
+                                       ? GATHER_DIRECT
+                                       : sp->buf_off + (s[k].addr - sp->addr);
+        }
+    }
+
+    uint64_t wanted = 0, read = 0, split = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t nf = frames_of(reqs[i].len, cap);
+        wanted += reqs[i].len;
+        split  += (uint64_t)((double)(nf * hl + reqs[i].len) * byte_ns) + nf * (uint64_t)c->frame_ns;
+    }
+    for (size_t i = 0; i < nspans; i++) read += spans[i].len;
+
+    plan->info = (spm_gather_info_t){
+        .requests     = count,
+        .spans        = nspans,
+        .frames       = nframes,
+        .messages     = nmsgs,
+        .bytes_wanted = wanted,
+        .bytes_read   = read,
+        .est_ns       = est,
+        .est_split_ns = split,
+    };
+
+    free(s);
+    free(spans);
+    *out_plan = plan;
+    return SPM_OK;
+
+nomem:
+    free(s);
+    free(spans);
+    plan_free(plan);
+    return SPM_ENOMEM;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_gather_plan_create(spm_device_t *dev, const spm_gather_cfg_t *cfg,
+                                   const spm_gather_req_t *reqs, size_t count,
+                                   spm_gather_plan_t **out_plan)
+{
+    if (!out_plan) return SPM_EPARAM;
+    *out_plan = NULL;
+    if (!reqs || count == 0) return SPM_EPARAM;
+    if (cfg && !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_gather_cfg_t c = cfg_or_default(cfg);
+    if (c.max_msg < SPM_BUFSIZ_ALIGN) return SPM_EPARAM;
+
+    const uint64_t space = 1ull << (8 * c.addr_bytes);
+    for (size_t i = 0; i < count; i++) {
+        if (!reqs[i].dst || reqs[i].len == 0)                  return SPM_EPARAM;
+        if ((uint64_t)reqs[i].addr + reqs[i].len > space)      return SPM_EPARAM;
+    }
+
+    double byte_ns;
+    spm_ecode_t rc = byte_ns_of(dev, &byte_ns);
+    if (rc != SPM_OK) return rc;
+
+    return plan_build(&c, byte_ns, reqs, count, out_plan);
+}
+
+spm_ecode_t spm_gather_plan_read(spm_device_t *dev, spm_gather_plan_t *plan)
+{
+    if (!plan) return SPM_EPARAM;
+
+    size_t start = 0;
+    for (size_t m = 0; m < plan->info.messages; m++) {
+        spm_ecode_t rc = spm_batch(dev, plan->xfers + start, plan->msg_end[m] - start);
+        if (rc != SPM_OK) return rc;
+        start = plan->msg_end[m];
+    }
+
+    for (size_t i = 0; i < plan->count; i++) {
+        if (plan->copy_off[i] == GATHER_DIRECT) continue;
+        memcpy(plan->reqs[i].dst, plan->buf + plan->copy_off[i], plan->reqs[i].len);
+    }
+    return SPM_OK;
+}
+
+spm_ecode_t spm_gather_plan_get_info(const spm_gather_plan_t *plan, spm_gather_info_t *out_info)
+{
+    if (!plan || !out_info) return SPM_EPARAM;
+    *out_info = plan->info;
+    return SPM_OK;
+}
+
+void spm_gather_plan_destroy(spm_gather_plan_t *plan)
+{
+    plan_free(plan);
+}
+
+spm_ecode_t spm_gather_read(spm_device_t *dev, const spm_gather_cfg_t *cfg,
+                            const spm_gather_req_t *reqs, size_t count)
+{
+    spm_gather_plan_t *plan = NULL;
+    spm_ecode_t rc = spm_gather_plan_create(dev, cfg, reqs, count, &plan);
+    if (rc != SPM_OK) return rc;
+
+    rc = spm_gather_plan_read(dev, plan);
+    plan_free(plan);
+    return rc;
+}
+
+spm_ecode_t spm_gather_calibrate(spm_device_t *dev, const spm_gather_cfg_t *cfg, uint32_t *out_frame_ns)
+{
+    if (!out_frame_ns) return SPM_EPARAM;
+    if (cfg && !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_gather_cfg_t c = cfg_or_default(cfg);
+    const size_t hl = hdr_len(&c);
+    if (c.max_msg < GATHER_CAL_FRAMES * SPM_BUFSIZ_COST(hl > GATHER_CAL_BYTES ? hl : GATHER_CAL_BYTES)) {
+        return SPM_EPARAM;
+    }
+
+    double byte_ns;
+    spm_ecode_t rc = byte_ns_of(dev, &byte_ns);
+    if (rc != SPM_OK) return rc;
+
+    /* the same data bytes as one frame and as GATHER_CAL_FRAMES frames */
+    uint8_t hdr[GATHER_MAX_HDR];
+    uint8_t rx[GATHER_CAL_FRAMES * GATHER_CAL_BYTES];
+    hdr_build(&c, 0, hdr);
+
+    spm_batch_xfer_t one[2] = {
+        { .tx = hdr, .len = hl },
+        { .rx = rx,  .len = sizeof rx },
+    };
+    spm_batch_xfer_t many[2 * GATHER_CAL_FRAMES];
+    for (size_t f = 0; f < GATHER_CAL_FRAMES; f++) {
+        many[2 * f]     = (spm_batch_xfer_t){ .tx = hdr, .len = hl };
+        many[2 * f + 1] = (spm_batch_xfer_t){ .rx = rx + f * GATHER_CAL_BYTES, .len = GATHER_CAL_BYTES,
+                                              .cs_change = f + 1 < GATHER_CAL_FRAMES };
+    }
+
+    uint64_t best_one = UINT64_MAX, best_many = UINT64_MAX;
+    for (int r = 0; r < GATHER_CAL_ROUNDS; r++) {
+        uint64_t t0 = now_ns();
+        rc = spm_batch(dev, one, 2);
+        uint64_t t1 = now_ns();
+        if (rc == SPM_OK) rc = spm_batch(dev, many, 2 * GATHER_CAL_FRAMES);
+        uint64_t t2 = now_ns();
+        if (rc != SPM_OK) return rc;
+
+        if (t1 - t0 < best_one)  best_one  = t1 - t0;
+        if (t2 - t1 < best_many) best_many = t2 - t1;
+    }
+
+    double per = best_many > best_one ? (double)(best_many - best_one) / (GATHER_CAL_FRAMES - 1) : 0.0;
+    per -= (double)hl * byte_ns;
+    *out_frame_ns = per > 1.0 ? (uint32_t)per : 1u;
+    return SPM_OK;
+}
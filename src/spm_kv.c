@@ -0,0 +1,1049 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_kv.h"
+
+#define SPM_KV_DEFAULT_SECTOR     4096u
+#define SPM_KV_DEFAULT_PAGE       256u
+#define SPM_KV_DEFAULT_GC_FREE    2u
+#define SPM_KV_DEFAULT_IDLE_US    5000u
+#define SPM_KV_PROG_TIMEOUT       20
+#define SPM_KV_ERASE_TIMEOUT      2000
+#define SPM_KV_ADDR_LIMIT         (1u << 24)
+#define SPM_KV_INDEX_MIN          64u
+#define SPM_KV_ERASE_POLL_US      1000u
+#define SPM_KV_IDLE_RECHECK_NS    100000000ull
+
+/* SPI NOR commands */
+#define NOR_READ   0x03
+#define NOR_PP     0x02
+#define NOR_WREN   0x06
+#define NOR_RDSR   0x05
+#define NOR_SE     0x20
+#define NOR_WIP    0x01
+
+/*
+ * Sector header (16 bytes): magic, erase count, CRC-32 of both, then
+ * the log sequence number, left erased until the sector is opened for
+ * appends so opening it is a single program.
+ */
+#define HDR_MAGIC      0x314B5653u   /* "SVK1" */
+#define HDR_SIZE       16u
+#define HDR_SEQ_OFF    12u
+#define SEQ_NONE       0xFFFFFFFFu
+
+/*
+ * Record: type, key length, value length (LE16), CRC-32 over those four
+ * bytes plus key and value, then key, value and 0xFF padding to 4.
+ * Types only clear bits of the erased 0xFF, which marks the log end.
+ */
+#define REC_HDR        8u
+#define REC_PUT        0xA5
+#define REC_DEL        0xA4
+#define REC_END        0xFF
+
+typedef enum {
+    SEC_FREE = 0,   /* erased; formatted says whether the header is written */
+    SEC_USED,
+    SEC_DIRTY,      /* collected or foreign, needs an erase */
+    SEC_ERASING,
+} sec_state_t;
+
+typedef struct {
+    sec_state_t  state;
+    bool         formatted;
+    uint32_t     seq;
+    uint32_t     erase_count;
+    uint32_t     used;        /* append offset */
+    uint32_t     live;        /* bytes of records the index points to */
+} kv_sector_t;
+
+typedef struct {
+    char        *key;         /* NULL = empty slot */
+    uint32_t     hash;
+    uint8_t      klen;
+    uint16_t     vlen;
+    uint32_t     sector;
+    uint32_t     off;
+    uint32_t     size;        /* record bytes incl. padding */
+} kv_entry_t;
+
+/**
+ * @brief Log-structured key-value store
+ *
+ * All flash access and index updates happen under lock. The log is
+ * FIFO: appends go to the newest sector and GC always collects the
+ * oldest, so a tombstone can be dropped together with its sector.
+ */
+struct spm_kv {
+    spm_device_t     *dev;
+    spm_kv_cfg_t      cfg;
+
+    kv_sector_t      *sectors;
+    int               head;       /* sector taking appends (-1 = none) */
+    uint32_t          seq;        /* newest sequence number */
+    int               erasing;    /* sector with an erase in flight (-1 = none) */
+    uint64_t          erase_t0;
+
+    kv_entry_t       *index;
+    uint32_t          index_cap;  /* power of two */
+    uint32_t          index_count;
+
+    uint8_t          *buf;        /* one sector: scans and GC */
+    uint8_t          *rec;        /* one sector: record encode and get */
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    bool              started;    /* thread needs joining */
+    bool              stop;
+    uint64_t          last_op_ns;
+
+    spm_kv_stats_t    stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_us(uint32_t us)
+{
+    struct timespec ts = { us / 1000000u, (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+    }
+    return ~crc;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t rec_size(size_t klen, size_t vlen)
+{
+    return (uint32_t)((REC_HDR + klen + vlen + 3u) & ~(size_t)3u);
+}
+
+static bool is_pow2(uint32_t v)
+{
+    return v && !(v & (v - 1));
+}
+
+static bool v_cfg_is_valid(const spm_kv_cfg_t *cfg)
+{
+    uint32_t ss = cfg->sector_size ? cfg->sector_size : SPM_KV_DEFAULT_SECTOR;
+    uint32_t ps = cfg->page_size ? cfg->page_size : SPM_KV_DEFAULT_PAGE;
+    if (!is_pow2(ss) || ss < 512u)                    return false;
+    if (!is_pow2(ps) || ps > ss)                      return false;
+    if (cfg->sectors < 3)                             return false;
+    if (cfg->base % ss)                               return false;
+    if ((uint64_t)cfg->base + (uint64_t)cfg->sectors * ss > SPM_KV_ADDR_LIMIT) return false;
+    if (cfg->gc_free >= cfg->sectors)                 return false;
+    if (cfg->prog_timeout_ms < 0 || cfg->erase_timeout_ms < 0) return false;
+    return true;
+}
+
+static uint32_t sector_addr(const spm_kv_t *kv, uint32_t s)
+{
+    return kv->cfg.base + s * kv->cfg.sector_size;
+}
+
+static void set_cmd(uint8_t *cmd, uint8_t op, uint32_t addr)
+{
+    cmd[0] = op;
+    cmd[1] = (uint8_t)(addr >> 16);
+    cmd[2] = (uint8_t)(addr >> 8);
+    cmd[3] = (uint8_t)addr;
+}
+
+/* ====================================================== */
+/* ======================== Flash ======================= */
+/* ====================================================== */
+
+static const spm_mem_cfg_t NOR_READ_CFG = { .read_cmd = NOR_READ, .addr_bytes = 3 };
+
+/* READ frames in messages within spidev's default bufsiz */
+static spm_ecode_t nor_read(spm_kv_t *kv, uint32_t addr, void *out, size_t len)
+{
+    spm_mem_range_t r = { .addr = addr, .dst = out, .len = len };
+    return spm_mem_read(kv->dev, &NOR_READ_CFG, &r, 1, NULL);
+}
+
+static spm_ecode_t nor_status(spm_kv_t *kv, uint8_t *out_sr)
+{
+    uint8_t tx[2] = { NOR_RDSR, 0x00 }, rx[2] = {0};
+    spm_ecode_t rc = spm_transfer(kv->dev, tx, rx, sizeof tx);
+    *out_sr = rx[1];
+    return rc;
+}
+
+static spm_ecode_t nor_wait(spm_kv_t *kv, int timeout_ms, uint32_t poll_us)
+{
+    uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ull;
+    for (;;) {
+        uint8_t sr;
+        spm_ecode_t rc = nor_status(kv, &sr);
+        if (rc != SPM_OK) return rc;
+        if (!(sr & NOR_WIP)) return SPM_OK;
+        if (now_ns() > deadline) return SPM_ETIMEOUT;
+        sleep_us(poll_us);
+    }
+}
+
+/* WREN and the command share a message, CS toggling between them */
+static spm_ecode_t nor_write_cmd(spm_kv_t *kv, uint8_t op, uint32_t addr, const void *data, size_t len)
+{
+    static const uint8_t wren = NOR_WREN;
+    uint8_t cmd[4];
+    set_cmd(cmd, op, addr);
+
+    spm_batch_xfer_t x[3] = {
+        { .tx = &wren, .len = 1, .cs_change = true },
+        { .tx = cmd,   .len = sizeof cmd },
+        { .tx = data,  .len = len },
+    };
+    return spm_batch(kv->dev, x, len ? 3 : 2);
+}
+
+static spm_ecode_t nor_program(spm_kv_t *kv, uint32_t addr, const uint8_t *data, size_t len)
+{
+    const uint32_t ps = kv->cfg.page_size;
+    while (len) {
+        size_t n = ps - (addr & (ps - 1));
+        if (n > len) n = len;
+        spm_ecode_t rc = nor_write_cmd(kv, NOR_PP, addr, data, n);
+        if (rc == SPM_OK) rc = nor_wait(kv, kv->cfg.prog_timeout_ms, 10);
+        if (rc != SPM_OK) return rc;
+        addr += (uint32_t)n; data += n; len -= n;
+    }
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ======================== Index ======================= */
+/* ====================================================== */
+
+static uint32_t key_hash(const char *key, size_t klen)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < klen; i++) h = (h ^ (uint8_t)key[i]) * 16777619u;
+    return h;
+}
+
+static kv_entry_t *idx_find(const spm_kv_t *kv, const char *key, size_t klen, uint32_t hash)
+{
+    const uint32_t mask = kv->index_cap - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        kv_entry_t *e = &kv->index[i];
+        if (!e->key) return NULL;
+        if (e->hash == hash && e->klen == klen && !memcmp(e->key, key, klen)) return e;
+    }
+}
+
+static kv_entry_t *idx_slot(kv_entry_t *tab, uint32_t cap, uint32_t hash)
+{
+    uint32_t i = hash & (cap - 1);
+    while (tab[i].key) i = (i + 1) & (cap - 1);
+    return &tab[i];
+}
+
+static spm_ecode_t idx_grow(spm_kv_t *kv)
+{
+    uint32_t cap = kv->index_cap ? kv->index_cap * 2 : SPM_KV_INDEX_MIN;
+    kv_entry_t *tab = calloc(cap, sizeof(*tab));
+    if (!tab) return SPM_ENOMEM;
+
+    for (uint32_t i = 0; i < kv->index_cap; i++) {
+        if (kv->index[i].key) *idx_slot(tab, cap, kv->index[i].hash) = kv->index[i];
+    }
+    free(kv->index);
+    kv->index = tab;
+    kv->index_cap = cap;
+    return SPM_OK;
+}
+
+/* Entry for key, created empty (sector = UINT32_MAX) if missing */
+static spm_ecode_t idx_upsert(spm_kv_t *kv, const char *key, size_t klen, uint32_t hash, kv_entry_t **out)
+{
+    kv_entry_t *e = idx_find(kv, key, klen, hash);
+    if (!e) {
+        if ((kv->index_count + 1) * 10u > kv->index_cap * 7u) {
+            spm_ecode_t rc = idx_grow(kv);
+            if (rc != SPM_OK) return rc;
+        }
+        char *copy = malloc(klen + 1);
+        if (!copy) return SPM_ENOMEM;
+        memcpy(copy, key, klen);
+        copy[klen] = '\0';
+
+        e = idx_slot(kv->index, kv->index_cap, hash);
+        *e = (kv_entry_t){ .key = copy, .hash = hash, .klen = (uint8_t)klen, .sector = UINT32_MAX };
+        kv->index_count++;
+    }
+    *out = e;
+    return SPM_OK;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones */
+static void idx_remove(spm_kv_t *kv, kv_entry_t *e)
+{
+    const uint32_t mask = kv->index_cap - 1;
+    uint32_t i = (uint32_t)(e - kv->index);
+    free(e->key);
+
+    for (uint32_t j = (i + 1) & mask; kv->index[j].key; j = (j + 1) & mask) {
+        uint32_t home = kv->index[j].hash & mask;
+        bool stays = (j > i) ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        kv->index[i] = kv->index[j];
+        i = j;
+    }
+    kv->index[i].key = NULL;
+    kv->index_count--;
+}
+
+static void idx_clear(spm_kv_t *kv)
+{
+    for (uint32_t i = 0; i < kv->index_cap; i++) {
+        free(kv->index[i].key);
+        kv->index[i].key = NULL;
+    }
+    kv->index_count = 0;
+}
+
+/* Point key at a record (or drop it for a tombstone) and fix live counts */
+static spm_ecode_t idx_apply(spm_kv_t *kv, uint8_t type, const char *key, size_t klen,
+                             size_t vlen, uint32_t sector, uint32_t off)
+{
+    uint32_t hash = key_hash(key, klen);
+    kv_entry_t *e = idx_find(kv, key, klen, hash);
+    if (e && e->sector != UINT32_MAX) kv->sectors[e->sector].live -= e->size;
+
+    if (type == REC_DEL) {
+        if (e) idx_remove(kv, e);
+        return SPM_OK;
+    }
+
+    spm_ecode_t rc = idx_upsert(kv, key, klen, hash, &e);
+    if (rc != SPM_OK) return rc;
+    e->vlen   = (uint16_t)vlen;
+    e->sector = sector;
+    e->off    = off;
+    e->size   = rec_size(klen, vlen);
+    kv->sectors[sector].live += e->size;
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ======================= Records ====================== */
+/* ====================================================== */
+
+static uint32_t encode_record(uint8_t *p, uint8_t type, const char *key, size_t klen,
+                              const void *val, size_t vlen)
+{
+    uint32_t size = rec_size(klen, vlen);
+    p[0] = type;
+    p[1] = (uint8_t)klen;
+    p[2] = (uint8_t)vlen;
+    p[3] = (uint8_t)(vlen >> 8);
+    memcpy(p + REC_HDR, key, klen);
+    if (vlen) memcpy(p + REC_HDR + klen, val, vlen);
+    memset(p + REC_HDR + klen + vlen, 0xFF, size - (REC_HDR + klen + vlen));
+
+    uint32_t crc = crc32_update(0, p, 4);
+    put_le32(p + 4, crc32_update(crc, p + REC_HDR, klen + vlen));
+    return size;
+}
+
+typedef enum {
+    REC_OK = 0,
+    REC_BAD_CRC,     /* skippable: lengths are sane */
+    REC_LOG_END,     /* erased space */
+    REC_GARBAGE,     /* cannot tell where the next record starts */
+} rec_parse_t;
+
+static rec_parse_t parse_record(const uint8_t *p, size_t avail, uint32_t *out_size)
+{
+    if (avail < REC_HDR || p[0] == REC_END) return REC_LOG_END;
+    if (p[0] != REC_PUT && p[0] != REC_DEL) return REC_GARBAGE;
+
+    size_t klen = p[1], vlen = (size_t)p[2] | (size_t)p[3] << 8;
+    uint32_t size = rec_size(klen, vlen);
+    if (!klen || size > avail) return REC_GARBAGE;
+    *out_size = size;
+
+    uint32_t crc = crc32_update(0, p, 4);
+    crc = crc32_update(crc, p + REC_HDR, klen + vlen);
+    return crc == get_le32(p + 4) ? REC_OK : REC_BAD_CRC;
+}
+
+/* ====================================================== */
+/* ======================= Sectors ====================== */
+/* ====================================================== */
+
+static uint32_t free_sectors(const spm_kv_t *kv)
+{
+    uint32_t n = 0;
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) n += kv->sectors[s].state == SEC_FREE;
+    return n;
+}
+
+static int find_sector(const spm_kv_t *kv, sec_state_t state)
+{
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        if (kv->sectors[s].state == state) return (int)s;
+    }
+    return -1;
+}
+
+static int oldest_sector(const spm_kv_t *kv)
+{
+    int best = -1;
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        const kv_sector_t *sec = &kv->sectors[s];
+        if (sec->state == SEC_USED && (best < 0 || sec->seq < kv->sectors[best].seq)) best = (int)s;
+    }
+    return best;
+}
+
+static uint64_t dead_bytes(const spm_kv_t *kv)
+{
+    uint64_t dead = 0;
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        const kv_sector_t *sec = &kv->sectors[s];
+        if (sec->state == SEC_USED) dead += sec->used - HDR_SIZE - sec->live;
+    }
+    return dead;
+}
+
+/* Take the least-worn erased sector for appends */
+static spm_ecode_t open_sector(spm_kv_t *kv)
+{
+    int best = -1;
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        const kv_sector_t *sec = &kv->sectors[s];
+        if (sec->state != SEC_FREE) continue;
+        if (best < 0 || sec->erase_count < kv->sectors[best].erase_count) best = (int)s;
+    }
+    if (best < 0) return SPM_ENOMEM;
+
+    kv_sector_t *sec = &kv->sectors[best];
+    uint32_t seq = kv->seq + 1;
+    uint8_t hdr[HDR_SIZE];
+    put_le32(hdr, HDR_MAGIC);
+    put_le32(hdr + 4, sec->erase_count);
+    put_le32(hdr + 8, crc32_update(0, hdr, 8));
+    put_le32(hdr + HDR_SEQ_OFF, seq);
+
+    uint32_t off = sec->formatted ? HDR_SEQ_OFF : 0;
+    spm_ecode_t rc = nor_program(kv, sector_addr(kv, (uint32_t)best) + off, hdr + off, HDR_SIZE - off);
+    if (rc != SPM_OK) {
+        sec->state = SEC_DIRTY;
+        return rc;
+    }
+
+    kv->seq = seq;
+    sec->state = SEC_USED;
+    sec->formatted = true;
+    sec->seq = seq;
+    sec->used = HDR_SIZE;
+    sec->live = 0;
+    kv->head = best;
+    return SPM_OK;
+}
+
+/*
+ * Append an encoded record to the head. Puts leave one erased sector
+ * spare so GC always has somewhere to relocate into.
+ */
+static spm_ecode_t append(spm_kv_t *kv, const uint8_t *rec, uint32_t size, bool gc, uint32_t *out_off)
+{
+    kv_sector_t *head = kv->head >= 0 ? &kv->sectors[kv->head] : NULL;
+    if (!head || head->used + size > kv->cfg.sector_size) {
+        if (free_sectors(kv) <= (gc ? 0u : 1u)) return SPM_EAGAIN;
+        spm_ecode_t rc = open_sector(kv);
+        if (rc != SPM_OK) return rc;
+        head = &kv->sectors[kv->head];
+    }
+
+    uint32_t off = head->used;
+    spm_ecode_t rc = nor_program(kv, sector_addr(kv, (uint32_t)kv->head) + off, rec, size);
+    /* A failed program may have left part of a record: never reuse it */
+    head->used = rc == SPM_OK ? off + size : kv->cfg.sector_size;
+    if (rc != SPM_OK) return rc;
+
+    if (gc) kv->stats.gc_bytes += size;
+    else    kv->stats.bytes_written += size;
+    *out_off = off;
+    return SPM_OK;
+}
+
+/* Move live records of the oldest sector to the head, leaving it dirty */
+static spm_ecode_t collect(spm_kv_t *kv)
+{
+    int s = oldest_sector(kv);
+    if (s < 0 || s == kv->head) return SPM_ESTATE;
+
+    kv_sector_t *sec = &kv->sectors[s];
+    const uint32_t ss = kv->cfg.sector_size;
+    spm_ecode_t rc = nor_read(kv, sector_addr(kv, (uint32_t)s), kv->buf, ss);
+    if (rc != SPM_OK) return rc;
+
+    for (uint32_t off = HDR_SIZE; off < sec->used && sec->live;) {
+        uint32_t size = 0;
+        rec_parse_t pr = parse_record(kv->buf + off, sec->used - off, &size);
+        if (pr == REC_LOG_END || pr == REC_GARBAGE) break;
+
+        const uint8_t *p = kv->buf + off;
+        if (pr == REC_OK && p[0] == REC_PUT) {
+            size_t klen = p[1];
+            kv_entry_t *e = idx_find(kv, (const char *)p + REC_HDR, klen, key_hash((const char *)p + REC_HDR, klen));
+            if (e && e->sector == (uint32_t)s && e->off == off) {
+                uint32_t to;
+                rc = append(kv, p, size, true, &to);
+                if (rc != SPM_OK) return rc;
+                sec->live -= size;
+                e->sector = (uint32_t)kv->head;
+                e->off = to;
+                kv->sectors[kv->head].live += size;
+            }
+        }
+        off += size;
+    }
+
+    sec->state = SEC_DIRTY;
+    sec->live = 0;
+    sec->used = 0;
+    kv->stats.gc_runs++;
+    return SPM_OK;
+}
+
+static spm_ecode_t erase_begin(spm_kv_t *kv, int s)
+{
+    spm_ecode_t rc = nor_write_cmd(kv, NOR_SE, sector_addr(kv, (uint32_t)s), NULL, 0);
+    if (rc != SPM_OK) return rc;
+    kv->sectors[s].state = SEC_ERASING;
+    kv->erasing = s;
+    kv->erase_t0 = now_ns();
+    return SPM_OK;
+}
+
+/* SPM_EAGAIN while the erase runs; on completion the header is written */
+static spm_ecode_t erase_poll(spm_kv_t *kv)
+{
+    int s = kv->erasing;
+    uint8_t sr;
+    spm_ecode_t rc = nor_status(kv, &sr);
+    if (rc == SPM_OK && (sr & NOR_WIP)) {
+        if (now_ns() - kv->erase_t0 <= (uint64_t)kv->cfg.erase_timeout_ms * 1000000ull) return SPM_EAGAIN;
+        rc = SPM_ETIMEOUT;
+    }
+    kv->erasing = -1;
+
+    kv_sector_t *sec = &kv->sectors[s];
+    if (rc != SPM_OK) {
+        sec->state = SEC_DIRTY;
+        return rc;
+    }
+    kv->stats.erases++;
+    sec->erase_count++;
+    sec->state = SEC_FREE;
+    sec->formatted = false;
+    sec->seq = SEQ_NONE;
+
+    /* Record the new count right away; the seq stays erased */
+    uint8_t hdr[HDR_SEQ_OFF];
+    put_le32(hdr, HDR_MAGIC);
+    put_le32(hdr + 4, sec->erase_count);
+    put_le32(hdr + 8, crc32_update(0, hdr, 8));
+    rc = nor_program(kv, sector_addr(kv, (uint32_t)s), hdr, sizeof hdr);
+    if (rc != SPM_OK) {
+        sec->state = SEC_DIRTY;
+        return rc;
+    }
+    sec->formatted = true;
+    return SPM_OK;
+}
+
+static spm_ecode_t erase_wait(spm_kv_t *kv)
+{
+    spm_ecode_t rc;
+    while ((rc = erase_poll(kv)) == SPM_EAGAIN) sleep_us(SPM_KV_ERASE_POLL_US);
+    return rc;
+}
+
+/* Calls that need the flash finish a background erase first */
+static spm_ecode_t settle(spm_kv_t *kv)
+{
+    kv->last_op_ns = now_ns();
+    if (kv->erasing < 0) return SPM_OK;
+
+    uint64_t t0 = now_ns();
+    spm_ecode_t rc = erase_wait(kv);
+    kv->stats.erase_wait_ns += now_ns() - t0;
+    return rc;
+}
+
+/* GC pays off once the garbage adds up to a sector */
+static bool gc_wanted(const spm_kv_t *kv)
+{
+    if (free_sectors(kv) >= kv->cfg.gc_free) return false;
+    int s = oldest_sector(kv);
+    return s >= 0 && s != kv->head && dead_bytes(kv) >= kv->cfg.sector_size - HDR_SIZE;
+}
+
+static bool work_pending(const spm_kv_t *kv)
+{
+    return kv->erasing >= 0 || find_sector(kv, SEC_DIRTY) >= 0 || gc_wanted(kv);
+}
+
+/* One unit of maintenance: start an erase or collect a sector */
+static spm_ecode_t maintain_step(spm_kv_t *kv, bool *out_did)
+{
+    *out_did = true;
+    int s = find_sector(kv, SEC_DIRTY);
+    if (s >= 0) return erase_begin(kv, s);
+    if (gc_wanted(kv)) return collect(kv);
+    *out_did = false;
+    return SPM_OK;
+}
+
+/* Synchronous erase, and GC if nothing is waiting for one, for a stuck put */
+static spm_ecode_t reclaim(spm_kv_t *kv)
+{
+    kv->stats.fg_gc_runs++;
+    spm_ecode_t rc = SPM_OK;
+    if (find_sector(kv, SEC_DIRTY) < 0) {
+        rc = collect(kv);
+        if (rc == SPM_ESTATE || rc == SPM_EAGAIN) return SPM_ENOMEM;
+    }
+    for (int s; rc == SPM_OK && (s = find_sector(kv, SEC_DIRTY)) >= 0;) {
+        rc = erase_begin(kv, s);
+        if (rc == SPM_OK) rc = erase_wait(kv);
+    }
+    return rc;
+}
+
+/* Append with foreground GC; gives up once every sector was tried */
+static spm_ecode_t append_record(spm_kv_t *kv, const uint8_t *rec, uint32_t size, uint32_t *out_off)
+{
+    for (uint32_t tries = 0;; tries++) {
+        spm_ecode_t rc = append(kv, rec, size, false, out_off);
+        if (rc != SPM_EAGAIN) return rc;
+        if (tries >= kv->cfg.sectors) return SPM_ENOMEM;
+        rc = reclaim(kv);
+        if (rc != SPM_OK) return rc;
+    }
+}
+
+/* ====================================================== */
+/* ======================== Mount ======================= */
+/* ====================================================== */
+
+static bool all_erased(const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+/* All sector headers, one frame each, in as few messages as bufsiz allows */
+static spm_ecode_t read_headers(spm_kv_t *kv, uint8_t *hdrs)
+{
+    spm_mem_range_t *r = malloc(kv->cfg.sectors * sizeof(*r));
+    if (!r) return SPM_ENOMEM;
+
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        r[s] = (spm_mem_range_t){ .addr = sector_addr(kv, s), .dst = hdrs + (size_t)s * HDR_SIZE,
+                                  .len = HDR_SIZE };
+    }
+    spm_ecode_t rc = spm_mem_read(kv->dev, &NOR_READ_CFG, r, kv->cfg.sectors, NULL);
+    if (rc == SPM_OK) kv->stats.mount_bytes += (uint64_t)kv->cfg.sectors * HDR_SIZE;
+    free(r);
+    return rc;
+}
+
+static void parse_header(kv_sector_t *sec, const uint8_t *h)
+{
+    memset(sec, 0, sizeof(*sec));
+    sec->seq = SEQ_NONE;
+
+    if (get_le32(h) == HDR_MAGIC && get_le32(h + 8) == crc32_update(0, h, 8)) {
+        sec->erase_count = get_le32(h + 4);
+        sec->formatted = true;
+        sec->seq = get_le32(h + HDR_SEQ_OFF);
+        sec->state = sec->seq == SEQ_NONE ? SEC_FREE : SEC_USED;
+    } else {
+        sec->state = all_erased(h, HDR_SIZE) ? SEC_FREE : SEC_DIRTY;
+    }
+}
+
+typedef struct {
+    uint32_t  seq;
+    uint32_t  sector;
+} seq_key_t;
+
+static int cmp_seq(const void *a, const void *b)
+{
+    uint32_t x = ((const seq_key_t *)a)->seq, y = ((const seq_key_t *)b)->seq;
+    return (x > y) - (x < y);
+}
+
+/* Replay one used sector's records into the index */
+static spm_ecode_t scan_sector(spm_kv_t *kv, uint32_t s)
+{
+    kv_sector_t *sec = &kv->sectors[s];
+    const uint32_t ss = kv->cfg.sector_size;
+    spm_ecode_t rc = nor_read(kv, sector_addr(kv, s), kv->buf, ss);
+    if (rc != SPM_OK) return rc;
+    kv->stats.mount_bytes += ss;
+
+    uint32_t off = HDR_SIZE;
+    while (off < ss) {
+        uint32_t size = 0;
+        rec_parse_t pr = parse_record(kv->buf + off, ss - off, &size);
+        if (pr == REC_LOG_END) break;
+        if (pr == REC_GARBAGE) {
+            off = ss;
+            break;
+        }
+        if (pr == REC_BAD_CRC) {
+            kv->stats.crc_errors++;
+        } else {
+            const uint8_t *p = kv->buf + off;
+            size_t vlen = (size_t)p[2] | (size_t)p[3] << 8;
+            rc = idx_apply(kv, p[0], (const char *)p + REC_HDR, p[1], vlen, s, off);
+            if (rc != SPM_OK) return rc;
+        }
+        off += size;
+    }
+    sec->used = off;
+    return SPM_OK;
+}
+
+static spm_ecode_t mount(spm_kv_t *kv)
+{
+    const uint32_t n = kv->cfg.sectors;
+    uint64_t t0 = now_ns();
+
+    uint8_t   *hdrs  = malloc((size_t)n * HDR_SIZE);
+    seq_key_t *order = malloc((size_t)n * sizeof(*order));
+    spm_ecode_t rc = (hdrs && order) ? read_headers(kv, hdrs) : SPM_ENOMEM;
+
+    uint32_t used = 0;
+    for (uint32_t s = 0; rc == SPM_OK && s < n; s++) {
+        parse_header(&kv->sectors[s], hdrs + (size_t)s * HDR_SIZE);
+        if (kv->sectors[s].state == SEC_USED) order[used++] = (seq_key_t){ kv->sectors[s].seq, s };
+    }
+    if (rc == SPM_OK) qsort(order, used, sizeof(*order), cmp_seq);
+
+    /* Log order, so later records win */
+    for (uint32_t i = 0; rc == SPM_OK && i < used; i++) {
+        rc = scan_sector(kv, order[i].sector);
+        kv->head = (int)order[i].sector;
+        kv->seq  = order[i].seq;
+    }
+
+    free(order);
+    free(hdrs);
+    kv->stats.mount_ns = now_ns() - t0;
+    return rc;
+}
+
+/* ====================================================== */
+/* =================== Background Work ================== */
+/* ====================================================== */
+
+static void wait_until(spm_kv_t *kv, uint64_t deadline_ns)
+{
+    struct timespec ts = { (time_t)(deadline_ns / 1000000000ull), (long)(deadline_ns % 1000000000ull) };
+    pthread_cond_timedwait(&kv->cond, &kv->lock, &ts);
+}
+
+static void *kv_thread(void *arg)
+{
+    spm_kv_t *kv = arg;
+    const uint64_t idle_ns = (uint64_t)kv->cfg.idle_us * 1000ull;
+
+    pthread_mutex_lock(&kv->lock);
+    while (!kv->stop) {
+        uint64_t now = now_ns();
+
+        /* Poll an erase in flight, releasing the store between polls */
+        if (kv->erasing >= 0) {
+            if (erase_poll(kv) == SPM_EAGAIN) wait_until(kv, now + SPM_KV_ERASE_POLL_US * 1000ull);
+            continue;
+        }
+        if (now - kv->last_op_ns < idle_ns) {
+            wait_until(kv, kv->last_op_ns + idle_ns);
+            continue;
+        }
+
+        bool did;
+        spm_ecode_t rc = maintain_step(kv, &did);
+        if (!did || rc != SPM_OK) wait_until(kv, now + SPM_KV_IDLE_RECHECK_NS);
+    }
+
+    if (kv->erasing >= 0) erase_wait(kv);
+    pthread_mutex_unlock(&kv->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_kv_create(spm_device_t *dev, const spm_kv_cfg_t *cfg, spm_kv_t **out_kv)
+{
+    if (out_kv) *out_kv = NULL;
+    if (!dev || !cfg || !out_kv || !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_kv_t *kv = calloc(1, sizeof(*kv));
+    if (!kv) return SPM_ENOMEM;
+
+    kv->dev = dev;
+    kv->cfg = *cfg;
+    if (!kv->cfg.sector_size)      kv->cfg.sector_size      = SPM_KV_DEFAULT_SECTOR;
+    if (!kv->cfg.page_size)        kv->cfg.page_size        = SPM_KV_DEFAULT_PAGE;
+    if (!kv->cfg.gc_free)          kv->cfg.gc_free          = SPM_KV_DEFAULT_GC_FREE;
+    if (!kv->cfg.idle_us)          kv->cfg.idle_us          = SPM_KV_DEFAULT_IDLE_US;
+    if (!kv->cfg.prog_timeout_ms)  kv->cfg.prog_timeout_ms  = SPM_KV_PROG_TIMEOUT;
+    if (!kv->cfg.erase_timeout_ms) kv->cfg.erase_timeout_ms = SPM_KV_ERASE_TIMEOUT;
+
+    kv->head    = -1;
+    kv->erasing = -1;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&kv->lock, NULL);
+    pthread_cond_init(&kv->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    kv->sectors = calloc(kv->cfg.sectors, sizeof(*kv->sectors));
+    kv->buf     = malloc(kv->cfg.sector_size);
+    kv->rec     = malloc(kv->cfg.sector_size);
+
+    spm_ecode_t rc = (kv->sectors && kv->buf && kv->rec) ? idx_grow(kv) : SPM_ENOMEM;
+    if (rc == SPM_OK) rc = mount(kv);
+    if (rc != SPM_OK) {
+        spm_kv_destroy(kv);
+        return rc;
+    }
+
+    kv->last_op_ns = now_ns();
+    *out_kv = kv;
+    return SPM_OK;
+}
+
+void spm_kv_destroy(spm_kv_t *kv)
+{
+    if (!kv) return;
+    spm_kv_stop(kv);
+    if (kv->erasing >= 0) erase_wait(kv);
+
+    if (kv->index) idx_clear(kv);
+    pthread_cond_destroy(&kv->cond);
+    pthread_mutex_destroy(&kv->lock);
+    free(kv->index);
+    free(kv->rec);
+    free(kv->buf);
+    free(kv->sectors);
+    free(kv);
+}
+
+spm_ecode_t spm_kv_format(spm_kv_t *kv)
+{
+    if (!kv) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    spm_ecode_t rc = settle(kv);
+    idx_clear(kv);
+    kv->head = -1;
+    for (uint32_t s = 0; rc == SPM_OK && s < kv->cfg.sectors; s++) {
+        kv->sectors[s].live = 0;
+        kv->sectors[s].used = 0;
+        rc = erase_begin(kv, (int)s);
+        if (rc == SPM_OK) rc = erase_wait(kv);
+    }
+    pthread_mutex_unlock(&kv->lock);
+    return rc;
+}
+
+spm_ecode_t spm_kv_put(spm_kv_t *kv, const char *key, const void *val, size_t len)
+{
+    if (!kv || !key || (len && !val)) return SPM_EPARAM;
+    size_t klen = strlen(key);
+    if (!klen || klen > SPM_KV_MAX_KEY || len > UINT16_MAX) return SPM_EPARAM;
+    if (rec_size(klen, len) > kv->cfg.sector_size - HDR_SIZE) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    spm_ecode_t rc = settle(kv);
+    if (rc == SPM_OK) {
+        uint32_t size = encode_record(kv->rec, REC_PUT, key, klen, val, len);
+        uint32_t off;
+        rc = append_record(kv, kv->rec, size, &off);
+        if (rc == SPM_OK) rc = idx_apply(kv, REC_PUT, key, klen, len, (uint32_t)kv->head, off);
+        if (rc == SPM_OK) kv->stats.puts++;
+    }
+    pthread_mutex_unlock(&kv->lock);
+    return rc;
+}
+
+spm_ecode_t spm_kv_get(spm_kv_t *kv, const char *key, void *out, size_t cap, size_t *out_len)
+{
+    if (!kv || !key || (cap && !out)) return SPM_EPARAM;
+    size_t klen = strlen(key);
+    if (!klen || klen > SPM_KV_MAX_KEY) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    spm_ecode_t rc = settle(kv);
+    kv_entry_t *e = rc == SPM_OK ? idx_find(kv, key, klen, key_hash(key, klen)) : NULL;
+    if (rc == SPM_OK && !e) rc = SPM_EPARAM;
+
+    if (rc == SPM_OK) {
+        if (out_len) *out_len = e->vlen;
+        if (e->vlen > cap) rc = SPM_ENOMEM;
+    }
+    if (rc == SPM_OK) {
+        /* The whole record, so its CRC can be checked */
+        rc = nor_read(kv, sector_addr(kv, e->sector) + e->off, kv->rec, e->size);
+        uint32_t size;
+        if (rc == SPM_OK && parse_record(kv->rec, e->size, &size) != REC_OK) {
+            kv->stats.crc_errors++;
+            rc = SPM_ECRC;
+        }
+        if (rc == SPM_OK) {
+            if (e->vlen) memcpy(out, kv->rec + REC_HDR + klen, e->vlen);
+            kv->stats.gets++;
+        }
+    }
+    pthread_mutex_unlock(&kv->lock);
+    return rc;
+}
+
+spm_ecode_t spm_kv_delete(spm_kv_t *kv, const char *key)
+{
+    if (!kv || !key) return SPM_EPARAM;
+    size_t klen = strlen(key);
+    if (!klen || klen > SPM_KV_MAX_KEY) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    spm_ecode_t rc = settle(kv);
+    if (rc == SPM_OK && !idx_find(kv, key, klen, key_hash(key, klen))) rc = SPM_EPARAM;
+    if (rc == SPM_OK) {
+        uint32_t size = encode_record(kv->rec, REC_DEL, key, klen, NULL, 0);
+        uint32_t off;
+        rc = append_record(kv, kv->rec, size, &off);
+        if (rc == SPM_OK) rc = idx_apply(kv, REC_DEL, key, klen, 0, (uint32_t)kv->head, off);
+        if (rc == SPM_OK) kv->stats.deletes++;
+    }
+    pthread_mutex_unlock(&kv->lock);
+    return rc;
+}
+
+spm_ecode_t spm_kv_start(spm_kv_t *kv)
+{
+    if (!kv) return SPM_EPARAM;
+    if (kv->started) return SPM_ESTATE;
+
+    pthread_mutex_lock(&kv->lock);
+    kv->stop = false;
+    pthread_mutex_unlock(&kv->lock);
+
+    if (pthread_create(&kv->thread, NULL, kv_thread, kv) != 0) return SPM_ENOMEM;
+    kv->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_kv_stop(spm_kv_t *kv)
+{
+    if (!kv) return SPM_EPARAM;
+    if (!kv->started) return SPM_OK;
+
+    pthread_mutex_lock(&kv->lock);
+    kv->stop = true;
+    pthread_cond_broadcast(&kv->cond);
+    pthread_mutex_unlock(&kv->lock);
+
+    pthread_join(kv->thread, NULL);
+    kv->started = false;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_kv_maintain(spm_kv_t *kv, bool *out_more)
+{
+    if (!kv) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    spm_ecode_t rc = kv->erasing >= 0 ? erase_wait(kv) : SPM_OK;
+    if (rc == SPM_OK) {
+        bool did;
+        rc = maintain_step(kv, &did);
+        if (rc == SPM_OK && kv->erasing >= 0) rc = erase_wait(kv);
+    }
+    if (out_more) *out_more = work_pending(kv);
+    pthread_mutex_unlock(&kv->lock);
+    return rc;
+}
+
+spm_ecode_t spm_kv_get_stats(spm_kv_t *kv, spm_kv_stats_t *out_stats)
+{
+    if (!kv || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    *out_stats = kv->stats;
+    out_stats->keys = kv->index_count;
+    out_stats->sectors_free = free_sectors(kv);
+    out_stats->sectors_dirty = 0;
+    out_stats->live_bytes = 0;
+    out_stats->dead_bytes = dead_bytes(kv);
+    out_stats->erase_min = UINT32_MAX;
+    out_stats->erase_max = 0;
+
+    double sum = 0.0;
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) {
+        const kv_sector_t *sec = &kv->sectors[s];
+        out_stats->sectors_dirty += sec->state == SEC_DIRTY || sec->state == SEC_ERASING;
+        out_stats->live_bytes += sec->live;
+        if (sec->erase_count < out_stats->erase_min) out_stats->erase_min = sec->erase_count;
+        if (sec->erase_count > out_stats->erase_max) out_stats->erase_max = sec->erase_count;
+        sum += sec->erase_count;
+    }
+    out_stats->erase_mean = sum / kv->cfg.sectors;
+    pthread_mutex_unlock(&kv->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_kv_get_erase_counts(spm_kv_t *kv, uint32_t *out_counts, size_t count)
+{
+    if (!kv || !out_counts || count != kv->cfg.sectors) return SPM_EPARAM;
+
+    pthread_mutex_lock(&kv->lock);
+    for (uint32_t s = 0; s < kv->cfg.sectors; s++) out_counts[s] = kv->sectors[s].erase_count;
+    pthread_mutex_unlock(&kv->lock);
+    return SPM_OK;
+}
@@ -0,0 +1,468 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "spm_live.h"
+
+#define LIVE_MAGIC        0x564C4D53u   /* "SMLV" */
+#define LIVE_VERSION      1u
+#define LIVE_SHM_DIR      "/dev/shm"
+#define LIVE_READ_TRIES   1000
+
+enum { SLOT_FREE = 0, SLOT_USED = 1 };
+
+/**
+ * @brief One device in the shared segment
+ *
+ * seq is a seqlock: odd while a writer is inside. Writers take it with
+ * a compare-exchange from even to odd, so it is also the writers' lock
+ * and nothing else is shared with readers. The gauges are single words
+ * and are stored without it.
+ */
+struct spm_live_slot {
+    _Atomic uint32_t  seq;
+    _Atomic uint32_t  state;
+    _Atomic uint32_t  inflight;
+    _Atomic uint32_t  wc_pending;
+    char              path[SPM_PATH_MAX];
+    _Atomic uint64_t  messages;
+    _Atomic uint64_t  xfers;
+    _Atomic uint64_t  bytes;
+    _Atomic uint64_t  errors;
+    _Atomic uint64_t  wire_ns;
+    _Atomic uint64_t  ioctl_ns;
+    _Atomic uint64_t  hist[SPM_LIVE_BUCKETS];
+};
+
+/* Segment layout; magic is stored last on create and cleared on stop */
+typedef struct {
+    _Atomic uint32_t      magic;
+    uint32_t              version;
+    uint32_t              slots;
+    uint32_t              slot_size;
+    pid_t                 pid;
+    char                  name[SPM_LIVE_NAME_MAX];
+    uint64_t              start_ns;
+    struct spm_live_slot  slot[SPM_LIVE_SLOTS];
+} live_seg_t;
+
+/**
+ * @brief Read-only mapping of another process's segment
+ */
+struct spm_live_view {
+    live_seg_t  *seg;
+};
+
+/* Process-wide: one segment per process */
+static struct {
+    pthread_mutex_t  lock;
+    live_seg_t      *seg;
+    char             shm_name[48];
+} g_live = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void shm_name_of(pid_t pid, char *out, size_t size)
+{
+    snprintf(out, size, "/" SPM_LIVE_SHM_PREFIX "%ld", (long)pid);
+}
+
+/* pid of a /dev/shm entry, 0 if it is not a segment */
+static pid_t pid_of_entry(const char *name)
+{
+    const size_t n = sizeof SPM_LIVE_SHM_PREFIX - 1;
+    if (strncmp(name, SPM_LIVE_SHM_PREFIX, n) != 0) return 0;
+
+    char *end;
+    long pid = strtol(name + n, &end, 10);
+    return (*end == '\0' && pid > 0) ? (pid_t)pid : 0;
+}
+
+static bool pid_alive(pid_t pid)
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static void sweep_stale(void)
+{
+    DIR *d = opendir(LIVE_SHM_DIR);
+    if (!d) return;
+
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        pid_t pid = pid_of_entry(e->d_name);
+        if (pid <= 0 || pid_alive(pid)) continue;
+        char name[48];
+        shm_name_of(pid, name, sizeof name);
+        shm_unlink(name);
+    }
+    closedir(d);
+}
+
+static void program_name(char *out, size_t size)
+{
+    snprintf(out, size, "?");
+    FILE *f = fopen("/proc/self/comm", "r");
+    if (!f) return;
+    if (fgets(out, (int)size, f)) out[strcspn(out, "\n")] = '\0';
+    fclose(f);
+}
+
+static unsigned bucket_of(uint64_t ns)
+{
+    unsigned b = ns ? 63u - (unsigned)__builtin_clzll(ns) : 0u;
+    return b < SPM_LIVE_BUCKETS ? b : SPM_LIVE_BUCKETS - 1;
+}
+
+/* ====================================================== */
+/* ====================== Seqlock ======================= */
+/* ====================================================== */
+
+static uint32_t seq_begin(struct spm_live_slot *s)
+{
+    uint32_t v = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    for (;;) {
+        if (v & 1u) {
+            sched_yield();
+            v = atomic_load_explicit(&s->seq, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&s->seq, &v, v + 1,
+                                                  memory_order_acquire, memory_order_relaxed)) break;
+    }
+    /* the odd value must be visible before any counter moves */
+    atomic_thread_fence(memory_order_release);
+    return v + 1;
+}
+
+static void seq_end(struct spm_live_slot *s, uint32_t v)
+{
+    atomic_store_explicit(&s->seq, v + 1, memory_order_release);
+}
+
+/* Only called between seq_begin and seq_end, so there is one writer */
+static void counter_add(_Atomic uint64_t *c, uint64_t v)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static uint64_t counter_get(_Atomic uint64_t *c)
+{
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+static bool slot_read(struct spm_live_slot *s, spm_live_dev_t *out)
+{
+    for (int i = 0; i < LIVE_READ_TRIES; i++) {
+        uint32_t v = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (v & 1u) {
+            sched_yield();
+            continue;
+        }
+
+        memcpy(out->path, s->path, sizeof out->path);
+        out->path[sizeof out->path - 1] = '\0';
+        out->messages = counter_get(&s->messages);
+        out->xfers    = counter_get(&s->xfers);
+        out->bytes    = counter_get(&s->bytes);
+        out->errors   = counter_get(&s->errors);
+        out->wire_ns  = counter_get(&s->wire_ns);
+        out->ioctl_ns = counter_get(&s->ioctl_ns);
+        for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) out->hist[b] = counter_get(&s->hist[b]);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == v) {
+            out->inflight   = atomic_load_explicit(&s->inflight, memory_order_relaxed);
+            out->wc_pending = atomic_load_explicit(&s->wc_pending, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_live_start(const char *name)
+{
+    pthread_mutex_lock(&g_live.lock);
+    if (g_live.seg) {
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_ESTATE;
+    }
+
+    sweep_stale();
+    shm_name_of(getpid(), g_live.shm_name, sizeof g_live.shm_name);
+    shm_unlink(g_live.shm_name);   /* left by an earlier process with our pid */
+
+    int fd = shm_open(g_live.shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_EIO;
+    }
+    live_seg_t *seg = MAP_FAILED;
+    if (ftruncate(fd, sizeof(live_seg_t)) == 0) {
+        seg = mmap(NULL, sizeof(live_seg_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (seg == MAP_FAILED) {
+        shm_unlink(g_live.shm_name);
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_EIO;
+    }
+
+    seg->version   = LIVE_VERSION;
+    seg->slots     = SPM_LIVE_SLOTS;
+    seg->slot_size = sizeof(struct spm_live_slot);
+    seg->pid       = getpid();
+    seg->start_ns  = now_ns();
+    if (name) snprintf(seg->name, sizeof seg->name, "%s", name);
+    else      program_name(seg->name, sizeof seg->name);
+    atomic_store_explicit(&seg->magic, LIVE_MAGIC, memory_order_release);
+
+    g_live.seg = seg;
+    pthread_mutex_unlock(&g_live.lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_live_stop(void)
+{
+    pthread_mutex_lock(&g_live.lock);
+    live_seg_t *seg = g_live.seg;
+    bool busy = false;
+    for (size_t i = 0; seg && i < SPM_LIVE_SLOTS; i++) {
+        if (atomic_load_explicit(&seg->slot[i].state, memory_order_acquire) == SLOT_USED) busy = true;
+    }
+    if (!seg || busy) {
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_ESTATE;
+    }
+
+    atomic_store_explicit(&seg->magic, 0, memory_order_release);
+    shm_unlink(g_live.shm_name);
+    munmap(seg, sizeof(live_seg_t));
+    g_live.seg = NULL;
+    pthread_mutex_unlock(&g_live.lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_live_slot_claim(const char *path, spm_live_slot_t **out_slot)
+{
+    if (!out_slot) return SPM_EPARAM;
+    *out_slot = NULL;
+    if (!path) return SPM_EPARAM;
+
+    pthread_mutex_lock(&g_live.lock);
+    if (!g_live.seg) {
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_ESTATE;
+    }
+
+    struct spm_live_slot *s = NULL;
+    for (size_t i = 0; i < SPM_LIVE_SLOTS && !s; i++) {
+        struct spm_live_slot *c = &g_live.seg->slot[i];
+        if (atomic_load_explicit(&c->state, memory_order_acquire) == SLOT_FREE) s = c;
+    }
+    if (!s) {
+        pthread_mutex_unlock(&g_live.lock);
+        return SPM_ENOMEM;
+    }
+
+    uint32_t v = seq_begin(s);
+    snprintf(s->path, sizeof s->path, "%s", path);
+    atomic_store_explicit(&s->messages, 0, memory_order_relaxed);
+    atomic_store_explicit(&s->xfers,    0, memory_order_relaxed);
+    atomic_store_explicit(&s->bytes,    0, memory_order_relaxed);
+    atomic_store_explicit(&s->errors,   0, memory_order_relaxed);
+    atomic_store_explicit(&s->wire_ns,  0, memory_order_relaxed);
+    atomic_store_explicit(&s->ioctl_ns, 0, memory_order_relaxed);
+    for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) atomic_store_explicit(&s->hist[b], 0, memory_order_relaxed);
+    atomic_store_explicit(&s->inflight,   0, memory_order_relaxed);
+    atomic_store_explicit(&s->wc_pending, 0, memory_order_relaxed);
+    seq_end(s, v);
+    atomic_store_explicit(&s->state, SLOT_USED, memory_order_release);
+
+    pthread_mutex_unlock(&g_live.lock);
+    *out_slot = s;
+    return SPM_OK;
+}
+
+void spm_live_slot_release(spm_live_slot_t *slot)
+{
+    if (!slot) return;
+    pthread_mutex_lock(&g_live.lock);
+    atomic_store_explicit(&slot->state, SLOT_FREE, memory_order_release);
+    pthread_mutex_unlock(&g_live.lock);
+}
+
+void spm_live_slot_record(spm_live_slot_t *slot, size_t xfers, uint64_t bytes, uint64_t wire_ns,
+                          uint64_t ioctl_ns, bool failed)
+{
+    uint32_t v = seq_begin(slot);
+    counter_add(&slot->messages, 1);
+    counter_add(&slot->xfers,    xfers);
+    counter_add(&slot->bytes,    bytes);
+    counter_add(&slot->wire_ns,  wire_ns);
+    counter_add(&slot->ioctl_ns, ioctl_ns);
+    counter_add(&slot->hist[bucket_of(ioctl_ns)], 1);
+    if (failed) counter_add(&slot->errors, 1);
+    seq_end(slot, v);
+}
+
+void spm_live_slot_inflight(spm_live_slot_t *slot, int delta)
+{
+    if (delta > 0) atomic_fetch_add_explicit(&slot->inflight, 1, memory_order_relaxed);
+    else           atomic_fetch_sub_explicit(&slot->inflight, 1, memory_order_relaxed);
+}
+
+void spm_live_slot_set_pending(spm_live_slot_t *slot, uint32_t pending)
+{
+    atomic_store_explicit(&slot->wc_pending, pending, memory_order_relaxed);
+}
+
+spm_ecode_t spm_live_list(pid_t *out_pids, size_t cap, size_t *out_count)
+{
+    if (!out_count || (!out_pids && cap)) return SPM_EPARAM;
+    *out_count = 0;
+
+    DIR *d = opendir(LIVE_SHM_DIR);
+    if (!d) return SPM_EIO;
+
+    size_t n = 0;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        pid_t pid = pid_of_entry(e->d_name);
+        if (pid <= 0 || !pid_alive(pid)) continue;
+        if (n < cap) out_pids[n] = pid;
+        n++;
+    }
+    closedir(d);
+
+    *out_count = n;
+    return n > cap ? SPM_ENOMEM : SPM_OK;
+}
+
+spm_ecode_t spm_live_attach(pid_t pid, spm_live_view_t **out_view)
+{
+    if (!out_view) return SPM_EPARAM;
+    *out_view = NULL;
+    if (pid <= 0) return SPM_EPARAM;
+
+    char name[48];
+    shm_name_of(pid, name, sizeof name);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return SPM_ENODEV;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return SPM_EIO;
+    }
+    if ((size_t)st.st_size != sizeof(live_seg_t)) {
+        close(fd);
+        return st.st_size == 0 ? SPM_ENODEV : SPM_ECONFIG;
+    }
+    live_seg_t *seg = mmap(NULL, sizeof(live_seg_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) return SPM_EIO;
+
+    spm_ecode_t rc = SPM_OK;
+    if (atomic_load_explicit(&seg->magic, memory_order_acquire) != LIVE_MAGIC) rc = SPM_ENODEV;
+    else if (seg->version != LIVE_VERSION || seg->slots != SPM_LIVE_SLOTS ||
+             seg->slot_size != sizeof(struct spm_live_slot)) rc = SPM_ECONFIG;
+
+    spm_live_view_t *v = rc == SPM_OK ? malloc(sizeof(*v)) : NULL;
+    if (rc == SPM_OK && !v) rc = SPM_ENOMEM;
+    if (rc != SPM_OK) {
+        munmap(seg, sizeof(live_seg_t));
+        return rc;
+    }
+    v->seg = seg;
+    *out_view = v;
+    return SPM_OK;
+}
+
+void spm_live_detach(spm_live_view_t *view)
+{
+    if (!view) return;
+    munmap(view->seg, sizeof(live_seg_t));
+    free(view);
+}
+
+spm_ecode_t spm_live_read(spm_live_view_t *view, spm_live_proc_t *out_proc,
+                          spm_live_dev_t *out_devs, size_t cap, size_t *out_count)
+{
+    if (!view || !out_count || (!out_devs && cap)) return SPM_EPARAM;
+    *out_count = 0;
+
+    live_seg_t *seg = view->seg;
+    if (atomic_load_explicit(&seg->magic, memory_order_acquire) != LIVE_MAGIC) return SPM_ENODEV;
+
+    if (out_proc) {
+        out_proc->pid      = seg->pid;
+        out_proc->start_ns = seg->start_ns;
+        memcpy(out_proc->name, seg->name, sizeof out_proc->name);
+        out_proc->name[sizeof out_proc->name - 1] = '\0';
+    }
+
+    spm_ecode_t rc = SPM_OK;
+    size_t n = 0;
+    for (size_t i = 0; i < SPM_LIVE_SLOTS; i++) {
+        struct spm_live_slot *s = &seg->slot[i];
+        if (atomic_load_explicit(&s->state, memory_order_acquire) != SLOT_USED) continue;
+
+        spm_live_dev_t d;
+        if (!slot_read(s, &d)) {
+            rc = SPM_EAGAIN;
+            continue;
+        }
+        if (n < cap) out_devs[n] = d;
+        n++;
+    }
+
+    *out_count = n;
+    return n > cap ? SPM_ENOMEM : rc;
+}
+
+uint64_t spm_live_percentile(const uint64_t hist[SPM_LIVE_BUCKETS], double q)
+{
+    if (!hist) return 0;
+
+    uint64_t total = 0;
+    for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0;
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    double   want = q * (double)total;
+    uint64_t rank = (uint64_t)want;
+    if ((double)rank < want || rank == 0) rank++;
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return 1ull << (b + 1);
+    }
+    return 1ull << SPM_LIVE_BUCKETS;
+}
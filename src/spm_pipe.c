@@ -0,0 +1,461 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spm_pipe.h"
+
+#define SPM_PIPE_DEFAULT_DEPTH 4
+#define SPM_PIPE_SPINS         64
+#define SPM_PIPE_YIELDS        64
+#define SPM_PIPE_SLEEP_NS      20000
+
+/**
+ * @brief Single-producer/single-consumer ring of frame pointers
+ *
+ * head and tail are free-running counters on separate cache lines.
+ */
+typedef struct {
+    _Alignas(64) _Atomic size_t head;   /* consumer */
+    _Alignas(64) _Atomic size_t tail;   /* producer */
+    _Alignas(64) size_t cap;
+    spm_pipe_frame_t **slots;
+} spsc_t;
+
+/**
+ * @brief Link between stage i and i + 1
+ *
+ * Frames circulate: producer takes from free, fills, pushes to full;
+ * consumer takes from full and gives back to free.
+ */
+typedef struct {
+    spsc_t            full;
+    spsc_t            free;
+    spm_pipe_frame_t *frames;
+    uint8_t          *data;
+} edge_t;
+
+typedef struct {
+    spm_pipe_t       *pipe;
+    size_t            idx;
+    spm_pipe_stage_t  decl;
+    pthread_t         thread;
+    pthread_mutex_t   lock;       /* guards stats */
+    spm_pipe_stats_t  stats;
+} stage_t;
+
+/**
+ * @brief Thread-per-stage pipeline
+ */
+struct spm_pipe {
+    spm_pipe_cfg_t    cfg;
+    stage_t          *stages;
+    size_t            nstages;
+    edge_t           *edges;      /* nstages - 1 */
+    spm_pipe_frame_t  spare;      /* source target while dropping */
+    uint8_t          *spare_data;
+
+    pthread_mutex_t   lock;
+    _Atomic bool      stop;
+    bool              started;
+    spm_ecode_t       err;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool spsc_init(spsc_t *q, size_t cap)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->cap = cap;
+    q->slots = calloc(cap, sizeof(*q->slots));
+    return q->slots != NULL;
+}
+
+static bool spsc_push(spsc_t *q, spm_pipe_frame_t *f)
+{
+    size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t h = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (t - h == q->cap) return false;
+
+    q->slots[t % q->cap] = f;
+    atomic_store_explicit(&q->tail, t + 1, memory_order_release);
+    return true;
+}
+
+static spm_pipe_frame_t *spsc_pop(spsc_t *q)
+{
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (t == h) return NULL;
+
+    spm_pipe_frame_t *f = q->slots[h % q->cap];
+    atomic_store_explicit(&q->head, h + 1, memory_order_release);
+    return f;
+}
+
+/* Spin, then yield, then sleep; keeps idle stages off the CPU */
+static void backoff(unsigned *n)
+{
+    if (*n < SPM_PIPE_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else if (*n < SPM_PIPE_SPINS + SPM_PIPE_YIELDS) {
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, SPM_PIPE_SLEEP_NS };
+        nanosleep(&ts, NULL);
+    }
+    (*n)++;
+}
+
+/* Blocking pop; NULL once the pipeline stops */
+static spm_pipe_frame_t *wait_pop(spm_pipe_t *pipe, spsc_t *q, uint64_t *waited_ns)
+{
+    spm_pipe_frame_t *f = spsc_pop(q);
+    if (f) return f;
+
+    uint64_t t0 = now_ns();
+    unsigned n = 0;
+    while (!(f = spsc_pop(q)) && !atomic_load_explicit(&pipe->stop, memory_order_relaxed)) {
+        backoff(&n);
+    }
+    *waited_ns += now_ns() - t0;
+    return f;
+}
+
+static void fail(spm_pipe_t *pipe, spm_ecode_t rc)
+{
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->err == SPM_OK) pipe->err = rc;
+    pthread_mutex_unlock(&pipe->lock);
+    atomic_store(&pipe->stop, true);
+}
+
+/* Every frame back on its edge's free ring; only while no stage runs */
+static void reset_edges(spm_pipe_t *pipe)
+{
+    for (size_t e = 0; e + 1 < pipe->nstages; e++) {
+        edge_t *ed = &pipe->edges[e];
+        atomic_store(&ed->full.head, 0);
+        atomic_store(&ed->full.tail, 0);
+        atomic_store(&ed->free.head, 0);
+        atomic_store(&ed->free.tail, 0);
+        for (size_t k = 0; k < pipe->cfg.depth; k++) spsc_push(&ed->free, &ed->frames[k]);
+    }
+}
+
+static void free_edges(spm_pipe_t *pipe)
+{
+    if (!pipe->edges) return;
+    for (size_t i = 0; i + 1 < pipe->nstages; i++) {
+        free(pipe->edges[i].full.slots);
+        free(pipe->edges[i].free.slots);
+        free(pipe->edges[i].frames);
+        free(pipe->edges[i].data);
+    }
+    free(pipe->edges);
+}
+
+/* ====================================================== */
+/* ==================== Stage Thread ==================== */
+/* ====================================================== */
+
+static void *stage_main(void *arg)
+{
+    stage_t *st = arg;
+    spm_pipe_t *pipe = st->pipe;
+    const size_t i = st->idx;
+    const bool source = i == 0;
+    edge_t *ein  = source ? NULL : &pipe->edges[i - 1];
+    edge_t *eout = i + 1 < pipe->nstages ? &pipe->edges[i] : NULL;
+
+    spm_pipe_frame_t *out = NULL;     /* kept across iterations when unused */
+    uint64_t seq = 0;
+
+    /*
+     * A frame still held on exit is given back: in to the upstream free
+     * ring, which only this stage fills. out came from the downstream
+     * free ring, which the next stage fills, so it is reclaimed by
+     * reset_edges() once every stage has been joined.
+     */
+    while (!atomic_load_explicit(&pipe->stop, memory_order_relaxed)) {
+        spm_pipe_stats_t d = {0};
+
+        spm_pipe_frame_t *in = NULL;
+        if (ein && !(in = wait_pop(pipe, &ein->full, &d.wait_in_ns))) break;
+
+        if (eout && !out) {
+            out = spsc_pop(&eout->free);
+            if (!out) {
+                d.stalls = 1;
+                if (source && pipe->cfg.drop_when_full) out = &pipe->spare;
+                else if (!(out = wait_pop(pipe, &eout->free, &d.wait_out_ns))) {
+                    if (in) spsc_push(&ein->free, in);
+                    break;
+                }
+            }
+        }
+
+        uint64_t t0 = now_ns();
+        spm_ecode_t rc;
+        spm_pipe_frame_t *fwd = out;
+
+        if (st->decl.process) {
+            /* In place: forward the input frame, recycle out upstream
+             * (every frame has the same capacity, so pools stay even) */
+            size_t len = in->len;
+            rc = st->decl.process(st->decl.ctx, in->data, &len);
+            if (rc == SPM_OK && len > in->cap) rc = SPM_EPARAM;
+            in->len = len;
+            if (eout) {
+                fwd = in;
+                in = out;
+                out = NULL;
+            }
+        } else {
+            if (out) {
+                out->len  = 0;
+                out->seq  = in ? in->seq : seq;
+                out->t_ns = in ? in->t_ns : 0;
+            }
+            rc = st->decl.fn(st->decl.ctx, in, out);
+            if (source && rc == SPM_OK) {
+                out->t_ns = now_ns();
+                seq++;
+            }
+        }
+        uint64_t t1 = now_ns();
+        d.busy_ns = t1 - t0;
+
+        const spm_pipe_frame_t *done = fwd ? fwd : in;
+        uint64_t lat = done ? t1 - done->t_ns : 0;
+
+        if (in) spsc_push(&ein->free, in);
+
+        if (rc == SPM_EAGAIN && source) {
+            if (out == &pipe->spare) out = NULL;
+            continue;
+        }
+        if (rc != SPM_OK) {
+            fail(pipe, rc);
+            break;
+        }
+
+        if (fwd == &pipe->spare) {
+            d.dropped = 1;
+        } else {
+            if (fwd) spsc_push(&eout->full, fwd);
+            if (fwd == out) out = NULL;
+            d.frames = 1;
+        }
+
+        pthread_mutex_lock(&st->lock);
+        st->stats.frames      += d.frames;
+        st->stats.busy_ns     += d.busy_ns;
+        st->stats.wait_in_ns  += d.wait_in_ns;
+        st->stats.wait_out_ns += d.wait_out_ns;
+        st->stats.stalls      += d.stalls;
+        st->stats.dropped     += d.dropped;
+        if (d.frames) {
+            st->stats.lat_ns_sum += lat;
+            if (lat > st->stats.lat_ns_max) st->stats.lat_ns_max = lat;
+        }
+        pthread_mutex_unlock(&st->lock);
+
+        if (fwd == &pipe->spare) out = NULL;
+    }
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_pipe_create(const spm_pipe_cfg_t *cfg, const spm_pipe_stage_t *stages,
+                            size_t nstages, spm_pipe_t **out_pipe)
+{
+    if (!out_pipe) return SPM_EPARAM;
+    *out_pipe = NULL;
+    if (!cfg || cfg->frame_cap == 0 || !stages || nstages < 2) return SPM_EPARAM;
+
+    for (size_t i = 0; i < nstages; i++) {
+        const spm_pipe_stage_t *s = &stages[i];
+        if (!s->fn == !s->process)     return SPM_EPARAM;   /* exactly one */
+        if (s->process && i == 0)      return SPM_EPARAM;   /* sources produce */
+    }
+
+    spm_pipe_t *pipe = calloc(1, sizeof(*pipe));
+    if (!pipe) return SPM_ENOMEM;
+
+    pipe->cfg = *cfg;
+    if (!pipe->cfg.depth) pipe->cfg.depth = SPM_PIPE_DEFAULT_DEPTH;
+    pipe->nstages = nstages;
+    pthread_mutex_init(&pipe->lock, NULL);
+    atomic_init(&pipe->stop, false);
+
+    const size_t depth = pipe->cfg.depth;
+    const size_t cap   = pipe->cfg.frame_cap;
+
+    pipe->stages = calloc(nstages, sizeof(*pipe->stages));
+    pipe->edges  = calloc(nstages - 1, sizeof(*pipe->edges));
+    pipe->spare_data = malloc(cap);
+    if (!pipe->stages || !pipe->edges || !pipe->spare_data) goto nomem;
+    pipe->spare = (spm_pipe_frame_t){ .data = pipe->spare_data, .cap = cap };
+
+    for (size_t i = 0; i < nstages; i++) {
+        stage_t *st = &pipe->stages[i];
+        st->pipe = pipe;
+        st->idx  = i;
+        st->decl = stages[i];
+        pthread_mutex_init(&st->lock, NULL);
+    }
+
+    for (size_t e = 0; e + 1 < nstages; e++) {
+        edge_t *ed = &pipe->edges[e];
+        if (!spsc_init(&ed->full, depth) || !spsc_init(&ed->free, depth)) goto nomem;
+
+        ed->frames = calloc(depth, sizeof(*ed->frames));
+        ed->data   = malloc(depth * cap);
+        if (!ed->frames || !ed->data) goto nomem;
+
+        for (size_t k = 0; k < depth; k++) {
+            ed->frames[k] = (spm_pipe_frame_t){ .data = ed->data + k * cap, .cap = cap };
+        }
+    }
+    reset_edges(pipe);
+
+    *out_pipe = pipe;
+    return SPM_OK;
+
+nomem:
+    spm_pipe_destroy(pipe);
+    return SPM_ENOMEM;
+}
+
+spm_ecode_t spm_pipe_start(spm_pipe_t *pipe)
+{
+    if (!pipe) return SPM_EPARAM;
+    if (pipe->started) return SPM_ESTATE;
+
+    long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    for (size_t i = 0; i < pipe->nstages; i++) {
+        const spm_pipe_stage_t *s = &pipe->stages[i].decl;
+        if (s->pin && (s->cpu < 0 || s->cpu >= ncpu || s->cpu >= CPU_SETSIZE)) return SPM_EPARAM;
+    }
+
+    /* frames in flight at the last stop are discarded */
+    reset_edges(pipe);
+    atomic_store(&pipe->stop, false);
+    pipe->err = SPM_OK;
+
+    for (size_t i = 0; i < pipe->nstages; i++) {
+        stage_t *st = &pipe->stages[i];
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (st->decl.pin) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(st->decl.cpu, &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+
+        int rc = pthread_create(&st->thread, &attr, stage_main, st);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            atomic_store(&pipe->stop, true);
+            for (size_t k = 0; k < i; k++) pthread_join(pipe->stages[k].thread, NULL);
+            return SPM_ENOMEM;
+        }
+    }
+
+    pipe->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_pipe_stop(spm_pipe_t *pipe)
+{
+    if (!pipe) return SPM_EPARAM;
+    if (!pipe->started) return pipe->err;
+
+    atomic_store(&pipe->stop, true);
+    for (size_t i = 0; i < pipe->nstages; i++) pthread_join(pipe->stages[i].thread, NULL);
+    pipe->started = false;
+    return pipe->err;
+}
+
+void spm_pipe_destroy(spm_pipe_t *pipe)
+{
+    if (!pipe) return;
+    spm_pipe_stop(pipe);
+
+    free_edges(pipe);
+    if (pipe->stages) {
+        for (size_t i = 0; i < pipe->nstages; i++) pthread_mutex_destroy(&pipe->stages[i].lock);
+    }
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe->stages);
+    free(pipe->spare_data);
+    free(pipe);
+}
+
+spm_ecode_t spm_pipe_error(spm_pipe_t *pipe)
+{
+    if (!pipe) return SPM_EPARAM;
+
+    pthread_mutex_lock(&pipe->lock);
+    spm_ecode_t rc = pipe->err;
+    pthread_mutex_unlock(&pipe->lock);
+    return rc;
+}
+
+spm_ecode_t spm_pipe_get_stats(spm_pipe_t *pipe, size_t stage, spm_pipe_stats_t *out_stats)
+{
+    if (!pipe || !out_stats || stage >= pipe->nstages) return SPM_EPARAM;
+
+    stage_t *st = &pipe->stages[stage];
+    pthread_mutex_lock(&st->lock);
+    *out_stats = st->stats;
+    pthread_mutex_unlock(&st->lock);
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ====================== Sources ======================= */
+/* ====================================================== */
+
+spm_ecode_t spm_pipe_src_read(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out)
+{
+    (void)in;
+    spm_pipe_read_src_t *src = ctx;
+    if (!src || !out || src->len == 0 || src->len > out->cap) return SPM_EPARAM;
+
+    spm_ecode_t rc = spm_transfer(src->dev, src->tx, out->data, src->len);
+    if (rc == SPM_OK) out->len = src->len;
+    return rc;
+}
+
+spm_ecode_t spm_pipe_src_plan(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out)
+{
+    (void)in;
+    spm_pipe_plan_src_t *src = ctx;
+    if (!src || !out || src->count > out->cap) return SPM_EPARAM;
+
+    spm_ecode_t rc = spm_reg_plan_read(src->dev, src->plan, out->data);
+    if (rc == SPM_OK) out->len = src->count;
+    return rc;
+}
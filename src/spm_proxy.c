@@ -0,0 +1,963 @@
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "spm_proxy.h"
+
+/*
+ * Wire format (little-endian):
+ *
+ *   request  : u8 op, u8 flags, u16 0, u32 seq, i32 handle, u32 plen, payload
+ *   reply    : u32 seq, i32 errno (0 = ok), u32 plen, u8 flags, u8[3] 0, payload
+ *
+ *   OPEN     : u32 open flags, path            -> u32 handle
+ *   CFG      : 12-byte config (see put_cfg)
+ *   XFER     : u32 count, count * 16-byte descriptor, tx data -> rx data
+ *
+ * Data sections may be PackBits-compressed (PX_FLAG_PACKBITS), prefixed
+ * by their raw length. A request with PX_FLAG_PACK_REPLY lets the
+ * server compress its rx section, whether or not tx was compressed.
+ */
+enum {
+    PX_OP_OPEN = 1,
+    PX_OP_CLOSE,
+    PX_OP_CFG_WRITE,
+    PX_OP_CFG_READ,
+    PX_OP_XFER,
+};
+
+#define PX_FLAG_PACKBITS   0x01u
+#define PX_FLAG_PACK_REPLY 0x02u
+
+#define PX_XF_TX           0x01u
+#define PX_XF_RX           0x02u
+#define PX_XF_CS_CHANGE    0x04u
+
+#define PX_HDR_LEN         16u
+#define PX_CFG_LEN         12u
+#define PX_DESC_LEN        16u
+#define PX_MAX_PAYLOAD     (64u << 20)
+#define PX_MAX_DEVS        64
+#define PX_DEF_INFLIGHT    64u
+#define PX_DEF_BUFFERED    (64u << 10)
+
+typedef struct {
+    uint8_t *p;
+    size_t   len;
+    size_t   cap;
+} px_buf_t;
+
+typedef struct {
+    uint8_t  op;
+    uint8_t  flags;
+    uint32_t seq;
+    int32_t  handle;     /* request: device, reply: errno */
+    uint32_t plen;
+} px_hdr_t;
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+static uint16_t get_u16(const uint8_t *p)   { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *buf_append(px_buf_t *b, size_t n)
+{
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        uint8_t *p = realloc(b->p, cap);
+        if (!p) return NULL;
+        b->p = p;
+        b->cap = cap;
+    }
+    uint8_t *at = b->p + b->len;
+    b->len += n;
+    return at;
+}
+
+static void buf_free(px_buf_t *b)
+{
+    free(b->p);
+    *b = (px_buf_t){0};
+}
+
+static int write_full(int fd, const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Returns 1 on success, 0 on clean EOF before the first byte, -1 on error */
+static int read_full(int fd, uint8_t *p, size_t n)
+{
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = recv(fd, p + got, n - got, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r == 0 && got == 0) return 0;
+        if (r <= 0) {
+            if (r == 0) errno = ECONNRESET;
+            return -1;
+        }
+        got += (size_t)r;
+    }
+    return 1;
+}
+
+static void put_hdr(uint8_t *p, const px_hdr_t *h, bool reply)
+{
+    memset(p, 0, PX_HDR_LEN);
+    if (reply) {
+        put_u32(p + 0, h->seq);
+        put_u32(p + 4, (uint32_t)h->handle);
+        put_u32(p + 8, h->plen);
+        p[12] = h->flags;
+    } else {
+        p[0] = h->op;
+        p[1] = h->flags;
+        put_u32(p + 4, h->seq);
+        put_u32(p + 8, (uint32_t)h->handle);
+        put_u32(p + 12, h->plen);
+    }
+}
+
+static void get_hdr(const uint8_t *p, px_hdr_t *h, bool reply)
+{
+    if (reply) {
+        *h = (px_hdr_t){
+            .seq    = get_u32(p + 0),
+            .handle = (int32_t)get_u32(p + 4),
+            .plen   = get_u32(p + 8),
+            .flags  = p[12],
+        };
+    } else {
+        *h = (px_hdr_t){
+            .op     = p[0],
+            .flags  = p[1],
+            .seq    = get_u32(p + 4),
+            .handle = (int32_t)get_u32(p + 8),
+            .plen   = get_u32(p + 12),
+        };
+    }
+}
+
+static void put_cfg(uint8_t *p, const spm_cfg_t *cfg)
+{
+    memset(p, 0, PX_CFG_LEN);
+    p[0] = (uint8_t)cfg->mode;
+    p[1] = cfg->bits_per_word;
+    p[2] = cfg->lsb_first;
+    p[3] = cfg->cs_active_high;
+    put_u32(p + 4, cfg->speed_hz);
+    put_u16(p + 8, cfg->delay_usecs);
+    p[10] = cfg->cs_change;
+}
+
+static void get_cfg(const uint8_t *p, spm_cfg_t *cfg)
+{
+    cfg->mode           = (spm_mode_t)(p[0] & 3);
+    cfg->bits_per_word  = p[1];
+    cfg->lsb_first      = p[2] != 0;
+    cfg->cs_active_high = p[3] != 0;
+    cfg->speed_hz       = get_u32(p + 4);
+    cfg->delay_usecs    = get_u16(p + 8);
+    cfg->cs_change      = p[10] != 0;
+}
+
+/* ====================================================== */
+/* ===================== PackBits ======================= */
+/* ====================================================== */
+
+static size_t packbits_bound(size_t n)
+{
+    return n + (n + 127) / 128;
+}
+
+static size_t packbits_encode(const uint8_t *s, size_t n, uint8_t *d)
+{
+    size_t i = 0, o = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && run < 128 && s[i + run] == s[i]) run++;
+        if (run >= 2) {
+            d[o++] = (uint8_t)(257 - run);
+            d[o++] = s[i];
+            i += run;
+            continue;
+        }
+
+        size_t lit = 1;
+        while (i + lit < n && lit < 128 &&
+               !(i + lit + 1 < n && s[i + lit] == s[i + lit + 1])) lit++;
+        d[o++] = (uint8_t)(lit - 1);
+        memcpy(d + o, s + i, lit);
+        o += lit;
+        i += lit;
+    }
+    return o;
+}
+
+static int packbits_decode(const uint8_t *s, size_t n, uint8_t *d, size_t cap)
+{
+    size_t i = 0, o = 0;
+    while (i < n) {
+        uint8_t h = s[i++];
+        if (h < 128) {
+            size_t lit = (size_t)h + 1;
+            if (i + lit > n || o + lit > cap) return -1;
+            memcpy(d + o, s + i, lit);
+            i += lit;
+            o += lit;
+        } else if (h > 128) {
+            size_t run = 257u - h;
+            if (i >= n || o + run > cap) return -1;
+            memset(d + o, s[i++], run);
+            o += run;
+        }
+    }
+    return o == cap ? 0 : -1;
+}
+
+/* Appends a data section, compressed when that saves bytes */
+static int put_data(px_buf_t *b, const uint8_t *data, size_t n, bool compress,
+                    uint8_t *flags, uint64_t *raw, uint64_t *wire)
+{
+    *raw += n;
+    if (compress && n > 0) {
+        size_t start = b->len;
+        uint8_t *p = buf_append(b, 4 + packbits_bound(n));
+        if (!p) return -1;
+        put_u32(p, (uint32_t)n);
+        size_t enc = packbits_encode(data, n, p + 4);
+        if (enc < n) {
+            b->len = start + 4 + enc;
+            *flags |= PX_FLAG_PACKBITS;
+            *wire += 4 + enc;
+            return 0;
+        }
+        b->len = start;
+    }
+
+    uint8_t *p = buf_append(b, n);
+    if (!p) return -1;
+    if (n) memcpy(p, data, n);
+    *wire += n;
+    return 0;
+}
+
+/* Resolves a data section into raw bytes (scratch is used when compressed) */
+static const uint8_t *get_data(const uint8_t *p, size_t avail, size_t expect, uint8_t flags,
+                               px_buf_t *scratch)
+{
+    if (!(flags & PX_FLAG_PACKBITS)) return avail == expect ? p : NULL;
+    if (avail < 4 || get_u32(p) != expect) return NULL;
+
+    scratch->len = 0;
+    uint8_t *d = buf_append(scratch, expect);
+    if (!d && expect) return NULL;
+    if (packbits_decode(p + 4, avail - 4, d, expect) < 0) return NULL;
+    return d;
+}
+
+static int ecode_to_errno(spm_ecode_t rc)
+{
+    switch (rc) {
+        case SPM_OK:       return 0;
+        case SPM_EPARAM:   return EINVAL;
+        case SPM_ENOTSUP:  return EOPNOTSUPP;
+        case SPM_ENODEV:   return ENODEV;
+        case SPM_ETIMEOUT: return ETIMEDOUT;
+        case SPM_EIO:      return EIO;
+        case SPM_ESTATE:   return EBADF;
+        case SPM_ECONFIG:  return EINVAL;
+        case SPM_ENOMEM:   return ENOMEM;
+        case SPM_EAGAIN:   return EAGAIN;
+        default:           return EPROTO;
+    }
+}
+
+/* ====================================================== */
+/* ======================= Client ======================= */
+/* ====================================================== */
+
+static struct {
+    pthread_mutex_t    lock;
+    int                fd;
+    spm_proxy_opts_t   opts;
+    px_buf_t           out;        /* requests not yet sent */
+    px_buf_t           in;         /* last reply payload */
+    px_buf_t           scratch;
+    uint32_t           seq;
+    uint32_t           pending;    /* pipelined replies outstanding */
+    int                deferred;   /* errno of a failed pipelined call */
+    spm_proxy_stats_t  stats;
+} g_cli = { .lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1 };
+
+static size_t cli_begin(uint8_t op, int32_t handle)
+{
+    size_t off = g_cli.out.len;
+    if (!buf_append(&g_cli.out, PX_HDR_LEN)) return SIZE_MAX;
+
+    px_hdr_t h = { .op = op, .seq = g_cli.seq++, .handle = handle };
+    put_hdr(g_cli.out.p + off, &h, false);
+    return off;
+}
+
+static void cli_end(size_t off, uint8_t flags)
+{
+    uint8_t *p = g_cli.out.p + off;
+    p[1] = flags;
+    put_u32(p + 12, (uint32_t)(g_cli.out.len - off - PX_HDR_LEN));
+    g_cli.stats.requests++;
+}
+
+static int cli_read_reply(px_hdr_t *h)
+{
+    uint8_t hb[PX_HDR_LEN];
+    if (read_full(g_cli.fd, hb, sizeof hb) <= 0) return -1;
+    get_hdr(hb, h, true);
+    if (h->plen > PX_MAX_PAYLOAD) { errno = EPROTO; return -1; }
+
+    g_cli.in.len = 0;
+    if (!buf_append(&g_cli.in, h->plen) && h->plen) { errno = ENOMEM; return -1; }
+    if (h->plen && read_full(g_cli.fd, g_cli.in.p, h->plen) <= 0) return -1;
+
+    g_cli.stats.bytes_rx += PX_HDR_LEN + h->plen;
+    return 0;
+}
+
+/* Sends everything buffered and collects replies of pipelined calls */
+static int cli_flush(void)
+{
+    if (g_cli.out.len) {
+        if (write_full(g_cli.fd, g_cli.out.p, g_cli.out.len) < 0) return -1;
+        g_cli.stats.bytes_tx += g_cli.out.len;
+        g_cli.out.len = 0;
+    }
+
+    if (g_cli.pending) g_cli.stats.round_trips++;
+    while (g_cli.pending) {
+        px_hdr_t h;
+        if (cli_read_reply(&h) < 0) return -1;
+        g_cli.pending--;
+        if (h.handle && !g_cli.deferred) g_cli.deferred = h.handle;
+    }
+    return 0;
+}
+
+/* Waits for the reply of the request just queued; payload in g_cli.in */
+static int cli_call(px_hdr_t *reply)
+{
+    uint32_t pending = g_cli.pending;
+    g_cli.pending = 0;
+
+    if (g_cli.out.len) {
+        if (write_full(g_cli.fd, g_cli.out.p, g_cli.out.len) < 0) return -1;
+        g_cli.stats.bytes_tx += g_cli.out.len;
+        g_cli.out.len = 0;
+    }
+    g_cli.stats.round_trips++;
+
+    for (; pending > 0; pending--) {
+        if (cli_read_reply(reply) < 0) return -1;
+        if (reply->handle && !g_cli.deferred) g_cli.deferred = reply->handle;
+    }
+    if (cli_read_reply(reply) < 0) return -1;
+
+    if (g_cli.deferred) {
+        errno = g_cli.deferred;
+        g_cli.deferred = 0;
+        return -1;
+    }
+    if (reply->handle) {
+        errno = reply->handle;
+        return -1;
+    }
+    return 0;
+}
+
+/* Queues the request without waiting when pipelining is enabled */
+static int cli_post(void)
+{
+    if (!g_cli.opts.pipeline) {
+        px_hdr_t h;
+        return cli_call(&h);
+    }
+
+    g_cli.pending++;
+    g_cli.stats.pipelined++;
+    if (g_cli.pending >= g_cli.opts.max_inflight || g_cli.out.len >= g_cli.opts.max_buffered) {
+        if (cli_flush() < 0) return -1;
+    }
+    if (g_cli.deferred) {
+        errno = g_cli.deferred;
+        g_cli.deferred = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static int p_open_(const char *path, int flags)
+{
+    pthread_mutex_lock(&g_cli.lock);
+    int rc = -1;
+    if (g_cli.fd < 0) { errno = ENODEV; goto out; }
+
+    size_t n = strlen(path);
+    size_t off = cli_begin(PX_OP_OPEN, -1);
+    uint8_t *p = off == SIZE_MAX ? NULL : buf_append(&g_cli.out, 4 + n);
+    if (!p) { errno = ENOMEM; goto out; }
+    put_u32(p, (uint32_t)flags);
+    memcpy(p + 4, path, n);
+    cli_end(off, 0);
+
+    px_hdr_t h;
+    if (cli_call(&h) < 0) goto out;
+    if (h.plen != 4) { errno = EPROTO; goto out; }
+    rc = (int)get_u32(g_cli.in.p);
+
+out:
+    pthread_mutex_unlock(&g_cli.lock);
+    return rc;
+}
+
+static int p_close_(int fd)
+{
+    pthread_mutex_lock(&g_cli.lock);
+    int rc = -1;
+    if (g_cli.fd < 0) { errno = EBADF; goto out; }
+
+    size_t off = cli_begin(PX_OP_CLOSE, fd);
+    if (off == SIZE_MAX) { errno = ENOMEM; goto out; }
+    cli_end(off, 0);
+
+    px_hdr_t h;
+    rc = cli_call(&h);
+
+out:
+    pthread_mutex_unlock(&g_cli.lock);
+    return rc;
+}
+
+static int p_config(int fd, spm_sys_msg_t *msg)
+{
+    bool write = msg->flags & SPM_SYS_MSG_CFG_WRITE;
+    size_t off = cli_begin(write ? PX_OP_CFG_WRITE : PX_OP_CFG_READ, fd);
+    if (off == SIZE_MAX) { errno = ENOMEM; return -1; }
+
+    if (write) {
+        uint8_t *p = buf_append(&g_cli.out, PX_CFG_LEN);
+        if (!p) { errno = ENOMEM; return -1; }
+        put_cfg(p, msg->cfg);
+        cli_end(off, 0);
+        return cli_post();
+    }
+
+    cli_end(off, 0);
+    px_hdr_t h;
+    if (cli_call(&h) < 0) return -1;
+    if (h.plen != PX_CFG_LEN) { errno = EPROTO; return -1; }
+    get_cfg(g_cli.in.p, msg->out_cfg);
+    return 0;
+}
+
+static int p_xfer(int fd, spm_sys_msg_t *msg)
+{
+    size_t off = cli_begin(PX_OP_XFER, fd);
+    uint8_t *p = off == SIZE_MAX ? NULL : buf_append(&g_cli.out, 4 + msg->count * PX_DESC_LEN);
+    if (!p) { errno = ENOMEM; return -1; }
+
+    size_t tx_total = 0, rx_total = 0;
+    put_u32(p, (uint32_t)msg->count);
+    p += 4;
+    for (size_t i = 0; i < msg->count; i++, p += PX_DESC_LEN) {
+        const spm_batch_xfer_t *x = &msg->xfers[i];
+        uint8_t xf = (x->tx ? PX_XF_TX : 0) | (x->rx ? PX_XF_RX : 0) | (x->cs_change ? PX_XF_CS_CHANGE : 0);
+
+        memset(p, 0, PX_DESC_LEN);
+        put_u32(p + 0, (uint32_t)x->len);
+        put_u32(p + 4, x->speed_hz ? x->speed_hz : msg->cfg->speed_hz);
+        p[8] = x->bits_per_word ? x->bits_per_word : msg->cfg->bits_per_word;
+        p[9] = xf;
+        put_u16(p + 10, x->delay_usecs);
+
+        if (x->tx) tx_total += x->len;
+        if (x->rx) rx_total += x->len;
+    }
+
+    /* Gather tx data, then append it as one (compressible) section */
+    g_cli.scratch.len = 0;
+    uint8_t *tx = buf_append(&g_cli.scratch, tx_total);
+    if (!tx && tx_total) { errno = ENOMEM; return -1; }
+    for (size_t i = 0; i < msg->count; i++) {
+        const spm_batch_xfer_t *x = &msg->xfers[i];
+        if (!x->tx) continue;
+        memcpy(tx, x->tx, x->len);
+        tx += x->len;
+    }
+
+    uint8_t flags = g_cli.opts.compress ? PX_FLAG_PACK_REPLY : 0;
+    if (put_data(&g_cli.out, g_cli.scratch.p, tx_total, g_cli.opts.compress, &flags,
+                 &g_cli.stats.payload_raw, &g_cli.stats.payload_wire) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    cli_end(off, flags);
+
+    if (rx_total == 0) return cli_post();
+
+    px_hdr_t h;
+    if (cli_call(&h) < 0) return -1;
+
+    const uint8_t *rx = get_data(g_cli.in.p, h.plen, rx_total, h.flags, &g_cli.scratch);
+    if (!rx) { errno = EPROTO; return -1; }
+    g_cli.stats.payload_raw  += rx_total;
+    g_cli.stats.payload_wire += h.plen;
+
+    for (size_t i = 0; i < msg->count; i++) {
+        const spm_batch_xfer_t *x = &msg->xfers[i];
+        if (!x->rx) continue;
+        memcpy(x->rx, rx, x->len);
+        rx += x->len;
+    }
+    return 0;
+}
+
+static int p_transfer_(int fd, spm_sys_msg_t *msg)
+{
+    pthread_mutex_lock(&g_cli.lock);
+    int rc;
+    if (g_cli.fd < 0) {
+        errno = EBADF;
+        rc = -1;
+    } else if (msg->flags & (SPM_SYS_MSG_CFG_WRITE | SPM_SYS_MSG_CFG_READ)) {
+        rc = p_config(fd, msg);
+    } else {
+        rc = p_xfer(fd, msg);
+    }
+    pthread_mutex_unlock(&g_cli.lock);
+    return rc;
+}
+
+const spm_sys_ops_t SPM_SYS_PROXY = {
+    .open_     = p_open_,
+    .close_    = p_close_,
+    .transfer_ = p_transfer_,
+};
+
+/* ====================================================== */
+/* ===================== Addressing ===================== */
+/* ====================================================== */
+
+static int parse_unix(const char *addr, struct sockaddr_un *sun)
+{
+    const char *path = addr + 5;
+    if (strlen(path) >= sizeof(sun->sun_path)) return -1;
+    memset(sun, 0, sizeof(*sun));
+    sun->sun_family = AF_UNIX;
+    strcpy(sun->sun_path, path);
+    return 0;
+}
+
+static int resolve_tcp(const char *addr, bool passive, struct addrinfo **out)
+{
+    const char *colon = strrchr(addr, ':');
+    if (!colon) return -1;
+
+    char host[256];
+    size_t hl = (size_t)(colon - addr);
+    if (hl >= sizeof host) return -1;
+    memcpy(host, addr, hl);
+    host[hl] = '\0';
+
+    struct addrinfo hints = {
+        .ai_family   = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags    = passive ? AI_PASSIVE : 0,
+    };
+    return getaddrinfo(hl ? host : NULL, colon + 1, &hints, out) == 0 ? 0 : -1;
+}
+
+/* ====================================================== */
+/* ================== Client Public API ================= */
+/* ====================================================== */
+
+spm_ecode_t spm_proxy_connect_fd(int fd, const spm_proxy_opts_t *opts)
+{
+    if (fd < 0) return SPM_EPARAM;
+
+    pthread_mutex_lock(&g_cli.lock);
+    if (g_cli.fd >= 0) {
+        pthread_mutex_unlock(&g_cli.lock);
+        return SPM_ESTATE;
+    }
+
+    g_cli.fd = fd;
+    g_cli.opts = opts ? *opts : (spm_proxy_opts_t){ .pipeline = true };
+    if (!g_cli.opts.max_inflight) g_cli.opts.max_inflight = PX_DEF_INFLIGHT;
+    if (!g_cli.opts.max_buffered) g_cli.opts.max_buffered = PX_DEF_BUFFERED;
+    g_cli.seq = 0;
+    g_cli.pending = 0;
+    g_cli.deferred = 0;
+    memset(&g_cli.stats, 0, sizeof g_cli.stats);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);   /* fails harmlessly on AF_UNIX */
+    pthread_mutex_unlock(&g_cli.lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_proxy_connect(const char *addr, const spm_proxy_opts_t *opts)
+{
+    if (!addr) return SPM_EPARAM;
+
+    int fd = -1;
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sun;
+        if (parse_unix(addr, &sun) < 0) return SPM_EPARAM;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&sun, sizeof sun) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct addrinfo *ai = NULL;
+        if (resolve_tcp(addr, false, &ai) < 0) return SPM_EPARAM;
+        for (struct addrinfo *a = ai; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(ai);
+    }
+    if (fd < 0) return SPM_ENODEV;
+
+    spm_ecode_t rc = spm_proxy_connect_fd(fd, opts);
+    if (rc != SPM_OK) close(fd);
+    return rc;
+}
+
+spm_ecode_t spm_proxy_flush(void)
+{
+    pthread_mutex_lock(&g_cli.lock);
+    spm_ecode_t rc = SPM_OK;
+    if (g_cli.fd < 0) {
+        rc = SPM_ESTATE;
+    } else if (cli_flush() < 0) {
+        rc = spm_map_errno();
+    } else if (g_cli.deferred) {
+        errno = g_cli.deferred;
+        g_cli.deferred = 0;
+        rc = spm_map_errno();
+    }
+    pthread_mutex_unlock(&g_cli.lock);
+    return rc;
+}
+
+spm_ecode_t spm_proxy_disconnect(void)
+{
+    spm_ecode_t rc = spm_proxy_flush();
+
+    pthread_mutex_lock(&g_cli.lock);
+    if (g_cli.fd >= 0) close(g_cli.fd);
+    g_cli.fd = -1;
+    buf_free(&g_cli.out);
+    buf_free(&g_cli.in);
+    buf_free(&g_cli.scratch);
+    pthread_mutex_unlock(&g_cli.lock);
+    return rc == SPM_ESTATE ? SPM_OK : rc;
+}
+
+spm_ecode_t spm_proxy_get_stats(spm_proxy_stats_t *out_stats)
+{
+    if (!out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&g_cli.lock);
+    *out_stats = g_cli.stats;
+    pthread_mutex_unlock(&g_cli.lock);
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ======================= Server ======================= */
+/* ====================================================== */
+
+typedef struct {
+    int                  fd;
+    const spm_sys_ops_t *sys;
+    spm_device_t        *devs[PX_MAX_DEVS];
+    px_buf_t             in;
+    px_buf_t             out;
+    px_buf_t             data;
+    px_buf_t             scratch;
+    spm_batch_xfer_t     xfers[SPM_MAX_BATCH_XFERS];
+} px_srv_t;
+
+static spm_device_t *srv_dev(px_srv_t *s, int32_t handle)
+{
+    if (handle < 0 || handle >= PX_MAX_DEVS) return NULL;
+    return s->devs[handle];
+}
+
+static spm_ecode_t srv_open(px_srv_t *s, const uint8_t *p, uint32_t n, px_buf_t *reply)
+{
+    if (n < 4 || n - 4 >= 64) return SPM_EPARAM;
+
+    char path[64];
+    memcpy(path, p + 4, n - 4);
+    path[n - 4] = '\0';
+
+    unsigned bus, cs;
+    if (sscanf(path, "/dev/spidev%u.%u", &bus, &cs) != 2 || bus > 255 || cs > 255) return SPM_ENODEV;
+
+    int slot = -1;
+    for (int i = 0; i < PX_MAX_DEVS && slot < 0; i++) if (!s->devs[i]) slot = i;
+    if (slot < 0) return SPM_ENOMEM;
+
+    spm_ecode_t rc = spm_dev_open_sys_ops((uint8_t)bus, (uint8_t)cs, NULL, s->sys, &s->devs[slot]);
+    if (rc != SPM_OK) return rc;
+
+    uint8_t *r = buf_append(reply, 4);
+    if (!r) return SPM_ENOMEM;
+    put_u32(r, (uint32_t)slot);
+    return SPM_OK;
+}
+
+static spm_ecode_t srv_xfer(px_srv_t *s, spm_device_t *dev, const px_hdr_t *h,
+                            const uint8_t *p, px_buf_t *reply, uint8_t *rflags)
+{
+    if (h->plen < 4) return SPM_EPARAM;
+    uint32_t count = get_u32(p);
+    if (count == 0 || count > SPM_MAX_BATCH_XFERS) return SPM_EPARAM;
+    if ((size_t)h->plen < 4 + (size_t)count * PX_DESC_LEN) return SPM_EPARAM;
+
+    size_t tx_total = 0, rx_total = 0;
+    const uint8_t *d = p + 4;
+    for (uint32_t i = 0; i < count; i++, d += PX_DESC_LEN) {
+        uint32_t len = get_u32(d);
+        if (d[9] & PX_XF_TX) tx_total += len;
+        if (d[9] & PX_XF_RX) rx_total += len;
+    }
+
+    const uint8_t *section = p + 4 + (size_t)count * PX_DESC_LEN;
+    size_t avail = h->plen - 4 - (size_t)count * PX_DESC_LEN;
+    const uint8_t *tx = get_data(section, avail, tx_total, h->flags, &s->scratch);
+    if (!tx && tx_total) return SPM_EPARAM;
+
+    s->data.len = 0;
+    uint8_t *rx = buf_append(&s->data, rx_total);
+    if (!rx && rx_total) return SPM_ENOMEM;
+
+    d = p + 4;
+    const uint8_t *txp = tx;
+    uint8_t *rxp = rx;
+    for (uint32_t i = 0; i < count; i++, d += PX_DESC_LEN) {
+        uint32_t len = get_u32(d);
+        s->xfers[i] = (spm_batch_xfer_t){
+            .tx            = (d[9] & PX_XF_TX) ? txp : NULL,
+            .rx            = (d[9] & PX_XF_RX) ? rxp : NULL,
+            .len           = len,
+            .speed_hz      = get_u32(d + 4),
+            .bits_per_word = d[8],
+            .delay_usecs   = get_u16(d + 10),
+            .cs_change     = (d[9] & PX_XF_CS_CHANGE) != 0,
+        };
+        if (d[9] & PX_XF_TX) txp += len;
+        if (d[9] & PX_XF_RX) rxp += len;
+    }
+
+    spm_ecode_t rc = spm_batch(dev, s->xfers, count);
+    if (rc != SPM_OK || rx_total == 0) return rc;
+
+    uint64_t raw = 0, wire = 0;
+    if (put_data(reply, rx, rx_total, (h->flags & PX_FLAG_PACK_REPLY) != 0, rflags, &raw, &wire) < 0) {
+        return SPM_ENOMEM;
+    }
+    return SPM_OK;
+}
+
+static spm_ecode_t srv_handle(px_srv_t *s, const px_hdr_t *h, const uint8_t *p,
+                              px_buf_t *reply, uint8_t *rflags)
+{
+    if (h->op == PX_OP_OPEN) return srv_open(s, p, h->plen, reply);
+
+    spm_device_t *dev = srv_dev(s, h->handle);
+    if (!dev) return SPM_ESTATE;
+
+    spm_cfg_t cfg;
+    switch (h->op) {
+        case PX_OP_CLOSE:
+            s->devs[h->handle] = NULL;
+            return spm_dev_close(dev);
+
+        case PX_OP_CFG_WRITE:
+            if (h->plen != PX_CFG_LEN) return SPM_EPARAM;
+            get_cfg(p, &cfg);
+            return spm_dev_set_cfg(dev, &cfg);
+
+        case PX_OP_CFG_READ: {
+            memset(&cfg, 0, sizeof cfg);
+            spm_ecode_t rc = spm_dev_get_cfg(dev, &cfg);
+            if (rc != SPM_OK) return rc;
+            uint8_t *r = buf_append(reply, PX_CFG_LEN);
+            if (!r) return SPM_ENOMEM;
+            put_cfg(r, &cfg);
+            return SPM_OK;
+        }
+
+        case PX_OP_XFER:
+            return srv_xfer(s, dev, h, p, reply, rflags);
+
+        default:
+            return SPM_ENOTSUP;
+    }
+}
+
+static bool srv_input_pending(int fd)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+static int srv_flush(px_srv_t *s)
+{
+    if (!s->out.len) return 0;
+    int rc = write_full(s->fd, s->out.p, s->out.len);
+    s->out.len = 0;
+    return rc;
+}
+
+static spm_ecode_t srv_loop(px_srv_t *s)
+{
+    for (;;) {
+        uint8_t hb[PX_HDR_LEN];
+        int r = read_full(s->fd, hb, sizeof hb);
+        if (r == 0) return SPM_OK;
+        if (r < 0) return spm_map_errno();
+
+        px_hdr_t h;
+        get_hdr(hb, &h, false);
+        if (h.plen > PX_MAX_PAYLOAD) return SPM_EPARAM;
+
+        s->in.len = 0;
+        if (!buf_append(&s->in, h.plen) && h.plen) return SPM_ENOMEM;
+        if (h.plen && read_full(s->fd, s->in.p, h.plen) <= 0) return spm_map_errno();
+
+        /* Reply header first, payload appended behind it */
+        size_t off = s->out.len;
+        if (!buf_append(&s->out, PX_HDR_LEN)) return SPM_ENOMEM;
+
+        uint8_t rflags = 0;
+        spm_ecode_t rc = srv_handle(s, &h, s->in.p, &s->out, &rflags);
+        if (rc != SPM_OK) s->out.len = off + PX_HDR_LEN;
+
+        px_hdr_t reply = {
+            .seq    = h.seq,
+            .handle = ecode_to_errno(rc),
+            .plen   = (uint32_t)(s->out.len - off - PX_HDR_LEN),
+            .flags  = rflags,
+        };
+        put_hdr(s->out.p + off, &reply, true);
+
+        /* Coalesce replies while the client keeps sending */
+        if (!srv_input_pending(s->fd) || s->out.len >= PX_DEF_BUFFERED) {
+            if (srv_flush(s) < 0) return spm_map_errno();
+        }
+    }
+}
+
+spm_ecode_t spm_proxy_serve_fd(int fd, const spm_sys_ops_t *sys)
+{
+    if (fd < 0) return SPM_EPARAM;
+
+    px_srv_t *s = calloc(1, sizeof(*s));
+    if (!s) {
+        close(fd);
+        return SPM_ENOMEM;
+    }
+    s->fd  = fd;
+    s->sys = sys ? sys : &SPM_SYS_DEFAULT;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    spm_ecode_t rc = srv_loop(s);
+    srv_flush(s);
+
+    for (int i = 0; i < PX_MAX_DEVS; i++) {
+        if (s->devs[i]) spm_dev_close(s->devs[i]);
+    }
+    buf_free(&s->in);
+    buf_free(&s->out);
+    buf_free(&s->data);
+    buf_free(&s->scratch);
+    free(s);
+    close(fd);
+    return rc;
+}
+
+spm_ecode_t spm_proxy_listen(const char *addr, int *out_fd)
+{
+    if (!addr || !out_fd) return SPM_EPARAM;
+    *out_fd = -1;
+
+    int fd = -1;
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sun;
+        if (parse_unix(addr, &sun) < 0) return SPM_EPARAM;
+        unlink(sun.sun_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr *)&sun, sizeof sun) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct addrinfo *ai = NULL;
+        if (resolve_tcp(addr, true, &ai) < 0) return SPM_EPARAM;
+        for (struct addrinfo *a = ai; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            if (bind(fd, a->ai_addr, a->ai_addrlen) < 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(ai);
+    }
+
+    if (fd < 0) return spm_map_errno();
+    if (listen(fd, 4) < 0) {
+        spm_ecode_t rc = spm_map_errno();
+        close(fd);
+        return rc;
+    }
+
+    *out_fd = fd;
+    return SPM_OK;
+}
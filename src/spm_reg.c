@@ -0,0 +1,268 @@
+#include <stdlib.h>
+
+#include "spm_reg.h"
+
+/**
+ * @brief Prepared multi-register access
+ */
+struct spm_reg_plan {
+    size_t            count;     /* requested addresses */
+    size_t            nbursts;   /* CS frames */
+    uint32_t         *map;       /* rx offset per requested address */
+    spm_batch_xfer_t *xfers;     /* one descriptor per burst */
+    size_t           *msg_end;   /* burst index ending each message */
+    size_t            nmsgs;
+    uint8_t          *tx;
+    uint8_t          *rx;
+};
+
+#define SPM_REG_ADDR_SPACE  256u
+#define SPM_REG_MAX_COUNT   (1u << 24)  /* index bits in the sort key */
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static int cmp_key(const void *a, const void *b)
+{
+    uint32_t ka = *(const uint32_t *)a;
+    uint32_t kb = *(const uint32_t *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/* Sort key: address in the top byte, caller index below (stable order) */
+static uint32_t *sorted_keys(const uint8_t *addrs, size_t count)
+{
+    uint32_t *keys = malloc(count * sizeof(*keys));
+    if (!keys) return NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = ((uint32_t)addrs[i] << 24) | (uint32_t)i;
+    }
+    qsort(keys, count, sizeof(*keys), cmp_key);
+    return keys;
+}
+
+static inline uint8_t key_addr(uint32_t key) { return (uint8_t)(key >> 24); }
+static inline size_t  key_idx(uint32_t key)  { return key & (SPM_REG_MAX_COUNT - 1); }
+
+static size_t max_burst_len(const spm_reg_proto_t *proto)
+{
+    if (!proto->auto_increment) return 1;
+    if (proto->max_burst == 0 || proto->max_burst > SPM_REG_ADDR_SPACE) return SPM_REG_ADDR_SPACE;
+    return proto->max_burst;
+}
+
+/*
+ * Reads may merge across holes of up to max_gap registers and share
+ * duplicates. Writes only merge strictly contiguous addresses; a
+ * repeated address starts a new burst so every write is issued.
+ */
+static bool extends_burst(const spm_reg_proto_t *proto, bool write, size_t max_burst,
+                          unsigned start, unsigned end, unsigned a)
+{
+    if (a - start + 1 > max_burst) return false;
+    if (write) return a == end + 1;
+    return a - end - 1 <= proto->max_gap;
+}
+
+static bool v_proto_is_valid(const spm_reg_proto_t *proto)
+{
+    if (!proto) return false;
+    size_t bufsiz = proto->bufsiz ? proto->bufsiz : SPM_BUFSIZ_DEFAULT;
+    return SPM_BUFSIZ_COST(1 + max_burst_len(proto)) <= bufsiz;
+}
+
+static uint8_t cmd_byte(const spm_reg_proto_t *proto, bool write, unsigned start, size_t span)
+{
+    uint8_t cmd = (uint8_t)start | (write ? proto->write_mask : proto->read_mask);
+    if (span > 1) cmd |= proto->burst_mask;
+    return cmd;
+}
+
+static void plan_free(spm_reg_plan_t *plan)
+{
+    if (!plan) return;
+    free(plan->map);
+    free(plan->xfers);
+    free(plan->msg_end);
+    free(plan->tx);
+    free(plan->rx);
+    free(plan);
+}
+
+static spm_ecode_t plan_build(const spm_reg_proto_t *proto, const uint8_t *addrs,
+                              const uint8_t *wvalues, size_t count, spm_reg_plan_t **out_plan)
+{
+    const bool write = wvalues != NULL;
+    const size_t max_burst = max_burst_len(proto);
+
+    spm_reg_plan_t *plan = calloc(1, sizeof(*plan));
+    uint32_t *keys = sorted_keys(addrs, count);
+    size_t   *burst_of = malloc(count * sizeof(*burst_of));
+    unsigned *starts = malloc(count * sizeof(*starts));
+    unsigned *spans  = malloc(count * sizeof(*spans));
+    if (!plan || !keys || !burst_of || !starts || !spans) goto nomem;
+
+    /* Pass 1: group sorted addresses into bursts */
+    size_t nb = 0;
+    size_t total = 0;
+    unsigned start = 0, end = 0;
+    for (size_t k = 0; k < count; k++) {
+        unsigned a = key_addr(keys[k]);
+        if (k == 0 || !extends_burst(proto, write, max_burst, start, end, a)) {
+            if (k > 0 && !write && a == end) {
+                burst_of[k] = nb - 1;   /* duplicate read shares the slot */
+                continue;
+            }
+            if (k > 0) {
+                spans[nb - 1] = end - start + 1;
+                total += 1 + spans[nb - 1];
+            }
+            starts[nb++] = start = end = a;
+        } else {
+            end = a;
+        }
+        burst_of[k] = nb - 1;
+    }
+    spans[nb - 1] = end - start + 1;
+    total += 1 + spans[nb - 1];
+
+    plan->count   = count;
+    plan->nbursts = nb;
+    plan->map     = malloc(count * sizeof(*plan->map));
+    plan->xfers   = calloc(nb, sizeof(*plan->xfers));
+    plan->msg_end = malloc(nb * sizeof(*plan->msg_end));
+    plan->tx      = calloc(total, 1);
+    plan->rx      = write ? NULL : calloc(total, 1);
+    if (!plan->map || !plan->xfers || !plan->msg_end || !plan->tx || (!write && !plan->rx)) goto nomem;
+
+    /* Pass 2: lay out frames and descriptors, cut into messages spidev accepts */
+    const size_t bufsiz = proto->bufsiz ? proto->bufsiz : SPM_BUFSIZ_DEFAULT;
+    size_t off = 0, n = 0, cost = 0;
+    for (size_t b = 0; b < nb; b++) {
+        size_t len = 1 + spans[b];
+
+        /* tx and rx carry the same frames, so one sum covers both */
+        if (n && (n == SPM_MAX_BATCH_XFERS || cost + SPM_BUFSIZ_COST(len) > bufsiz)) {
+            plan->xfers[b - 1].cs_change = false;
+            plan->msg_end[plan->nmsgs++] = b;
+            n = cost = 0;
+        }
+
+        plan->tx[off] = cmd_byte(proto, write, starts[b], spans[b]);
+        plan->xfers[b] = (spm_batch_xfer_t){
+            .tx        = plan->tx + off,
+            .rx        = write ? NULL : plan->rx + off,
+            .len       = len,
+            .cs_change = b != nb - 1,
+        };
+        off += len;
+        n++;
+        cost += SPM_BUFSIZ_COST(len);
+    }
+    plan->msg_end[plan->nmsgs++] = nb;
+
+    /* Pass 3: data byte of every requested address */
+    for (size_t k = 0; k < count; k++) {
+        size_t b = burst_of[k];
+        size_t frame = (size_t)((const uint8_t *)plan->xfers[b].tx - plan->tx);
+        uint32_t pos = (uint32_t)(frame + 1 + (key_addr(keys[k]) - starts[b]));
+
+        plan->map[key_idx(keys[k])] = pos;
+        if (write) plan->tx[pos] = wvalues[key_idx(keys[k])];
+    }
+
+    free(keys);
+    free(burst_of);
+    free(starts);
+    free(spans);
+    *out_plan = plan;
+    return SPM_OK;
+
+nomem:
+    free(keys);
+    free(burst_of);
+    free(starts);
+    free(spans);
+    plan_free(plan);
+    return SPM_ENOMEM;
+}
+
+static spm_ecode_t send_messages(spm_device_t *dev, const spm_reg_plan_t *plan)
+{
+    size_t b = 0;
+    for (size_t m = 0; m < plan->nmsgs; m++) {
+        spm_ecode_t rc = spm_batch(dev, plan->xfers + b, plan->msg_end[m] - b);
+        if (rc != SPM_OK) return rc;
+        b = plan->msg_end[m];
+    }
+    return SPM_OK;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_reg_plan_create(const spm_reg_proto_t *proto, const uint8_t *addrs,
+                                size_t count, spm_reg_plan_t **out_plan)
+{
+    if (!out_plan) return SPM_EPARAM;
+    *out_plan = NULL;
+    if (!v_proto_is_valid(proto) || !addrs || count == 0 || count >= SPM_REG_MAX_COUNT) return SPM_EPARAM;
+
+    return plan_build(proto, addrs, NULL, count, out_plan);
+}
+
+spm_ecode_t spm_reg_plan_read(spm_device_t *dev, spm_reg_plan_t *plan, uint8_t *values)
+{
+    if (!plan || !values) return SPM_EPARAM;
+
+    spm_ecode_t rc = send_messages(dev, plan);
+    if (rc != SPM_OK) return rc;
+
+    for (size_t i = 0; i < plan->count; i++) {
+        values[i] = plan->rx[plan->map[i]];
+    }
+    return SPM_OK;
+}
+
+size_t spm_reg_plan_bursts(const spm_reg_plan_t *plan)
+{
+    return plan ? plan->nbursts : 0;
+}
+
+void spm_reg_plan_destroy(spm_reg_plan_t *plan)
+{
+    plan_free(plan);
+}
+
+spm_ecode_t spm_reg_read_multi(spm_device_t *dev, const spm_reg_proto_t *proto,
+                               const uint8_t *addrs, uint8_t *values, size_t count)
+{
+    if (!values) return SPM_EPARAM;
+
+    spm_reg_plan_t *plan = NULL;
+    spm_ecode_t rc = spm_reg_plan_create(proto, addrs, count, &plan);
+    if (rc != SPM_OK) return rc;
+
+    rc = spm_reg_plan_read(dev, plan, values);
+    plan_free(plan);
+    return rc;
+}
+
+spm_ecode_t spm_reg_write_multi(spm_device_t *dev, const spm_reg_proto_t *proto,
+                                const uint8_t *addrs, const uint8_t *values, size_t count)
+{
+    if (!v_proto_is_valid(proto) || !addrs || !values || count == 0 || count >= SPM_REG_MAX_COUNT) {
+        return SPM_EPARAM;
+    }
+
+    spm_reg_plan_t *plan = NULL;
+    spm_ecode_t rc = plan_build(proto, addrs, values, count, &plan);
+    if (rc != SPM_OK) return rc;
+
+    rc = send_messages(dev, plan);
+    plan_free(plan);
+    return rc;
+}
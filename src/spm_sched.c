@@ -0,0 +1,508 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_sched.h"
+
+/* One spm_batch() of a tick: consecutive tasks of one device */
+typedef struct {
+    spm_device_t  *dev;
+    size_t         xfer_first;
+    size_t         xfer_count;
+    size_t         task_first;    /* into task_ids */
+    size_t         task_count;
+} sched_msg_t;
+
+typedef struct {
+    spm_sched_task_t  task;       /* xfers points into the schedule's copy */
+    uint32_t          period;     /* in ticks */
+    uint32_t          offset;     /* first tick */
+    uint32_t          speed_hz;
+    uint8_t           bits_per_word;
+    uint64_t          cost_ns;    /* alone, one message */
+    size_t            tx_cost;    /* against bufsiz, as spidev counts */
+    size_t            rx_cost;
+} sched_task_t;
+
+/**
+ * @brief Cyclic schedule
+ *
+ * Compiled once: tick t of the hyperperiod issues msgs
+ * [tick_first[t], tick_first[t + 1]). Descriptors of a message are
+ * contiguous in xfers.
+ */
+struct spm_sched {
+    sched_task_t     *tasks;
+    size_t            ntasks;
+    spm_batch_xfer_t *task_xfers;  /* copies of the tasks' descriptors */
+
+    spm_batch_xfer_t *xfers;
+    sched_msg_t      *msgs;
+    size_t           *task_ids;
+    uint32_t         *tick_first;  /* ticks + 1 entries */
+    uint64_t          tick_ns;
+    size_t            bufsiz;
+    spm_sched_info_t  info;
+
+    uint32_t          cur;         /* next tick index */
+    uint64_t          tick_no;     /* ticks since creation, passed to done() */
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    bool              started;     /* thread needs joining */
+    bool              stop;
+    double            exec_sum_ns;
+    spm_sched_stats_t stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns)
+{
+    return (struct timespec){
+        .tv_sec  = (time_t)(ns / 1000000000ull),
+        .tv_nsec = (long)(ns % 1000000000ull),
+    };
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b)
+{
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static bool v_tasks_are_valid(const spm_sched_task_t *tasks, size_t count)
+{
+    if (!tasks || count == 0) return false;
+    for (size_t i = 0; i < count; i++) {
+        const spm_sched_task_t *t = &tasks[i];
+        if (!t->dev || !t->xfers || t->period_us == 0)           return false;
+        if (t->count == 0 || t->count > SPM_MAX_BATCH_XFERS)     return false;
+    }
+    return true;
+}
+
+typedef struct {
+    uint32_t  period;
+    uint64_t  cost_ns;
+    size_t    idx;
+} rm_key_t;
+
+/* Rate-monotonic order: shorter period first, then costlier first */
+static int cmp_rm(const void *pa, const void *pb)
+{
+    const rm_key_t *a = pa, *b = pb;
+    if (a->period != b->period)   return a->period < b->period ? -1 : 1;
+    if (a->cost_ns != b->cost_ns) return a->cost_ns > b->cost_ns ? -1 : 1;
+    return a->idx < b->idx ? -1 : 1;
+}
+
+/* ====================================================== */
+/* ===================== Compilation ==================== */
+/* ====================================================== */
+
+static spm_ecode_t derive_ticks(spm_sched_t *s, const spm_sched_cfg_t *cfg)
+{
+    uint64_t tick_us = cfg->tick_us;
+    if (!tick_us) {
+        for (size_t i = 0; i < s->ntasks; i++) tick_us = gcd_u64(tick_us, s->tasks[i].task.period_us);
+    }
+
+    uint64_t hyper = 1;
+    for (size_t i = 0; i < s->ntasks; i++) {
+        sched_task_t *t = &s->tasks[i];
+        if (t->task.period_us % tick_us != 0) return SPM_ECONFIG;
+
+        t->period = (uint32_t)(t->task.period_us / tick_us);
+        hyper = hyper / gcd_u64(hyper, t->period) * t->period;
+        if (hyper > SPM_SCHED_MAX_TICKS) return SPM_ECONFIG;
+    }
+
+    s->info.tick_us = (uint32_t)tick_us;
+    s->info.ticks   = (uint32_t)hyper;
+    s->tick_ns      = tick_us * 1000u;
+    return SPM_OK;
+}
+
+/* Greedy offset choice: lowest peak, then lowest total over the task's ticks */
+static spm_ecode_t balance(spm_sched_t *s)
+{
+    const uint32_t H = s->info.ticks;
+    uint64_t *load  = calloc(H, sizeof(*load));
+    rm_key_t *order = malloc(s->ntasks * sizeof(*order));
+    if (!load || !order) {
+        free(load);
+        free(order);
+        return SPM_ENOMEM;
+    }
+
+    for (size_t i = 0; i < s->ntasks; i++) {
+        order[i] = (rm_key_t){ s->tasks[i].period, s->tasks[i].cost_ns, i };
+    }
+    qsort(order, s->ntasks, sizeof(*order), cmp_rm);
+
+    for (size_t k = 0; k < s->ntasks; k++) {
+        sched_task_t *t = &s->tasks[order[k].idx];
+        uint32_t best = 0;
+        uint64_t best_peak = UINT64_MAX, best_sum = UINT64_MAX;
+
+        for (uint32_t o = 0; o < t->period; o++) {
+            uint64_t peak = 0, sum = 0;
+            for (uint32_t tk = o; tk < H; tk += t->period) {
+                if (load[tk] > peak) peak = load[tk];
+                sum += load[tk];
+            }
+            if (peak < best_peak || (peak == best_peak && sum < best_sum)) {
+                best = o;
+                best_peak = peak;
+                best_sum = sum;
+            }
+        }
+
+        t->offset = best;
+        for (uint32_t tk = best; tk < H; tk += t->period) load[tk] += t->cost_ns;
+    }
+
+    free(load);
+    free(order);
+    return SPM_OK;
+}
+
+/* Lays out every tick's messages; tasks of one device share messages */
+static spm_ecode_t pack(spm_sched_t *s)
+{
+    const uint32_t H = s->info.ticks;
+    size_t ninst = 0, nxfers = 0;
+    for (size_t i = 0; i < s->ntasks; i++) {
+        size_t runs = H / s->tasks[i].period;
+        ninst  += runs;
+        nxfers += runs * s->tasks[i].task.count;
+    }
+
+    s->xfers      = malloc(nxfers * sizeof(*s->xfers));
+    s->msgs       = malloc(ninst * sizeof(*s->msgs));
+    s->task_ids   = malloc(ninst * sizeof(*s->task_ids));
+    s->tick_first = malloc(((size_t)H + 1) * sizeof(*s->tick_first));
+    if (!s->xfers || !s->msgs || !s->task_ids || !s->tick_first) return SPM_ENOMEM;
+
+    bool *placed = malloc(s->ntasks * sizeof(*placed));
+    if (!placed) return SPM_ENOMEM;
+
+    size_t nm = 0, nx = 0, nt = 0;
+    for (uint32_t tk = 0; tk < H; tk++) {
+        s->tick_first[tk] = (uint32_t)nm;
+        for (size_t i = 0; i < s->ntasks; i++) {
+            const sched_task_t *t = &s->tasks[i];
+            placed[i] = (tk % t->period) != t->offset;
+        }
+
+        for (size_t i = 0; i < s->ntasks; i++) {
+            if (placed[i]) continue;
+
+            sched_msg_t *m = &s->msgs[nm++];
+            *m = (sched_msg_t){ .dev = s->tasks[i].task.dev, .xfer_first = nx, .task_first = nt };
+            size_t tx = 0, rx = 0;
+
+            for (size_t j = i; j < s->ntasks; j++) {
+                const sched_task_t *t = &s->tasks[j];
+                if (placed[j] || t->task.dev != m->dev) continue;
+                if (m->xfer_count + t->task.count > SPM_MAX_BATCH_XFERS) continue;
+                if (tx + t->tx_cost > s->bufsiz || rx + t->rx_cost > s->bufsiz) continue;
+
+                /* CS is released between packed tasks, as between messages */
+                if (m->xfer_count) s->xfers[nx - 1].cs_change = !s->xfers[nx - 1].cs_change;
+                memcpy(&s->xfers[nx], t->task.xfers, t->task.count * sizeof(*s->xfers));
+                nx += t->task.count;
+                tx += t->tx_cost;
+                rx += t->rx_cost;
+                m->xfer_count += t->task.count;
+                s->task_ids[nt++] = j;
+                m->task_count++;
+                placed[j] = true;
+            }
+        }
+    }
+    s->tick_first[H] = (uint32_t)nm;
+    s->info.messages = (uint32_t)nm;
+    free(placed);
+    return SPM_OK;
+}
+
+/* Worst-case modeled bus time per tick against the budget */
+static spm_ecode_t validate(spm_sched_t *s, const spm_sched_cfg_t *cfg)
+{
+    const spm_sim_timing_t def = {0};
+    const spm_sim_timing_t *timing = cfg->timing ? cfg->timing : &def;
+    uint64_t budget_ns = (uint64_t)(cfg->budget_us ? cfg->budget_us : s->info.tick_us) * 1000u;
+    uint64_t total = 0;
+
+    for (uint32_t tk = 0; tk < s->info.ticks; tk++) {
+        uint64_t ns = 0;
+        for (uint32_t m = s->tick_first[tk]; m < s->tick_first[tk + 1]; m++) {
+            const sched_msg_t *msg = &s->msgs[m];
+            const sched_task_t *t = &s->tasks[s->task_ids[msg->task_first]];
+            ns += spm_sim_wire_ns(timing, &s->xfers[msg->xfer_first], msg->xfer_count,
+                                  t->speed_hz, t->bits_per_word);
+        }
+        if (ns > s->info.max_tick_ns) {
+            s->info.max_tick_ns = ns;
+            s->info.worst_tick = tk;
+        }
+        total += ns;
+    }
+    s->info.avg_tick_ns = total / s->info.ticks;
+
+    return s->info.max_tick_ns > budget_ns ? SPM_ECONFIG : SPM_OK;
+}
+
+/* ====================================================== */
+/* ====================== Execution ===================== */
+/* ====================================================== */
+
+/* Runs tick s->cur and advances; returns the first message error */
+static spm_ecode_t run_tick(spm_sched_t *s, uint64_t *out_msgs, uint64_t *out_errors)
+{
+    spm_ecode_t first = SPM_OK;
+    const uint32_t tk = s->cur;
+
+    for (uint32_t i = s->tick_first[tk]; i < s->tick_first[tk + 1]; i++) {
+        const sched_msg_t *m = &s->msgs[i];
+        spm_ecode_t rc = spm_batch(m->dev, &s->xfers[m->xfer_first], m->xfer_count);
+        if (rc != SPM_OK) {
+            (*out_errors)++;
+            if (first == SPM_OK) first = rc;
+        }
+
+        for (size_t k = 0; k < m->task_count; k++) {
+            const spm_sched_task_t *t = &s->tasks[s->task_ids[m->task_first + k]].task;
+            if (t->done) t->done(t->ctx, rc, s->tick_no);
+        }
+    }
+
+    *out_msgs += s->tick_first[tk + 1] - s->tick_first[tk];
+    s->cur = (tk + 1) % s->info.ticks;
+    s->tick_no++;
+    return first;
+}
+
+static void *sched_thread(void *arg)
+{
+    spm_sched_t *s = arg;
+    uint64_t deadline = now_ns();
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        struct timespec ts = ns_to_ts(deadline);
+        while (!s->stop && pthread_cond_timedwait(&s->cond, &s->lock, &ts) == 0) { }
+        if (s->stop) break;
+        pthread_mutex_unlock(&s->lock);
+
+        uint64_t t0 = now_ns();
+        uint64_t msgs = 0, errors = 0;
+        spm_ecode_t rc = run_tick(s, &msgs, &errors);
+        uint64_t t1 = now_ns();
+
+        /* Late ticks run once; older missed starts are dropped */
+        uint64_t next = deadline + s->tick_ns;
+        uint64_t skipped = 0;
+        while (next + s->tick_ns <= t1) {
+            next += s->tick_ns;
+            s->cur = (s->cur + 1) % s->info.ticks;
+            s->tick_no++;
+            skipped++;
+        }
+
+        pthread_mutex_lock(&s->lock);
+        spm_sched_stats_t *st = &s->stats;
+        st->ticks++;
+        st->messages += msgs;
+        st->errors   += errors;
+        st->skipped  += skipped;
+        if (rc != SPM_OK) st->last_error = rc;
+        if (t1 > deadline + s->tick_ns) st->overruns++;
+        if (t1 - t0 > st->max_exec_ns) st->max_exec_ns = t1 - t0;
+        if (t0 > deadline && t0 - deadline > st->max_late_ns) st->max_late_ns = t0 - deadline;
+        s->exec_sum_ns += (double)(t1 - t0);
+        deadline = next;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_sched_create(const spm_sched_task_t *tasks, size_t count,
+                             const spm_sched_cfg_t *cfg, spm_sched_t **out_sched)
+{
+    if (out_sched) *out_sched = NULL;
+    if (!out_sched || !v_tasks_are_valid(tasks, count)) return SPM_EPARAM;
+
+    const spm_sched_cfg_t def = {0};
+    if (!cfg) cfg = &def;
+
+    spm_sched_t *s = calloc(1, sizeof(*s));
+    if (!s) return SPM_ENOMEM;
+
+    size_t nx = 0;
+    for (size_t i = 0; i < count; i++) nx += tasks[i].count;
+
+    s->ntasks     = count;
+    s->bufsiz     = cfg->bufsiz ? cfg->bufsiz : SPM_BUFSIZ_DEFAULT;
+    s->tasks      = calloc(count, sizeof(*s->tasks));
+    s->task_xfers = malloc(nx * sizeof(*s->task_xfers));
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    spm_ecode_t rc = (s->tasks && s->task_xfers) ? SPM_OK : SPM_ENOMEM;
+
+    const spm_sim_timing_t def_timing = {0};
+    nx = 0;
+    for (size_t i = 0; rc == SPM_OK && i < count; i++) {
+        sched_task_t *t = &s->tasks[i];
+        spm_cfg_t dcfg;
+        rc = spm_dev_get_cfg(tasks[i].dev, &dcfg);
+        if (rc != SPM_OK) break;
+
+        memcpy(&s->task_xfers[nx], tasks[i].xfers, tasks[i].count * sizeof(*s->task_xfers));
+        t->task          = tasks[i];
+        t->task.xfers    = &s->task_xfers[nx];
+        t->speed_hz      = dcfg.speed_hz;
+        t->bits_per_word = dcfg.bits_per_word;
+        t->cost_ns       = spm_sim_wire_ns(cfg->timing ? cfg->timing : &def_timing, t->task.xfers,
+                                           t->task.count, t->speed_hz, t->bits_per_word);
+        for (size_t k = 0; k < t->task.count; k++) {
+            const spm_batch_xfer_t *x = &t->task.xfers[k];
+            if (x->tx) t->tx_cost += SPM_BUFSIZ_COST(x->len);
+            if (x->rx) t->rx_cost += SPM_BUFSIZ_COST(x->len);
+        }
+        if (t->tx_cost > s->bufsiz || t->rx_cost > s->bufsiz) rc = SPM_EPARAM;
+        nx += tasks[i].count;
+    }
+
+    if (rc == SPM_OK) rc = derive_ticks(s, cfg);
+    if (rc == SPM_OK) rc = balance(s);
+    if (rc == SPM_OK) rc = pack(s);
+    if (rc == SPM_OK) rc = validate(s, cfg);
+    if (rc != SPM_OK) {
+        spm_sched_destroy(s);
+        return rc;
+    }
+
+    *out_sched = s;
+    return SPM_OK;
+}
+
+void spm_sched_destroy(spm_sched_t *sched)
+{
+    if (!sched) return;
+    spm_sched_stop(sched);
+
+    pthread_cond_destroy(&sched->cond);
+    pthread_mutex_destroy(&sched->lock);
+    free(sched->tick_first);
+    free(sched->task_ids);
+    free(sched->msgs);
+    free(sched->xfers);
+    free(sched->task_xfers);
+    free(sched->tasks);
+    free(sched);
+}
+
+spm_ecode_t spm_sched_start(spm_sched_t *sched)
+{
+    if (!sched) return SPM_EPARAM;
+    if (sched->started) return SPM_ESTATE;
+
+    pthread_mutex_lock(&sched->lock);
+    sched->stop = false;
+    memset(&sched->stats, 0, sizeof sched->stats);
+    sched->exec_sum_ns = 0.0;
+    pthread_mutex_unlock(&sched->lock);
+
+    if (pthread_create(&sched->thread, NULL, sched_thread, sched) != 0) return SPM_ENOMEM;
+    sched->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_sched_stop(spm_sched_t *sched)
+{
+    if (!sched) return SPM_EPARAM;
+    if (!sched->started) return SPM_OK;
+
+    pthread_mutex_lock(&sched->lock);
+    sched->stop = true;
+    pthread_cond_broadcast(&sched->cond);
+    pthread_mutex_unlock(&sched->lock);
+
+    pthread_join(sched->thread, NULL);
+    sched->started = false;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_sched_step(spm_sched_t *sched)
+{
+    if (!sched) return SPM_EPARAM;
+    if (sched->started) return SPM_ESTATE;
+
+    uint64_t t0 = now_ns();
+    uint64_t msgs = 0, errors = 0;
+    spm_ecode_t rc = run_tick(sched, &msgs, &errors);
+    uint64_t dt = now_ns() - t0;
+
+    pthread_mutex_lock(&sched->lock);
+    sched->stats.ticks++;
+    sched->stats.messages += msgs;
+    sched->stats.errors   += errors;
+    if (rc != SPM_OK) sched->stats.last_error = rc;
+    if (dt > sched->stats.max_exec_ns) sched->stats.max_exec_ns = dt;
+    sched->exec_sum_ns += (double)dt;
+    pthread_mutex_unlock(&sched->lock);
+    return rc;
+}
+
+spm_ecode_t spm_sched_get_info(const spm_sched_t *sched, spm_sched_info_t *out_info)
+{
+    if (!sched || !out_info) return SPM_EPARAM;
+    *out_info = sched->info;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_sched_get_offset(const spm_sched_t *sched, size_t task, uint32_t *out_offset)
+{
+    if (!sched || !out_offset || task >= sched->ntasks) return SPM_EPARAM;
+    *out_offset = sched->tasks[task].offset;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_sched_get_stats(spm_sched_t *sched, spm_sched_stats_t *out_stats)
+{
+    if (!sched || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&sched->lock);
+    *out_stats = sched->stats;
+    out_stats->avg_exec_ns = sched->stats.ticks ? sched->exec_sum_ns / (double)sched->stats.ticks : 0.0;
+    pthread_mutex_unlock(&sched->lock);
+    return SPM_OK;
+}
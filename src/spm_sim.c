@@ -0,0 +1,394 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_sim.h"
+
+#define SPM_SIM_FD_BASE          0x5000
+#define SPM_SIM_PATH_MAX         64
+#define SPM_SIM_DEFAULT_HZ       1000000u
+#define SPM_SIM_DEFAULT_MSG_NS   15000u
+#define SPM_SIM_DEFAULT_XFER_NS  1000u
+
+typedef struct {
+    bool              used;
+    char              path[SPM_SIM_PATH_MAX];
+    uint32_t          mode;
+    uint8_t           bits_per_word;
+    uint32_t          speed_hz;
+    spm_sim_xfer_fn   fn;
+    void             *ctx;
+    spm_sim_stats_t   stats;
+} sim_dev_t;
+
+/* Process-wide: spm_sys_ops_t callbacks carry no context */
+static struct {
+    pthread_mutex_t   lock;
+    sim_dev_t         devs[SPM_SIM_MAX_DEVICES];
+    spm_sim_timing_t  timing;
+    size_t            bufsiz;
+} g_sim = {
+    .lock   = PTHREAD_MUTEX_INITIALIZER,
+    .timing = { SPM_SIM_DEFAULT_MSG_NS, SPM_SIM_DEFAULT_XFER_NS, false },
+    .bufsiz = SPM_BUFSIZ_DEFAULT,
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void spin_until(uint64_t t)
+{
+    while (now_ns() < t) { }
+}
+
+static spm_sim_timing_t timing_or_default(const spm_sim_timing_t *t)
+{
+    spm_sim_timing_t r = t ? *t : (spm_sim_timing_t){0};
+    if (!r.msg_overhead_ns)  r.msg_overhead_ns  = SPM_SIM_DEFAULT_MSG_NS;
+    if (!r.xfer_overhead_ns) r.xfer_overhead_ns = SPM_SIM_DEFAULT_XFER_NS;
+    return r;
+}
+
+/* Called with lock held */
+static sim_dev_t *dev_by_fd(int fd)
+{
+    int i = fd - SPM_SIM_FD_BASE;
+    if (i < 0 || i >= SPM_SIM_MAX_DEVICES || !g_sim.devs[i].used) return NULL;
+    return &g_sim.devs[i];
+}
+
+static sim_dev_t *dev_by_path(const char *path)
+{
+    for (int i = 0; i < SPM_SIM_MAX_DEVICES; i++) {
+        if (g_sim.devs[i].used && strcmp(g_sim.devs[i].path, path) == 0) return &g_sim.devs[i];
+    }
+    return NULL;
+}
+
+static uint64_t xfer_ns(const spm_sim_timing_t *t, size_t len, uint32_t hz, uint8_t bpw,
+                        uint16_t delay_usecs)
+{
+    if (!bpw) bpw = 8;
+    uint64_t ns = t->xfer_overhead_ns + (uint64_t)delay_usecs * 1000u;
+    if (hz) {
+        uint64_t words = len / ((bpw + 7u) / 8u);
+        ns += (words * bpw * 1000000000ull + hz - 1) / hz;
+    }
+    return ns;
+}
+
+/* spidev's check: tx and rx sums, each transfer aligned, within bufsiz; lock held */
+static bool fits_bufsiz(const struct spi_ioc_transfer *trs, size_t n)
+{
+    size_t tx = 0, rx = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (trs[i].tx_buf) tx += SPM_BUFSIZ_COST(trs[i].len);
+        if (trs[i].rx_buf) rx += SPM_BUFSIZ_COST(trs[i].len);
+    }
+    return tx <= g_sim.bufsiz && rx <= g_sim.bufsiz;
+}
+
+/* Models and accounting on one message; lock held, returns wire time */
+static uint64_t run_message(sim_dev_t *d, const struct spi_ioc_transfer *trs, size_t n)
+{
+    uint64_t ns = g_sim.timing.msg_overhead_ns;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t hz  = trs[i].speed_hz ? trs[i].speed_hz : d->speed_hz;
+        uint8_t  bpw = trs[i].bits_per_word ? trs[i].bits_per_word : d->bits_per_word;
+        ns += xfer_ns(&g_sim.timing, trs[i].len, hz, bpw, trs[i].delay_usecs);
+        d->stats.bytes += trs[i].len;
+
+        if (!d->fn && trs[i].rx_buf) memset((void *)(uintptr_t)trs[i].rx_buf, 0, trs[i].len);
+    }
+    if (d->fn && n > 0) d->fn(trs, n, d->ctx);
+
+    d->stats.messages++;
+    d->stats.xfers += n;
+    d->stats.wire_ns += ns;
+    return ns;
+}
+
+static uint32_t cfg_mode_mask(const spm_cfg_t *cfg)
+{
+    static const uint32_t lut[4] = { 0, SPI_CPHA, SPI_CPOL, SPI_CPOL | SPI_CPHA };
+    return lut[cfg->mode & 3]
+         | (cfg->cs_active_high ? SPI_CS_HIGH   : 0)
+         | (cfg->lsb_first      ? SPI_LSB_FIRST : 0);
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+void spm_sim_reset(void)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    memset(g_sim.devs, 0, sizeof(g_sim.devs));
+    g_sim.timing = timing_or_default(NULL);
+    g_sim.bufsiz = SPM_BUFSIZ_DEFAULT;
+    pthread_mutex_unlock(&g_sim.lock);
+}
+
+spm_ecode_t spm_sim_add(const char *path, uint32_t max_speed_hz, spm_sim_xfer_fn fn, void *ctx)
+{
+    if (!path || strlen(path) >= SPM_SIM_PATH_MAX) return SPM_EPARAM;
+
+    pthread_mutex_lock(&g_sim.lock);
+    if (dev_by_path(path)) {
+        pthread_mutex_unlock(&g_sim.lock);
+        return SPM_ESTATE;
+    }
+
+    for (int i = 0; i < SPM_SIM_MAX_DEVICES; i++) {
+        sim_dev_t *d = &g_sim.devs[i];
+        if (d->used) continue;
+
+        *d = (sim_dev_t){
+            .used          = true,
+            .bits_per_word = 8,
+            .speed_hz      = max_speed_hz ? max_speed_hz : SPM_SIM_DEFAULT_HZ,
+            .fn            = fn,
+            .ctx           = ctx,
+        };
+        strcpy(d->path, path);
+        pthread_mutex_unlock(&g_sim.lock);
+        return SPM_OK;
+    }
+    pthread_mutex_unlock(&g_sim.lock);
+    return SPM_ENOMEM;
+}
+
+bool spm_sim_has(const char *path)
+{
+    if (!path) return false;
+    pthread_mutex_lock(&g_sim.lock);
+    bool found = dev_by_path(path) != NULL;
+    pthread_mutex_unlock(&g_sim.lock);
+    return found;
+}
+
+void spm_sim_set_timing(const spm_sim_timing_t *timing)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    g_sim.timing = timing_or_default(timing);
+    pthread_mutex_unlock(&g_sim.lock);
+}
+
+void spm_sim_set_bufsiz(size_t bufsiz)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    g_sim.bufsiz = bufsiz ? bufsiz : SPM_BUFSIZ_DEFAULT;
+    pthread_mutex_unlock(&g_sim.lock);
+}
+
+uint64_t spm_sim_wire_ns(const spm_sim_timing_t *timing, const spm_batch_xfer_t *xfers, size_t count,
+                         uint32_t speed_hz, uint8_t bits_per_word)
+{
+    spm_sim_timing_t t;
+    if (timing) {
+        t = timing_or_default(timing);
+    } else {
+        pthread_mutex_lock(&g_sim.lock);
+        t = g_sim.timing;
+        pthread_mutex_unlock(&g_sim.lock);
+    }
+    if (!xfers || count == 0) return 0;
+
+    uint64_t ns = t.msg_overhead_ns;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t hz  = xfers[i].speed_hz ? xfers[i].speed_hz : speed_hz;
+        uint8_t  bpw = xfers[i].bits_per_word ? xfers[i].bits_per_word : bits_per_word;
+        ns += xfer_ns(&t, xfers[i].len, hz, bpw, xfers[i].delay_usecs);
+    }
+    return ns;
+}
+
+spm_ecode_t spm_sim_get_stats(const char *path, spm_sim_stats_t *out_stats)
+{
+    if (!out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&g_sim.lock);
+    spm_ecode_t rc = SPM_OK;
+    if (path) {
+        sim_dev_t *d = dev_by_path(path);
+        if (d) *out_stats = d->stats;
+        else rc = SPM_EPARAM;
+    } else {
+        spm_sim_stats_t t = {0};
+        for (int i = 0; i < SPM_SIM_MAX_DEVICES; i++) {
+            const spm_sim_stats_t *s = &g_sim.devs[i].stats;
+            t.syscalls += s->syscalls;
+            t.messages += s->messages;
+            t.xfers    += s->xfers;
+            t.bytes    += s->bytes;
+            t.wire_ns  += s->wire_ns;
+            t.errors   += s->errors;
+        }
+        *out_stats = t;
+    }
+    pthread_mutex_unlock(&g_sim.lock);
+    return rc;
+}
+
+void spm_sim_reset_stats(void)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    for (int i = 0; i < SPM_SIM_MAX_DEVICES; i++) {
+        memset(&g_sim.devs[i].stats, 0, sizeof(g_sim.devs[i].stats));
+    }
+    pthread_mutex_unlock(&g_sim.lock);
+}
+
+/* ====================================================== */
+/* ====================== Backend ======================= */
+/* ====================================================== */
+
+static int s_open_(const char *path, int flags)
+{
+    (void)flags;
+    pthread_mutex_lock(&g_sim.lock);
+    sim_dev_t *d = path ? dev_by_path(path) : NULL;
+    int fd = d ? SPM_SIM_FD_BASE + (int)(d - g_sim.devs) : -1;
+    pthread_mutex_unlock(&g_sim.lock);
+
+    if (fd < 0) errno = ENODEV;
+    return fd;
+}
+
+static int s_close_(int fd)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    bool ok = dev_by_fd(fd) != NULL;
+    pthread_mutex_unlock(&g_sim.lock);
+
+    if (!ok) {
+        errno = EBADF;
+        return -1;
+    }
+    return 0;
+}
+
+static int s_ioctl_(int fd, unsigned long req, void *arg)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    sim_dev_t *d = dev_by_fd(fd);
+    if (!d) {
+        pthread_mutex_unlock(&g_sim.lock);
+        errno = EBADF;
+        return -1;
+    }
+    d->stats.syscalls++;
+
+    uint64_t wire = 0;
+    int err = 0;
+    if (_IOC_TYPE(req) == SPI_IOC_MAGIC && _IOC_NR(req) == 0 && (_IOC_DIR(req) & _IOC_WRITE)) {
+        size_t sz = _IOC_SIZE(req);
+        size_t n  = sz / sizeof(struct spi_ioc_transfer);
+        if (sz % sizeof(struct spi_ioc_transfer) != 0) {
+            err = EINVAL;
+        } else if (!fits_bufsiz(arg, n)) {
+            err = EMSGSIZE;
+        } else {
+            wire = run_message(d, arg, n);
+        }
+    } else {
+        switch (req) {
+            case SPI_IOC_RD_MODE32:        *(uint32_t *)arg = d->mode;            break;
+            case SPI_IOC_RD_MODE:          *(uint8_t *)arg  = (uint8_t)d->mode;   break;
+            case SPI_IOC_RD_BITS_PER_WORD: *(uint8_t *)arg  = d->bits_per_word;   break;
+            case SPI_IOC_RD_MAX_SPEED_HZ:  *(uint32_t *)arg = d->speed_hz;        break;
+            case SPI_IOC_WR_MODE32:        d->mode = *(uint32_t *)arg;            break;
+            case SPI_IOC_WR_MODE:          d->mode = *(uint8_t *)arg;             break;
+            case SPI_IOC_WR_BITS_PER_WORD: d->bits_per_word = *(uint8_t *)arg;    break;
+            case SPI_IOC_WR_MAX_SPEED_HZ:  d->speed_hz = *(uint32_t *)arg;        break;
+            default:                       err = EINVAL;                          break;
+        }
+    }
+    if (err) d->stats.errors++;
+    bool realtime = g_sim.timing.realtime;
+    pthread_mutex_unlock(&g_sim.lock);
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    if (realtime && wire) spin_until(now_ns() + wire);
+    return 0;
+}
+
+static int s_transfer_(int fd, spm_sys_msg_t *msg)
+{
+    pthread_mutex_lock(&g_sim.lock);
+    sim_dev_t *d = dev_by_fd(fd);
+    if (!d) {
+        pthread_mutex_unlock(&g_sim.lock);
+        errno = EBADF;
+        return -1;
+    }
+    d->stats.syscalls++;
+
+    uint64_t wire = 0;
+    int err = 0;
+    if (msg->flags & SPM_SYS_MSG_CFG_WRITE) {
+        d->mode = cfg_mode_mask(msg->cfg);
+        d->bits_per_word = msg->cfg->bits_per_word;
+        d->speed_hz = msg->cfg->speed_hz;
+    } else if (msg->flags & SPM_SYS_MSG_CFG_READ) {
+        msg->out_cfg->mode           = (spm_mode_t)(d->mode & (SPI_CPOL | SPI_CPHA));
+        msg->out_cfg->cs_active_high = !!(d->mode & SPI_CS_HIGH);
+        msg->out_cfg->lsb_first      = !!(d->mode & SPI_LSB_FIRST);
+        msg->out_cfg->bits_per_word  = d->bits_per_word;
+        msg->out_cfg->speed_hz       = d->speed_hz;
+    } else if (msg->count > SPM_MAX_BATCH_XFERS) {
+        err = EMSGSIZE;
+    } else if (msg->count > 0) {
+        struct spi_ioc_transfer trs[SPM_MAX_BATCH_XFERS];
+        size_t n = msg->count;
+        for (size_t i = 0; i < n; i++) {
+            const spm_batch_xfer_t *x = &msg->xfers[i];
+            trs[i] = (struct spi_ioc_transfer){
+                .tx_buf        = (uintptr_t)x->tx,
+                .rx_buf        = (uintptr_t)x->rx,
+                .len           = (uint32_t)x->len,
+                .speed_hz      = x->speed_hz ? x->speed_hz : msg->cfg->speed_hz,
+                .bits_per_word = x->bits_per_word ? x->bits_per_word : msg->cfg->bits_per_word,
+                .delay_usecs   = x->delay_usecs,
+                .cs_change     = x->cs_change,
+            };
+        }
+        if (fits_bufsiz(trs, n)) wire = run_message(d, trs, n);
+        else                     err = EMSGSIZE;
+    }
+    if (err) d->stats.errors++;
+    bool realtime = g_sim.timing.realtime;
+    pthread_mutex_unlock(&g_sim.lock);
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    if (realtime && wire) spin_until(now_ns() + wire);
+    return 0;
+}
+
+const spm_sys_ops_t SPM_SYS_SIM = {
+    .open_  = s_open_,
+    .close_ = s_close_,
+    .ioctl_ = s_ioctl_,
+};
+
+const spm_sys_ops_t SPM_SYS_SIM_MSG = {
+    .open_     = s_open_,
+    .close_    = s_close_,
+    .transfer_ = s_transfer_,
+};
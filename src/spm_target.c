@@ -0,0 +1,376 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spm_target.h"
+
+#define SPM_TARGET_DEFAULT_TX_DEPTH  4u
+#define SPM_TARGET_DEFAULT_RX_DEPTH  8u
+#define SPM_TARGET_ERROR_BACKOFF_MS  1
+#define SPM_TARGET_ABORT_RETRY_MS    1
+
+/* Queued response */
+typedef struct {
+    uint8_t   *data;
+    uint64_t   queued_ns;
+} tx_slot_t;
+
+/* Received frame */
+typedef struct {
+    uint8_t             *data;
+    spm_target_frame_t   info;
+} rx_slot_t;
+
+/**
+ * @brief Target-mode endpoint
+ *
+ * Both queues are rings guarded by lock. The thread copies the head
+ * response into armed_tx and only pops it once the host has clocked
+ * it, so an interrupted message does not lose the response.
+ */
+struct spm_target {
+    spm_device_t      *dev;
+    spm_target_cfg_t   cfg;
+
+    tx_slot_t         *tx;
+    size_t             tx_head, tx_count;
+    rx_slot_t         *rx;
+    size_t             rx_head, rx_count;
+    uint8_t           *armed_tx;
+    uint8_t           *armed_rx;
+
+    pthread_t          thread;
+    pthread_mutex_t    lock;
+    pthread_cond_t     cond;       /* queue space, new frames, thread exit */
+    bool               started;    /* thread needs joining */
+    bool               stop;
+    bool               exited;
+
+    uint64_t           seq;
+    uint64_t           start_ns;
+    double             latency_sum_ns;
+    uint64_t           latency_n;
+    double             rearm_sum_ns;
+    uint64_t           rearm_n;
+    spm_target_stats_t stats;
+};
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void deadline_after_ms(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool v_cfg_is_valid(const spm_target_cfg_t *cfg)
+{
+    if (!cfg || cfg->frame_len == 0)            return false;
+    if (cfg->frame_len > UINT32_MAX)            return false;
+    if (cfg->abort_signal < 0 || cfg->abort_signal >= NSIG) return false;
+    return true;
+}
+
+/* Wait on cond for up to timeout_ms (-1 = forever); false on timeout */
+static bool wait_ms(spm_target_t *tgt, int timeout_ms, const struct timespec *deadline)
+{
+    if (timeout_ms == 0) return false;
+    if (timeout_ms < 0) {
+        pthread_cond_wait(&tgt->cond, &tgt->lock);
+        return true;
+    }
+    return pthread_cond_timedwait(&tgt->cond, &tgt->lock, deadline) == 0;
+}
+
+static void on_abort_signal(int sig)
+{
+    (void)sig;
+}
+
+/* Without a handler the abort signal would terminate the process */
+static void install_abort_handler(int sig)
+{
+    struct sigaction old;
+    if (sigaction(sig, NULL, &old) != 0) return;
+    if (old.sa_handler != SIG_DFL && old.sa_handler != SIG_IGN) return;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = on_abort_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(sig, &sa, NULL);   /* no SA_RESTART: the message must return EINTR */
+}
+
+/* ====================================================== */
+/* ==================== Frame Thread ==================== */
+/* ====================================================== */
+
+/* Called with lock held after a completed frame */
+static void complete_frame(spm_target_t *tgt, bool underrun, uint64_t queued_ns, uint64_t done_ns)
+{
+    tgt->stats.frames++;
+    tgt->stats.bytes += tgt->cfg.frame_len;
+
+    if (underrun) {
+        tgt->stats.underruns++;
+    } else {
+        uint64_t lat = done_ns - queued_ns;
+        if (lat > tgt->stats.resp_latency_max_ns) tgt->stats.resp_latency_max_ns = lat;
+        tgt->latency_sum_ns += (double)lat;
+        tgt->latency_n++;
+        tgt->tx_head = (tgt->tx_head + 1) % tgt->cfg.tx_depth;
+        tgt->tx_count--;
+    }
+
+    /* Either way the lost frame leaves a gap in seq */
+    if (tgt->rx_count == tgt->cfg.rx_depth) {
+        tgt->stats.overruns++;
+        if (!tgt->cfg.overwrite) {
+            tgt->seq++;
+            return;
+        }
+        tgt->rx_head = (tgt->rx_head + 1) % tgt->cfg.rx_depth;
+        tgt->rx_count--;
+    }
+
+    rx_slot_t *slot = &tgt->rx[(tgt->rx_head + tgt->rx_count) % tgt->cfg.rx_depth];
+    memcpy(slot->data, tgt->armed_rx, tgt->cfg.frame_len);
+    slot->info = (spm_target_frame_t){ .seq = tgt->seq++, .underrun = underrun, .done_ns = done_ns };
+    tgt->rx_count++;
+}
+
+static void *frame_thread(void *arg)
+{
+    spm_target_t *tgt = arg;
+    const size_t len = tgt->cfg.frame_len;
+    uint64_t last_done = 0;
+
+    pthread_mutex_lock(&tgt->lock);
+    while (!tgt->stop) {
+        /* Arm the oldest response, or fill if the queue ran dry */
+        bool underrun = tgt->tx_count == 0;
+        uint64_t queued_ns = 0;
+        if (underrun) {
+            memset(tgt->armed_tx, tgt->cfg.fill, len);
+        } else {
+            const tx_slot_t *slot = &tgt->tx[tgt->tx_head];
+            memcpy(tgt->armed_tx, slot->data, len);
+            queued_ns = slot->queued_ns;
+        }
+
+        uint64_t armed = now_ns();
+        if (last_done) {
+            uint64_t gap = armed - last_done;
+            if (gap > tgt->stats.rearm_max_ns) tgt->stats.rearm_max_ns = gap;
+            tgt->rearm_sum_ns += (double)gap;
+            tgt->rearm_n++;
+        }
+        pthread_mutex_unlock(&tgt->lock);
+
+        spm_ecode_t rc = spm_transfer(tgt->dev, tgt->armed_tx, tgt->armed_rx, len);
+        uint64_t done = now_ns();
+
+        pthread_mutex_lock(&tgt->lock);
+        if (rc == SPM_OK) {
+            complete_frame(tgt, underrun, queued_ns, done);
+            last_done = done;
+            pthread_cond_broadcast(&tgt->cond);
+        } else if (!tgt->stop && rc != SPM_EAGAIN) {
+            /* EAGAIN is a stray signal: just re-arm */
+            tgt->stats.errors++;
+            last_done = 0;
+            struct timespec ts;
+            deadline_after_ms(&ts, SPM_TARGET_ERROR_BACKOFF_MS);
+            pthread_cond_timedwait(&tgt->cond, &tgt->lock, &ts);
+        }
+    }
+
+    tgt->exited = true;
+    pthread_cond_broadcast(&tgt->cond);
+    pthread_mutex_unlock(&tgt->lock);
+    return NULL;
+}
+
+/* ====================================================== */
+/* ===================== Public API ===================== */
+/* ====================================================== */
+
+spm_ecode_t spm_target_create(spm_device_t *dev, const spm_target_cfg_t *cfg, spm_target_t **out_tgt)
+{
+    if (out_tgt) *out_tgt = NULL;
+    if (!dev || !out_tgt || !v_cfg_is_valid(cfg)) return SPM_EPARAM;
+
+    spm_target_t *tgt = calloc(1, sizeof(*tgt));
+    if (!tgt) return SPM_ENOMEM;
+
+    tgt->dev = dev;
+    tgt->cfg = *cfg;
+    if (!tgt->cfg.tx_depth)     tgt->cfg.tx_depth     = SPM_TARGET_DEFAULT_TX_DEPTH;
+    if (!tgt->cfg.rx_depth)     tgt->cfg.rx_depth     = SPM_TARGET_DEFAULT_RX_DEPTH;
+    if (!tgt->cfg.abort_signal) tgt->cfg.abort_signal = SIGUSR2;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&tgt->lock, NULL);
+    pthread_cond_init(&tgt->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    const size_t len = tgt->cfg.frame_len;
+    tgt->tx       = calloc(tgt->cfg.tx_depth, sizeof(*tgt->tx));
+    tgt->rx       = calloc(tgt->cfg.rx_depth, sizeof(*tgt->rx));
+    tgt->armed_tx = malloc(len);
+    tgt->armed_rx = malloc(len);
+    bool ok = tgt->tx && tgt->rx && tgt->armed_tx && tgt->armed_rx;
+
+    for (size_t i = 0; ok && i < tgt->cfg.tx_depth; i++) ok = (tgt->tx[i].data = malloc(len)) != NULL;
+    for (size_t i = 0; ok && i < tgt->cfg.rx_depth; i++) ok = (tgt->rx[i].data = malloc(len)) != NULL;
+    if (!ok) {
+        spm_target_destroy(tgt);
+        return SPM_ENOMEM;
+    }
+
+    *out_tgt = tgt;
+    return SPM_OK;
+}
+
+void spm_target_destroy(spm_target_t *tgt)
+{
+    if (!tgt) return;
+    spm_target_stop(tgt);
+
+    pthread_cond_destroy(&tgt->cond);
+    pthread_mutex_destroy(&tgt->lock);
+    for (size_t i = 0; tgt->tx && i < tgt->cfg.tx_depth; i++) free(tgt->tx[i].data);
+    for (size_t i = 0; tgt->rx && i < tgt->cfg.rx_depth; i++) free(tgt->rx[i].data);
+    free(tgt->armed_rx);
+    free(tgt->armed_tx);
+    free(tgt->rx);
+    free(tgt->tx);
+    free(tgt);
+}
+
+spm_ecode_t spm_target_start(spm_target_t *tgt)
+{
+    if (!tgt) return SPM_EPARAM;
+    if (tgt->started) return SPM_ESTATE;
+
+    install_abort_handler(tgt->cfg.abort_signal);
+
+    pthread_mutex_lock(&tgt->lock);
+    tgt->stop = false;
+    tgt->exited = false;
+    memset(&tgt->stats, 0, sizeof tgt->stats);
+    tgt->latency_sum_ns = tgt->rearm_sum_ns = 0.0;
+    tgt->latency_n = tgt->rearm_n = 0;
+    tgt->start_ns = now_ns();
+    pthread_mutex_unlock(&tgt->lock);
+
+    if (pthread_create(&tgt->thread, NULL, frame_thread, tgt) != 0) return SPM_ENOMEM;
+    tgt->started = true;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_target_stop(spm_target_t *tgt)
+{
+    if (!tgt) return SPM_EPARAM;
+    if (!tgt->started) return SPM_OK;
+
+    /* The signal may land before the message is armed, so repeat it */
+    pthread_mutex_lock(&tgt->lock);
+    tgt->stop = true;
+    pthread_cond_broadcast(&tgt->cond);
+    while (!tgt->exited) {
+        pthread_kill(tgt->thread, tgt->cfg.abort_signal);
+        struct timespec ts;
+        deadline_after_ms(&ts, SPM_TARGET_ABORT_RETRY_MS);
+        pthread_cond_timedwait(&tgt->cond, &tgt->lock, &ts);
+    }
+    pthread_mutex_unlock(&tgt->lock);
+
+    pthread_join(tgt->thread, NULL);
+    tgt->started = false;
+    return SPM_OK;
+}
+
+spm_ecode_t spm_target_send(spm_target_t *tgt, const void *data, size_t len, int timeout_ms)
+{
+    if (!tgt || (len && !data) || len > tgt->cfg.frame_len) return SPM_EPARAM;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) deadline_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&tgt->lock);
+    while (tgt->tx_count == tgt->cfg.tx_depth) {
+        if (!wait_ms(tgt, timeout_ms, &deadline) && tgt->tx_count == tgt->cfg.tx_depth) {
+            pthread_mutex_unlock(&tgt->lock);
+            return SPM_ETIMEOUT;
+        }
+    }
+
+    tx_slot_t *slot = &tgt->tx[(tgt->tx_head + tgt->tx_count) % tgt->cfg.tx_depth];
+    if (len) memcpy(slot->data, data, len);
+    memset(slot->data + len, tgt->cfg.fill, tgt->cfg.frame_len - len);
+    slot->queued_ns = now_ns();
+    tgt->tx_count++;
+    pthread_mutex_unlock(&tgt->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_target_recv(spm_target_t *tgt, void *out, size_t cap, spm_target_frame_t *out_frame, int timeout_ms)
+{
+    if (!tgt || !out || cap < tgt->cfg.frame_len) return SPM_EPARAM;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) deadline_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&tgt->lock);
+    while (tgt->rx_count == 0) {
+        if (!wait_ms(tgt, timeout_ms, &deadline) && tgt->rx_count == 0) {
+            pthread_mutex_unlock(&tgt->lock);
+            return SPM_ETIMEOUT;
+        }
+    }
+
+    rx_slot_t *slot = &tgt->rx[tgt->rx_head];
+    memcpy(out, slot->data, tgt->cfg.frame_len);
+    if (out_frame) *out_frame = slot->info;
+    tgt->rx_head = (tgt->rx_head + 1) % tgt->cfg.rx_depth;
+    tgt->rx_count--;
+    pthread_mutex_unlock(&tgt->lock);
+    return SPM_OK;
+}
+
+spm_ecode_t spm_target_get_stats(spm_target_t *tgt, spm_target_stats_t *out_stats)
+{
+    if (!tgt || !out_stats) return SPM_EPARAM;
+
+    pthread_mutex_lock(&tgt->lock);
+    *out_stats = tgt->stats;
+    out_stats->resp_latency_avg_ns = tgt->latency_n ? tgt->latency_sum_ns / (double)tgt->latency_n : 0.0;
+    out_stats->rearm_avg_ns = tgt->rearm_n ? tgt->rearm_sum_ns / (double)tgt->rearm_n : 0.0;
+
+    double secs = tgt->start_ns ? (double)(now_ns() - tgt->start_ns) / 1e9 : 0.0;
+    if (secs > 0.0) {
+        out_stats->frames_per_s = (double)tgt->stats.frames / secs;
+        out_stats->kbps = (double)tgt->stats.bytes / 1024.0 / secs;
+    }
+    pthread_mutex_unlock(&tgt->lock);
+    return SPM_OK;
+}
@@ -6,20 +6,37 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
+#include <linux/spi/spidev.h>
 #include "spm_sys.h"
 
 typedef struct spm_sys_fake_ioctl_stats {
     uint64_t total, rd, wr, msg, fail;
+    uint64_t native;    /* calls that arrived through transfer_ */
 } spm_sys_fake_ioctl_stats;
 
+/* Peripheral model: sees every SPI_IOC_MESSAGE, may fill rx buffers */
+typedef void (*spm_sys_fake_xfer_fn)(const struct spi_ioc_transfer *trs, size_t n, void *ctx);
+
 extern const spm_sys_ops_t SPM_SYS_F_DEFAULT;
+extern const spm_sys_ops_t SPM_SYS_F_MSG;      /* message-level, no ioctl_ */
 
 /* State mgmt */
 void spm_sys_fake_reset(void);
 void spm_sys_fake_reset_ioctl_stats(void);
 spm_sys_fake_ioctl_stats spm_sys_fake_get_ioctl_stats(void);
 void spm_sys_fake_set_defaults(uint32_t mode, uint8_t bpw, uint32_t max_hz);
+void spm_sys_fake_set_xfer_handler(spm_sys_fake_xfer_fn fn, void *ctx);
+
+/*
+ * Target mode: data messages block until the simulated host clocks
+ * them (or a signal interrupts the wait: EINTR, as on a Linux target
+ * controller). host_xfer swaps len bytes with the armed message and
+ * returns -1/ETIMEDOUT if nothing was armed within timeout_ms.
+ */
+void spm_sys_fake_set_target_mode(bool on);
+int spm_sys_fake_host_xfer(const void *tx, void *rx, size_t len, int timeout_ms);
 
 /* Fail injection */
 void spm_sys_fake_fail_open(void);                  /* compatibility */
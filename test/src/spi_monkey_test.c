@@ -3,8 +3,10 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "spi_monkey.h"
+#include "spm_sim.h"
 #include "spm_sys_fake.h"
 
 #define TEST_COL 60
@@ -1079,6 +1081,880 @@ static void batch_transfer_fails_invalid_params(void)
     TEST_PASS();
 }
 
+/* ====================================================== */
+/* ===================== Validation ===================== */
+/* ====================================================== */
+
+static void set_validation_fails_invalid_input(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+
+    spm_validation_t level;
+    rc = spm_dev_get_validation(dev, &level);
+    assert(rc == SPM_OK);
+    assert(level == SPM_VALIDATE_FULL);
+
+    rc = spm_dev_set_validation(NULL, SPM_VALIDATE_NONE);
+    assert(rc == SPM_ESTATE);
+
+    rc = spm_dev_set_validation(dev, (spm_validation_t)3);
+    assert(rc == SPM_EPARAM);
+
+    rc = spm_dev_get_validation(dev, NULL);
+    assert(rc == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void validation_none_skips_param_checks(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+
+    rc = spm_dev_set_validation(dev, SPM_VALIDATE_NONE);
+    assert(rc == SPM_OK);
+
+    /* Fake ignores buffers, so the unchecked call reaches the driver */
+    spm_sys_fake_reset_ioctl_stats();
+    rc = spm_transfer(dev, NULL, NULL, 1);
+    assert(rc == SPM_OK);
+
+    struct spm_sys_fake_ioctl_stats s = spm_sys_fake_get_ioctl_stats();
+    assert(s.msg == 1);
+
+    /* NULL handles are rejected at every level */
+    rc = spm_transfer(NULL, (void*)1, NULL, 1);
+    assert(rc == SPM_ESTATE);
+
+    rc = spm_dev_set_validation(dev, SPM_VALIDATE_FULL);
+    assert(rc == SPM_OK);
+    rc = spm_transfer(dev, NULL, NULL, 1);
+    assert(rc == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void unchecked_transfers_succeed(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+
+    uint8_t tx[4] = {0x01, 0x02, 0x03, 0x04};
+    uint8_t rx[4] = {0};
+    spm_batch_xfer_t xfers[] = {
+        { .tx = tx, .rx = NULL, .len = 1 },
+        { .tx = NULL, .rx = rx, .len = sizeof(rx) },
+    };
+
+    spm_sys_fake_reset_ioctl_stats();
+    assert(spm_transfer_unchecked(dev, tx, rx, sizeof(tx)) == SPM_OK);
+    assert(spm_write_unchecked(dev, tx, sizeof(tx)) == SPM_OK);
+    assert(spm_read_unchecked(dev, rx, sizeof(rx)) == SPM_OK);
+    assert(spm_batch_unchecked(dev, xfers, 2) == SPM_OK);
+
+    struct spm_sys_fake_ioctl_stats s = spm_sys_fake_get_ioctl_stats();
+    assert(s.total == 4);
+    assert(s.fail == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ===================== Cfg Policy ===================== */
+/* ====================================================== */
+
+static void per_transfer_policy_skips_speed_bpw_ioctls(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+
+    rc = spm_dev_set_cfg_policy(dev, SPM_CFG_PER_TRANSFER);
+    assert(rc == SPM_OK);
+
+    spm_sys_fake_reset_ioctl_stats();
+    assert(spm_dev_set_speed(dev, 8000000) == SPM_OK);
+    assert(spm_dev_set_bpw(dev, 16) == SPM_OK);
+
+    struct spm_sys_fake_ioctl_stats s = spm_sys_fake_get_ioctl_stats();
+    assert(s.total == 0);
+
+    /* Mode bits still reach the driver */
+    assert(spm_dev_set_mode(dev, SPM_MODE3) == SPM_OK);
+    s = spm_sys_fake_get_ioctl_stats();
+    assert(s.wr == 1);
+    assert(s.rd == 1);
+
+    spm_cfg_t cfg;
+    assert(spm_dev_get_cfg(dev, &cfg) == SPM_OK);
+    assert(cfg.speed_hz == 8000000);
+    assert(cfg.bits_per_word == 16);
+    assert(cfg.mode == SPM_MODE3);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void driver_policy_restores_driver_state(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+
+    assert(spm_dev_set_cfg_policy(NULL, SPM_CFG_DRIVER) == SPM_ESTATE);
+    assert(spm_dev_set_cfg_policy(dev, (spm_cfg_policy_t)7) == SPM_EPARAM);
+
+    assert(spm_dev_set_cfg_policy(dev, SPM_CFG_PER_TRANSFER) == SPM_OK);
+    assert(spm_dev_set_speed(dev, 2000000) == SPM_OK);
+    assert(spm_dev_set_cfg_policy(dev, SPM_CFG_DRIVER) == SPM_OK);
+
+    spm_cfg_policy_t policy;
+    assert(spm_dev_get_cfg_policy(dev, &policy) == SPM_OK);
+    assert(policy == SPM_CFG_DRIVER);
+
+    spm_cfg_t cfg;
+    assert(spm_dev_get_cfg(dev, &cfg) == SPM_OK);
+    assert(cfg.speed_hz == 2000000);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ================= Message-Level Backend ============== */
+/* ====================================================== */
+
+static void msg_backend_receives_transfers_natively(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_MSG, &dev);
+    assert(rc == SPM_OK);
+
+    struct spm_sys_fake_ioctl_stats s = spm_sys_fake_get_ioctl_stats();
+    assert(s.native == s.total);
+    assert(s.wr == 1);
+    assert(s.rd == 1);
+
+    uint8_t tx[3] = {1, 2, 3};
+    uint8_t rx[3];
+    spm_batch_xfer_t xfers[] = {
+        { .tx = tx, .len = 1 },
+        { .rx = rx, .len = 3 },
+    };
+
+    spm_sys_fake_reset_ioctl_stats();
+    assert(spm_transfer(dev, tx, rx, 3) == SPM_OK);
+    assert(spm_batch(dev, xfers, 2) == SPM_OK);
+
+    s = spm_sys_fake_get_ioctl_stats();
+    assert(s.total == 2);
+    assert(s.native == 2);
+    assert(s.msg == 3);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void msg_backend_applies_and_reads_config(void)
+{
+    spm_sys_fake_reset();
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_MSG, &dev);
+    assert(rc == SPM_OK);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE2, .speed_hz = 3000000, .bits_per_word = 16 };
+    assert(spm_dev_set_cfg(dev, &cfg) == SPM_OK);
+
+    spm_cfg_t out;
+    assert(spm_dev_get_cfg(dev, &out) == SPM_OK);
+    assert(out.mode == SPM_MODE2);
+    assert(out.speed_hz == 3000000);
+    assert(out.bits_per_word == 16);
+
+    /* Per-transfer policy: mode changes only */
+    assert(spm_dev_set_cfg_policy(dev, SPM_CFG_PER_TRANSFER) == SPM_OK);
+    spm_sys_fake_reset_ioctl_stats();
+    assert(spm_dev_set_speed(dev, 1000000) == SPM_OK);
+    assert(spm_sys_fake_get_ioctl_stats().total == 0);
+
+    spm_sys_fake_fail_ioctl();
+    assert(spm_transfer(dev, &out, NULL, 1) != SPM_OK);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ================== Write Combining =================== */
+/* ====================================================== */
+
+typedef struct {
+    unsigned messages;
+    unsigned xfers;
+    uint8_t  first_byte[16];
+    uint8_t  cs_change[16];
+} wc_log_t;
+
+static wc_log_t g_wc_log;
+
+static void wc_log_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    wc_log_t *log = ctx;
+    log->messages++;
+    for (size_t i = 0; i < n; i++, log->xfers++) {
+        if (log->xfers >= 16) continue;
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        log->first_byte[log->xfers] = tx ? tx[0] : 0;
+        log->cs_change[log->xfers] = trs[i].cs_change;
+    }
+}
+
+static spm_device_t *open_wc_dev(const spm_wc_cfg_t *cfg)
+{
+    spm_sys_fake_reset();
+    memset(&g_wc_log, 0, sizeof g_wc_log);
+
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    assert(spm_dev_set_write_combining(dev, cfg) == SPM_OK);
+    spm_sys_fake_set_xfer_handler(wc_log_xfer, &g_wc_log);
+    return dev;
+}
+
+static void write_combining_fails_invalid_input(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = SPM_MAX_BATCH_XFERS + 1 };
+    assert(spm_dev_set_write_combining(NULL, &cfg) == SPM_ESTATE);
+    assert(spm_dev_flush(NULL) == SPM_ESTATE);
+
+    spm_device_t *dev = open_wc_dev(NULL);
+    assert(spm_dev_set_write_combining(dev, &cfg) == SPM_EPARAM);
+    assert(spm_dev_get_wc_stats(dev, NULL) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_combining_flushes_before_read(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = 8 };
+    spm_device_t *dev = open_wc_dev(&cfg);
+
+    for (uint8_t i = 0; i < 5; i++) {
+        uint8_t buf[2] = { i, 0xEE };
+        assert(spm_write(dev, buf, sizeof buf) == SPM_OK);
+    }
+    assert(g_wc_log.messages == 0);
+
+    uint8_t rx[2];
+    assert(spm_read(dev, rx, sizeof rx) == SPM_OK);
+    assert(g_wc_log.messages == 2);
+    assert(g_wc_log.xfers == 6);
+
+    /* Order kept, CS released between the combined writes */
+    for (unsigned i = 0; i < 5; i++) {
+        assert(g_wc_log.first_byte[i] == i);
+        assert(g_wc_log.cs_change[i] == (i < 4));
+    }
+
+    spm_wc_stats_t st;
+    assert(spm_dev_get_wc_stats(dev, &st) == SPM_OK);
+    assert(st.writes == 5);
+    assert(st.flushes == 1);
+    assert(st.avg_combine == 5.0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_combining_flushes_on_limits(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = 4, .max_bytes = 64 };
+    spm_device_t *dev = open_wc_dev(&cfg);
+
+    uint8_t buf[40] = {0};
+    for (int i = 0; i < 10; i++) assert(spm_write(dev, buf, 1) == SPM_OK);
+    assert(g_wc_log.messages == 2);
+
+    /* Byte limit: 2 + 40 fits, the next 40 does not */
+    assert(spm_dev_flush(dev) == SPM_OK);
+    assert(g_wc_log.messages == 3);
+    assert(spm_write(dev, buf, 40) == SPM_OK);
+    assert(spm_write(dev, buf, 40) == SPM_OK);
+    assert(g_wc_log.messages == 4);
+
+    /* Oversized writes bypass the buffer in order */
+    uint8_t big[100] = {0};
+    assert(spm_write(dev, big, sizeof big) == SPM_OK);
+    assert(g_wc_log.messages == 6);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_combining_time_bound_flushes(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = 64, .max_delay_us = 2000 };
+    spm_device_t *dev = open_wc_dev(&cfg);
+
+    uint8_t b = 0x42;
+    assert(spm_write(dev, &b, 1) == SPM_OK);
+
+    spm_wc_stats_t st = {0};
+    for (int i = 0; i < 200 && st.flushes == 0; i++) {
+        usleep(1000);
+        assert(spm_dev_get_wc_stats(dev, &st) == SPM_OK);
+    }
+    assert(st.flushes == 1);
+    assert(st.timed_flushes == 1);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_combining_reports_deferred_error(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = 8 };
+    spm_device_t *dev = open_wc_dev(&cfg);
+
+    spm_sys_fake_fail_ioctl();
+    uint8_t b = 0;
+    assert(spm_write(dev, &b, 1) == SPM_OK);
+    assert(spm_dev_flush(dev) != SPM_OK);
+    assert(spm_dev_flush(dev) == SPM_OK);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ==================== Interceptors ==================== */
+/* ====================================================== */
+
+typedef struct {
+    char         trace[32];
+    size_t       n;
+    spm_hook_op_t last_op;
+    size_t       last_count;
+    uint32_t     last_cfg_hz;
+    spm_ecode_t  pre_rc;
+    spm_ecode_t  post_seen;
+} hook_log_t;
+
+static void hook_mark(hook_log_t *log, char c)
+{
+    if (log->n + 1 < sizeof log->trace) log->trace[log->n++] = c;
+}
+
+static spm_ecode_t hook_pre_a(spm_device_t *dev, const spm_hook_call_t *call, void *ctx)
+{
+    (void)dev;
+    hook_log_t *log = ctx;
+    hook_mark(log, 'a');
+    log->last_op = call->op;
+    log->last_count = call->count;
+    return log->pre_rc;
+}
+
+static spm_ecode_t hook_post_a(spm_device_t *dev, const spm_hook_call_t *call, spm_ecode_t rc, void *ctx)
+{
+    (void)dev;
+    hook_log_t *log = ctx;
+    hook_mark(log, 'A');
+    log->post_seen = rc;
+    if (call->op == SPM_HOOK_CONFIG) log->last_cfg_hz = call->cfg->speed_hz;
+    return rc;
+}
+
+static spm_ecode_t hook_pre_b(spm_device_t *dev, const spm_hook_call_t *call, void *ctx)
+{
+    (void)dev; (void)call;
+    hook_mark(ctx, 'b');
+    return SPM_OK;
+}
+
+/* Checksum check: last rx byte must be the XOR of the others */
+static spm_ecode_t hook_post_xor(spm_device_t *dev, const spm_hook_call_t *call, spm_ecode_t rc, void *ctx)
+{
+    (void)dev;
+    hook_mark(ctx, 'B');
+    if (rc != SPM_OK || call->op == SPM_HOOK_CONFIG) return rc;
+
+    const spm_batch_xfer_t *x = &call->xfers[call->count - 1];
+    const uint8_t *rx = x->rx;
+    if (!rx) return rc;
+
+    uint8_t sum = 0;
+    for (size_t i = 0; i + 1 < x->len; i++) sum ^= rx[i];
+    return sum == rx[x->len - 1] ? rc : SPM_ECRC;
+}
+
+static void hook_loopback(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    for (size_t i = 0; i < n; i++) {
+        if (trs[i].tx_buf && trs[i].rx_buf) {
+            memcpy((void *)(uintptr_t)trs[i].rx_buf, (const void *)(uintptr_t)trs[i].tx_buf, trs[i].len);
+        }
+    }
+}
+
+static spm_device_t *open_hook_dev(void)
+{
+    spm_sys_fake_reset();
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    spm_sys_fake_set_xfer_handler(hook_loopback, NULL);
+    return dev;
+}
+
+static void hooks_fail_invalid_input(void)
+{
+    spm_device_t *dev = open_hook_dev();
+    hook_log_t log = {0};
+    spm_hook_t a = { .pre = hook_pre_a, .ctx = &log };
+
+    assert(spm_dev_add_hook(NULL, &a) == SPM_ESTATE);
+    assert(spm_dev_add_hook(dev, NULL) == SPM_EPARAM);
+    assert(spm_dev_add_hook(dev, &(spm_hook_t){ .ctx = &log }) == SPM_EPARAM);
+    assert(spm_dev_remove_hook(dev, &a) == SPM_EPARAM);
+
+    assert(spm_dev_add_hook(dev, &a) == SPM_OK);
+    assert(spm_dev_add_hook(dev, &a) == SPM_ESTATE);
+
+    hook_log_t more[SPM_MAX_HOOKS];
+    for (int i = 0; i < SPM_MAX_HOOKS - 1; i++) {
+        assert(spm_dev_add_hook(dev, &(spm_hook_t){ .pre = hook_pre_a, .ctx = &more[i] }) == SPM_OK);
+    }
+    assert(spm_dev_add_hook(dev, &(spm_hook_t){ .pre = hook_pre_a, .ctx = &more[SPM_MAX_HOOKS - 1] }) == SPM_ENOMEM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void hooks_wrap_transfers_in_order(void)
+{
+    spm_device_t *dev = open_hook_dev();
+    hook_log_t log = {0};
+    spm_hook_t a = { .pre = hook_pre_a, .post = hook_post_a, .ctx = &log };
+    spm_hook_t b = { .pre = hook_pre_b, .post = hook_post_xor, .ctx = &log };
+    assert(spm_dev_add_hook(dev, &a) == SPM_OK);
+    assert(spm_dev_add_hook(dev, &b) == SPM_OK);
+
+    uint8_t tx[4] = { 0x01, 0x02, 0x04, 0x07 }, rx[4];
+    uint64_t before = spm_sys_fake_get_ioctl_stats().msg;
+    assert(spm_transfer(dev, tx, rx, sizeof tx) == SPM_OK);
+    assert(spm_sys_fake_get_ioctl_stats().msg == before + 1);
+    assert(strcmp(log.trace, "abBA") == 0);
+    assert(log.last_op == SPM_HOOK_TRANSFER && log.last_count == 1);
+
+    /* Bad checksum surfaces as the call's result */
+    tx[3] = 0x00;
+    assert(spm_transfer(dev, tx, rx, sizeof tx) == SPM_ECRC);
+    assert(log.post_seen == SPM_ECRC);
+
+    spm_batch_xfer_t x[2] = { { .tx = tx, .len = 1 }, { .tx = tx, .rx = rx, .len = 4 } };
+    tx[3] = 0x07;
+    assert(spm_batch(dev, x, 2) == SPM_OK);
+    assert(log.last_op == SPM_HOOK_BATCH && log.last_count == 2);
+
+    /* Removing the last hook restores the plain path */
+    assert(spm_dev_remove_hook(dev, &a) == SPM_OK);
+    assert(spm_dev_remove_hook(dev, &b) == SPM_OK);
+    log.n = 0;
+    memset(log.trace, 0, sizeof log.trace);
+    assert(spm_transfer(dev, tx, rx, sizeof tx) == SPM_OK);
+    assert(log.n == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void hooks_pre_error_skips_operation(void)
+{
+    spm_device_t *dev = open_hook_dev();
+    hook_log_t log = { .pre_rc = SPM_EIO };
+    spm_hook_t b = { .pre = hook_pre_b, .post = hook_post_xor, .ctx = &log };
+    spm_hook_t a = { .pre = hook_pre_a, .post = hook_post_a, .ctx = &log };
+    assert(spm_dev_add_hook(dev, &b) == SPM_OK);
+    assert(spm_dev_add_hook(dev, &a) == SPM_OK);
+
+    uint8_t tx[2] = {0};
+    uint64_t before = spm_sys_fake_get_ioctl_stats().msg;
+    assert(spm_write(dev, tx, sizeof tx) == SPM_EIO);
+    assert(spm_sys_fake_get_ioctl_stats().msg == before);
+
+    /* Only hooks that let the call through see post */
+    assert(strcmp(log.trace, "baB") == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void hooks_see_config_writes(void)
+{
+    spm_device_t *dev = open_hook_dev();
+    hook_log_t log = {0};
+    spm_hook_t a = { .pre = hook_pre_a, .post = hook_post_a, .ctx = &log };
+    assert(spm_dev_add_hook(dev, &a) == SPM_OK);
+
+    assert(spm_dev_set_speed(dev, 2000000) == SPM_OK);
+    assert(log.last_op == SPM_HOOK_CONFIG && log.last_count == 0);
+    assert(log.last_cfg_hz == 2000000);
+    assert(strcmp(log.trace, "aA") == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void hooks_see_write_combining_flushes(void)
+{
+    spm_wc_cfg_t cfg = { .max_xfers = 8 };
+    spm_device_t *dev = open_wc_dev(&cfg);
+    hook_log_t log = {0};
+    spm_hook_t a = { .pre = hook_pre_a, .post = hook_post_a, .ctx = &log };
+    assert(spm_dev_add_hook(dev, &a) == SPM_OK);
+
+    uint8_t b = 0x5A;
+    for (int i = 0; i < 3; i++) assert(spm_write(dev, &b, 1) == SPM_OK);
+    assert(log.n == 0);
+
+    assert(spm_dev_flush(dev) == SPM_OK);
+    assert(log.last_op == SPM_HOOK_BATCH && log.last_count == 3);
+    assert(strcmp(log.trace, "aA") == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =================== Tag Accounting =================== */
+/* ====================================================== */
+
+static spm_device_t *open_tagged_dev(void)
+{
+    spm_sys_fake_reset();
+    memset(&g_wc_log, 0, sizeof g_wc_log);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 1000000, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    spm_sys_fake_set_xfer_handler(wc_log_xfer, &g_wc_log);
+    return dev;
+}
+
+static void tag_accounting_fails_invalid_input(void)
+{
+    spm_tag_stats_t st[4];
+    size_t n = 0;
+    uint8_t tag = 0xFF, b = 0;
+    assert(spm_dev_set_tag_accounting(NULL, true) == SPM_ESTATE);
+    assert(spm_dev_set_tag(NULL, 1) == SPM_ESTATE);
+    assert(spm_dev_get_tag_stats(NULL, st, 4, &n) == SPM_ESTATE);
+    assert(spm_transfer_tagged(NULL, 1, &b, NULL, 1) == SPM_ESTATE);
+
+    spm_device_t *dev = open_tagged_dev();
+    assert(spm_dev_get_tag(dev, &tag) == SPM_OK && tag == 0);
+    assert(spm_dev_set_tag(dev, SPM_MAX_TAGS) == SPM_EPARAM);
+    assert(spm_transfer_tagged(dev, SPM_MAX_TAGS, &b, NULL, 1) == SPM_EPARAM);
+    spm_batch_xfer_t x = { .tx = &b, .len = 1 };
+    assert(spm_batch_tagged(dev, SPM_MAX_TAGS, &x, 1) == SPM_EPARAM);
+    assert(g_wc_log.messages == 0);
+
+    /* off until enabled */
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_ESTATE && n == 0);
+    assert(spm_dev_reset_tag_stats(dev) == SPM_ESTATE);
+    assert(spm_dev_set_tag_accounting(dev, true) == SPM_OK);
+    assert(spm_dev_get_tag_stats(dev, NULL, 4, &n) == SPM_EPARAM);
+    assert(spm_dev_get_tag_stats(dev, st, 4, NULL) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void tag_accounting_attributes_messages(void)
+{
+    spm_device_t *dev = open_tagged_dev();
+    spm_cfg_t cfg;
+    assert(spm_dev_get_cfg(dev, &cfg) == SPM_OK);
+    const uint64_t hz = cfg.speed_hz;
+    assert(spm_dev_set_tag_accounting(dev, true) == SPM_OK);
+
+    uint8_t tx[100] = {0}, rx[100];
+    assert(spm_write(dev, tx, 100) == SPM_OK);                 /* device tag 0 */
+    assert(spm_dev_set_tag(dev, 3) == SPM_OK);
+    assert(spm_read(dev, rx, 50) == SPM_OK);                    /* device tag 3 */
+    assert(spm_transfer_tagged(dev, 7, tx, rx, 10) == SPM_OK);  /* explicit */
+    spm_batch_xfer_t x[2] = {
+        { .tx = tx, .len = 10, .delay_usecs = 5 },
+        { .rx = rx, .len = 20 },
+    };
+    assert(spm_batch_tagged(dev, 7, x, 2) == SPM_OK);
+    assert(spm_batch(dev, x, 2) == SPM_OK);                     /* device tag 3 */
+    assert(g_wc_log.messages == 5);
+
+    spm_tag_stats_t st[4];
+    size_t n = 0;
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_OK);
+    assert(n == 3);
+    assert(st[0].tag == 0 && st[1].tag == 3 && st[2].tag == 7);
+
+    assert(st[0].messages == 1 && st[0].xfers == 1 && st[0].bytes == 100);
+    assert(st[0].wire_ns == (100 * 8 * 1000000000ull + hz - 1) / hz);
+    assert(st[1].messages == 2 && st[1].xfers == 3 && st[1].bytes == 80);
+    assert(st[2].messages == 2 && st[2].xfers == 3 && st[2].bytes == 40);
+    assert(st[2].wire_ns == 2 * ((10 * 8 * 1000000000ull + hz - 1) / hz)
+                            + (20 * 8 * 1000000000ull + hz - 1) / hz + 5000);
+
+    double share = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        assert(st[i].errors == 0);
+        assert(st[i].ioctl_ns >= st[i].ioctl_max_ns);
+        share += st[i].wire_share;
+    }
+    assert(share > 0.999 && share < 1.001);
+    assert(st[0].wire_share > st[2].wire_share);
+
+    /* failures still count, short output says how many there are */
+    spm_sys_fake_fail_ioctl();
+    assert(spm_transfer_tagged(dev, 9, tx, NULL, 4) != SPM_OK);
+    assert(spm_dev_get_tag_stats(dev, st, 2, &n) == SPM_ENOMEM);
+    assert(n == 4 && st[1].tag == 3);
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_OK);
+    assert(st[3].tag == 9 && st[3].messages == 1 && st[3].errors == 1);
+
+    assert(spm_dev_reset_tag_stats(dev) == SPM_OK);
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_OK && n == 0);
+    assert(spm_dev_set_tag_accounting(dev, false) == SPM_OK);
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_ESTATE);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void tag_accounting_splits_combined_writes(void)
+{
+    spm_device_t *dev = open_tagged_dev();
+    spm_wc_cfg_t wc = { .max_xfers = 16 };
+    assert(spm_dev_set_write_combining(dev, &wc) == SPM_OK);
+    assert(spm_dev_set_tag_accounting(dev, true) == SPM_OK);
+
+    uint8_t b[4] = { 1, 2, 3, 4 };
+    assert(spm_transfer_tagged(dev, 1, &b[0], NULL, 1) == SPM_OK);
+    assert(spm_transfer_tagged(dev, 1, &b[1], NULL, 1) == SPM_OK);
+    assert(g_wc_log.messages == 0);
+    assert(spm_transfer_tagged(dev, 2, &b[2], NULL, 2) == SPM_OK);  /* new owner: flush */
+    assert(g_wc_log.messages == 1);
+    assert(spm_dev_flush(dev) == SPM_OK);
+    assert(g_wc_log.messages == 2);
+
+    spm_tag_stats_t st[4];
+    size_t n = 0;
+    assert(spm_dev_get_tag_stats(dev, st, 4, &n) == SPM_OK);
+    assert(n == 2);
+    assert(st[0].tag == 1 && st[0].messages == 1 && st[0].xfers == 2 && st[0].bytes == 2);
+    assert(st[1].tag == 2 && st[1].messages == 1 && st[1].xfers == 1 && st[1].bytes == 2);
+
+    /* without accounting tags do not split batches */
+    assert(spm_dev_set_tag_accounting(dev, false) == SPM_OK);
+    assert(spm_transfer_tagged(dev, 1, &b[0], NULL, 1) == SPM_OK);
+    assert(spm_transfer_tagged(dev, 2, &b[1], NULL, 1) == SPM_OK);
+    assert(spm_dev_flush(dev) == SPM_OK);
+    assert(g_wc_log.messages == 3);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ===================== Bulk Open ====================== */
+/* ====================================================== */
+
+static void bulk_open_fails_invalid_input(void)
+{
+    spm_open_entry_t e = {0};
+    assert(spm_dev_open_bulk(NULL, 1, NULL, 0, NULL) == SPM_EPARAM);
+    assert(spm_dev_open_bulk(&e, 0, NULL, 0, NULL) == SPM_EPARAM);
+    assert(spm_dev_open_bulk(&e, 1, &(spm_sys_ops_t){0}, 0, NULL) == SPM_EPARAM);
+    TEST_PASS();
+}
+
+static void bulk_open_opens_across_buses(void)
+{
+    /* Thread-safe simulator: 3 buses x 4 chip-selects, bus 2 cs 3 missing */
+    spm_sim_reset();
+    char path[32];
+    for (int bus = 0; bus < 3; bus++) {
+        for (int cs = 0; cs < 4; cs++) {
+            if (bus == 2 && cs == 3) continue;
+            snprintf(path, sizeof path, "/dev/spidev%d.%d", bus, cs);
+            assert(spm_sim_add(path, 0, NULL, NULL) == SPM_OK);
+        }
+    }
+
+    spm_cfg_t cfg = { .mode = SPM_MODE2, .speed_hz = 1000000, .bits_per_word = 8 };
+    spm_open_entry_t e[12];
+    for (int i = 0; i < 12; i++) {
+        e[i] = (spm_open_entry_t){ .bus = (uint8_t)(i % 3), .cs = (uint8_t)(i / 3), .cfg = &cfg };
+    }
+
+    spm_open_report_t r;
+    assert(spm_dev_open_bulk(e, 12, &SPM_SYS_SIM, 0, &r) == SPM_ENODEV);
+    assert(r.buses == 3 && r.threads == 3);
+    assert(r.opened == 11 && r.failed == 1);
+    assert(r.total_ns > 0);
+
+    for (int i = 0; i < 12; i++) {
+        if (e[i].bus == 2 && e[i].cs == 3) {
+            assert(e[i].rc == SPM_ENODEV && e[i].dev == NULL);
+            continue;
+        }
+        assert(e[i].rc == SPM_OK && e[i].dev);
+
+        char want[32], got[32];
+        snprintf(want, sizeof want, "/dev/spidev%u.%u", e[i].bus, e[i].cs);
+        assert(spm_dev_get_path(e[i].dev, got, sizeof got) == SPM_OK);
+        assert(strcmp(want, got) == 0);
+
+        spm_cfg_t out;
+        assert(spm_dev_get_cfg(e[i].dev, &out) == SPM_OK);
+        assert(out.mode == SPM_MODE2 && out.speed_hz == 1000000);
+        spm_dev_close(e[i].dev);
+    }
+
+    /* Capped to one worker: everything runs inline */
+    assert(spm_dev_open_bulk(e, 3, &SPM_SYS_SIM, 1, &r) == SPM_OK);
+    assert(r.threads == 1 && r.opened == 3);
+    for (int i = 0; i < 3; i++) spm_dev_close(e[i].dev);
+
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ==================== Memory Reads ==================== */
+/* ====================================================== */
+
+/* Memory with byte(a) = a ^ 0x5A, 3-byte READ; tracks spidev's bufsiz sums */
+typedef struct {
+    unsigned  msgs;
+    unsigned  frames;
+    size_t    max_tx;
+    size_t    max_rx;
+    unsigned  bad;
+} mem_log_t;
+
+static mem_log_t g_mem;
+
+static size_t aligned(size_t len)
+{
+    return (len + SPM_BUFSIZ_ALIGN - 1) / SPM_BUFSIZ_ALIGN * SPM_BUFSIZ_ALIGN;
+}
+
+static void mem_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    size_t tx = 0, rx = 0, pos = 0;
+    uint32_t addr = 0;
+    g_mem.msgs++;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *t = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        uint8_t *r = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        if (t) tx += aligned(trs[i].len);
+        if (r) rx += aligned(trs[i].len);
+        for (uint32_t k = 0; k < trs[i].len; k++, pos++) {
+            if (pos == 0 && (!t || t[k] != 0x03)) g_mem.bad++;
+            else if (pos >= 1 && pos <= 3) addr = addr << 8 | t[k];
+            else if (pos >= 4 && r) r[k] = (uint8_t)((addr + pos - 4) ^ 0x5A);
+        }
+        if (trs[i].cs_change || i + 1 == n) {
+            g_mem.frames++;
+            pos = 0;
+            addr = 0;
+        }
+    }
+    if (tx > g_mem.max_tx) g_mem.max_tx = tx;
+    if (rx > g_mem.max_rx) g_mem.max_rx = rx;
+}
+
+static void mem_read_fails_invalid_input(void)
+{
+    spm_sys_fake_reset();
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+
+    uint8_t buf[4];
+    spm_mem_range_t ok = { 0, buf, sizeof buf };
+    assert(spm_mem_read(dev, NULL, NULL, 1, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, NULL, &ok, 0, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, NULL, &(spm_mem_range_t){ 0, NULL, 4 }, 1, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, NULL, &(spm_mem_range_t){ 0, buf, 0 }, 1, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, &(spm_mem_cfg_t){ .addr_bytes = 5 }, &ok, 1, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, &(spm_mem_cfg_t){ .dummy_bytes = SPM_MEM_MAX_DUMMY + 1 }, &ok, 1, NULL) == SPM_EPARAM);
+    assert(spm_mem_read(dev, &(spm_mem_cfg_t){ .bufsiz = SPM_BUFSIZ_ALIGN - 1 }, &ok, 1, NULL) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void mem_read_keeps_messages_within_bufsiz(void)
+{
+    spm_sys_fake_reset();
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    spm_sys_fake_set_xfer_handler(mem_model, NULL);
+
+    /* one long range: a frame per 4 KiB, each filling a message's rx */
+    enum { BIG = 5 * 4096 + 100 };
+    static uint8_t big[BIG];
+    memset(&g_mem, 0, sizeof g_mem);
+    uint64_t msgs = 0;
+    spm_mem_range_t r = { 0x10000, big, sizeof big };
+    assert(spm_mem_read(dev, NULL, &r, 1, &msgs) == SPM_OK);
+    assert(msgs == 6 && g_mem.msgs == 6 && g_mem.frames == 6);
+    assert(g_mem.max_rx <= SPM_BUFSIZ_DEFAULT && g_mem.max_tx <= SPM_BUFSIZ_DEFAULT);
+    for (size_t i = 0; i < sizeof big; i++) assert(big[i] == (uint8_t)((0x10000 + i) ^ 0x5A));
+
+    /* many small ranges: the padded header and data sums bound a message */
+    enum { N = 100 };
+    static uint8_t small[N][16];
+    static spm_mem_range_t rs[N];
+    for (size_t i = 0; i < N; i++) rs[i] = (spm_mem_range_t){ (uint32_t)(i * 4096), small[i], 16 };
+    memset(&g_mem, 0, sizeof g_mem);
+    msgs = 0;
+    assert(spm_mem_read(dev, NULL, rs, N, &msgs) == SPM_OK);
+    assert(g_mem.frames == N);
+    assert(msgs == (N + 31) / 32);          /* 4096 / 128 frames a message */
+    assert(g_mem.max_rx <= SPM_BUFSIZ_DEFAULT && g_mem.max_tx <= SPM_BUFSIZ_DEFAULT);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t k = 0; k < 16; k++) assert(small[i][k] == (uint8_t)((i * 4096 + k) ^ 0x5A));
+    }
+    assert(g_mem.bad == 0);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
 /* ====================================================== */
 /* =========================== Main ===================== */
 /* ====================================================== */
@@ -1147,6 +2023,38 @@ int main(void)
     // batch
     batch_transfer_succeeds_multiple_xfers();
     batch_transfer_fails_invalid_params();
+    // validation
+    set_validation_fails_invalid_input();
+    validation_none_skips_param_checks();
+    unchecked_transfers_succeed();
+    // cfg policy
+    per_transfer_policy_skips_speed_bpw_ioctls();
+    driver_policy_restores_driver_state();
+    // message-level backend
+    msg_backend_receives_transfers_natively();
+    msg_backend_applies_and_reads_config();
+    // write combining
+    write_combining_fails_invalid_input();
+    write_combining_flushes_before_read();
+    write_combining_flushes_on_limits();
+    write_combining_time_bound_flushes();
+    write_combining_reports_deferred_error();
+    // interceptors
+    hooks_fail_invalid_input();
+    hooks_wrap_transfers_in_order();
+    hooks_pre_error_skips_operation();
+    hooks_see_config_writes();
+    hooks_see_write_combining_flushes();
+    // tag accounting
+    tag_accounting_fails_invalid_input();
+    tag_accounting_attributes_messages();
+    tag_accounting_splits_combined_writes();
+    // bulk open
+    bulk_open_fails_invalid_input();
+    bulk_open_opens_across_buses();
+    // memory reads
+    mem_read_fails_invalid_input();
+    mem_read_keeps_messages_within_bufsiz();
 
     TEST_PASS();
     return 0;
@@ -0,0 +1,422 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_acq.h"
+#include "spm_sim.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ==================== ADC Model ======================= */
+/* ====================================================== */
+
+/* Every received byte carries a running counter */
+typedef struct {
+    uint8_t  counter;
+    unsigned frames;
+    unsigned cs_toggles;
+    uint8_t  last_cmd;
+} adc_model_t;
+
+static adc_model_t g_adc;
+
+static void adc_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    adc_model_t *m = ctx;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        if (tx) m->last_cmd = tx[0];
+        for (uint32_t k = 0; k < trs[i].len; k++) rx[k] = m->counter++;
+        if (trs[i].cs_change) m->cs_toggles++;
+        m->frames++;
+    }
+}
+
+static spm_device_t *open_adc_dev(void)
+{
+    spm_sys_fake_reset();
+    memset(&g_adc, 0, sizeof g_adc);
+    spm_sys_fake_set_xfer_handler(adc_xfer, &g_adc);
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+    return dev;
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_adc_dev();
+    spm_acq_t *acq = NULL;
+    uint8_t cmd = 0x01;
+
+    spm_acq_cfg_t cfg = { .block_len = 64 };
+    assert(spm_acq_create(dev, &cfg, NULL) == SPM_EPARAM);
+    assert(spm_acq_create(NULL, &cfg, &acq) == SPM_EPARAM);
+    assert(spm_acq_create(dev, NULL, &acq) == SPM_EPARAM);
+
+    spm_acq_cfg_t bad = { .block_len = 0 };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+
+    bad = (spm_acq_cfg_t){ .block_len = 64, .nbufs = 1 };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+
+    bad = (spm_acq_cfg_t){ .block_len = 64, .frame_len = 3 };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+
+    bad = (spm_acq_cfg_t){ .block_len = 64, .tx_frame = &cmd };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+
+    bad = (spm_acq_cfg_t){ .block_len = 64, .bufsiz = SPM_BUFSIZ_ALIGN - 1 };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+
+    /* one transfer must fit a message */
+    bad = (spm_acq_cfg_t){ .block_len = 8192, .chunk_len = 4097 };
+    assert(spm_acq_create(dev, &bad, &acq) == SPM_EPARAM);
+    assert(acq == NULL);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Handoff ======================= */
+/* ====================================================== */
+
+static void acquire_returns_blocks_in_order(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    spm_acq_cfg_t cfg = { .block_len = 100, .nbufs = 3, .chunk_len = 32 };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_ESTATE);
+
+    uint8_t expect = 0;
+    for (uint64_t i = 0; i < 20; i++) {
+        spm_acq_block_t blk;
+        assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+        assert(blk.seq == i);
+        assert(blk.len == 100);
+        for (size_t k = 0; k < blk.len; k++) assert(blk.data[k] == expect++);
+        assert(spm_acq_release(acq, &blk) == SPM_OK);
+        assert(spm_acq_release(acq, &blk) == SPM_EPARAM);
+    }
+
+    assert(spm_acq_stop(acq) == SPM_OK);
+
+    spm_acq_stats_t st;
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.blocks >= 20);
+    assert(st.dropped == 0);
+    assert(st.errors == 0);
+
+    spm_acq_destroy(acq);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void overwrite_mode_drops_oldest_on_overrun(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    spm_acq_cfg_t cfg = { .block_len = 16, .nbufs = 3, .overwrite = true };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    spm_acq_block_t held;
+    assert(spm_acq_acquire(acq, 1000, &held) == SPM_OK);
+    usleep(20000);
+
+    spm_acq_block_t next;
+    assert(spm_acq_acquire(acq, 1000, &next) == SPM_OK);
+    assert(next.seq > held.seq + 1);
+    assert(next.index != held.index);
+
+    assert(spm_acq_release(acq, &next) == SPM_OK);
+    assert(spm_acq_release(acq, &held) == SPM_OK);
+    assert(spm_acq_stop(acq) == SPM_OK);
+
+    spm_acq_stats_t st;
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.overruns > 0);
+    assert(st.dropped > 0);
+
+    spm_acq_destroy(acq);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void wait_mode_counts_overrun_without_dropping(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    spm_acq_cfg_t cfg = { .block_len = 16, .nbufs = 2 };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    spm_acq_block_t a, b;
+    assert(spm_acq_acquire(acq, 1000, &a) == SPM_OK);
+    assert(spm_acq_acquire(acq, 1000, &b) == SPM_OK);
+    assert(b.seq == a.seq + 1);
+
+    /* Both buffers held: fill thread must wait */
+    spm_acq_block_t c;
+    assert(spm_acq_acquire(acq, 0, &c) == SPM_ETIMEOUT);
+    assert(spm_acq_acquire(acq, 10, &c) == SPM_ETIMEOUT);
+
+    assert(spm_acq_release(acq, &a) == SPM_OK);
+    assert(spm_acq_acquire(acq, 1000, &c) == SPM_OK);
+    assert(c.seq == b.seq + 1);
+
+    assert(spm_acq_release(acq, &b) == SPM_OK);
+    assert(spm_acq_release(acq, &c) == SPM_OK);
+    spm_acq_destroy(acq);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void frame_mode_toggles_cs_and_sends_template(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    const uint8_t cmd[3] = {0x06, 0x40, 0x00};
+    spm_acq_cfg_t cfg = { .block_len = 30, .frame_len = 3, .tx_frame = cmd };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    spm_acq_block_t blk;
+    assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+    assert(spm_acq_stop(acq) == SPM_OK);
+
+    assert(g_adc.last_cmd == 0x06);
+    assert(g_adc.frames % 10 == 0);
+    assert(g_adc.cs_toggles == g_adc.frames / 10 * 9);
+
+    assert(spm_acq_release(acq, &blk) == SPM_OK);
+    spm_acq_destroy(acq);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void fill_error_is_reported_to_consumer(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    spm_acq_cfg_t cfg = { .block_len = 16 };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+
+    spm_sys_fake_fail_ioctl();
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    spm_acq_block_t blk;
+    spm_ecode_t rc = spm_acq_acquire(acq, 1000, &blk);
+    assert(rc != SPM_OK && rc != SPM_ETIMEOUT);
+
+    spm_acq_stats_t st;
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.errors == 1);
+
+    spm_acq_destroy(acq);
+    spm_sys_fake_reset();
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ===================== Autotuning ===================== */
+/* ====================================================== */
+
+static spm_device_t *open_sim_adc_dev(uint32_t speed_hz)
+{
+    spm_sim_reset();
+    memset(&g_adc, 0, sizeof g_adc);
+    assert(spm_sim_add("/dev/spidev0.0", 0, adc_xfer, &g_adc) == SPM_OK);
+
+    spm_sim_timing_t tm = { .realtime = true };
+    spm_sim_set_timing(&tm);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = speed_hz, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+/* Let the tuner settle while a consumer keeps up, return the last stats */
+static void run_tuned(spm_acq_t *acq, unsigned ms, spm_acq_stats_t *st)
+{
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < ms; i++) {
+        spm_acq_block_t blk;
+        while (spm_acq_acquire(acq, 0, &blk) == SPM_OK) {
+            assert(blk.len > 0 && blk.len % 8 == 0 && blk.len <= 8 * 64);
+            seen++;
+            assert(spm_acq_release(acq, &blk) == SPM_OK);
+        }
+        usleep(1000);
+    }
+    assert(seen > 0);
+    assert(spm_acq_get_stats(acq, st) == SPM_OK);
+}
+
+static void autotune_meets_latency_bound_and_follows_overhead(void)
+{
+    /* 1 MHz, 8-byte frames: 65 us per frame on the wire plus 15 us per message */
+    spm_device_t *dev = open_sim_adc_dev(1000000);
+
+    spm_acq_cfg_t cfg = { .block_len = 8 * 64, .frame_len = 8, .nbufs = 4,
+                          .overwrite = true, .latency_us = 600 };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+
+    spm_acq_stats_t st;
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.depth == 1);
+
+    assert(spm_acq_start(acq) == SPM_OK);
+    run_tuned(acq, 150, &st);
+    assert(st.depth >= 4 && st.depth <= 9);
+    assert(st.xfer_ns > 40000.0 && st.xfer_ns < 130000.0);
+    assert(st.est_latency_ns <= 600000.0);
+    assert(st.est_xfers_per_s > 0.0);
+    assert(st.messages == st.blocks + st.errors);
+    const uint32_t fast_depth = st.depth;
+
+    /* Heavier per-message cost leaves room for fewer frames */
+    spm_sim_timing_t tm = { .msg_overhead_ns = 300000, .realtime = true };
+    spm_sim_set_timing(&tm);
+    run_tuned(acq, 300, &st);
+    assert(st.depth < fast_depth);
+    assert(st.msg_overhead_ns > 150000.0);
+
+    assert(spm_acq_stop(acq) == SPM_OK);
+    spm_acq_destroy(acq);
+    spm_dev_close(dev);
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+static void fixed_depth_counts_messages_per_block(void)
+{
+    spm_device_t *dev = open_adc_dev();
+
+    /* 300 frames need two messages per block when bufsiz fits 256 */
+    spm_acq_cfg_t cfg = { .block_len = 300, .frame_len = 1,
+                          .bufsiz = SPM_MAX_BATCH_XFERS * SPM_BUFSIZ_ALIGN };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    spm_acq_block_t blk;
+    assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+    assert(blk.len == 300);
+    assert(spm_acq_release(acq, &blk) == SPM_OK);
+    assert(spm_acq_stop(acq) == SPM_OK);
+
+    spm_acq_stats_t st;
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.messages == st.blocks * 2);
+    assert(st.depth == SPM_MAX_BATCH_XFERS);
+
+    spm_acq_destroy(acq);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void blocks_split_into_bufsiz_messages(void)
+{
+    spm_device_t *dev = open_adc_dev();
+    spm_acq_stats_t st;
+    spm_acq_block_t blk;
+    spm_acq_t *acq = NULL;
+
+    /* Streaming: one default chunk per message */
+    spm_acq_cfg_t cfg = { .block_len = 16384 };
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+    assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+    assert(blk.len == 16384);
+    assert(spm_acq_release(acq, &blk) == SPM_OK);
+    assert(spm_acq_stop(acq) == SPM_OK);
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.messages == st.blocks * 4);
+    assert(st.depth == 1);
+    spm_acq_destroy(acq);
+
+    /* Frames: each counts SPM_BUFSIZ_ALIGN, 32 fit in 4096 */
+    cfg = (spm_acq_cfg_t){ .block_len = 300, .frame_len = 1 };
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+    assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+    assert(blk.len == 300);
+    assert(spm_acq_release(acq, &blk) == SPM_OK);
+    assert(spm_acq_stop(acq) == SPM_OK);
+    assert(spm_acq_get_stats(acq, &st) == SPM_OK);
+    assert(st.messages == st.blocks * 10);
+    assert(st.depth == 4096 / SPM_BUFSIZ_ALIGN);
+    spm_acq_destroy(acq);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =========================== Main ===================== */
+/* ====================================================== */
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    // handoff
+    acquire_returns_blocks_in_order();
+    overwrite_mode_drops_oldest_on_overrun();
+    wait_mode_counts_overrun_without_dropping();
+    frame_mode_toggles_cs_and_sends_template();
+    fill_error_is_reported_to_consumer();
+    // autotuning
+    fixed_depth_counts_messages_per_block();
+    blocks_split_into_bufsiz_messages();
+    autotune_meets_latency_bound_and_follows_overhead();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spi_monkey.h"
+#include "spm_asset.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ===================== NOR Model ====================== */
+/* ====================================================== */
+
+#define NOR_SIZE   (256u * 1024u)
+#define ASSET_LEN  (96u * 1024u + 123u)
+#define ASSET_AT   0x1000u
+
+/* Read-only SPI NOR: READ 0x03 and FAST READ 0x0B (one dummy byte) */
+typedef struct {
+    uint8_t   mem[NOR_SIZE];
+    unsigned  frames;
+    unsigned  bad_cmds;
+} nor_t;
+
+static nor_t g_nor;
+
+static void nor_frame(const struct spi_ioc_transfer *trs, size_t n)
+{
+    uint8_t cmd = 0;
+    uint32_t addr = 0;
+    size_t pos = 0;
+
+    for (size_t t = 0; t < n; t++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[t].tx_buf;
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[t].rx_buf;
+        for (uint32_t k = 0; k < trs[t].len; k++, pos++) {
+            uint8_t b = tx ? tx[k] : 0, out = 0xFF;
+            size_t data = cmd == 0x0B ? 5 : 4;
+            if (pos == 0)         cmd = b;
+            else if (pos <= 3)    addr = addr << 8 | b;
+            else if (pos >= data) out = g_nor.mem[(addr + pos - data) % NOR_SIZE];
+            if (rx) rx[k] = out;
+        }
+    }
+    g_nor.frames++;
+    if (cmd != 0x03 && cmd != 0x0B) g_nor.bad_cmds++;
+}
+
+static void nor_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (trs[i].cs_change || i + 1 == n) {
+            nor_frame(&trs[start], i + 1 - start);
+            start = i + 1;
+        }
+    }
+}
+
+static spm_device_t *open_nor(void)
+{
+    spm_sim_reset();
+    memset(&g_nor, 0, sizeof g_nor);
+    memset(g_nor.mem, 0xFF, sizeof g_nor.mem);
+    assert(spm_sim_add("/dev/spidev0.0", 0, nor_model, NULL) == SPM_OK);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 20000000, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+/*
+ * Something shaped like UI assets: runs of one colour, repeated rows,
+ * a stretch of noise that does not compress, and text-like filler.
+ */
+static void make_asset(uint8_t *p, size_t len)
+{
+    uint32_t x = 12345;
+    for (size_t i = 0; i < len; i++) {
+        size_t r = i % 24576;
+        if (r < 4096)        p[i] = 0x20;
+        else if (r < 12288)  p[i] = (uint8_t)((i / 3) % 61);
+        else if (r < 16384) { x = x * 1103515245u + 12345u; p[i] = (uint8_t)(x >> 16); }
+        else                 p[i] = (uint8_t)("lorem ipsum dolor sit amet "[(i * 7 / 5) % 27]);
+    }
+}
+
+static size_t store_asset(const uint8_t *src, size_t len, uint32_t block_size)
+{
+    size_t cap = spm_asset_pack_bound(len, block_size), out = 0;
+    assert(cap > 0 && ASSET_AT + cap <= NOR_SIZE);
+    assert(spm_asset_pack(src, len, block_size, &g_nor.mem[ASSET_AT], cap, &out) == SPM_OK);
+    assert(out > 0 && out <= cap);
+    return out;
+}
+
+/* ====================================================== */
+/* ======================= Tests ======================== */
+/* ====================================================== */
+
+static void pipelined_read_matches_source(void)
+{
+    spm_device_t *dev = open_nor();
+    uint8_t *src = malloc(ASSET_LEN), *got = malloc(ASSET_LEN);
+    assert(src && got);
+    make_asset(src, ASSET_LEN);
+    size_t packed = store_asset(src, ASSET_LEN, 4096);
+    assert(packed < ASSET_LEN * 3 / 4);
+
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+
+    spm_asset_info_t info;
+    assert(spm_asset_get_info(a, &info) == SPM_OK);
+    assert(info.size == ASSET_LEN);
+    assert(info.block_size == 4096);
+    assert(info.blocks == (ASSET_LEN + 4095) / 4096);
+    assert(info.packed_size == packed);
+
+    memset(got, 0, ASSET_LEN);
+    assert(spm_asset_read(a, 0, got, ASSET_LEN) == SPM_OK);
+    assert(memcmp(got, src, ASSET_LEN) == 0);
+
+    spm_asset_stats_t st;
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.reads == 1);
+    assert(st.blocks == info.blocks);
+    assert(st.messages == info.blocks);          /* one message per block */
+    assert(st.bytes_out == ASSET_LEN);
+    assert(st.bytes_in < packed && st.bytes_in > packed - 20 - 4 * (info.blocks + 1) - 1);
+    assert(st.cache_hits == 0);
+    assert(st.total_ns > 0 && st.decode_ns > 0);
+    assert(st.overlap >= 0.0 && st.overlap <= 1.0);
+    assert(g_nor.bad_cmds == 0);
+
+    spm_asset_close(a);
+    spm_dev_close(dev);
+    free(got);
+    free(src);
+    TEST_PASS();
+}
+
+static void serial_and_fast_read_agree(void)
+{
+    spm_device_t *dev = open_nor();
+    uint8_t *src = malloc(ASSET_LEN), *got = malloc(ASSET_LEN);
+    assert(src && got);
+    make_asset(src, ASSET_LEN);
+    store_asset(src, ASSET_LEN, 8192);
+
+    spm_asset_cfg_t serial = { .serial = true, .bufsiz = 1024 };
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT, &serial, &a) == SPM_OK);
+    memset(got, 0, ASSET_LEN);
+    assert(spm_asset_read(a, 0, got, ASSET_LEN) == SPM_OK);
+    assert(memcmp(got, src, ASSET_LEN) == 0);
+    spm_asset_stats_t st;
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.stall_ns == 0);
+    spm_asset_close(a);
+
+    spm_asset_cfg_t fast = { .read_cmd = 0x0B, .dummy_bytes = 1 };
+    assert(spm_asset_open(dev, ASSET_AT, &fast, &a) == SPM_OK);
+    memset(got, 0, ASSET_LEN);
+    assert(spm_asset_read(a, 0, got, ASSET_LEN) == SPM_OK);
+    assert(memcmp(got, src, ASSET_LEN) == 0);
+    spm_asset_close(a);
+    assert(g_nor.bad_cmds == 0);
+
+    spm_asset_cfg_t bad = { .addr_bytes = 2 };
+    assert(spm_asset_open(dev, ASSET_AT, &bad, &a) == SPM_EPARAM);
+    assert(a == NULL);
+
+    spm_dev_close(dev);
+    free(got);
+    free(src);
+    TEST_PASS();
+}
+
+static void large_blocks_read_in_bufsiz_messages(void)
+{
+    enum { LEN = 64 * 1024, BLOCK = 16 * 1024 };
+    spm_device_t *dev = open_nor();
+    uint8_t *src = malloc(LEN), *got = malloc(LEN);
+    assert(src && got);
+    uint32_t x = 777;
+    for (size_t i = 0; i < LEN; i++) {
+        x = x * 1103515245u + 12345u;
+        src[i] = (uint8_t)(x >> 16);
+    }
+    store_asset(src, LEN, BLOCK);
+
+    /* noise is stored raw: each 16 KiB block takes four 4 KiB messages */
+    spm_asset_cfg_t cfg = { .serial = true };
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT, &cfg, &a) == SPM_OK);
+    memset(got, 0, LEN);
+    assert(spm_asset_read(a, 0, got, LEN) == SPM_OK);
+    assert(memcmp(got, src, LEN) == 0);
+    spm_asset_stats_t st;
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.blocks == LEN / BLOCK);
+    assert(st.messages == 4 * st.blocks);
+    spm_asset_close(a);
+
+    spm_asset_cfg_t bad = { .bufsiz = SPM_BUFSIZ_ALIGN - 1 };
+    assert(spm_asset_open(dev, ASSET_AT, &bad, &a) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    free(got);
+    free(src);
+    TEST_PASS();
+}
+
+static void random_access_reads_only_covering_blocks(void)
+{
+    spm_device_t *dev = open_nor();
+    uint8_t *src = malloc(ASSET_LEN);
+    uint8_t got[10000];
+    assert(src);
+    make_asset(src, ASSET_LEN);
+    store_asset(src, ASSET_LEN, 4096);
+
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+
+    /* inside one block: one read, then served from the cache */
+    assert(spm_asset_read(a, 5000, got, 100) == SPM_OK);
+    assert(memcmp(got, src + 5000, 100) == 0);
+    assert(spm_asset_read(a, 5100, got, 200) == SPM_OK);
+    assert(memcmp(got, src + 5100, 200) == 0);
+    spm_asset_stats_t st;
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.blocks == 1 && st.messages == 1 && st.cache_hits == 1);
+
+    /* spanning three blocks, partial at both ends; the head is cached */
+    assert(spm_asset_read(a, 6000, got, 8000) == SPM_OK);
+    assert(memcmp(got, src + 6000, 8000) == 0);
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.blocks == 3 && st.messages == 3 && st.cache_hits == 2);
+
+    /* ending in the block cached last */
+    assert(spm_asset_read(a, 11000, got, 3000) == SPM_OK);
+    assert(memcmp(got, src + 11000, 3000) == 0);
+    assert(spm_asset_get_stats(a, &st) == SPM_OK);
+    assert(st.blocks == 4 && st.cache_hits == 3);
+
+    /* the short last block, and the very end */
+    assert(spm_asset_read(a, ASSET_LEN - 10000, got, 10000) == SPM_OK);
+    assert(memcmp(got, src + ASSET_LEN - 10000, 10000) == 0);
+    assert(spm_asset_read(a, ASSET_LEN - 1, got, 1) == SPM_OK);
+    assert(got[0] == src[ASSET_LEN - 1]);
+    assert(spm_asset_read(a, ASSET_LEN, got, 0) == SPM_OK);
+    assert(spm_asset_read(a, ASSET_LEN - 1, got, 2) == SPM_EPARAM);
+
+    for (unsigned i = 0; i < 200; i++) {
+        uint32_t off = (i * 7919u) % ASSET_LEN;
+        size_t len = (i * 131u) % sizeof got;
+        if (len > ASSET_LEN - off) len = ASSET_LEN - off;
+        assert(spm_asset_read(a, off, got, len) == SPM_OK);
+        assert(len == 0 || memcmp(got, src + off, len) == 0);
+    }
+
+    spm_asset_close(a);
+    spm_dev_close(dev);
+    free(src);
+    TEST_PASS();
+}
+
+static void codec_edge_cases_round_trip(void)
+{
+    spm_device_t *dev = open_nor();
+    enum { LEN = 40000 };
+    uint8_t *src = malloc(LEN), *got = malloc(LEN);
+    assert(src && got);
+
+    /* one long run (overlapping match, length > 255), long literals,
+       a match right at the end, and tiny blocks */
+    uint32_t x = 7;
+    for (size_t i = 0; i < LEN; i++) {
+        if (i < 9000)       src[i] = 0xAB;
+        else if (i < 9700) { x = x * 1664525u + 1013904223u; src[i] = (uint8_t)(x >> 24); }
+        else                src[i] = src[i - 700];
+    }
+
+    const uint32_t sizes[] = { 1, 13, 700, 4096, 65536 };
+    for (size_t k = 0; k < sizeof sizes / sizeof sizes[0]; k++) {
+        memset(g_nor.mem, 0xFF, sizeof g_nor.mem);
+        store_asset(src, LEN, sizes[k]);
+        spm_asset_t *a = NULL;
+        assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+        memset(got, 0, LEN);
+        assert(spm_asset_read(a, 0, got, LEN) == SPM_OK);
+        assert(memcmp(got, src, LEN) == 0);
+        spm_asset_close(a);
+    }
+
+    /* noise only: every block stored raw */
+    for (size_t i = 0; i < LEN; i++) { x = x * 1664525u + 1013904223u; src[i] = (uint8_t)(x >> 24); }
+    size_t packed = store_asset(src, LEN, 4096);
+    assert(packed == spm_asset_pack_bound(LEN, 4096));
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+    assert(spm_asset_read(a, 0, got, LEN) == SPM_OK);
+    assert(memcmp(got, src, LEN) == 0);
+    spm_asset_close(a);
+
+    /* too small an output buffer */
+    size_t out = 0;
+    assert(spm_asset_pack(src, LEN, 4096, got, 1000, &out) == SPM_ENOMEM);
+    assert(spm_asset_pack(src, LEN, 0, got, LEN, &out) == SPM_EPARAM);
+
+    /* empty asset */
+    memset(g_nor.mem, 0xFF, sizeof g_nor.mem);
+    store_asset(src, 0, 4096);
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+    spm_asset_info_t info;
+    assert(spm_asset_get_info(a, &info) == SPM_OK);
+    assert(info.size == 0 && info.blocks == 0);
+    assert(spm_asset_read(a, 0, got, 0) == SPM_OK);
+    spm_asset_close(a);
+
+    spm_dev_close(dev);
+    free(got);
+    free(src);
+    TEST_PASS();
+}
+
+static void damage_is_reported_and_reader_recovers(void)
+{
+    spm_device_t *dev = open_nor();
+    uint8_t *src = malloc(ASSET_LEN), *got = malloc(ASSET_LEN);
+    assert(src && got);
+    make_asset(src, ASSET_LEN);
+    store_asset(src, ASSET_LEN, 4096);
+
+    /* erased flash and a damaged index */
+    spm_asset_t *a = NULL;
+    assert(spm_asset_open(dev, ASSET_AT + 0x100, NULL, &a) != SPM_OK);
+    assert(a == NULL);
+    g_nor.mem[ASSET_AT + 24] ^= 0x01;
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_ECRC);
+    g_nor.mem[ASSET_AT + 24] ^= 0x01;
+
+    /* damage the first block's match offset area: it no longer decodes */
+    assert(spm_asset_open(dev, ASSET_AT, NULL, &a) == SPM_OK);
+    spm_asset_info_t info;
+    assert(spm_asset_get_info(a, &info) == SPM_OK);
+    uint32_t data = ASSET_AT + 20 + 4 * (info.blocks + 1);
+    uint8_t saved[8];
+    memcpy(saved, &g_nor.mem[data], sizeof saved);
+    memset(&g_nor.mem[data], 0xF0, sizeof saved);
+
+    assert(spm_asset_read(a, 0, got, ASSET_LEN) == SPM_ECRC);
+    assert(spm_asset_read(a, 100, got, 10) == SPM_ECRC);
+
+    /* the pipeline was drained: later reads line up again */
+    memcpy(&g_nor.mem[data], saved, sizeof saved);
+    assert(spm_asset_read(a, 0, got, ASSET_LEN) == SPM_OK);
+    assert(memcmp(got, src, ASSET_LEN) == 0);
+    assert(spm_asset_read(a, 4000, got, 300) == SPM_OK);
+    assert(memcmp(got, src + 4000, 300) == 0);
+
+    spm_asset_close(a);
+    spm_dev_close(dev);
+    free(got);
+    free(src);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // streaming
+    pipelined_read_matches_source();
+    serial_and_fast_read_agree();
+    large_blocks_read_in_bufsiz_messages();
+    random_access_reads_only_covering_blocks();
+
+    // format
+    codec_edge_cases_round_trip();
+    damage_is_reported_and_reader_recovers();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,402 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_boot.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+static uint32_t g_rng = 4242;
+
+static uint8_t rand_byte(void)
+{
+    g_rng = g_rng * 1103515245u + 12345u;
+    return (uint8_t)(g_rng >> 16);
+}
+
+/* ====================================================== */
+/* ================= Bootloader Model =================== */
+/* ====================================================== */
+
+#define BL_BASE   0x08000000u
+#define BL_SIZE   (32u * 1024u)
+
+enum {
+    S_SOF, S_CMD, S_CMDX, S_ADDR, S_WLEN, S_WDATA, S_RLEN, S_ERASE,
+    S_RESP, S_WAIT_HACK, S_RDUMMY, S_RDATA,
+};
+
+/* STM32 SPI bootloader (AN4286) at byte level; flash only clears bits */
+typedef struct {
+    uint8_t   mem[BL_SIZE];
+    int       state, next;
+    bool      synced;
+    uint8_t   cmd;
+    uint8_t   buf[300];
+    size_t    got, need;
+    uint32_t  addr;
+    size_t    rpos, rlen;
+    uint8_t   resp;
+    unsigned  countdown;
+    unsigned  lat_cmd, lat_data, lat_erase;   /* bytes until ACK */
+    bool      dead;                           /* never answers */
+    uint32_t  go_addr;
+    unsigned  violations;                     /* host clocked data while we were busy */
+    unsigned  messages;
+} bl_model_t;
+
+static void respond(bl_model_t *m, bool ok, unsigned lat, int next)
+{
+    m->resp = ok ? 0x79 : 0x1F;
+    m->countdown = (lat ? lat : 1) + 1;   /* the host's dummy byte comes first */
+    m->state = S_RESP;
+    m->next = ok ? next : S_SOF;
+}
+
+static bool addr_ok(uint32_t a, size_t n)
+{
+    return a >= BL_BASE && a - BL_BASE + n <= BL_SIZE;
+}
+
+static uint8_t xor_of(const uint8_t *p, size_t n)
+{
+    uint8_t x = 0;
+    for (size_t i = 0; i < n; i++) x ^= p[i];
+    return x;
+}
+
+static uint8_t bl_clock(bl_model_t *m, uint8_t in)
+{
+    switch (m->state) {
+    case S_RESP:
+        if (in != 0x00) m->violations++;
+        if (m->dead || --m->countdown > 0) return 0xA5;
+        m->state = S_WAIT_HACK;
+        return m->resp;
+
+    case S_WAIT_HACK:
+        if (in == 0x79) m->state = m->next;
+        else if (in != 0x00) m->violations++;
+        return 0xA5;
+
+    case S_RDUMMY:
+        m->state = S_RDATA;
+        return 0xA5;
+
+    case S_RDATA: {
+        uint8_t v = m->mem[m->addr - BL_BASE + m->rpos++];
+        if (m->rpos == m->rlen) m->state = S_SOF;
+        return v;
+    }
+
+    case S_SOF:
+        if (in != 0x5A) return 0xA5;
+        if (!m->synced) {
+            m->synced = true;
+            respond(m, true, m->lat_cmd, S_SOF);
+        } else {
+            m->state = S_CMD;
+        }
+        return 0xA5;
+
+    case S_CMD:
+        m->cmd = in;
+        m->state = S_CMDX;
+        return 0xA5;
+
+    case S_CMDX: {
+        bool ok = in == (uint8_t)~m->cmd;
+        int next = m->cmd == 0x44 ? S_ERASE : S_ADDR;
+        ok = ok && (m->cmd == 0x11 || m->cmd == 0x21 || m->cmd == 0x31 || m->cmd == 0x44);
+        m->got = 0;
+        respond(m, ok, m->lat_cmd, next);
+        return 0xA5;
+    }
+
+    case S_ADDR:
+        m->buf[m->got++] = in;
+        if (m->got == 5) {
+            m->addr = (uint32_t)m->buf[0] << 24 | (uint32_t)m->buf[1] << 16 |
+                      (uint32_t)m->buf[2] << 8 | m->buf[3];
+            bool ok = xor_of(m->buf, 4) == m->buf[4] && addr_ok(m->addr, 1);
+            if (m->cmd == 0x21) m->go_addr = m->addr;
+            int next = m->cmd == 0x31 ? S_WLEN : m->cmd == 0x11 ? S_RLEN : S_SOF;
+            m->got = 0;
+            respond(m, ok, m->lat_cmd, next);
+        }
+        return 0xA5;
+
+    case S_WLEN:
+        m->buf[0] = in;
+        m->need = (size_t)in + 1 + 1;    /* data + checksum */
+        m->got = 0;
+        m->state = S_WDATA;
+        return 0xA5;
+
+    case S_WDATA:
+        m->buf[1 + m->got++] = in;
+        if (m->got == m->need) {
+            size_t n = m->need - 1;
+            bool ok = xor_of(m->buf, 1 + n) == m->buf[1 + n] && n % 4 == 0 && addr_ok(m->addr, n);
+            if (ok) {
+                for (size_t i = 0; i < n; i++) m->mem[m->addr - BL_BASE + i] &= m->buf[1 + i];
+            }
+            respond(m, ok, m->lat_data, S_SOF);
+        }
+        return 0xA5;
+
+    case S_RLEN:
+        m->buf[m->got++] = in;
+        if (m->got == 2) {
+            m->rlen = (size_t)m->buf[0] + 1;
+            m->rpos = 0;
+            bool ok = m->buf[1] == (uint8_t)~m->buf[0] && addr_ok(m->addr, m->rlen);
+            respond(m, ok, m->lat_cmd, S_RDUMMY);
+        }
+        return 0xA5;
+
+    case S_ERASE:
+        m->buf[m->got++] = in;
+        if (m->got == 3) {
+            bool ok = m->buf[0] == 0xFF && m->buf[1] == 0xFF && m->buf[2] == 0x00;
+            if (ok) memset(m->mem, 0xFF, BL_SIZE);
+            respond(m, ok, m->lat_erase, S_SOF);
+        }
+        return 0xA5;
+    }
+    return 0xA5;
+}
+
+static void bl_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    bl_model_t *m = ctx;
+    m->messages++;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        for (uint32_t k = 0; k < trs[i].len; k++) {
+            uint8_t v = bl_clock(m, tx ? tx[k] : 0x00);
+            if (rx) rx[k] = v;
+        }
+    }
+}
+
+static bl_model_t *model_new(void)
+{
+    bl_model_t *m = calloc(1, sizeof(*m));
+    for (size_t i = 0; i < BL_SIZE; i++) m->mem[i] = (uint8_t)i;   /* old firmware */
+    m->lat_cmd = 1;
+    m->lat_data = 40;
+    m->lat_erase = 3000;
+    return m;
+}
+
+static spm_device_t *open_bl(bl_model_t *m)
+{
+    spm_sys_fake_reset();
+    spm_sys_fake_set_xfer_handler(bl_xfer, m);
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    return dev;
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    bl_model_t *m = model_new();
+    spm_device_t *dev = open_bl(m);
+    spm_boot_t *b = NULL;
+
+    assert(spm_boot_create(dev, NULL, NULL) == SPM_EPARAM);
+    assert(spm_boot_create(NULL, NULL, &b) == SPM_EPARAM);
+    spm_boot_cfg_t bad = { .chunk = 6 };
+    assert(spm_boot_create(dev, &bad, &b) == SPM_EPARAM);
+    bad = (spm_boot_cfg_t){ .chunk = 260 };
+    assert(spm_boot_create(dev, &bad, &b) == SPM_EPARAM);
+    assert(b == NULL);
+
+    assert(spm_boot_create(dev, NULL, &b) == SPM_OK);
+    assert(spm_boot_flash(b, NULL, 4) == SPM_EPARAM);
+    assert(spm_boot_flash_file(b, "/nonexistent/image.bin") == SPM_ENODEV);
+    assert(spm_boot_get_stats(b, NULL) == SPM_EPARAM);
+    assert(m->messages == 0);
+    spm_boot_destroy(b);
+    spm_boot_destroy(NULL);
+
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Protocol ====================== */
+/* ====================================================== */
+
+static void flash_file_erases_writes_and_verifies(void)
+{
+    bl_model_t *m = model_new();
+    spm_device_t *dev = open_bl(m);
+
+    enum { LEN = 5001 };
+    static uint8_t img[LEN];
+    for (size_t i = 0; i < LEN; i++) img[i] = rand_byte();
+
+    char path[] = "/tmp/spm_boot_testXXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    assert(write(fd, img, LEN) == LEN);
+    close(fd);
+
+    spm_boot_cfg_t cfg = { .mass_erase = true, .verify = true };
+    spm_boot_t *b = NULL;
+    assert(spm_boot_create(dev, &cfg, &b) == SPM_OK);
+    assert(spm_boot_sync(b) == SPM_OK);
+    assert(spm_boot_flash_file(b, path) == SPM_OK);
+    unlink(path);
+
+    assert(memcmp(m->mem, img, LEN) == 0);
+    assert(m->mem[LEN] == 0xFF && m->mem[LEN + 2] == 0xFF);   /* tail padding */
+    assert(m->mem[LEN + 3] == 0xFF);                          /* erased */
+
+    spm_boot_stats_t st;
+    assert(spm_boot_get_stats(b, &st) == SPM_OK);
+    assert(st.bytes_written == LEN && st.bytes_read == LEN);
+    assert(st.image_crc == st.readback_crc && st.image_crc != 0);
+    assert(st.nacks == 0);
+    assert(st.write_kbps > 0 && st.verify_kbps > 0);
+    assert(st.messages == m->messages);
+
+    /* 20 chunks: 3 messages per write, 4 per read, plus ACK window warm-up and erase polls */
+    assert(st.messages <= 20 * 3 + 20 * 4 + 40);
+    assert(m->violations == 0);
+
+    assert(spm_boot_go(b, BL_BASE + 4) == SPM_OK);
+    assert(m->go_addr == BL_BASE + 4);
+    spm_boot_destroy(b);
+    assert(m->state == S_SOF);                                 /* final host ACK sent */
+
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void verify_detects_unerased_flash(void)
+{
+    bl_model_t *m = model_new();
+    spm_device_t *dev = open_bl(m);
+
+    uint8_t img[64];
+    memset(img, 0xF0, sizeof(img));
+    spm_boot_cfg_t cfg = { .verify = true, .chunk = 16 };
+    spm_boot_t *b = NULL;
+    assert(spm_boot_create(dev, &cfg, &b) == SPM_OK);
+    assert(spm_boot_sync(b) == SPM_OK);
+    assert(spm_boot_flash(b, img, sizeof(img)) == SPM_ECRC);
+
+    spm_boot_stats_t st;
+    assert(spm_boot_get_stats(b, &st) == SPM_OK);
+    assert(st.image_crc != st.readback_crc);
+
+    uint8_t back[64];
+    assert(spm_boot_read(b, BL_BASE, back, sizeof(back)) == SPM_OK);
+    for (size_t i = 0; i < sizeof(back); i++) assert(back[i] == ((uint8_t)i & 0xF0));
+
+    spm_boot_destroy(b);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void nack_is_reported_and_recovered(void)
+{
+    bl_model_t *m = model_new();
+    spm_device_t *dev = open_bl(m);
+    spm_boot_t *b = NULL;
+    assert(spm_boot_create(dev, NULL, &b) == SPM_OK);
+    assert(spm_boot_sync(b) == SPM_OK);
+
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    assert(spm_boot_write(b, 0x20000000u, data, 8) == SPM_EIO);
+
+    spm_boot_stats_t st;
+    assert(spm_boot_get_stats(b, &st) == SPM_OK);
+    assert(st.nacks == 1);
+
+    /* Next command still lines up with the target */
+    uint8_t back[8];
+    assert(spm_boot_read(b, BL_BASE + 8, back, 8) == SPM_OK);
+    for (int i = 0; i < 8; i++) assert(back[i] == 8 + i);
+    assert(m->violations == 0);
+
+    spm_boot_destroy(b);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void silent_target_times_out(void)
+{
+    bl_model_t *m = model_new();
+    m->dead = true;
+    spm_device_t *dev = open_bl(m);
+
+    spm_boot_cfg_t cfg = { .ack_timeout_ms = 20 };
+    spm_boot_t *b = NULL;
+    assert(spm_boot_create(dev, &cfg, &b) == SPM_OK);
+    assert(spm_boot_sync(b) == SPM_ETIMEOUT);
+
+    spm_boot_stats_t st;
+    assert(spm_boot_get_stats(b, &st) == SPM_OK);
+    assert(st.poll_misses > 2);
+    assert(st.poll_bytes > 0);
+
+    spm_boot_destroy(b);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    // protocol
+    flash_file_erases_writes_and_verifies();
+    verify_detects_unerased_flash();
+    nack_is_reported_and_recovered();
+    silent_target_times_out();
+
+    TEST_PASS();
+    return 0;
+}
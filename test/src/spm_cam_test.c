@@ -0,0 +1,382 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spi_monkey.h"
+#include "spm_cam.h"
+#include "spm_sim.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* JPEG-like frame k: SOI, stuffed random body, EOI */
+static size_t gen_jpeg(unsigned k, uint8_t *out)
+{
+    uint32_t rng = 777u + k;
+    size_t body = 3000 + (size_t)k * 1777;
+    size_t n = 0;
+
+    out[n++] = 0xFF;
+    out[n++] = 0xD8;
+    while (n < body) {
+        rng = rng * 1103515245u + 12345u;
+        uint8_t b = (uint8_t)(rng >> 16);
+        out[n++] = b;
+        if (b == 0xFF) out[n++] = 0x00;
+    }
+    out[n++] = 0xFF;
+    out[n++] = 0xD9;
+    return n;
+}
+
+/* ====================================================== */
+/* ==================== Camera Model ==================== */
+/* ====================================================== */
+
+/* ArduCAM-style FIFO camera behind the fake backend */
+typedef struct {
+    uint8_t   fifo[64 * 1024];
+    size_t    fifo_len;
+    size_t    rd;
+    bool      burst;
+    unsigned  frame;          /* next frame to capture */
+    unsigned  polls;
+    unsigned  done_after;     /* status polls before capture completes */
+    size_t    lead;           /* junk bytes before SOI */
+    size_t    pad;            /* junk bytes after EOI */
+    bool      break_eoi;      /* corrupt the EOI of odd frames */
+    bool      never_done;
+    size_t    max_msg;        /* largest burst message seen, aligned tx or rx sum */
+} cam_model_t;
+
+static void cam_capture(cam_model_t *m)
+{
+    size_t n = 0;
+    memset(m->fifo, 0x00, m->lead);
+    n += m->lead;
+    n += gen_jpeg(m->frame < 30 ? m->frame : 30, m->fifo + n);
+    if (m->break_eoi && (m->frame & 1)) m->fifo[n - 1] = 0x00;
+    memset(m->fifo + n, 0x00, m->pad);
+    n += m->pad;
+    m->fifo_len = n;
+    m->frame++;
+    m->polls = 0;
+}
+
+static void cam_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    cam_model_t *m = ctx;
+    size_t tx_cost = 0, rx_cost = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        if (tx) tx_cost += SPM_BUFSIZ_COST(trs[i].len);
+        if (rx) rx_cost += SPM_BUFSIZ_COST(trs[i].len);
+
+        if (tx && tx[0] == 0x3C) {
+            m->burst = true;
+            m->rd = 0;
+        } else if (tx && trs[i].len == 2) {
+            m->burst = false;
+            uint8_t addr = tx[0] & 0x7F;
+            if (tx[0] & 0x80) {
+                if (addr == 0x04 && (tx[1] & 0x02)) cam_capture(m);
+            } else if (rx) {
+                uint8_t v = 0;
+                if (addr == 0x41) v = (!m->never_done && m->polls++ >= m->done_after) ? 0x08 : 0x00;
+                if (addr == 0x42) v = (uint8_t)m->fifo_len;
+                if (addr == 0x43) v = (uint8_t)(m->fifo_len >> 8);
+                if (addr == 0x44) v = (uint8_t)(m->fifo_len >> 16);
+                rx[1] = v;
+            }
+        } else if (m->burst && rx) {
+            for (uint32_t k = 0; k < trs[i].len; k++, m->rd++) {
+                rx[k] = m->rd < m->fifo_len ? m->fifo[m->rd] : 0x00;
+            }
+        }
+    }
+    size_t cost = tx_cost > rx_cost ? tx_cost : rx_cost;
+    if (m->burst && cost > m->max_msg) m->max_msg = cost;
+}
+
+static spm_device_t *open_cam(cam_model_t *m)
+{
+    spm_sys_fake_reset();
+    spm_sys_fake_set_xfer_handler(cam_xfer, m);
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+    return dev;
+}
+
+/* ====================================================== */
+/* ====================== Scanning ====================== */
+/* ====================================================== */
+
+static void find_jpeg_locates_markers(void)
+{
+    static uint8_t buf[8192];
+    size_t off = 0, len = 0;
+
+    assert(spm_cam_find_jpeg(NULL, 1, &off, &len) == SPM_EPARAM);
+    assert(spm_cam_find_jpeg(buf, 1, NULL, &len) == SPM_EPARAM);
+    assert(spm_cam_kernel() != NULL);
+
+    /* SOI and EOI at every offset around vector boundaries */
+    for (size_t soi = 0; soi < 70; soi++) {
+        for (size_t eoi = soi + 2; eoi < 140; eoi += 3) {
+            memset(buf, 0xFF, 200);                 /* FF runs but no markers */
+            buf[soi] = 0xFF; buf[soi + 1] = 0xD8;
+            buf[eoi] = 0xFF; buf[eoi + 1] = 0xD9;
+            for (size_t i = 0; i < 200; i++) {
+                if (i != soi && i != soi + 1 && i != eoi && i != eoi + 1 && (i & 1)) buf[i] = 0x00;
+            }
+            if (soi > 0 && buf[soi - 1] == 0xFF && soi - 1 != eoi) buf[soi - 1] = 0x11;
+
+            assert(spm_cam_find_jpeg(buf, 200, &off, &len) == SPM_OK);
+            assert(off == soi);
+            assert(len == eoi + 2 - soi);
+        }
+    }
+
+    /* Marker split by the end of the buffer, missing EOI, empty input */
+    memset(buf, 0, sizeof(buf));
+    buf[10] = 0xFF; buf[11] = 0xD8;
+    buf[99] = 0xFF;
+    assert(spm_cam_find_jpeg(buf, 100, &off, &len) == SPM_EIO);
+    buf[100] = 0xD9;
+    assert(spm_cam_find_jpeg(buf, 101, &off, &len) == SPM_OK);
+    assert(off == 10 && len == 91);
+    assert(spm_cam_find_jpeg(buf, 0, &off, &len) == SPM_EIO);
+
+    /* Stuffed FF 00 bytes in a long body are skipped */
+    size_t n = gen_jpeg(3, buf + 5);
+    assert(spm_cam_find_jpeg(buf, n + 5, &off, &len) == SPM_OK);
+    assert(off == 5 && len == n);
+
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Capture ======================= */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    cam_model_t *m = calloc(1, sizeof(*m));
+    spm_device_t *dev = open_cam(m);
+    spm_cam_t *cam = NULL;
+
+    assert(spm_cam_create(dev, NULL, NULL) == SPM_EPARAM);
+    assert(spm_cam_create(NULL, NULL, &cam) == SPM_EPARAM);
+
+    spm_cam_cfg_t bad = { .nbufs = 1 };
+    assert(spm_cam_create(dev, &bad, &cam) == SPM_EPARAM);
+    bad = (spm_cam_cfg_t){ .bufsiz = 2, .burst_dummy = 1 };
+    assert(spm_cam_create(dev, &bad, &cam) == SPM_EPARAM);
+    bad = (spm_cam_cfg_t){ .bufsiz = SPM_BUFSIZ_ALIGN - 1 };
+    assert(spm_cam_create(dev, &bad, &cam) == SPM_EPARAM);
+    bad = (spm_cam_cfg_t){ .burst_dummy = 9 };
+    assert(spm_cam_create(dev, &bad, &cam) == SPM_EPARAM);
+    assert(cam == NULL);
+
+    assert(spm_cam_create(dev, NULL, &cam) == SPM_OK);
+    spm_cam_frame_t fr;
+    assert(spm_cam_acquire(cam, 0, &fr) == SPM_ESTATE);
+    fr = (spm_cam_frame_t){ .index = 7 };
+    assert(spm_cam_release(cam, &fr) == SPM_EPARAM);
+    assert(spm_cam_stop(cam) == SPM_OK);
+    spm_cam_destroy(cam);
+    spm_cam_destroy(NULL);
+
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void capture_delivers_frames_zero_copy(void)
+{
+    cam_model_t *m = calloc(1, sizeof(*m));
+    m->done_after = 2;
+    m->lead = 3;
+    m->pad = 17;
+    spm_device_t *dev = open_cam(m);
+
+    spm_cam_cfg_t cfg = { .max_frame = 32 * 1024, .nbufs = 3, .bufsiz = 1000, .burst_dummy = 1, .poll_us = 50 };
+    spm_cam_t *cam = NULL;
+    assert(spm_cam_create(dev, &cfg, &cam) == SPM_OK);
+    assert(spm_cam_start(cam) == SPM_OK);
+    assert(spm_cam_start(cam) == SPM_ESTATE);
+
+    static uint8_t ref[64 * 1024];
+    for (unsigned k = 0; k < 6; k++) {
+        spm_cam_frame_t fr;
+        assert(spm_cam_acquire(cam, 2000, &fr) == SPM_OK);
+        assert(fr.seq == k);
+
+        size_t n = gen_jpeg(k, ref);
+        assert(fr.len == n);
+        assert(memcmp(fr.data, ref, n) == 0);
+        assert(fr.fifo_len == 3 + n + 17);
+        assert(spm_cam_release(cam, &fr) == SPM_OK);
+        assert(spm_cam_release(cam, &fr) == SPM_EPARAM);
+    }
+    assert(spm_cam_stop(cam) == SPM_OK);
+
+    spm_cam_stats_t st;
+    assert(spm_cam_get_stats(cam, &st) == SPM_OK);
+    assert(st.frames >= 6);
+    assert(st.bad_frames == 0 && st.errors == 0 && st.truncated == 0);
+    assert(st.polls >= st.frames * 3);
+    assert(st.fps > 0 && st.bytes_per_s > 0);
+    assert(m->max_msg == 1000 / SPM_BUFSIZ_ALIGN * SPM_BUFSIZ_ALIGN);
+
+    spm_cam_destroy(cam);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void bad_and_oversized_frames_are_counted(void)
+{
+    cam_model_t *m = calloc(1, sizeof(*m));
+    m->break_eoi = true;
+    spm_device_t *dev = open_cam(m);
+
+    /* Frames 0, 2, 4 fit; odd frames have no EOI; frame 6+ exceed max_frame */
+    spm_cam_cfg_t cfg = { .max_frame = 12000, .nbufs = 2 };
+    spm_cam_t *cam = NULL;
+    assert(spm_cam_create(dev, &cfg, &cam) == SPM_OK);
+    assert(spm_cam_start(cam) == SPM_OK);
+
+    static uint8_t ref[64 * 1024];
+    for (unsigned k = 0; k < 3; k++) {
+        spm_cam_frame_t fr;
+        assert(spm_cam_acquire(cam, 2000, &fr) == SPM_OK);
+        assert(fr.seq == k);
+        size_t n = gen_jpeg(2 * k, ref);
+        assert(fr.len == n && memcmp(fr.data, ref, n) == 0);
+        assert(spm_cam_release(cam, &fr) == SPM_OK);
+    }
+
+    spm_cam_frame_t fr;
+    assert(spm_cam_acquire(cam, 50, &fr) == SPM_ETIMEOUT);   /* only broken frames left */
+    assert(spm_cam_stop(cam) == SPM_OK);
+
+    spm_cam_stats_t st;
+    assert(spm_cam_get_stats(cam, &st) == SPM_OK);
+    assert(st.frames == 3);
+    assert(st.bad_frames >= 3);
+    assert(st.truncated >= 1);
+
+    spm_cam_destroy(cam);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void capture_timeout_stops_thread(void)
+{
+    cam_model_t *m = calloc(1, sizeof(*m));
+    m->never_done = true;
+    spm_device_t *dev = open_cam(m);
+
+    spm_cam_cfg_t cfg = { .max_frame = 4096, .poll_us = 200, .timeout_ms = 20 };
+    spm_cam_t *cam = NULL;
+    assert(spm_cam_create(dev, &cfg, &cam) == SPM_OK);
+    assert(spm_cam_start(cam) == SPM_OK);
+
+    spm_cam_frame_t fr;
+    assert(spm_cam_acquire(cam, -1, &fr) == SPM_ETIMEOUT);
+    assert(spm_cam_stop(cam) == SPM_OK);
+
+    spm_cam_stats_t st;
+    assert(spm_cam_get_stats(cam, &st) == SPM_OK);
+    assert(st.errors == 1);
+    assert(st.frames == 0);
+    assert(st.polls > 1);
+
+    spm_cam_destroy(cam);
+    spm_dev_close(dev);
+    free(m);
+    TEST_PASS();
+}
+
+static void unaligned_bufsiz_fits_simulator_limit(void)
+{
+    cam_model_t *m = calloc(1, sizeof(*m));
+    m->done_after = 1;
+    spm_sim_reset();
+    spm_sim_set_bufsiz(1000);
+    assert(spm_sim_add("/dev/spidev0.0", 0, cam_xfer, m) == SPM_OK);
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_SIM, &dev) == SPM_OK);
+
+    spm_cam_cfg_t cfg = { .max_frame = 32 * 1024, .bufsiz = 1000, .burst_dummy = 1, .poll_us = 50 };
+    spm_cam_t *cam = NULL;
+    assert(spm_cam_create(dev, &cfg, &cam) == SPM_OK);
+    assert(spm_cam_start(cam) == SPM_OK);
+
+    static uint8_t ref[64 * 1024];
+    for (unsigned k = 0; k < 3; k++) {
+        spm_cam_frame_t fr;
+        assert(spm_cam_acquire(cam, 2000, &fr) == SPM_OK);
+        size_t n = gen_jpeg(k, ref);
+        assert(fr.len == n && memcmp(fr.data, ref, n) == 0);
+        assert(spm_cam_release(cam, &fr) == SPM_OK);
+    }
+    assert(spm_cam_stop(cam) == SPM_OK);
+
+    spm_cam_stats_t st;
+    assert(spm_cam_get_stats(cam, &st) == SPM_OK);
+    assert(st.errors == 0);
+    spm_sim_stats_t ss;
+    assert(spm_sim_get_stats("/dev/spidev0.0", &ss) == SPM_OK);
+    assert(ss.errors == 0);
+
+    spm_cam_destroy(cam);
+    spm_dev_close(dev);
+    spm_sim_reset();
+    free(m);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // scanning
+    find_jpeg_locates_markers();
+    // capture
+    create_fails_invalid_input();
+    capture_delivers_frames_zero_copy();
+    bad_and_oversized_frames_are_counted();
+    capture_timeout_stops_thread();
+    unaligned_bufsiz_fits_simulator_limit();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_dac.h"
+#include "spm_sim.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ==================== DAC Model ======================= */
+/* ====================================================== */
+
+/* Latches every 16-bit word, checks framing and pacing */
+#define DAC_LOG 1024
+
+typedef struct {
+    uint16_t words[DAC_LOG];
+    unsigned nwords;
+    unsigned messages;
+    unsigned bad_frames;     /* cs_change on a last transfer, or missing between words */
+    uint16_t delay_usecs;
+} dac_model_t;
+
+static dac_model_t g_dac;
+
+static void dac_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    dac_model_t *m = ctx;
+    m->messages++;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        if (trs[i].len != 2 || trs[i].cs_change != (i + 1 < n)) m->bad_frames++;
+        m->delay_usecs = trs[i].delay_usecs;
+        if (m->nwords < DAC_LOG) m->words[m->nwords++] = (uint16_t)(tx[0] << 8 | tx[1]);
+    }
+}
+
+/* MCP4921-style: 12-bit, buffered, gain 1, active */
+static const spm_dac_cfg_t MCP4921 = {
+    .word_len = 2, .bits = 12, .cmd = 0x7000, .sample_rate_hz = 10000,
+};
+
+static spm_device_t *open_dac_dev(void)
+{
+    spm_sys_fake_reset();
+    memset(&g_dac, 0, sizeof g_dac);
+    spm_sys_fake_set_xfer_handler(dac_xfer, &g_dac);
+
+    spm_device_t *dev = NULL;
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 1000000, .bits_per_word = 8 };
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+    return dev;
+}
+
+static void wait_samples(spm_dac_t *dac, uint64_t n)
+{
+    spm_dac_stats_t st = {0};
+    for (int i = 0; i < 2000 && st.samples < n; i++) {
+        assert(spm_dac_get_stats(dac, &st) == SPM_OK);
+        if (st.samples < n) usleep(1000);
+    }
+    assert(st.samples >= n);
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_t *dac = NULL;
+
+    assert(spm_dac_create(dev, &MCP4921, NULL) == SPM_EPARAM);
+    assert(spm_dac_create(NULL, &MCP4921, &dac) == SPM_EPARAM);
+    assert(spm_dac_create(dev, NULL, &dac) == SPM_EPARAM);
+
+    spm_dac_cfg_t bad = MCP4921;
+    bad.data_shift = 5;
+    assert(spm_dac_create(dev, &bad, &dac) == SPM_EPARAM);
+
+    bad = MCP4921;
+    bad.sample_rate_hz = 0;
+    assert(spm_dac_create(dev, &bad, &dac) == SPM_EPARAM);
+
+    bad = MCP4921;
+    bad.samples_per_msg = SPM_MAX_BATCH_XFERS + 1;
+    bad.bufsiz = 1u << 20;
+    assert(spm_dac_create(dev, &bad, &dac) == SPM_EPARAM);
+
+    /* each word counts SPM_BUFSIZ_ALIGN bytes against bufsiz */
+    bad = MCP4921;
+    bad.samples_per_msg = SPM_BUFSIZ_DEFAULT / SPM_BUFSIZ_ALIGN + 1;
+    assert(spm_dac_create(dev, &bad, &dac) == SPM_EPARAM);
+
+    bad = MCP4921;
+    bad.bufsiz = SPM_BUFSIZ_ALIGN - 1;
+    assert(spm_dac_create(dev, &bad, &dac) == SPM_EPARAM);
+    assert(dac == NULL);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void encode_builds_command_words(void)
+{
+    uint32_t s[3] = { 0x000, 0xABC, 0x1FFF };   /* last one is masked to 12 bits */
+    uint8_t out[6];
+
+    assert(spm_dac_encode(&MCP4921, s, 3, out) == SPM_OK);
+    assert(out[0] == 0x70 && out[1] == 0x00);
+    assert(out[2] == 0x7A && out[3] == 0xBC);
+    assert(out[4] == 0x7F && out[5] == 0xFF);
+
+    spm_dac_cfg_t dac24 = { .word_len = 3, .bits = 16, .cmd = 0x310000, .sample_rate_hz = 1 };
+    uint32_t v = 0x1234;
+    assert(spm_dac_encode(&dac24, &v, 1, out) == SPM_OK);
+    assert(out[0] == 0x31 && out[1] == 0x12 && out[2] == 0x34);
+
+    assert(spm_dac_encode(NULL, s, 3, out) == SPM_EPARAM);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Playback ====================== */
+/* ====================================================== */
+
+static void streaming_sends_paced_frames_in_order(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &MCP4921, &dac) == SPM_OK);
+
+    uint32_t s[200];
+    for (int i = 0; i < 200; i++) s[i] = (uint32_t)i * 20;
+
+    size_t written = 0;
+    assert(spm_dac_write(dac, s, 200, 0, &written) == SPM_OK);
+    assert(written == 200);
+    assert(spm_dac_start(dac) == SPM_OK);
+    assert(spm_dac_start(dac) == SPM_ESTATE);
+    wait_samples(dac, 200);
+    assert(spm_dac_stop(dac) == SPM_OK);
+
+    for (int i = 0; i < 200; i++) assert(g_dac.words[i] == (0x7000 | (i * 20)));
+    assert(g_dac.bad_frames == 0);
+
+    /* 100 us period minus 16 us on the wire at 1 MHz */
+    spm_dac_stats_t st;
+    assert(spm_dac_get_stats(dac, &st) == SPM_OK);
+    assert(st.delay_usecs == 84);
+    assert(g_dac.delay_usecs == 84);
+    assert(st.paced_rate_hz > 9999.0 && st.paced_rate_hz < 10001.0);
+    assert(st.messages == 7);           /* 32 two-byte words fill 4096 bytes */
+    assert(st.rate_hz > 0.0);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void empty_ring_counts_underrun(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &MCP4921, &dac) == SPM_OK);
+    assert(spm_dac_start(dac) == SPM_OK);
+
+    uint32_t s[10] = {0};
+    assert(spm_dac_write(dac, s, 10, 100, NULL) == SPM_OK);
+    wait_samples(dac, 10);
+    assert(spm_dac_write(dac, s, 10, 100, NULL) == SPM_OK);
+    wait_samples(dac, 20);
+    assert(spm_dac_stop(dac) == SPM_OK);
+
+    spm_dac_stats_t st;
+    assert(spm_dac_get_stats(dac, &st) == SPM_OK);
+    assert(st.underruns >= 1 && st.underruns <= 2);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void full_ring_times_out_with_partial_write(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_cfg_t cfg = MCP4921;
+    cfg.ring_len = 16;
+
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &cfg, &dac) == SPM_OK);
+
+    uint32_t s[20] = {0};
+    size_t written = 0;
+    assert(spm_dac_write(dac, s, 20, 10, &written) == SPM_ETIMEOUT);
+    assert(written == 16);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void loop_mode_repeats_table(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &MCP4921, &dac) == SPM_OK);
+
+    uint32_t table[10];
+    for (int i = 0; i < 10; i++) table[i] = (uint32_t)(i * 400);
+    assert(spm_dac_load_loop(dac, table, 10) == SPM_OK);
+
+    assert(spm_dac_start(dac) == SPM_OK);
+    assert(spm_dac_load_loop(dac, NULL, 0) == SPM_ESTATE);
+    wait_samples(dac, 35);
+    assert(spm_dac_stop(dac) == SPM_OK);
+
+    for (int i = 0; i < 35; i++) assert(g_dac.words[i] == (0x7000 | table[i % 10]));
+    assert(g_dac.bad_frames == 0);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_error_stops_playback(void)
+{
+    spm_device_t *dev = open_dac_dev();
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &MCP4921, &dac) == SPM_OK);
+
+    spm_sys_fake_fail_ioctl();
+    uint32_t s[4] = {0};
+    assert(spm_dac_start(dac) == SPM_OK);
+    assert(spm_dac_write(dac, s, 4, 100, NULL) == SPM_OK);
+
+    spm_dac_stats_t st = {0};
+    for (int i = 0; i < 1000 && st.errors == 0; i++) {
+        usleep(1000);
+        assert(spm_dac_get_stats(dac, &st) == SPM_OK);
+    }
+    assert(st.errors == 1);
+    assert(spm_dac_write(dac, s, 4, 0, NULL) != SPM_OK);
+    assert(spm_dac_stop(dac) != SPM_OK);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void default_config_plays_back_on_simulator(void)
+{
+    spm_sim_reset();
+    assert(spm_sim_add("/dev/spidev0.0", 1000000, NULL, NULL) == SPM_OK);
+    spm_device_t *dev = NULL;
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 1000000, .bits_per_word = 8 };
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+
+    spm_dac_cfg_t dcfg = MCP4921;
+    dcfg.sample_rate_hz = 1000000;
+    spm_dac_t *dac = NULL;
+    assert(spm_dac_create(dev, &dcfg, &dac) == SPM_OK);
+
+    uint32_t s[200] = {0};
+    assert(spm_dac_write(dac, s, 200, 0, NULL) == SPM_OK);
+    assert(spm_dac_start(dac) == SPM_OK);
+    wait_samples(dac, 200);
+    assert(spm_dac_stop(dac) == SPM_OK);
+
+    spm_dac_stats_t st;
+    assert(spm_dac_get_stats(dac, &st) == SPM_OK);
+    assert(st.samples == 200 && st.errors == 0);
+
+    spm_sim_stats_t ss;
+    assert(spm_sim_get_stats("/dev/spidev0.0", &ss) == SPM_OK);
+    assert(ss.errors == 0 && ss.messages == st.messages);
+
+    spm_dac_destroy(dac);
+    spm_dev_close(dev);
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    encode_builds_command_words();
+    // playback
+    streaming_sends_paced_frames_in_order();
+    empty_ring_counts_underrun();
+    full_ring_times_out_with_partial_write();
+    loop_mode_repeats_table();
+    write_error_stops_playback();
+    default_config_plays_back_on_simulator();
+
+    TEST_PASS();
+    return 0;
+}
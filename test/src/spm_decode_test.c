@@ -0,0 +1,182 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spm_decode.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+#define MAX_FRAMES 1000
+#define MAX_CH     4
+
+static uint8_t g_buf[MAX_FRAMES * 32];
+
+static void fill_random(void)
+{
+    srand(1234);
+    for (size_t i = 0; i < sizeof g_buf; i++) g_buf[i] = (uint8_t)rand();
+}
+
+/* Straightforward reference: mask, then sign-extend */
+static int32_t ref_sample(const spm_fmt_t *f, const uint8_t *p)
+{
+    uint64_t raw = 0;
+    for (unsigned i = 0; i < f->container; i++) {
+        unsigned b = f->little_endian ? f->container - 1 - i : i;
+        raw = (raw << 8) | p[b];
+    }
+    uint64_t v = (raw >> f->shift) & ((1ull << f->bits) - 1);
+    if (f->is_signed && (v >> (f->bits - 1)) & 1) v |= ~((1ull << f->bits) - 1);
+    return (int32_t)(uint32_t)v;
+}
+
+static void check_format(const spm_fmt_t *f)
+{
+    size_t ch = f->channels ? f->channels : 1;
+    size_t stride = spm_fmt_frame_len(f);
+    static int32_t out[MAX_CH][MAX_FRAMES];
+    int32_t *outs[MAX_CH] = { out[0], out[1], out[2], out[3] };
+
+    for (size_t n = 0; n <= 40; n++) {
+        assert(spm_decode_i32(f, g_buf, n, outs) == SPM_OK);
+        for (size_t i = 0; i < n; i++)
+            for (size_t c = 0; c < ch; c++)
+                assert(out[c][i] == ref_sample(f, g_buf + i * stride + f->header_len + c * f->container));
+    }
+
+    assert(spm_decode_i32(f, g_buf, MAX_FRAMES, outs) == SPM_OK);
+    for (size_t i = 0; i < MAX_FRAMES; i++)
+        for (size_t c = 0; c < ch; c++)
+            assert(out[c][i] == ref_sample(f, g_buf + i * stride + f->header_len + c * f->container));
+}
+
+/* ====================================================== */
+/* ======================= Decode ======================= */
+/* ====================================================== */
+
+static void decode_single_channel_formats_match_reference(void)
+{
+    const spm_fmt_t fmts[] = {
+        { .bits = 16, .container = 2, .is_signed = true },
+        { .bits = 16, .container = 2, .little_endian = true },
+        { .bits = 12, .container = 2, .shift = 2, .is_signed = true },
+        { .bits = 24, .container = 3, .is_signed = true },
+        { .bits = 24, .container = 3, .little_endian = true },
+        { .bits = 18, .container = 3, .shift = 6, .is_signed = true },
+        { .bits = 20, .container = 3, .shift = 0, .is_signed = true },
+        { .bits = 20, .container = 3, .shift = 4 },
+        { .bits = 32, .container = 4, .is_signed = true, .little_endian = true },
+        { .bits = 8,  .container = 1, .is_signed = true },
+    };
+
+    for (size_t i = 0; i < sizeof fmts / sizeof fmts[0]; i++) check_format(&fmts[i]);
+    TEST_PASS();
+}
+
+static void decode_deinterleaves_channels(void)
+{
+    const spm_fmt_t fmts[] = {
+        { .bits = 24, .container = 3, .is_signed = true, .channels = 4 },
+        { .bits = 16, .container = 2, .is_signed = true, .channels = 3 },
+        { .bits = 16, .container = 2, .channels = 2, .little_endian = true },
+    };
+
+    for (size_t i = 0; i < sizeof fmts / sizeof fmts[0]; i++) check_format(&fmts[i]);
+    TEST_PASS();
+}
+
+static void decode_skips_headers_and_honours_stride(void)
+{
+    const spm_fmt_t fmts[] = {
+        { .bits = 24, .container = 3, .is_signed = true, .header_len = 1, .channels = 2 },
+        { .bits = 18, .container = 3, .shift = 6, .is_signed = true, .header_len = 2 },
+        { .bits = 16, .container = 2, .channels = 2, .stride = 8 },
+    };
+
+    for (size_t i = 0; i < sizeof fmts / sizeof fmts[0]; i++) check_format(&fmts[i]);
+    TEST_PASS();
+}
+
+static void decode_f32_applies_scale_and_offset(void)
+{
+    const uint8_t buf[] = { 0x7F, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF };
+    const spm_fmt_t f = { .bits = 16, .container = 2, .is_signed = true, .channels = 2 };
+    float a[2], b[2];
+    float *outs[2] = { a, b };
+
+    assert(spm_decode_f32(&f, buf, 2, outs, 0.5f, 1.0f) == SPM_OK);
+    assert(a[0] == 32767 * 0.5f + 1.0f);
+    assert(b[0] == -32768 * 0.5f + 1.0f);
+    assert(a[1] == 1 * 0.5f + 1.0f);
+    assert(b[1] == -1 * 0.5f + 1.0f);
+
+    TEST_PASS();
+}
+
+static void decode_fails_invalid_input(void)
+{
+    int32_t o[4];
+    int32_t *outs[2] = { o, NULL };
+    const spm_fmt_t ok = { .bits = 16, .container = 2 };
+
+    assert(spm_decode_i32(NULL, g_buf, 1, outs) == SPM_EPARAM);
+    assert(spm_decode_i32(&ok, NULL, 1, outs) == SPM_EPARAM);
+    assert(spm_decode_i32(&ok, g_buf, 1, NULL) == SPM_EPARAM);
+
+    spm_fmt_t bad = { .bits = 17, .container = 2 };
+    assert(spm_decode_i32(&bad, g_buf, 1, outs) == SPM_EPARAM);
+    bad = (spm_fmt_t){ .bits = 16, .container = 5 };
+    assert(spm_decode_i32(&bad, g_buf, 1, outs) == SPM_EPARAM);
+    bad = (spm_fmt_t){ .bits = 16, .container = 2, .shift = 1 };
+    assert(spm_decode_i32(&bad, g_buf, 1, outs) == SPM_EPARAM);
+    bad = (spm_fmt_t){ .bits = 16, .container = 2, .channels = 2, .stride = 3 };
+    assert(spm_decode_i32(&bad, g_buf, 1, outs) == SPM_EPARAM);
+    bad = (spm_fmt_t){ .bits = 16, .container = 2, .channels = 2 };
+    assert(spm_decode_i32(&bad, g_buf, 1, outs) == SPM_EPARAM);
+
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =========================== Main ===================== */
+/* ====================================================== */
+
+int main(void)
+{
+    fill_random();
+    printf("decode kernel: %s\n", spm_decode_kernel());
+
+    decode_single_channel_formats_match_reference();
+    decode_deinterleaves_channels();
+    decode_skips_headers_and_honours_stride();
+    decode_f32_applies_scale_and_offset();
+    decode_fails_invalid_input();
+
+    TEST_PASS();
+    return 0;
+}
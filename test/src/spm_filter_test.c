@@ -0,0 +1,304 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spi_monkey.h"
+#include "spm_acq.h"
+#include "spm_filter.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+static uint32_t g_rng = 12345;
+
+static int32_t rand_sample(int32_t amp)
+{
+    g_rng = g_rng * 1103515245u + 12345u;
+    return (int32_t)((g_rng >> 8) % (uint32_t)(2 * amp + 1)) - amp;
+}
+
+/* Feeds n samples per channel in irregular chunks */
+static size_t run_chunked(spm_filter_t *f, unsigned ch, int32_t *const *in, size_t n, float *const *out)
+{
+    static const size_t chunks[] = { 1, 7, 64, 3, 100, 13 };
+    size_t done = 0, total = 0;
+
+    for (size_t k = 0; done < n; k++) {
+        size_t len = chunks[k % 6];
+        if (len > n - done) len = n - done;
+
+        const int32_t *ip[4];
+        float *op[4];
+        for (unsigned c = 0; c < ch; c++) {
+            ip[c] = in[c] + done;
+            op[c] = out[c] + total;
+        }
+
+        size_t on = 0;
+        assert(spm_filter_process(f, ip, len, op, &on) == SPM_OK);
+        done += len;
+        total += on;
+    }
+    return total;
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    spm_filter_t *f = NULL;
+    spm_filter_cfg_t cfg = { .type = SPM_FILTER_MOVAVG, .decim = 4 };
+
+    assert(spm_filter_create(&cfg, NULL) == SPM_EPARAM);
+    assert(spm_filter_create(NULL, &f) == SPM_EPARAM);
+
+    spm_filter_cfg_t bad = { .type = SPM_FILTER_FIR, .decim = 2 };
+    assert(spm_filter_create(&bad, &f) == SPM_EPARAM);
+
+    bad = (spm_filter_cfg_t){ .type = SPM_FILTER_CIC, .decim = 64, .stages = 6 };   /* 36 bits growth */
+    assert(spm_filter_create(&bad, &f) == SPM_EPARAM);
+
+    bad = (spm_filter_cfg_t){ .type = SPM_FILTER_CIC, .stages = 7 };
+    assert(spm_filter_create(&bad, &f) == SPM_EPARAM);
+    assert(f == NULL);
+
+    assert(spm_filter_create(&cfg, &f) == SPM_OK);
+    size_t on;
+    assert(spm_filter_process(f, NULL, 1, NULL, &on) == SPM_EPARAM);
+    assert(spm_filter_acq_process(f, (uint8_t *)"", &on) == SPM_EPARAM);   /* no fmt */
+    spm_filter_destroy(f);
+
+    assert(spm_filter_kernel() != NULL);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Filters ======================= */
+/* ====================================================== */
+
+static void movavg_averages_and_decimates(void)
+{
+    spm_filter_cfg_t cfg = { .type = SPM_FILTER_MOVAVG, .decim = 4, .len = 8, .scale = 0.5f };
+    spm_filter_t *f = NULL;
+    assert(spm_filter_create(&cfg, &f) == SPM_OK);
+
+    int32_t x[400];
+    for (int i = 0; i < 400; i++) x[i] = i;
+    float y[101];
+    int32_t *in[1] = { x };
+    float *out[1] = { y };
+
+    size_t n = run_chunked(f, 1, in, 400, out);
+    assert(n == 100);
+
+    /* Output k covers inputs 4k-4 .. 4k+3 */
+    for (size_t k = 1; k < n; k++) {
+        double ref = 0;
+        for (int j = 0; j < 8; j++) ref += (double)(4 * (int)k + 3 - j);
+        assert(fabs(y[k] - ref / 8 * 0.5) < 1e-3);
+    }
+
+    spm_filter_stats_t st;
+    assert(spm_filter_get_stats(f, &st) == SPM_OK);
+    assert(st.in_samples == 400);
+    assert(st.out_samples == 100);
+    assert(st.calls > 1);
+
+    spm_filter_destroy(f);
+    TEST_PASS();
+}
+
+static void cic_matches_reference(void)
+{
+    enum { R = 8, N = 3, LEN = 2000 };
+    spm_filter_cfg_t cfg = { .type = SPM_FILTER_CIC, .decim = R, .stages = N, .channels = 2 };
+    spm_filter_t *f = NULL;
+    assert(spm_filter_create(&cfg, &f) == SPM_OK);
+
+    static int32_t x0[LEN], x1[LEN];
+    static float y0[LEN / R + 1], y1[LEN / R + 1];
+    for (int i = 0; i < LEN; i++) {
+        x0[i] = rand_sample(1 << 23);
+        x1[i] = 5000;
+    }
+    int32_t *in[2] = { x0, x1 };
+    float *out[2] = { y0, y1 };
+    size_t n = run_chunked(f, 2, in, LEN, out);
+    assert(n == LEN / R);
+
+    /* Direct form: sum of the last R inputs, N times over */
+    static double s[N + 1][LEN];
+    for (int i = 0; i < LEN; i++) s[0][i] = x0[i];
+    for (int k = 1; k <= N; k++) {
+        for (int i = 0; i < LEN; i++) {
+            double acc = 0;
+            for (int j = 0; j < R && j <= i; j++) acc += s[k - 1][i - j];
+            s[k][i] = acc;
+        }
+    }
+    for (size_t m = 0; m < n; m++) {
+        double ref = s[N][m * R + R - 1] / (R * R * R);
+        assert(fabs(y0[m] - ref) <= fabs(ref) * 1e-6 + 1e-3);
+    }
+
+    /* Unity DC gain once settled */
+    for (size_t m = N; m < n; m++) assert(fabs(y1[m] - 5000.0f) < 1e-3);
+
+    spm_filter_destroy(f);
+    TEST_PASS();
+}
+
+static void fir_matches_reference_across_blocks(void)
+{
+    enum { NT = 37, R = 3, LEN = 1500 };
+    float taps[NT];
+    for (int i = 0; i < NT; i++) taps[i] = (float)rand_sample(1000) / 1000.0f;
+
+    spm_filter_cfg_t cfg = {
+        .type = SPM_FILTER_FIR, .decim = R, .channels = 2,
+        .taps = taps, .ntaps = NT, .scale = 0.25f,
+    };
+    spm_filter_t *f = NULL;
+    assert(spm_filter_create(&cfg, &f) == SPM_OK);
+
+    static int32_t x0[LEN], x1[LEN];
+    static float y0[LEN / R + 1], y1[LEN / R + 1];
+    for (int i = 0; i < LEN; i++) {
+        x0[i] = rand_sample(30000);
+        x1[i] = -x0[i];
+    }
+    int32_t *in[2] = { x0, x1 };
+    float *out[2] = { y0, y1 };
+    size_t n = run_chunked(f, 2, in, LEN, out);
+    assert(n == LEN / R);
+
+    for (size_t m = 0; m < n; m++) {
+        int i = (int)m * R + R - 1;
+        double ref = 0;
+        for (int j = 0; j < NT && j <= i; j++) ref += (double)taps[j] * x0[i - j];
+        ref *= 0.25;
+        assert(fabs(y0[m] - ref) <= 1e-4 * (fabs(ref) + 1000.0));
+        assert(fabs(y1[m] + y0[m]) <= 1e-4 * (fabs(ref) + 1000.0));
+    }
+
+    spm_filter_reset(f);
+    size_t on = 0;
+    const int32_t *ip[2] = { x0, x1 };
+    float *op[2] = { y0, y1 };
+    assert(spm_filter_process(f, ip, R, op, &on) == SPM_OK);
+    assert(on == 1);
+
+    spm_filter_destroy(f);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ==================== Acquisition ===================== */
+/* ====================================================== */
+
+/* Two big-endian 16-bit channels: ch0 = 1000, ch1 = -2000 */
+static void adc_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        for (uint32_t k = 0; k + 4 <= trs[i].len; k += 4) {
+            rx[k + 0] = 0x03; rx[k + 1] = 0xE8;
+            rx[k + 2] = 0xF8; rx[k + 3] = 0x30;
+        }
+    }
+}
+
+static void acq_process_hook_decimates_blocks(void)
+{
+    spm_sys_fake_reset();
+    spm_sys_fake_set_xfer_handler(adc_xfer, NULL);
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+
+    spm_fmt_t fmt = { .bits = 16, .container = 2, .is_signed = true, .channels = 2 };
+    spm_filter_cfg_t fcfg = {
+        .type = SPM_FILTER_CIC, .decim = 4, .stages = 2, .channels = 2, .fmt = &fmt,
+    };
+    spm_filter_t *f = NULL;
+    assert(spm_filter_create(&fcfg, &f) == SPM_OK);
+
+    spm_acq_cfg_t cfg = {
+        .block_len = 256, .nbufs = 3, .frame_len = 4,
+        .process = spm_filter_acq_process, .process_ctx = f,
+    };
+    spm_acq_t *acq = NULL;
+    assert(spm_acq_create(dev, &cfg, &acq) == SPM_OK);
+    assert(spm_acq_start(acq) == SPM_OK);
+
+    for (int b = 0; b < 3; b++) {
+        spm_acq_block_t blk;
+        assert(spm_acq_acquire(acq, 1000, &blk) == SPM_OK);
+        assert(blk.len == 16 * 2 * sizeof(float));
+
+        const float *v = (const float *)(const void *)blk.data;
+        for (int k = (b == 0 ? 2 : 0); k < 16; k++) {
+            assert(fabsf(v[2 * k] - 1000.0f) < 1e-3f);
+            assert(fabsf(v[2 * k + 1] + 2000.0f) < 1e-3f);
+        }
+        assert(spm_acq_release(acq, &blk) == SPM_OK);
+    }
+    assert(spm_acq_stop(acq) == SPM_OK);
+
+    spm_acq_stats_t ast;
+    assert(spm_acq_get_stats(acq, &ast) == SPM_OK);
+    assert(ast.errors == 0);
+
+    spm_filter_stats_t fst;
+    assert(spm_filter_get_stats(f, &fst) == SPM_OK);
+    assert(fst.in_samples == ast.blocks * 64 * 2);
+    assert(fst.out_samples * 4 == fst.in_samples);
+
+    spm_acq_destroy(acq);
+    spm_filter_destroy(f);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    // filters
+    movavg_averages_and_decimates();
+    cic_matches_reference();
+    fir_matches_reference_across_blocks();
+    // acquisition
+    acq_process_hook_decimates_blocks();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,347 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spi_monkey.h"
+#include "spm_gather.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ===================== Sim Models ===================== */
+/* ====================================================== */
+
+#define NOR_SIZE   (1024u * 1024u)
+
+/*
+ * SPI NOR answering READ 0x03 with 3 address bytes, and a register
+ * device: first byte 0x80 | reg, then registers from reg upwards.
+ */
+typedef struct {
+    uint8_t   mem[NOR_SIZE];
+    uint8_t   regs[128];
+    unsigned  frames;
+    unsigned  bad_frames;
+} model_t;
+
+static model_t g_m;
+
+static void nor_frame(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+    if (len < 4 || tx[0] != 0x03) {
+        g_m.bad_frames++;
+        return;
+    }
+    uint32_t addr = (uint32_t)tx[1] << 16 | (uint32_t)tx[2] << 8 | tx[3];
+    for (size_t k = 4; k < len; k++) rx[k] = g_m.mem[(addr + k - 4) % NOR_SIZE];
+}
+
+static void reg_frame(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+    if (len < 1 || !(tx[0] & 0x80)) {
+        g_m.bad_frames++;
+        return;
+    }
+    for (size_t k = 1; k < len; k++) rx[k] = g_m.regs[(tx[0] + k - 1) & 0x7F];
+}
+
+/* Flattens each CS frame so the frame handlers see one byte stream */
+static void model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    void (*frame)(const uint8_t *, uint8_t *, size_t) = ctx;
+    static uint8_t tx[8192], rx[8192];
+    size_t pos = 0, start = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *t = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        assert(pos + trs[i].len <= sizeof tx);
+        if (t) memcpy(tx + pos, t, trs[i].len);
+        else   memset(tx + pos, 0, trs[i].len);
+        pos += trs[i].len;
+
+        if (!trs[i].cs_change && i + 1 != n) continue;
+        memset(rx, 0xEE, pos);
+        frame(tx, rx, pos);
+        g_m.frames++;
+        for (size_t j = start, off = 0; j <= i; off += trs[j].len, j++) {
+            uint8_t *r = (uint8_t *)(uintptr_t)trs[j].rx_buf;
+            if (r) memcpy(r, rx + off, trs[j].len);
+        }
+        pos = 0;
+        start = i + 1;
+    }
+}
+
+static spm_device_t *open_model(void (*frame)(const uint8_t *, uint8_t *, size_t))
+{
+    spm_sim_reset();
+    memset(&g_m, 0, sizeof g_m);
+    for (size_t i = 0; i < NOR_SIZE; i++) g_m.mem[i] = (uint8_t)(i * 7 + (i >> 8));
+    for (size_t i = 0; i < sizeof g_m.regs; i++) g_m.regs[i] = (uint8_t)(0xA0 ^ i);
+    assert(spm_sim_add("/dev/spidev0.0", 0, model, (void *)frame) == SPM_OK);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 20000000, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+static void check_req(const spm_gather_req_t *r)
+{
+    const uint8_t *d = r->dst;
+    for (size_t k = 0; k < r->len; k++) assert(d[k] == g_m.mem[r->addr + k]);
+}
+
+/* ====================================================== */
+/* ======================= Tests ======================== */
+/* ====================================================== */
+
+static void bad_requests_are_rejected(void)
+{
+    spm_device_t *dev = open_model(nor_frame);
+    uint8_t buf[16];
+    spm_gather_plan_t *plan = (spm_gather_plan_t *)1;
+    spm_gather_req_t ok = { 0x100, 4, buf };
+
+    assert(spm_gather_plan_create(dev, NULL, &ok, 0, &plan) == SPM_EPARAM);
+    assert(plan == NULL);
+    assert(spm_gather_plan_create(dev, NULL, NULL, 1, &plan) == SPM_EPARAM);
+    assert(spm_gather_plan_create(dev, NULL, &ok, 1, NULL) == SPM_EPARAM);
+
+    spm_gather_req_t empty = { 0x100, 0, buf };
+    spm_gather_req_t nodst = { 0x100, 4, NULL };
+    spm_gather_req_t past  = { 0xFFFFFE, 4, buf };
+    assert(spm_gather_plan_create(dev, NULL, &empty, 1, &plan) == SPM_EPARAM);
+    assert(spm_gather_plan_create(dev, NULL, &nodst, 1, &plan) == SPM_EPARAM);
+    assert(spm_gather_plan_create(dev, NULL, &past, 1, &plan) == SPM_EPARAM);
+
+    spm_gather_cfg_t wide = { .addr_bytes = 5 };
+    spm_gather_cfg_t tiny = { .max_msg = SPM_BUFSIZ_ALIGN - 1 };
+    assert(spm_gather_plan_create(dev, &wide, &ok, 1, &plan) == SPM_EPARAM);
+    assert(spm_gather_plan_create(dev, &tiny, &ok, 1, &plan) == SPM_EPARAM);
+    assert(spm_gather_plan_read(dev, NULL) == SPM_EPARAM);
+    assert(spm_gather_plan_get_info(NULL, NULL) == SPM_EPARAM);
+    spm_gather_plan_destroy(NULL);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void near_reads_merge_and_far_reads_split(void)
+{
+    spm_device_t *dev = open_model(nor_frame);
+    uint8_t a[4], b[4], c[6], d[6], e[8];
+    /* out of order; c overlaps b, d repeats c, e is far away */
+    spm_gather_req_t reqs[] = {
+        { 0x2000, sizeof e, e },
+        { 0x10A,  sizeof c, c },
+        { 0x100,  sizeof a, a },
+        { 0x10A,  sizeof d, d },
+        { 0x108,  sizeof b, b },
+    };
+
+    /* 20 MHz: 400 ns a byte, so 4000 ns covers 10 bytes plus the header */
+    spm_gather_cfg_t cfg = { .frame_ns = 4000 };
+    spm_gather_plan_t *plan = NULL;
+    assert(spm_gather_plan_create(dev, &cfg, reqs, 5, &plan) == SPM_OK);
+
+    spm_gather_info_t info;
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.requests == 5);
+    assert(info.spans == 2);
+    assert(info.frames == 2);
+    assert(info.messages == 1);
+    assert(info.bytes_wanted == 28);
+    assert(info.bytes_read == 16 + 8);
+    assert(info.est_ns == 2 * 4000 + (4 + 16 + 4 + 8) * 400);
+    assert(info.est_split_ns > info.est_ns);
+
+    for (int round = 0; round < 2; round++) {
+        memset(a, 0, sizeof a); memset(b, 0, sizeof b); memset(c, 0, sizeof c);
+        memset(d, 0, sizeof d); memset(e, 0, sizeof e);
+        g_m.frames = 0;
+        assert(spm_gather_plan_read(dev, plan) == SPM_OK);
+        assert(g_m.frames == 2);
+        for (size_t i = 0; i < 5; i++) check_req(&reqs[i]);
+    }
+    spm_gather_plan_destroy(plan);
+
+    /* when frames are cheap the 4-byte gap no longer pays */
+    spm_gather_req_t apart[] = { { 0x100, 4, a }, { 0x10C, 4, b } };
+    cfg.frame_ns = 1;
+    assert(spm_gather_plan_create(dev, &cfg, apart, 2, &plan) == SPM_OK);
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.spans == 2 && info.bytes_read == 8);
+    spm_gather_plan_destroy(plan);
+
+    cfg.frame_ns = 4000;
+    assert(spm_gather_plan_create(dev, &cfg, apart, 2, &plan) == SPM_OK);
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.spans == 1 && info.bytes_read == 16);
+    spm_gather_plan_destroy(plan);
+
+    assert(g_m.bad_frames == 0);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void large_gathers_split_into_messages(void)
+{
+    spm_device_t *dev = open_model(nor_frame);
+
+    /* a span longer than max_msg is cut into frames of max_msg data bytes */
+    uint8_t big[600];
+    spm_gather_req_t one = { 0x3000, sizeof big, big };
+    spm_gather_cfg_t small = { .max_msg = 2 * SPM_BUFSIZ_ALIGN };
+    spm_gather_plan_t *plan = NULL;
+    assert(spm_gather_plan_create(dev, &small, &one, 1, &plan) == SPM_OK);
+    spm_gather_info_t info;
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.spans == 1);
+    assert(info.frames == 3);          /* 256 + 256 + 88 */
+    assert(info.messages == 3);
+    memset(big, 0, sizeof big);
+    g_m.frames = 0;
+    spm_sim_set_bufsiz(small.max_msg);
+    assert(spm_gather_plan_read(dev, plan) == SPM_OK);
+    spm_sim_set_bufsiz(0);
+    assert(g_m.frames == 3);
+    check_req(&one);
+    spm_gather_plan_destroy(plan);
+
+    /* sparse words: every header and data transfer counts SPM_BUFSIZ_ALIGN */
+    static uint8_t words[64][4];
+    spm_gather_req_t wreqs[64];
+    for (size_t i = 0; i < 64; i++) wreqs[i] = (spm_gather_req_t){ (uint32_t)(i * 4096), 4, words[i] };
+    assert(spm_gather_plan_create(dev, NULL, wreqs, 64, &plan) == SPM_OK);
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.frames == 64);
+    assert(info.messages == 64 / (SPM_BUFSIZ_DEFAULT / SPM_BUFSIZ_ALIGN));
+    memset(words, 0, sizeof words);
+    assert(spm_gather_plan_read(dev, plan) == SPM_OK);
+    for (size_t i = 0; i < 64; i++) check_req(&wreqs[i]);
+    spm_gather_plan_destroy(plan);
+
+    /* scattered bytes at the simulator's default bufsiz: 32 frames a message */
+    enum { N = 300 };
+    static uint8_t dst[N];
+    static spm_gather_req_t reqs[N];
+    for (size_t i = 0; i < N; i++) reqs[i] = (spm_gather_req_t){ (uint32_t)(i * 1000), 1, &dst[i] };
+    const size_t per_msg = SPM_BUFSIZ_DEFAULT / SPM_BUFSIZ_ALIGN;
+    assert(spm_gather_plan_create(dev, NULL, reqs, N, &plan) == SPM_OK);
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.spans == N && info.frames == N);
+    assert(info.messages == (N + per_msg - 1) / per_msg);
+    memset(dst, 0, sizeof dst);
+    g_m.frames = 0;
+    assert(spm_gather_plan_read(dev, plan) == SPM_OK);
+    assert(g_m.frames == N);
+    for (size_t i = 0; i < N; i++) check_req(&reqs[i]);
+    spm_gather_plan_destroy(plan);
+
+    /* with a large bufsiz, SPM_MAX_BATCH_XFERS bounds a message */
+    spm_gather_cfg_t roomy = { .max_msg = 65536 };
+    assert(spm_gather_plan_create(dev, &roomy, reqs, N, &plan) == SPM_OK);
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.messages == (2 * N + SPM_MAX_BATCH_XFERS - 1) / SPM_MAX_BATCH_XFERS);
+    spm_gather_plan_destroy(plan);
+
+    assert(g_m.bad_frames == 0);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void register_reads_use_address_framing(void)
+{
+    spm_device_t *dev = open_model(reg_frame);
+    uint8_t status[2], irq, fifo[4];
+    spm_gather_req_t reqs[] = {
+        { 0x10, sizeof status, status },
+        { 0x14, 1,             &irq },
+        { 0x40, sizeof fifo,   fifo },
+    };
+    spm_gather_cfg_t cfg = { .addr_only = true, .addr_bytes = 1, .addr_mask = 0x80 };
+
+    spm_gather_plan_t *plan = NULL;
+    assert(spm_gather_plan_create(dev, &cfg, reqs, 3, &plan) == SPM_OK);
+    spm_gather_info_t info;
+    assert(spm_gather_plan_get_info(plan, &info) == SPM_OK);
+    assert(info.spans == 2);           /* 0x10..0x14 merge, 0x40 stays apart */
+    assert(info.bytes_read == 5 + 4);
+
+    g_m.frames = 0;
+    assert(spm_gather_plan_read(dev, plan) == SPM_OK);
+    assert(g_m.frames == 2);
+    assert(status[0] == (0xA0 ^ 0x10) && status[1] == (0xA0 ^ 0x11));
+    assert(irq == (0xA0 ^ 0x14));
+    for (size_t k = 0; k < sizeof fifo; k++) assert(fifo[k] == (0xA0 ^ (0x40 + k)));
+    spm_gather_plan_destroy(plan);
+
+    spm_gather_req_t past = { 0xFF, 2, fifo };
+    assert(spm_gather_plan_create(dev, &cfg, &past, 1, &plan) == SPM_EPARAM);
+
+    assert(g_m.bad_frames == 0);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void calibrate_and_one_shot_read(void)
+{
+    spm_device_t *dev = open_model(nor_frame);
+
+    spm_gather_cfg_t cfg = { 0 };
+    assert(spm_gather_calibrate(dev, &cfg, NULL) == SPM_EPARAM);
+    assert(spm_gather_calibrate(dev, &cfg, &cfg.frame_ns) == SPM_OK);
+    assert(cfg.frame_ns > 0);
+
+    uint8_t x[3], y[17];
+    spm_gather_req_t reqs[] = { { 0x500, sizeof x, x }, { 0x50A, sizeof y, y } };
+    assert(spm_gather_read(dev, &cfg, reqs, 2) == SPM_OK);
+    check_req(&reqs[0]);
+    check_req(&reqs[1]);
+    assert(spm_gather_read(dev, NULL, reqs, 0) == SPM_EPARAM);
+
+    assert(g_m.bad_frames == 0);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // planning
+    bad_requests_are_rejected();
+    near_reads_merge_and_far_reads_split();
+    large_gathers_split_into_messages();
+
+    // framing
+    register_reads_use_address_framing();
+    calibrate_and_one_shot_read();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,536 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_kv.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ===================== NOR Model ====================== */
+/* ====================================================== */
+
+#define NOR_SIZE    (64u * 1024u)
+#define NOR_SECTOR  4096u
+#define NOR_PAGE    256u
+
+/* SPI NOR: READ 0x03, PP 0x02, WREN 0x06, RDSR 0x05, SE 0x20 */
+typedef struct {
+    uint8_t   mem[NOR_SIZE];
+    bool      wel;
+    unsigned  busy;                    /* RDSR polls until ready */
+    unsigned  erases[NOR_SIZE / NOR_SECTOR];
+    unsigned  overprograms;            /* attempts to turn a 0 back into 1 */
+    unsigned  ignored;                 /* commands sent while busy */
+    long      cut_bytes;               /* >= 0: power fails after this many programmed bytes */
+} nor_t;
+
+static nor_t g_nor;
+
+static void nor_frame(const struct spi_ioc_transfer *trs, size_t n)
+{
+    const bool busy = g_nor.busy > 0;
+    uint8_t cmd = 0;
+    uint32_t addr = 0;
+    size_t pos = 0;
+
+    for (size_t t = 0; t < n; t++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[t].tx_buf;
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[t].rx_buf;
+        for (uint32_t k = 0; k < trs[t].len; k++, pos++) {
+            uint8_t b = tx ? tx[k] : 0, out = 0xFF;
+            if (pos == 0)      cmd = b;
+            else if (pos <= 3) addr = addr << 8 | b;
+            else if (!busy && cmd == 0x03) {
+                out = g_nor.mem[(addr + pos - 4) % NOR_SIZE];
+            } else if (!busy && cmd == 0x02 && g_nor.wel && g_nor.cut_bytes != 0) {
+                uint32_t a = ((addr & ~(NOR_PAGE - 1)) | ((addr + pos - 4) & (NOR_PAGE - 1))) % NOR_SIZE;
+                if (~g_nor.mem[a] & b) g_nor.overprograms++;
+                g_nor.mem[a] &= b;
+                if (g_nor.cut_bytes > 0) g_nor.cut_bytes--;
+            }
+            if (cmd == 0x05 && pos >= 1) out = (uint8_t)((busy ? 0x01 : 0) | (g_nor.wel ? 0x02 : 0));
+            if (rx) rx[k] = out;
+        }
+    }
+
+    if (cmd == 0x05) {
+        if (g_nor.busy) g_nor.busy--;
+        return;
+    }
+    if (busy) {
+        g_nor.ignored++;
+        return;
+    }
+    if (cmd == 0x06) g_nor.wel = true;
+    if (cmd == 0x02 && g_nor.wel && pos > 4) {
+        g_nor.wel = false;
+        g_nor.busy = 1;
+    }
+    if (cmd == 0x20 && g_nor.wel && pos == 4) {
+        uint32_t s = (addr % NOR_SIZE) / NOR_SECTOR;
+        memset(&g_nor.mem[s * NOR_SECTOR], 0xFF, NOR_SECTOR);
+        g_nor.erases[s]++;
+        g_nor.wel = false;
+        g_nor.busy = 5;
+    }
+}
+
+static void nor_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (trs[i].cs_change || i + 1 == n) {
+            nor_frame(&trs[start], i + 1 - start);
+            start = i + 1;
+        }
+    }
+}
+
+static spm_device_t *open_nor(void)
+{
+    spm_sim_reset();
+    memset(&g_nor, 0, sizeof g_nor);
+    memset(g_nor.mem, 0xFF, sizeof g_nor.mem);
+    g_nor.cut_bytes = -1;
+    assert(spm_sim_add("/dev/spidev0.0", 0, nor_model, NULL) == SPM_OK);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 20000000, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+static void fill_value(uint8_t *v, size_t len, unsigned key, unsigned gen)
+{
+    for (size_t i = 0; i < len; i++) v[i] = (uint8_t)(key * 31u + gen * 7u + i);
+}
+
+static void expect_value(spm_kv_t *kv, const char *key, const uint8_t *want, size_t len)
+{
+    uint8_t got[4096];
+    size_t n = 0;
+    assert(spm_kv_get(kv, key, got, sizeof got, &n) == SPM_OK);
+    assert(n == len);
+    assert(len == 0 || memcmp(got, want, len) == 0);
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_t *kv = (spm_kv_t *)0x1;
+
+    spm_kv_cfg_t cfg = { .sectors = 4 };
+    assert(spm_kv_create(NULL, &cfg, &kv) == SPM_EPARAM);
+    assert(kv == NULL);
+    assert(spm_kv_create(dev, NULL, &kv) == SPM_EPARAM);
+    assert(spm_kv_create(dev, &cfg, NULL) == SPM_EPARAM);
+
+    spm_kv_cfg_t two = { .sectors = 2 };
+    assert(spm_kv_create(dev, &two, &kv) == SPM_EPARAM);
+    spm_kv_cfg_t odd = { .sectors = 4, .sector_size = 3000 };
+    assert(spm_kv_create(dev, &odd, &kv) == SPM_EPARAM);
+    spm_kv_cfg_t unaligned = { .sectors = 4, .base = 100 };
+    assert(spm_kv_create(dev, &unaligned, &kv) == SPM_EPARAM);
+    spm_kv_cfg_t greedy = { .sectors = 4, .gc_free = 4 };
+    assert(spm_kv_create(dev, &greedy, &kv) == SPM_EPARAM);
+
+    spm_kv_destroy(NULL);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void put_get_delete_roundtrip(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .base = 2 * NOR_SECTOR, .sectors = 4 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    const char cal[] = "gain=1.0021;offset=-3";
+    assert(spm_kv_put(kv, "adc.cal", cal, sizeof cal) == SPM_OK);
+    assert(spm_kv_put(kv, "empty", NULL, 0) == SPM_OK);
+    expect_value(kv, "adc.cal", (const uint8_t *)cal, sizeof cal);
+    expect_value(kv, "empty", NULL, 0);
+
+    /* Overwrite, then a buffer that is too small */
+    const char cal2[] = "gain=0.9987;offset=2";
+    assert(spm_kv_put(kv, "adc.cal", cal2, sizeof cal2) == SPM_OK);
+    expect_value(kv, "adc.cal", (const uint8_t *)cal2, sizeof cal2);
+    char small[4];
+    size_t n = 0;
+    assert(spm_kv_get(kv, "adc.cal", small, sizeof small, &n) == SPM_ENOMEM);
+    assert(n == sizeof cal2);
+
+    assert(spm_kv_get(kv, "missing", small, sizeof small, &n) == SPM_EPARAM);
+    assert(spm_kv_delete(kv, "adc.cal") == SPM_OK);
+    assert(spm_kv_get(kv, "adc.cal", small, sizeof small, &n) == SPM_EPARAM);
+    assert(spm_kv_delete(kv, "adc.cal") == SPM_EPARAM);
+    assert(spm_kv_put(kv, "", cal, 1) == SPM_EPARAM);
+
+    /* Only the configured region was touched, never 0 -> 1 */
+    for (uint32_t a = 0; a < 2 * NOR_SECTOR; a++) assert(g_nor.mem[a] == 0xFF);
+    assert(g_nor.overprograms == 0);
+    assert(g_nor.ignored == 0);
+
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.keys == 1);
+    assert(st.puts == 3 && st.deletes == 1);
+    assert(st.dead_bytes > 0);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ======================== Mount ======================= */
+/* ====================================================== */
+
+static void remount_rebuilds_index_in_bulk(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 8 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    uint8_t v[64];
+    for (unsigned gen = 0; gen < 3; gen++) {
+        for (unsigned k = 0; k < 100; k++) {
+            char key[16];
+            snprintf(key, sizeof key, "key%u", k);
+            fill_value(v, sizeof v, k, gen);
+            assert(spm_kv_put(kv, key, v, 16 + k % 48) == SPM_OK);
+        }
+    }
+    assert(spm_kv_delete(kv, "key7") == SPM_OK);
+
+    spm_kv_stats_t before;
+    assert(spm_kv_get_stats(kv, &before) == SPM_OK);
+    spm_kv_destroy(kv);
+
+    spm_sim_reset_stats();
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    /* One message for all headers plus one per used sector */
+    spm_sim_stats_t sim;
+    assert(spm_sim_get_stats("/dev/spidev0.0", &sim) == SPM_OK);
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(sim.messages == 1 + (cfg.sectors - st.sectors_free));
+    assert(st.mount_bytes == cfg.sectors * 16u + (cfg.sectors - st.sectors_free) * NOR_SECTOR);
+    assert(st.keys == 99);
+    assert(st.live_bytes == before.live_bytes);
+    assert(st.dead_bytes == before.dead_bytes);
+
+    for (unsigned k = 0; k < 100; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "key%u", k);
+        if (k == 7) {
+            assert(spm_kv_get(kv, key, v, sizeof v, NULL) == SPM_EPARAM);
+            continue;
+        }
+        fill_value(v, sizeof v, k, 2);
+        expect_value(kv, key, v, 16 + k % 48);
+    }
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void large_sectors_mount_in_bufsiz_messages(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 3, .sector_size = 4 * NOR_SECTOR };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    uint8_t v[64];
+    for (unsigned k = 0; k < 200; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "key%u", k);
+        fill_value(v, sizeof v, k, 0);
+        assert(spm_kv_put(kv, key, v, sizeof v) == SPM_OK);
+    }
+    spm_kv_destroy(kv);
+
+    spm_sim_reset_stats();
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    /* a sector scan takes one message per 4 KiB of spidev bufsiz */
+    spm_sim_stats_t sim;
+    assert(spm_sim_get_stats("/dev/spidev0.0", &sim) == SPM_OK);
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.keys == 200);
+    assert(sim.messages == 1 + (cfg.sectors - st.sectors_free) * 4);
+
+    for (unsigned k = 0; k < 200; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "key%u", k);
+        fill_value(v, sizeof v, k, 0);
+        expect_value(kv, key, v, sizeof v);
+    }
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void torn_record_is_skipped_on_mount(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 4 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    uint8_t v[600];
+    fill_value(v, sizeof v, 1, 0);
+    assert(spm_kv_put(kv, "a", v, 100) == SPM_OK);
+
+    /* Power fails part-way through the second record */
+    g_nor.cut_bytes = 300;
+    assert(spm_kv_put(kv, "b", v, sizeof v) == SPM_OK);
+    spm_kv_destroy(kv);
+    g_nor.cut_bytes = -1;
+
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.crc_errors == 1);
+    assert(st.keys == 1);
+    expect_value(kv, "a", v, 100);
+    assert(spm_kv_get(kv, "b", v, sizeof v, NULL) == SPM_EPARAM);
+
+    /* Appends continue behind the torn record */
+    assert(spm_kv_put(kv, "c", v, 50) == SPM_OK);
+    spm_kv_destroy(kv);
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+    expect_value(kv, "a", v, 100);
+    expect_value(kv, "c", v, 50);
+    assert(g_nor.overprograms == 0);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void foreign_sector_is_erased_before_use(void)
+{
+    spm_device_t *dev = open_nor();
+    memset(&g_nor.mem[NOR_SECTOR], 0x00, 64);
+
+    spm_kv_cfg_t cfg = { .sectors = 3, .gc_free = 1 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.sectors_dirty == 1);
+    assert(st.sectors_free == 2);
+
+    bool more = true;
+    assert(spm_kv_maintain(kv, &more) == SPM_OK);
+    assert(!more);
+    assert(g_nor.erases[1] == 1);
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.sectors_dirty == 0 && st.sectors_free == 3);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ================== Garbage Collection ================ */
+/* ====================================================== */
+
+static void rewrites_collect_and_level_wear(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 4 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    uint8_t v[200];
+    for (unsigned gen = 0; gen < 300; gen++) {
+        for (unsigned k = 0; k < 6; k++) {
+            char key[16];
+            snprintf(key, sizeof key, "cal%u", k);
+            fill_value(v, sizeof v, k, gen);
+            assert(spm_kv_put(kv, key, v, sizeof v) == SPM_OK);
+        }
+    }
+
+    spm_kv_stats_t st;
+    assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+    assert(st.keys == 6);
+    assert(st.gc_runs > 0 && st.fg_gc_runs > 0);
+    assert(st.erases >= st.gc_runs - 1);
+    assert(st.erase_max - st.erase_min <= 2);
+
+    uint32_t counts[4];
+    assert(spm_kv_get_erase_counts(kv, counts, 4) == SPM_OK);
+    assert(spm_kv_get_erase_counts(kv, counts, 3) == SPM_EPARAM);
+    for (unsigned s = 0; s < 4; s++) assert(counts[s] == g_nor.erases[s]);
+
+    spm_kv_destroy(kv);
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+    for (unsigned k = 0; k < 6; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "cal%u", k);
+        fill_value(v, sizeof v, k, 299);
+        expect_value(kv, key, v, sizeof v);
+    }
+
+    /* Erase counts survive the remount */
+    uint32_t again[4];
+    assert(spm_kv_get_erase_counts(kv, again, 4) == SPM_OK);
+    assert(memcmp(counts, again, sizeof counts) == 0);
+    assert(g_nor.overprograms == 0);
+    assert(g_nor.ignored == 0);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void background_gc_runs_in_idle_time(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 6, .gc_free = 2, .idle_us = 2000 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+    assert(spm_kv_start(kv) == SPM_OK);
+    assert(spm_kv_start(kv) == SPM_ESTATE);
+
+    /* About 4.2 sectors of 212-byte records for four keys */
+    uint8_t v[200];
+    for (unsigned gen = 0; gen < 20; gen++) {
+        for (unsigned k = 0; k < 4; k++) {
+            char key[16];
+            snprintf(key, sizeof key, "k%u", k);
+            fill_value(v, sizeof v, k, gen);
+            assert(spm_kv_put(kv, key, v, sizeof v) == SPM_OK);
+        }
+    }
+
+    spm_kv_stats_t st;
+    for (int i = 0; i < 200; i++) {
+        usleep(5000);
+        assert(spm_kv_get_stats(kv, &st) == SPM_OK);
+        if (st.sectors_free >= 2 && st.sectors_dirty == 0 && st.gc_runs > 0) break;
+    }
+    assert(st.sectors_free >= 2 && st.sectors_dirty == 0);
+    assert(st.gc_runs > 0 && st.erases > 0);
+    assert(st.fg_gc_runs == 0);
+
+    assert(spm_kv_stop(kv) == SPM_OK);
+    for (unsigned k = 0; k < 4; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "k%u", k);
+        fill_value(v, sizeof v, k, 19);
+        expect_value(kv, key, v, sizeof v);
+    }
+    assert(g_nor.overprograms == 0);
+    assert(g_nor.ignored == 0);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void full_store_reports_enomem(void)
+{
+    spm_device_t *dev = open_nor();
+    spm_kv_cfg_t cfg = { .sectors = 3, .gc_free = 1 };
+    spm_kv_t *kv = NULL;
+    assert(spm_kv_create(dev, &cfg, &kv) == SPM_OK);
+
+    uint8_t v[1500];
+    unsigned stored = 0;
+    spm_ecode_t rc;
+    for (;;) {
+        char key[16];
+        snprintf(key, sizeof key, "blob%u", stored);
+        fill_value(v, sizeof v, stored, 0);
+        rc = spm_kv_put(kv, key, v, sizeof v);
+        if (rc != SPM_OK) break;
+        stored++;
+    }
+    assert(rc == SPM_ENOMEM);
+    assert(stored >= 4);
+
+    /* Nothing stored was lost, and deleting makes room again */
+    for (unsigned k = 0; k < stored; k++) {
+        char key[16];
+        snprintf(key, sizeof key, "blob%u", k);
+        fill_value(v, sizeof v, k, 0);
+        expect_value(kv, key, v, sizeof v);
+    }
+    assert(spm_kv_delete(kv, "blob0") == SPM_OK);
+    assert(spm_kv_delete(kv, "blob1") == SPM_OK);
+    assert(spm_kv_put(kv, "blobx", v, sizeof v) == SPM_OK);
+
+    spm_kv_destroy(kv);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =========================== Main ===================== */
+/* ====================================================== */
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    put_get_delete_roundtrip();
+    // mount
+    remount_rebuilds_index_in_bulk();
+    large_sectors_mount_in_bufsiz_messages();
+    torn_record_is_skipped_on_mount();
+    foreign_sector_is_erased_before_use();
+    // garbage collection
+    rewrites_collect_and_level_wear();
+    background_gc_runs_in_idle_time();
+    full_store_reports_enomem();
+
+    TEST_PASS();
+    return 0;
+}
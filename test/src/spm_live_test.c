@@ -0,0 +1,318 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_live.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+static spm_device_t *open_sim(uint8_t cs)
+{
+    char path[SPM_PATH_MAX];
+    snprintf(path, sizeof path, "/dev/spidev0.%u", cs);
+    if (!spm_sim_has(path)) assert(spm_sim_add(path, 0, NULL, NULL) == SPM_OK);
+
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, cs, NULL, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+static uint64_t hist_sum(const spm_live_dev_t *d)
+{
+    uint64_t n = 0;
+    for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) n += d->hist[b];
+    return n;
+}
+
+static bool listed(pid_t pid)
+{
+    pid_t pids[64];
+    size_t n = 0;
+    spm_ecode_t rc = spm_live_list(pids, 64, &n);
+    assert(rc == SPM_OK || rc == SPM_ENOMEM);
+    for (size_t i = 0; i < n && i < 64; i++) {
+        if (pids[i] == pid) return true;
+    }
+    return false;
+}
+
+/* ====================================================== */
+/* ===================== Lifecycle ====================== */
+/* ====================================================== */
+
+static void live_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_sim(0);
+    assert(spm_dev_set_live(dev, true) == SPM_ESTATE);   /* not started */
+    assert(spm_dev_set_live(NULL, true) == SPM_ESTATE);
+    assert(spm_live_stop() == SPM_ESTATE);
+
+    spm_live_slot_t *slot;
+    assert(spm_live_slot_claim("/dev/x", NULL) == SPM_EPARAM);
+    assert(spm_live_slot_claim(NULL, &slot) == SPM_EPARAM);
+
+    spm_live_view_t *v;
+    assert(spm_live_attach(0, &v) == SPM_EPARAM);
+    assert(spm_live_attach(getpid(), NULL) == SPM_EPARAM);
+    assert(spm_live_attach(getpid(), &v) == SPM_ENODEV);
+    assert(!listed(getpid()));
+
+    assert(spm_live_start("live-test") == SPM_OK);
+    assert(spm_live_start("live-test") == SPM_ESTATE);
+    assert(spm_live_stop() == SPM_OK);
+
+    size_t n;
+    assert(spm_live_list(NULL, 1, &n) == SPM_EPARAM);
+    assert(spm_live_read(NULL, NULL, NULL, 0, &n) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void live_stop_waits_for_devices(void)
+{
+    assert(spm_live_start(NULL) == SPM_OK);
+    spm_device_t *dev = open_sim(0);
+    assert(spm_dev_set_live(dev, true) == SPM_OK);
+    assert(spm_live_stop() == SPM_ESTATE);
+
+    /* close frees the slot */
+    spm_dev_close(dev);
+    assert(spm_live_stop() == SPM_OK);
+    TEST_PASS();
+}
+
+static void live_slots_run_out(void)
+{
+    assert(spm_live_start(NULL) == SPM_OK);
+
+    spm_live_slot_t *slot[SPM_LIVE_SLOTS + 1];
+    for (size_t i = 0; i < SPM_LIVE_SLOTS; i++) {
+        assert(spm_live_slot_claim("/dev/spidevX", &slot[i]) == SPM_OK);
+    }
+    assert(spm_live_slot_claim("/dev/spidevX", &slot[SPM_LIVE_SLOTS]) == SPM_ENOMEM);
+    assert(slot[SPM_LIVE_SLOTS] == NULL);
+
+    spm_live_slot_release(slot[3]);
+    assert(spm_live_slot_claim("/dev/spidevY", &slot[3]) == SPM_OK);
+
+    for (size_t i = 0; i < SPM_LIVE_SLOTS; i++) spm_live_slot_release(slot[i]);
+    assert(spm_live_stop() == SPM_OK);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ===================== Publishing ===================== */
+/* ====================================================== */
+
+static void live_publishes_device_counters(void)
+{
+    assert(spm_live_start("live-test") == SPM_OK);
+    assert(listed(getpid()));
+
+    spm_device_t *a = open_sim(0);
+    spm_device_t *b = open_sim(1);
+    assert(spm_dev_set_live(a, true) == SPM_OK);
+    assert(spm_dev_set_live(a, true) == SPM_OK);        /* already on */
+    assert(spm_dev_set_live(b, true) == SPM_OK);
+
+    uint8_t tx[64] = {0}, rx[64];
+    for (int i = 0; i < 10; i++) assert(spm_transfer(a, tx, rx, 64) == SPM_OK);
+    spm_batch_xfer_t x[2] = { { .tx = tx, .len = 16 }, { .rx = rx, .len = 32 } };
+    assert(spm_batch(b, x, 2) == SPM_OK);
+
+    spm_live_view_t *v;
+    assert(spm_live_attach(getpid(), &v) == SPM_OK);
+
+    spm_live_proc_t proc;
+    spm_live_dev_t devs[4];
+    size_t n = 0;
+    assert(spm_live_read(v, &proc, devs, 4, &n) == SPM_OK);
+    assert(proc.pid == getpid());
+    assert(strcmp(proc.name, "live-test") == 0);
+    assert(n == 2);
+
+    assert(strcmp(devs[0].path, "/dev/spidev0.0") == 0);
+    assert(devs[0].messages == 10 && devs[0].xfers == 10 && devs[0].bytes == 640);
+    assert(devs[0].errors == 0 && devs[0].inflight == 0);
+    assert(hist_sum(&devs[0]) == 10);
+    assert(devs[0].wire_ns == 10 * ((64 * 8 * 1000000000ull + 999999) / 1000000));
+    assert(devs[0].ioctl_ns > 0);
+
+    assert(strcmp(devs[1].path, "/dev/spidev0.1") == 0);
+    assert(devs[1].messages == 1 && devs[1].xfers == 2 && devs[1].bytes == 48);
+
+    /* a short buffer still reports the count */
+    assert(spm_live_read(v, NULL, devs, 1, &n) == SPM_ENOMEM);
+    assert(n == 2);
+
+    /* disabling frees the slot; enabling again starts from zero */
+    assert(spm_dev_set_live(a, false) == SPM_OK);
+    assert(spm_live_read(v, NULL, devs, 4, &n) == SPM_OK);
+    assert(n == 1 && strcmp(devs[0].path, "/dev/spidev0.1") == 0);
+    assert(spm_dev_set_live(a, true) == SPM_OK);
+    assert(spm_live_read(v, NULL, devs, 4, &n) == SPM_OK);
+    assert(n == 2 && devs[0].messages == 0);
+
+    spm_dev_close(a);
+    spm_dev_close(b);
+    assert(spm_live_stop() == SPM_OK);
+    assert(spm_live_read(v, NULL, devs, 4, &n) == SPM_ENODEV);
+    assert(!listed(getpid()));
+    spm_live_detach(v);
+    TEST_PASS();
+}
+
+static void live_publishes_wc_queue_depth(void)
+{
+    assert(spm_live_start(NULL) == SPM_OK);
+    spm_device_t *dev = open_sim(0);
+    spm_wc_cfg_t wc = { .max_xfers = 8 };
+    assert(spm_dev_set_write_combining(dev, &wc) == SPM_OK);
+    assert(spm_dev_set_live(dev, true) == SPM_OK);
+
+    spm_live_view_t *v;
+    assert(spm_live_attach(getpid(), &v) == SPM_OK);
+
+    uint8_t tx[4] = {0};
+    for (int i = 0; i < 3; i++) assert(spm_write(dev, tx, sizeof tx) == SPM_OK);
+
+    spm_live_dev_t d;
+    size_t n;
+    assert(spm_live_read(v, NULL, &d, 1, &n) == SPM_OK);
+    assert(n == 1 && d.wc_pending == 3 && d.messages == 0);
+
+    assert(spm_dev_flush(dev) == SPM_OK);
+    assert(spm_live_read(v, NULL, &d, 1, &n) == SPM_OK);
+    assert(d.wc_pending == 0 && d.messages == 1 && d.xfers == 3);
+
+    spm_live_detach(v);
+    spm_dev_close(dev);
+    assert(spm_live_stop() == SPM_OK);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Seqlock ======================= */
+/* ====================================================== */
+
+typedef struct {
+    spm_device_t *dev;
+    int           count;
+} writer_arg_t;
+
+static void *writer_main(void *p)
+{
+    writer_arg_t *w = p;
+    uint8_t tx[8] = {0}, rx[8];
+    for (int i = 0; i < w->count; i++) assert(spm_transfer(w->dev, tx, rx, 8) == SPM_OK);
+    return NULL;
+}
+
+static void live_snapshots_are_consistent(void)
+{
+    assert(spm_live_start(NULL) == SPM_OK);
+    spm_device_t *dev = open_sim(0);
+    assert(spm_dev_set_live(dev, true) == SPM_OK);
+
+    spm_live_view_t *v;
+    assert(spm_live_attach(getpid(), &v) == SPM_OK);
+
+    /* two writers share the slot; every copy must be a whole number of messages */
+    writer_arg_t w = { dev, 20000 };
+    pthread_t th[2];
+    for (int i = 0; i < 2; i++) assert(pthread_create(&th[i], NULL, writer_main, &w) == 0);
+
+    spm_live_dev_t d;
+    size_t n;
+    uint64_t last = 0;
+    do {
+        assert(spm_live_read(v, NULL, &d, 1, &n) == SPM_OK);
+        assert(d.xfers == d.messages && d.bytes == 8 * d.messages);
+        assert(hist_sum(&d) == d.messages);
+        assert(d.messages >= last);
+        assert(d.inflight <= 2);
+        last = d.messages;
+    } while (last < 40000);
+
+    for (int i = 0; i < 2; i++) pthread_join(th[i], NULL);
+    assert(spm_live_read(v, NULL, &d, 1, &n) == SPM_OK);
+    assert(d.messages == 40000 && d.inflight == 0);
+
+    spm_live_detach(v);
+    spm_dev_close(dev);
+    assert(spm_live_stop() == SPM_OK);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ==================== Percentiles ===================== */
+/* ====================================================== */
+
+static void live_percentile_from_histogram(void)
+{
+    uint64_t h[SPM_LIVE_BUCKETS] = {0};
+    assert(spm_live_percentile(h, 0.5) == 0);
+    assert(spm_live_percentile(NULL, 0.5) == 0);
+
+    h[10] = 90;     /* [1024, 2048) ns */
+    h[20] = 9;      /* ~1 ms */
+    h[25] = 1;
+    assert(spm_live_percentile(h, 0.0)  == 2048);
+    assert(spm_live_percentile(h, 0.50) == 2048);
+    assert(spm_live_percentile(h, 0.90) == 2048);
+    assert(spm_live_percentile(h, 0.95) == 1u << 21);
+    assert(spm_live_percentile(h, 0.99) == 1u << 21);
+    assert(spm_live_percentile(h, 1.0)  == 1u << 26);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    live_fails_invalid_input();
+    live_stop_waits_for_devices();
+    live_slots_run_out();
+
+    // publishing
+    live_publishes_device_counters();
+    live_publishes_wc_queue_depth();
+
+    // seqlock
+    live_snapshots_are_consistent();
+
+    // percentiles
+    live_percentile_from_histogram();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,419 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spi_monkey.h"
+#include "spm_pipe.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+static void sleep_us(long us)
+{
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+/* Source: 4-byte little-endian counter, stops producing after limit */
+typedef struct {
+    uint32_t next;
+    uint32_t limit;
+} counter_src_t;
+
+static spm_ecode_t counter_src(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out)
+{
+    (void)in;
+    counter_src_t *c = ctx;
+    if (c->next == c->limit) {
+        sleep_us(100);
+        return SPM_EAGAIN;
+    }
+    memcpy(out->data, &c->next, 4);
+    out->len = 4;
+    c->next++;
+    return SPM_OK;
+}
+
+/* Transform: value * 3 */
+static spm_ecode_t triple(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out)
+{
+    (void)ctx;
+    uint32_t v;
+    memcpy(&v, in->data, 4);
+    v *= 3;
+    memcpy(out->data, &v, 4);
+    out->len = 4;
+    return SPM_OK;
+}
+
+/* In place: append the inverted value */
+static spm_ecode_t append_inv(void *ctx, uint8_t *data, size_t *len)
+{
+    (void)ctx;
+    for (size_t i = 0; i < 4; i++) data[4 + i] = (uint8_t)~data[i];
+    *len = 8;
+    return SPM_OK;
+}
+
+/* Sink: records values in order */
+typedef struct {
+    uint32_t         vals[4096];
+    uint64_t         seqs[4096];
+    size_t           lens[4096];
+    _Atomic size_t   n;
+    long             delay_us;
+    size_t           fail_at;     /* 0 = never */
+} sink_t;
+
+static spm_ecode_t record_sink(void *ctx, const spm_pipe_frame_t *in, spm_pipe_frame_t *out)
+{
+    assert(out == NULL);
+    sink_t *s = ctx;
+    size_t n = atomic_load(&s->n);
+    if (s->fail_at && n + 1 == s->fail_at) return SPM_EIO;
+    if (s->delay_us) sleep_us(s->delay_us);
+
+    if (n < 4096) {
+        memcpy(&s->vals[n], in->data, 4);
+        s->seqs[n] = in->seq;
+        s->lens[n] = in->len;
+    }
+    atomic_store(&s->n, n + 1);
+    return SPM_OK;
+}
+
+static void wait_count(sink_t *s, size_t n)
+{
+    for (int i = 0; i < 20000 && atomic_load(&s->n) < n; i++) sleep_us(100);
+    assert(atomic_load(&s->n) >= n);
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    counter_src_t c = { .limit = 1 };
+    sink_t *s = calloc(1, sizeof(*s));
+    spm_pipe_stage_t stages[2] = {
+        { .name = "src",  .fn = counter_src, .ctx = &c },
+        { .name = "sink", .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 8 };
+    spm_pipe_t *pipe = NULL;
+
+    assert(spm_pipe_create(&cfg, stages, 2, NULL) == SPM_EPARAM);
+    assert(spm_pipe_create(NULL, stages, 2, &pipe) == SPM_EPARAM);
+    assert(spm_pipe_create(&cfg, stages, 1, &pipe) == SPM_EPARAM);
+
+    spm_pipe_cfg_t zero = { 0 };
+    assert(spm_pipe_create(&zero, stages, 2, &pipe) == SPM_EPARAM);
+
+    spm_pipe_stage_t bad[2] = { stages[0], { .fn = record_sink, .process = append_inv } };
+    assert(spm_pipe_create(&cfg, bad, 2, &pipe) == SPM_EPARAM);
+    bad[0] = (spm_pipe_stage_t){ .process = append_inv };
+    bad[1] = stages[1];
+    assert(spm_pipe_create(&cfg, bad, 2, &pipe) == SPM_EPARAM);
+    assert(pipe == NULL);
+
+    stages[0].pin = true;
+    stages[0].cpu = 1 << 20;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_EPARAM);
+    spm_pipe_destroy(pipe);
+
+    stages[0].cpu = 0;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_ESTATE);
+    wait_count(s, 1);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+
+    spm_pipe_stats_t st;
+    assert(spm_pipe_get_stats(pipe, 2, &st) == SPM_EPARAM);
+    assert(spm_pipe_get_stats(pipe, 0, NULL) == SPM_EPARAM);
+    spm_pipe_destroy(pipe);
+    spm_pipe_destroy(NULL);
+
+    free(s);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Dataflow ====================== */
+/* ====================================================== */
+
+static void chain_preserves_order(void)
+{
+    enum { N = 3000 };
+    counter_src_t c = { .limit = N };
+    sink_t *s = calloc(1, sizeof(*s));
+    spm_pipe_stage_t stages[4] = {
+        { .name = "src",    .fn = counter_src, .ctx = &c },
+        { .name = "triple", .fn = triple },
+        { .name = "inv",    .process = append_inv },
+        { .name = "sink",   .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 16, .depth = 3 };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 4, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+
+    wait_count(s, N);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+    assert(atomic_load(&s->n) == N);
+
+    for (uint32_t i = 0; i < N; i++) {
+        assert(s->vals[i] == i * 3);
+        assert(s->seqs[i] == i);
+        assert(s->lens[i] == 8);
+    }
+
+    for (size_t k = 0; k < 4; k++) {
+        spm_pipe_stats_t st;
+        assert(spm_pipe_get_stats(pipe, k, &st) == SPM_OK);
+        assert(st.frames == N);
+        assert(st.dropped == 0);
+        assert(st.lat_ns_max >= st.lat_ns_sum / N);
+    }
+
+    spm_pipe_destroy(pipe);
+    free(s);
+    TEST_PASS();
+}
+
+static void drop_when_full_never_blocks_source(void)
+{
+    counter_src_t c = { .limit = 400 };
+    sink_t *s = calloc(1, sizeof(*s));
+    s->delay_us = 2000;
+    spm_pipe_stage_t stages[2] = {
+        { .name = "src",  .fn = counter_src, .ctx = &c },
+        { .name = "sink", .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 4, .depth = 2, .drop_when_full = true };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+
+    /* Only the queued frames reach the sink, the rest are dropped */
+    wait_count(s, 2);
+    sleep_us(50000);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+
+    spm_pipe_stats_t src, sink;
+    assert(spm_pipe_get_stats(pipe, 0, &src) == SPM_OK);
+    assert(spm_pipe_get_stats(pipe, 1, &sink) == SPM_OK);
+    assert(src.frames + src.dropped == 400);
+    assert(src.dropped > 0);
+    assert(src.wait_out_ns == 0);
+    assert(sink.frames == atomic_load(&s->n));
+
+    /* Delivered values still increase */
+    for (size_t i = 1; i < atomic_load(&s->n); i++) assert(s->vals[i] > s->vals[i - 1]);
+
+    spm_pipe_destroy(pipe);
+    free(s);
+    TEST_PASS();
+}
+
+static void backpressure_stalls_source(void)
+{
+    counter_src_t c = { .limit = 50 };
+    sink_t *s = calloc(1, sizeof(*s));
+    s->delay_us = 500;
+    spm_pipe_stage_t stages[2] = {
+        { .name = "src",  .fn = counter_src, .ctx = &c },
+        { .name = "sink", .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 4, .depth = 2 };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+
+    wait_count(s, 50);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+
+    spm_pipe_stats_t src;
+    assert(spm_pipe_get_stats(pipe, 0, &src) == SPM_OK);
+    assert(src.frames == 50);
+    assert(src.dropped == 0);
+    assert(src.stalls > 0);
+    assert(src.wait_out_ns > 0);
+    for (uint32_t i = 0; i < 50; i++) assert(s->vals[i] == i);
+
+    spm_pipe_destroy(pipe);
+    free(s);
+    TEST_PASS();
+}
+
+static void stage_error_stops_pipeline(void)
+{
+    counter_src_t c = { .limit = 1000 };
+    sink_t *s = calloc(1, sizeof(*s));
+    s->fail_at = 10;
+    spm_pipe_stage_t stages[3] = {
+        { .name = "src",    .fn = counter_src, .ctx = &c },
+        { .name = "triple", .fn = triple },
+        { .name = "sink",   .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 4 };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 3, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+
+    for (int i = 0; i < 20000 && spm_pipe_error(pipe) == SPM_OK; i++) sleep_us(100);
+    assert(spm_pipe_error(pipe) == SPM_EIO);
+    assert(spm_pipe_stop(pipe) == SPM_EIO);
+    assert(atomic_load(&s->n) == 9);
+
+    spm_pipe_destroy(pipe);
+    free(s);
+    TEST_PASS();
+}
+
+static void restart_recovers_frames_in_flight(void)
+{
+    counter_src_t c = { .limit = 0 };
+    sink_t *s = calloc(1, sizeof(*s));
+    s->delay_us = 1000;
+    spm_pipe_stage_t stages[3] = {
+        { .name = "src",    .fn = counter_src, .ctx = &c },
+        { .name = "triple", .fn = triple },
+        { .name = "sink",   .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 4, .depth = 2 };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 3, &pipe) == SPM_OK);
+
+    /* idle: the source holds a frame and waits for data */
+    for (int round = 0; round < 3; round++) {
+        assert(spm_pipe_start(pipe) == SPM_OK);
+        sleep_us(2000);
+        assert(spm_pipe_stop(pipe) == SPM_OK);
+    }
+
+    /* busy: frames are queued behind the slow sink when it stops */
+    for (int round = 0; round < 3; round++) {
+        c.limit += 8;
+        assert(spm_pipe_start(pipe) == SPM_OK);
+        sleep_us(3000);
+        assert(spm_pipe_stop(pipe) == SPM_OK);
+    }
+
+    /* every frame is back and nothing stale is delivered */
+    size_t n0 = atomic_load(&s->n);
+    uint32_t first = c.next;
+    c.limit = first + 10;
+    s->delay_us = 0;
+    assert(spm_pipe_start(pipe) == SPM_OK);
+    wait_count(s, n0 + 10);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+    assert(atomic_load(&s->n) == n0 + 10);
+    for (uint32_t i = 0; i < 10; i++) assert(s->vals[n0 + i] == 3 * (first + i));
+
+    spm_pipe_destroy(pipe);
+    free(s);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Sources ======================= */
+/* ====================================================== */
+
+static void fill_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    uint8_t *ctr = ctx;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        if (!rx) continue;
+        for (uint32_t k = 0; k < trs[i].len; k++) rx[k] = *ctr;
+        (*ctr)++;
+    }
+}
+
+static void src_read_feeds_device_frames(void)
+{
+    uint8_t ctr = 0;
+    spm_sys_fake_reset();
+    spm_sys_fake_set_xfer_handler(fill_xfer, &ctr);
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev) == SPM_OK);
+
+    sink_t *s = calloc(1, sizeof(*s));
+    spm_pipe_read_src_t rd = { .dev = dev, .len = 6 };
+    spm_pipe_stage_t stages[2] = {
+        { .name = "spi",  .fn = spm_pipe_src_read, .ctx = &rd },
+        { .name = "sink", .fn = record_sink, .ctx = s },
+    };
+    spm_pipe_cfg_t cfg = { .frame_cap = 8 };
+    spm_pipe_t *pipe = NULL;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+    wait_count(s, 20);
+    assert(spm_pipe_stop(pipe) == SPM_OK);
+
+    for (size_t i = 0; i < 20; i++) {
+        assert(s->lens[i] == 6);
+        assert(s->vals[i] == 0x01010101u * (uint8_t)i);
+    }
+    spm_pipe_destroy(pipe);
+
+    /* Frames larger than frame_cap are rejected by the source */
+    atomic_store(&s->n, 0);
+    rd.len = 9;
+    assert(spm_pipe_create(&cfg, stages, 2, &pipe) == SPM_OK);
+    assert(spm_pipe_start(pipe) == SPM_OK);
+    for (int i = 0; i < 20000 && spm_pipe_error(pipe) == SPM_OK; i++) sleep_us(100);
+    assert(spm_pipe_stop(pipe) == SPM_EPARAM);
+    spm_pipe_destroy(pipe);
+
+    spm_dev_close(dev);
+    free(s);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    // dataflow
+    chain_preserves_order();
+    drop_when_full_never_blocks_source();
+    backpressure_stalls_source();
+    stage_error_stops_pipeline();
+    restart_recovers_frames_in_flight();
+    // sources
+    src_read_feeds_device_frames();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "spi_monkey.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+#define NODE        "/dev/spidev7.0"
+#define TRACE_FILE  "/tmp/spm_preload_test.trace"
+
+/*
+ * The shim only takes effect when loaded before libc, so the test
+ * re-executes itself with LD_PRELOAD pointing at the build output.
+ */
+static void reexec_preloaded(char **argv)
+{
+    if (getenv("LD_PRELOAD")) return;
+
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof exe - 1);
+    assert(n > 0);
+    exe[n] = '\0';
+    *strrchr(exe, '/') = '\0';
+
+    char lib[PATH_MAX + 64];
+    snprintf(lib, sizeof lib, "%s/../../build/libspm-preload.so", exe);
+    assert(access(lib, R_OK) == 0);
+
+    setenv("LD_PRELOAD", lib, 1);
+    setenv("SPM_PRELOAD_DEVICES", "/dev/spidev6.0=loop@2000000", 1);
+    setenv("SPM_PRELOAD_MODEL", "loop", 1);
+    setenv("SPM_PRELOAD_TRACE", TRACE_FILE, 1);
+    setenv("SPM_PRELOAD_REPORT", "off", 1);
+    execv("/proc/self/exe", argv);
+    assert(!"execv failed");
+}
+
+/* ====================================================== */
+/* ======================== Tests ======================= */
+/* ====================================================== */
+
+static void test_open_routes_to_sim(void)
+{
+    int fd = open(NODE, O_RDWR);
+    assert(fd >= 0);
+    assert(spm_sim_has(NODE));
+    assert(spm_sim_has("/dev/spidev6.0"));
+    assert(close(fd) == 0);
+
+    /* anything else still reaches the kernel */
+    fd = open("/dev/null", O_WRONLY);
+    assert(fd >= 0);
+    assert(write(fd, "x", 1) == 1);
+    assert(close(fd) == 0);
+
+    TEST_PASS();
+}
+
+static void test_ioctl_message(void)
+{
+    spm_sim_reset_stats();
+
+    int fd = open(NODE, O_RDWR);
+    assert(fd >= 0);
+
+    uint32_t speed = 1000000;
+    assert(ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == 0);
+    speed = 0;
+    assert(ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == 0);
+    assert(speed == 1000000);
+
+    uint8_t tx[2][8] = { { 1, 2, 3, 4, 5, 6, 7, 8 }, { 9, 10, 11, 12, 13, 14, 15, 16 } };
+    uint8_t rx[2][8] = { { 0 } };
+    struct spi_ioc_transfer tr[2] = {
+        { .tx_buf = (uintptr_t)tx[0], .rx_buf = (uintptr_t)rx[0], .len = 8 },
+        { .tx_buf = (uintptr_t)tx[1], .rx_buf = (uintptr_t)rx[1], .len = 8 },
+    };
+    assert(ioctl(fd, SPI_IOC_MESSAGE(2), tr) == 16);
+    assert(memcmp(tx, rx, sizeof tx) == 0);
+
+    spm_sim_stats_t st;
+    assert(spm_sim_get_stats(NODE, &st) == SPM_OK);
+    assert(st.messages == 1);
+    assert(st.xfers == 2);
+    assert(st.bytes == 16);
+    spm_batch_xfer_t bx[2] = { { .tx = tx[0], .rx = rx[0], .len = 8 },
+                               { .tx = tx[1], .rx = rx[1], .len = 8 } };
+    assert(st.wire_ns == spm_sim_wire_ns(NULL, bx, 2, 1000000, 8));
+
+    assert(close(fd) == 0);
+    TEST_PASS();
+}
+
+static void test_read_write(void)
+{
+    spm_sim_reset_stats();
+
+    int fd = open(NODE, O_RDWR);
+    assert(fd >= 0);
+
+    uint8_t buf[32];
+    memset(buf, 0xAA, sizeof buf);
+    assert(write(fd, buf, sizeof buf) == (ssize_t)sizeof buf);
+    assert(read(fd, buf, 5) == 5);
+    assert(buf[0] == 0 && buf[4] == 0 && buf[5] == 0xAA);   /* half duplex: nothing clocked out */
+
+    spm_sim_stats_t st;
+    assert(spm_sim_get_stats(NODE, &st) == SPM_OK);
+    assert(st.messages == 2);
+    assert(st.bytes == sizeof buf + 5);
+
+    assert(close(fd) == 0);
+    TEST_PASS();
+}
+
+static void test_dup_follows_node(void)
+{
+    spm_sim_reset_stats();
+
+    int fd = open(NODE, O_RDWR);
+    assert(fd >= 0);
+    int fd2 = dup(fd);
+    assert(fd2 >= 0);
+    assert(close(fd) == 0);
+
+    /* the shell's "> /dev/spidevX" is open + dup2 onto 1 + close */
+    int saved = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+    assert(saved >= 10);
+    assert(dup2(fd2, STDOUT_FILENO) == STDOUT_FILENO);
+    assert(close(fd2) == 0);
+    assert(write(STDOUT_FILENO, "abc", 3) == 3);
+    assert(dup2(saved, STDOUT_FILENO) == STDOUT_FILENO);
+    assert(close(saved) == 0);
+
+    spm_sim_stats_t st;
+    assert(spm_sim_get_stats(NODE, &st) == SPM_OK);
+    assert(st.messages == 1);
+    assert(st.bytes == 3);
+
+    TEST_PASS();
+}
+
+static void test_trace_lines(void)
+{
+    FILE *f = fopen(TRACE_FILE, "r");
+    assert(f);
+
+    char line[256];
+    bool opened = false, msg = false, closed = false;
+    while (fgets(line, sizeof line, f)) {
+        if (strstr(line, " open " NODE))                            opened = true;
+        if (strstr(line, " msg " NODE) && strstr(line, "bytes 16")) msg = true;
+        if (strstr(line, " close " NODE))                           closed = true;
+    }
+    fclose(f);
+    assert(opened && msg && closed);
+
+    TEST_PASS();
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    reexec_preloaded(argv);
+
+    // routing
+    test_open_routes_to_sim();
+
+    // spidev calls
+    test_ioctl_message();
+    test_read_write();
+    test_dup_follows_node();
+
+    // trace
+    test_trace_lines();
+
+    unlink(TRACE_FILE);
+    TEST_PASS();
+    return 0;
+}
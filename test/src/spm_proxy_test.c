@@ -0,0 +1,297 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "spi_monkey.h"
+#include "spm_proxy.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* =================== Remote Model ===================== */
+/* ====================================================== */
+
+/* Answers every byte with its complement and records what was written */
+typedef struct {
+    unsigned frames;
+    size_t   written;
+    uint8_t  last_tx;
+} echo_model_t;
+
+static echo_model_t g_echo;
+
+static void echo_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    echo_model_t *m = ctx;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        for (uint32_t k = 0; k < trs[i].len; k++) {
+            if (tx) m->last_tx = tx[k];
+            if (rx) rx[k] = tx ? (uint8_t)~tx[k] : 0xA5;
+        }
+        if (tx) m->written += trs[i].len;
+        m->frames++;
+    }
+}
+
+static pthread_t g_server;
+
+static void *server_main(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    spm_proxy_serve_fd(fd, &SPM_SYS_F_DEFAULT);
+    return NULL;
+}
+
+/* Server thread on one end of a socketpair, client on the other */
+static void start_proxy(const spm_proxy_opts_t *opts)
+{
+    spm_sys_fake_reset();
+    memset(&g_echo, 0, sizeof g_echo);
+    spm_sys_fake_set_xfer_handler(echo_xfer, &g_echo);
+
+    int sv[2];
+    int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    assert(rc == 0);
+    rc = pthread_create(&g_server, NULL, server_main, (void *)(intptr_t)sv[1]);
+    assert(rc == 0);
+    assert(spm_proxy_connect_fd(sv[0], opts) == SPM_OK);
+}
+
+static void stop_proxy(void)
+{
+    assert(spm_proxy_disconnect() == SPM_OK);
+    pthread_join(g_server, NULL);
+}
+
+static spm_device_t *open_remote_dev(void)
+{
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_PROXY, &dev);
+    assert(rc == SPM_OK);
+    return dev;
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void open_fails_when_not_connected(void)
+{
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_PROXY, &dev) != SPM_OK);
+    assert(dev == NULL);
+    assert(spm_proxy_flush() == SPM_ESTATE);
+    assert(spm_proxy_connect(NULL, NULL) == SPM_EPARAM);
+    TEST_PASS();
+}
+
+static void config_round_trips_to_remote_device(void)
+{
+    start_proxy(NULL);
+    spm_device_t *dev = open_remote_dev();
+
+    spm_cfg_t cfg = { .mode = SPM_MODE3, .speed_hz = 2000000, .bits_per_word = 8 };
+    assert(spm_dev_set_cfg(dev, &cfg) == SPM_OK);
+
+    spm_cfg_t got;
+    memset(&got, 0, sizeof got);
+    assert(spm_dev_get_cfg(dev, &got) == SPM_OK);
+    assert(got.mode == SPM_MODE3);
+    assert(got.speed_hz == 2000000);
+
+    assert(spm_dev_close(dev) == SPM_OK);
+    stop_proxy();
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Transfers ===================== */
+/* ====================================================== */
+
+static void transfer_returns_remote_rx_data(void)
+{
+    start_proxy(NULL);
+    spm_device_t *dev = open_remote_dev();
+
+    uint8_t tx[64], rx[64];
+    for (int i = 0; i < 64; i++) tx[i] = (uint8_t)i;
+    memset(rx, 0, sizeof rx);
+
+    assert(spm_transfer(dev, tx, rx, sizeof rx) == SPM_OK);
+    for (int i = 0; i < 64; i++) assert(rx[i] == (uint8_t)~i);
+
+    uint8_t rd[8];
+    assert(spm_read(dev, rd, sizeof rd) == SPM_OK);
+
+    assert(spm_dev_close(dev) == SPM_OK);
+    stop_proxy();
+    TEST_PASS();
+}
+
+static void writes_are_pipelined_into_one_round_trip(void)
+{
+    start_proxy(NULL);
+    spm_device_t *dev = open_remote_dev();
+
+    spm_proxy_stats_t before, after;
+    assert(spm_proxy_get_stats(&before) == SPM_OK);
+
+    uint8_t buf[4] = {1, 2, 3, 4};
+    for (int i = 0; i < 20; i++) {
+        buf[0] = (uint8_t)i;
+        assert(spm_write(dev, buf, sizeof buf) == SPM_OK);
+    }
+    assert(spm_proxy_flush() == SPM_OK);
+    assert(spm_proxy_get_stats(&after) == SPM_OK);
+
+    assert(after.pipelined - before.pipelined == 20);
+    assert(after.round_trips - before.round_trips == 1);
+    assert(g_echo.written == 20 * sizeof buf);
+    assert(g_echo.last_tx == 4);
+
+    assert(spm_dev_close(dev) == SPM_OK);
+    stop_proxy();
+    TEST_PASS();
+}
+
+static void compression_shrinks_repetitive_payloads(void)
+{
+    spm_proxy_opts_t opts = { .compress = true, .pipeline = true };
+    start_proxy(&opts);
+    spm_device_t *dev = open_remote_dev();
+
+    uint8_t tx[4096], rx[4096];
+    memset(tx, 0x00, sizeof tx);
+    assert(spm_transfer(dev, tx, rx, sizeof rx) == SPM_OK);
+    for (size_t i = 0; i < sizeof rx; i++) assert(rx[i] == 0xFF);
+
+    /* Incompressible data goes out raw */
+    for (size_t i = 0; i < sizeof tx; i++) tx[i] = (uint8_t)(i * 7 + (i >> 3));
+    assert(spm_transfer(dev, tx, rx, sizeof rx) == SPM_OK);
+    for (size_t i = 0; i < sizeof rx; i++) assert(rx[i] == (uint8_t)~tx[i]);
+
+    spm_proxy_stats_t st;
+    assert(spm_proxy_get_stats(&st) == SPM_OK);
+    assert(st.payload_raw == 4 * sizeof tx);
+    assert(st.payload_wire < 2 * sizeof tx + 256);
+
+    assert(spm_dev_close(dev) == SPM_OK);
+    stop_proxy();
+    TEST_PASS();
+}
+
+static void compression_covers_read_only_replies(void)
+{
+    spm_proxy_opts_t opts = { .compress = true };
+    start_proxy(&opts);
+    spm_device_t *dev = open_remote_dev();
+
+    /* Nothing to compress on the way out, a flash-dump-like reply back */
+    uint8_t rx[4096];
+    memset(rx, 0, sizeof rx);
+    assert(spm_read(dev, rx, sizeof rx) == SPM_OK);
+    for (size_t i = 0; i < sizeof rx; i++) assert(rx[i] == 0xA5);
+
+    spm_proxy_stats_t st;
+    assert(spm_proxy_get_stats(&st) == SPM_OK);
+    assert(st.payload_raw == sizeof rx);
+    assert(st.payload_wire < 256);
+
+    assert(spm_dev_close(dev) == SPM_OK);
+    stop_proxy();
+    TEST_PASS();
+}
+
+static void pipelined_failure_is_reported_on_flush(void)
+{
+    start_proxy(NULL);
+    spm_device_t *dev = open_remote_dev();
+
+    spm_sys_fake_fail_ioctl();
+    uint8_t buf[2] = {0};
+    assert(spm_write(dev, buf, sizeof buf) == SPM_OK);
+    assert(spm_proxy_flush() != SPM_OK);
+    assert(spm_proxy_flush() == SPM_OK);   /* reported once */
+
+    spm_dev_close(dev);
+    stop_proxy();
+    TEST_PASS();
+}
+
+static void unix_socket_listen_and_connect(void)
+{
+    spm_sys_fake_reset();
+    memset(&g_echo, 0, sizeof g_echo);
+    spm_sys_fake_set_xfer_handler(echo_xfer, &g_echo);
+
+    char addr[64];
+    snprintf(addr, sizeof addr, "unix:/tmp/spm_proxy_test.%d", (int)getpid());
+
+    int lfd = -1;
+    assert(spm_proxy_listen(addr, &lfd) == SPM_OK);
+    assert(spm_proxy_connect(addr, NULL) == SPM_OK);
+
+    int cfd = accept(lfd, NULL, NULL);
+    assert(cfd >= 0);
+    int rc = pthread_create(&g_server, NULL, server_main, (void *)(intptr_t)cfd);
+    assert(rc == 0);
+
+    spm_device_t *dev = open_remote_dev();
+    uint8_t tx = 0x0F, rx = 0;
+    assert(spm_transfer(dev, &tx, &rx, 1) == SPM_OK);
+    assert(rx == 0xF0);
+    assert(spm_dev_close(dev) == SPM_OK);
+
+    stop_proxy();
+    close(lfd);
+    unlink(addr + 5);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // lifecycle
+    open_fails_when_not_connected();
+    config_round_trips_to_remote_device();
+    // transfers
+    transfer_returns_remote_rx_data();
+    writes_are_pipelined_into_one_round_trip();
+    compression_shrinks_repetitive_payloads();
+    compression_covers_read_only_replies();
+    pipelined_failure_is_reported_on_flush();
+    // transport
+    unix_socket_listen_and_connect();
+
+    TEST_PASS();
+    return 0;
+}
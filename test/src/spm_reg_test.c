@@ -0,0 +1,298 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spi_monkey.h"
+#include "spm_reg.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* ====================================================== */
+/* ================== Register Model ==================== */
+/* ====================================================== */
+
+/* 64 registers, bit7 = read, bit6 = auto-increment burst */
+typedef struct {
+    uint8_t  regs[64];
+    unsigned frames;
+    unsigned messages;
+} reg_model_t;
+
+static reg_model_t g_model;
+
+static const spm_reg_proto_t PROTO = {
+    .read_mask      = 0x80,
+    .write_mask     = 0x00,
+    .burst_mask     = 0x40,
+    .auto_increment = true,
+    .max_gap        = 2,
+    .max_burst      = 0,
+};
+
+static void model_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    reg_model_t *m = ctx;
+    m->messages++;
+
+    /* spidev rejects messages whose aligned tx or rx sum exceeds bufsiz */
+    size_t cost = 0;
+    for (size_t i = 0; i < n; i++) cost += SPM_BUFSIZ_COST(trs[i].len);
+    assert(cost <= SPM_BUFSIZ_DEFAULT);
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        uint8_t       *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        uint8_t cmd  = tx[0];
+        uint8_t addr = cmd & 0x3F;
+        bool    burst = cmd & 0x40;
+
+        assert(burst || trs[i].len == 2);
+        for (uint32_t k = 1; k < trs[i].len; k++) {
+            uint8_t a = (uint8_t)((addr + k - 1) & 0x3F);
+            if (cmd & 0x80) rx[k] = m->regs[a];
+            else            m->regs[a] = tx[k];
+        }
+        m->frames++;
+    }
+}
+
+static spm_device_t *open_model_dev(void)
+{
+    spm_sys_fake_reset();
+    memset(&g_model, 0, sizeof g_model);
+    for (unsigned i = 0; i < sizeof g_model.regs; i++) g_model.regs[i] = (uint8_t)(0xA0 + i);
+    spm_sys_fake_set_xfer_handler(model_xfer, &g_model);
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_F_DEFAULT, &dev);
+    assert(rc == SPM_OK);
+    return dev;
+}
+
+/* ====================================================== */
+/* ======================== Read ======================== */
+/* ====================================================== */
+
+static void read_multi_groups_and_scatters(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    const uint8_t addrs[] = {0x31, 0x10, 0x12, 0x30, 0x11};
+    uint8_t values[5] = {0};
+
+    spm_ecode_t rc = spm_reg_read_multi(dev, &PROTO, addrs, values, 5);
+    assert(rc == SPM_OK);
+
+    for (int i = 0; i < 5; i++) assert(values[i] == (uint8_t)(0xA0 + addrs[i]));
+    assert(g_model.messages == 1);
+    assert(g_model.frames == 2);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void read_multi_reads_through_small_gaps(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    const uint8_t addrs[] = {0x01, 0x04, 0x08, 0x08};
+    uint8_t values[4] = {0};
+
+    spm_reg_plan_t *plan = NULL;
+    assert(spm_reg_plan_create(&PROTO, addrs, 4, &plan) == SPM_OK);
+    assert(spm_reg_plan_bursts(plan) == 2);   /* 0x01..0x04 | 0x08 */
+
+    assert(spm_reg_plan_read(dev, plan, values) == SPM_OK);
+    assert(values[0] == 0xA1);
+    assert(values[1] == 0xA4);
+    assert(values[2] == 0xA8);
+    assert(values[3] == 0xA8);
+
+    /* Plans are reusable */
+    g_model.regs[0x04] = 0x55;
+    assert(spm_reg_plan_read(dev, plan, values) == SPM_OK);
+    assert(values[1] == 0x55);
+    assert(g_model.messages == 2);
+
+    spm_reg_plan_destroy(plan);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void read_multi_without_auto_increment_uses_single_frames(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    spm_reg_proto_t proto = PROTO;
+    proto.auto_increment = false;
+
+    const uint8_t addrs[] = {0x02, 0x03, 0x04};
+    uint8_t values[3] = {0};
+
+    assert(spm_reg_read_multi(dev, &proto, addrs, values, 3) == SPM_OK);
+    assert(values[0] == 0xA2 && values[1] == 0xA3 && values[2] == 0xA4);
+    assert(g_model.frames == 3);
+    assert(g_model.messages == 1);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void read_multi_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    const uint8_t addrs[] = {0x01};
+    uint8_t values[1];
+    spm_reg_plan_t *plan = NULL;
+
+    assert(spm_reg_read_multi(dev, NULL, addrs, values, 1) == SPM_EPARAM);
+    assert(spm_reg_read_multi(dev, &PROTO, NULL, values, 1) == SPM_EPARAM);
+    assert(spm_reg_read_multi(dev, &PROTO, addrs, NULL, 1) == SPM_EPARAM);
+    assert(spm_reg_read_multi(dev, &PROTO, addrs, values, 0) == SPM_EPARAM);
+    assert(spm_reg_read_multi(NULL, &PROTO, addrs, values, 1) == SPM_ESTATE);
+    assert(spm_reg_plan_create(&PROTO, addrs, 1, NULL) == SPM_EPARAM);
+    assert(spm_reg_plan_create(&PROTO, addrs, 0, &plan) == SPM_EPARAM);
+
+    /* a full 256-register burst does not fit 256 bytes */
+    spm_reg_proto_t small = PROTO;
+    small.bufsiz = 256;
+    assert(spm_reg_plan_create(&small, addrs, 1, &plan) == SPM_EPARAM);
+    assert(spm_reg_write_multi(dev, &small, addrs, values, 1) == SPM_EPARAM);
+    small.max_burst = 16;
+    assert(spm_reg_plan_create(&small, addrs, 1, &plan) == SPM_OK);
+    spm_reg_plan_destroy(plan);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void read_multi_splits_scattered_registers_by_bufsiz(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    /* 40 single-register frames, each counting SPM_BUFSIZ_ALIGN */
+    spm_reg_proto_t proto = PROTO;
+    proto.auto_increment = false;
+    uint8_t addrs[40], values[40];
+    for (uint8_t i = 0; i < 40; i++) addrs[i] = (uint8_t)(39 - i);
+
+    assert(spm_reg_read_multi(dev, &proto, addrs, values, 40) == SPM_OK);
+    for (int i = 0; i < 40; i++) assert(values[i] == (uint8_t)(0xA0 + addrs[i]));
+    assert(g_model.frames == 40);
+    assert(g_model.messages == 2);
+
+    /* a smaller bufsiz means more messages */
+    g_model.messages = 0;
+    proto.bufsiz = 8 * SPM_BUFSIZ_ALIGN;
+    assert(spm_reg_read_multi(dev, &proto, addrs, values, 40) == SPM_OK);
+    assert(g_model.messages == 5);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ======================== Write ======================= */
+/* ====================================================== */
+
+static void write_multi_merges_contiguous_only(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    const uint8_t addrs[]  = {0x21, 0x20, 0x24};
+    const uint8_t values[] = {0x11, 0x10, 0x14};
+
+    assert(spm_reg_write_multi(dev, &PROTO, addrs, values, 3) == SPM_OK);
+    assert(g_model.regs[0x20] == 0x10);
+    assert(g_model.regs[0x21] == 0x11);
+    assert(g_model.regs[0x22] == 0xA0 + 0x22);   /* gap untouched */
+    assert(g_model.regs[0x24] == 0x14);
+    assert(g_model.frames == 2);
+    assert(g_model.messages == 1);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_multi_splits_scattered_registers_by_bufsiz(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    uint8_t addrs[40], values[40];
+    for (uint8_t i = 0; i < 40; i++) {
+        addrs[i]  = (uint8_t)(i & 1 ? 63 - i / 2 : i / 2);
+        values[i] = (uint8_t)(0x40 + i);
+    }
+    spm_reg_proto_t proto = PROTO;
+    proto.auto_increment = false;
+
+    assert(spm_reg_write_multi(dev, &proto, addrs, values, 40) == SPM_OK);
+    for (int i = 0; i < 40; i++) assert(g_model.regs[addrs[i]] == values[i]);
+    assert(g_model.frames == 40);
+    assert(g_model.messages == 2);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void write_multi_keeps_order_of_duplicates(void)
+{
+    spm_device_t *dev = open_model_dev();
+
+    const uint8_t addrs[]  = {0x05, 0x05, 0x05};
+    const uint8_t values[] = {0x01, 0x02, 0x03};
+
+    assert(spm_reg_write_multi(dev, &PROTO, addrs, values, 3) == SPM_OK);
+    assert(g_model.regs[0x05] == 0x03);
+    assert(g_model.frames == 3);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =========================== Main ===================== */
+/* ====================================================== */
+
+int main(void)
+{
+    // read
+    read_multi_groups_and_scatters();
+    read_multi_reads_through_small_gaps();
+    read_multi_without_auto_increment_uses_single_frames();
+    read_multi_fails_invalid_input();
+    read_multi_splits_scattered_registers_by_bufsiz();
+    // write
+    write_multi_merges_contiguous_only();
+    write_multi_splits_scattered_registers_by_bufsiz();
+    write_multi_keeps_order_of_duplicates();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_sched.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* Records message boundaries and CS releases */
+typedef struct {
+    unsigned  messages;
+    unsigned  xfers;
+    uint8_t   first_byte[64];
+    uint8_t   cs_change[64];
+    unsigned  msg_xfers[64];
+} bus_log_t;
+
+static bus_log_t g_log;
+
+static void log_xfer(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    bus_log_t *log = ctx;
+    if (log->messages < 64) log->msg_xfers[log->messages] = (unsigned)n;
+    log->messages++;
+    for (size_t i = 0; i < n; i++, log->xfers++) {
+        if (log->xfers >= 64) continue;
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        log->first_byte[log->xfers] = tx ? tx[0] : 0;
+        log->cs_change[log->xfers] = trs[i].cs_change;
+    }
+}
+
+/* Simulated bus 0 with four chip-selects, all logged */
+static void reset_bus(void)
+{
+    spm_sim_reset();
+    memset(&g_log, 0, sizeof g_log);
+
+    char path[32];
+    for (int cs = 0; cs < 4; cs++) {
+        snprintf(path, sizeof path, "/dev/spidev0.%d", cs);
+        assert(spm_sim_add(path, 0, log_xfer, &g_log) == SPM_OK);
+    }
+}
+
+static spm_device_t *open_dev(uint8_t cs, uint32_t speed_hz)
+{
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = speed_hz, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, cs, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+    return dev;
+}
+
+static spm_ecode_t fail_pre(spm_device_t *dev, const spm_hook_call_t *call, void *ctx)
+{
+    (void)dev; (void)call; (void)ctx;
+    return SPM_EIO;
+}
+
+typedef struct {
+    unsigned  runs;
+    uint64_t  last_tick;
+    spm_ecode_t last_rc;
+} done_log_t;
+
+static void on_done(void *ctx, spm_ecode_t rc, uint64_t tick)
+{
+    done_log_t *d = ctx;
+    d->runs++;
+    d->last_tick = tick;
+    d->last_rc = rc;
+}
+
+static uint8_t g_cmd[8] = { 0xA0, 0xB0, 0xC0, 0xD0, 0xE0, 0xF0, 0x10, 0x20 };
+static uint8_t g_rx[8][4];
+
+/* ====================================================== */
+/* ===================== Compilation ==================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    reset_bus();
+    spm_device_t *dev = open_dev(0, 1000000);
+    spm_batch_xfer_t x = { .tx = g_cmd, .len = 1 };
+    spm_sched_t *s = (spm_sched_t *)1;
+
+    spm_sched_task_t t = { .dev = dev, .xfers = &x, .count = 1, .period_us = 1000 };
+    assert(spm_sched_create(NULL, 1, NULL, &s) == SPM_EPARAM && s == NULL);
+    assert(spm_sched_create(&t, 0, NULL, &s) == SPM_EPARAM);
+    assert(spm_sched_create(&t, 1, NULL, NULL) == SPM_EPARAM);
+
+    t.period_us = 0;
+    assert(spm_sched_create(&t, 1, NULL, &s) == SPM_EPARAM);
+
+    /* A task whose own message exceeds bufsiz */
+    static uint8_t big[SPM_BUFSIZ_DEFAULT + 1];
+    spm_batch_xfer_t xl = { .rx = big, .len = sizeof big };
+    spm_sched_task_t tl = { .dev = dev, .xfers = &xl, .count = 1, .period_us = 100000 };
+    assert(spm_sched_create(&tl, 1, NULL, &s) == SPM_EPARAM && s == NULL);
+    assert(spm_sched_create(&tl, 1, &(spm_sched_cfg_t){ .bufsiz = 2 * SPM_BUFSIZ_DEFAULT }, &s) == SPM_OK);
+    spm_sched_destroy(s);
+
+    /* Period not a tick multiple */
+    t.period_us = 1500;
+    assert(spm_sched_create(&t, 1, &(spm_sched_cfg_t){ .tick_us = 1000 }, &s) == SPM_ECONFIG);
+
+    /* Hyperperiod too long */
+    spm_sched_task_t tt[2] = { t, t };
+    tt[0].period_us = 65537;
+    tt[1].period_us = 65539;
+    assert(spm_sched_create(tt, 2, &(spm_sched_cfg_t){ .tick_us = 1 }, &s) == SPM_ECONFIG);
+
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void create_derives_tick_and_hyperperiod(void)
+{
+    reset_bus();
+    spm_device_t *dev = open_dev(0, 8000000);
+    spm_batch_xfer_t x = { .tx = g_cmd, .len = 2 };
+
+    /* 1 kHz, 250 Hz and 100 Hz */
+    spm_sched_task_t t[3] = {
+        { .dev = dev, .xfers = &x, .count = 1, .period_us = 1000 },
+        { .dev = dev, .xfers = &x, .count = 1, .period_us = 4000 },
+        { .dev = dev, .xfers = &x, .count = 1, .period_us = 10000 },
+    };
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(t, 3, NULL, &s) == SPM_OK);
+
+    spm_sched_info_t info;
+    assert(spm_sched_get_info(s, &info) == SPM_OK);
+    assert(info.tick_us == 1000);
+    assert(info.ticks == 20);
+    assert(info.max_tick_ns > 0 && info.max_tick_ns <= 1000000);
+    assert(info.avg_tick_ns <= info.max_tick_ns);
+
+    /* One device: one message per tick */
+    assert(info.messages == 20);
+
+    spm_sched_destroy(s);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void balancer_spreads_equal_tasks(void)
+{
+    reset_bus();
+    spm_device_t *dev[4];
+    for (int i = 0; i < 4; i++) dev[i] = open_dev((uint8_t)i, 1000000);
+
+    /* Four 4-tick tasks on one 1-tick grid: one per tick */
+    spm_batch_xfer_t x[4];
+    spm_sched_task_t t[5];
+    for (int i = 0; i < 4; i++) {
+        x[i] = (spm_batch_xfer_t){ .tx = &g_cmd[i], .len = 16 };
+        t[i] = (spm_sched_task_t){ .dev = dev[i], .xfers = &x[i], .count = 1, .period_us = 4000 };
+    }
+    t[4] = (spm_sched_task_t){ .dev = dev[0], .xfers = &x[0], .count = 1, .period_us = 1000 };
+
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(t, 5, NULL, &s) == SPM_OK);
+
+    bool used[4] = {false};
+    for (size_t i = 0; i < 4; i++) {
+        uint32_t off;
+        assert(spm_sched_get_offset(s, i, &off) == SPM_OK);
+        assert(off < 4 && !used[off]);
+        used[off] = true;
+    }
+    uint32_t off;
+    assert(spm_sched_get_offset(s, 5, &off) == SPM_EPARAM);
+
+    spm_sched_destroy(s);
+    for (int i = 0; i < 4; i++) spm_dev_close(dev[i]);
+    TEST_PASS();
+}
+
+static void budget_is_checked_against_wire_model(void)
+{
+    reset_bus();
+    spm_device_t *dev = open_dev(0, 1000000);
+
+    /* 100 bytes at 1 MHz = 800 us of bits plus overheads */
+    static uint8_t buf[100];
+    spm_batch_xfer_t x = { .tx = buf, .len = sizeof buf };
+    spm_sched_task_t t[2] = {
+        { .dev = dev, .xfers = &x, .count = 1, .period_us = 1000 },
+        { .dev = dev, .xfers = &x, .count = 1, .period_us = 1000 },
+    };
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(t, 1, NULL, &s) == SPM_OK);
+    spm_sched_destroy(s);
+
+    /* Two per 1 ms tick cannot fit */
+    assert(spm_sched_create(t, 2, NULL, &s) == SPM_ECONFIG && s == NULL);
+
+    /* A 2 ms period gives the balancer room */
+    t[1].period_us = 2000;
+    assert(spm_sched_create(t, 2, NULL, &s) == SPM_ECONFIG);
+    t[0].period_us = 2000;
+    assert(spm_sched_create(t, 2, NULL, &s) == SPM_OK);
+
+    spm_sched_destroy(s);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Execution ===================== */
+/* ====================================================== */
+
+static void step_packs_device_tasks_into_one_message(void)
+{
+    reset_bus();
+    spm_device_t *a = open_dev(0, 4000000);
+    spm_device_t *b = open_dev(1, 4000000);
+
+    /* Register read on a (cmd + data), status read on a, one write on b */
+    spm_batch_xfer_t xa[2] = {
+        { .tx = &g_cmd[0], .len = 1 },
+        { .rx = g_rx[0], .len = 4 },
+    };
+    spm_batch_xfer_t xs = { .tx = &g_cmd[1], .rx = g_rx[1], .len = 2 };
+    spm_batch_xfer_t xb = { .tx = &g_cmd[2], .len = 3 };
+
+    done_log_t d[3] = {0};
+    spm_sched_task_t t[3] = {
+        { .dev = a, .xfers = xa,  .count = 2, .period_us = 1000, .done = on_done, .ctx = &d[0] },
+        { .dev = a, .xfers = &xs, .count = 1, .period_us = 1000, .done = on_done, .ctx = &d[1] },
+        { .dev = b, .xfers = &xb, .count = 1, .period_us = 2000, .done = on_done, .ctx = &d[2] },
+    };
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(t, 3, NULL, &s) == SPM_OK);
+
+    uint32_t off_b;
+    assert(spm_sched_get_offset(s, 2, &off_b) == SPM_OK);
+
+    assert(spm_sched_step(s) == SPM_OK);
+    assert(spm_sched_step(s) == SPM_OK);
+
+    /* Two ticks: a's pair every tick, b once */
+    assert(g_log.messages == 3);
+    assert(d[0].runs == 2 && d[1].runs == 2 && d[2].runs == 1);
+    assert(d[2].last_tick == off_b);
+
+    /* Tick 0 opens with a's message: cmd, data (CS released), status */
+    const unsigned x0 = 0;
+    assert(g_log.msg_xfers[0] == 3);
+    assert(g_log.first_byte[x0] == 0xA0);
+    assert(g_log.cs_change[x0] == 0);
+    assert(g_log.cs_change[x0 + 1] == 1);
+    assert(g_log.first_byte[x0 + 2] == 0xB0);
+    assert(g_log.cs_change[x0 + 2] == 0);
+
+    spm_sched_stats_t st;
+    assert(spm_sched_get_stats(s, &st) == SPM_OK);
+    assert(st.ticks == 2 && st.messages == 3 && st.errors == 0);
+
+    /* Failed messages reach the callbacks and the counters */
+    assert(spm_dev_add_hook(a, &(spm_hook_t){ .pre = fail_pre }) == SPM_OK);
+    assert(spm_sched_step(s) == SPM_EIO);
+    assert(d[0].last_rc == SPM_EIO);
+    assert(spm_sched_get_stats(s, &st) == SPM_OK);
+    assert(st.errors == 1 && st.last_error == SPM_EIO);
+
+    spm_sched_destroy(s);
+    spm_dev_close(a);
+    spm_dev_close(b);
+    TEST_PASS();
+}
+
+static void step_splits_packed_tasks_by_bufsiz(void)
+{
+    reset_bus();
+    spm_device_t *dev = open_dev(0, 10000000);
+
+    /* Each task counts SPM_BUFSIZ_ALIGN tx and rx: 32 fit a message */
+    enum { N = 40 };
+    static uint8_t rx[N][2];
+    spm_batch_xfer_t x[N];
+    spm_sched_task_t t[N];
+    for (int i = 0; i < N; i++) {
+        x[i] = (spm_batch_xfer_t){ .tx = g_cmd, .rx = rx[i], .len = 2 };
+        t[i] = (spm_sched_task_t){ .dev = dev, .xfers = &x[i], .count = 1, .period_us = 1000 };
+    }
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(t, N, NULL, &s) == SPM_OK);
+
+    spm_sched_info_t info;
+    assert(spm_sched_get_info(s, &info) == SPM_OK);
+    assert(info.ticks == 1 && info.messages == 2);
+
+    assert(spm_sched_step(s) == SPM_OK);
+    assert(spm_sched_step(s) == SPM_OK);
+    assert(g_log.messages == 4);
+    assert(g_log.msg_xfers[0] == SPM_BUFSIZ_DEFAULT / SPM_BUFSIZ_ALIGN);
+    assert(g_log.msg_xfers[1] == N - SPM_BUFSIZ_DEFAULT / SPM_BUFSIZ_ALIGN);
+
+    spm_sched_stats_t st;
+    assert(spm_sched_get_stats(s, &st) == SPM_OK);
+    assert(st.messages == 4 && st.errors == 0);
+
+    spm_sched_destroy(s);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+static void timer_runs_ticks_until_stopped(void)
+{
+    reset_bus();
+    spm_device_t *dev = open_dev(0, 10000000);
+
+    spm_batch_xfer_t x = { .tx = g_cmd, .rx = g_rx[0], .len = 4 };
+    done_log_t d = {0};
+    spm_sched_task_t t = { .dev = dev, .xfers = &x, .count = 1, .period_us = 2000,
+                           .done = on_done, .ctx = &d };
+    spm_sched_t *s = NULL;
+    assert(spm_sched_create(&t, 1, NULL, &s) == SPM_OK);
+
+    assert(spm_sched_start(s) == SPM_OK);
+    assert(spm_sched_start(s) == SPM_ESTATE);
+    assert(spm_sched_step(s) == SPM_ESTATE);
+    usleep(50000);
+    assert(spm_sched_stop(s) == SPM_OK);
+
+    spm_sched_stats_t st;
+    assert(spm_sched_get_stats(s, &st) == SPM_OK);
+    assert(st.ticks >= 5);
+    assert(st.ticks + st.skipped <= 40);
+    assert(d.runs == st.ticks);
+    assert(st.avg_exec_ns > 0.0);
+
+    spm_sched_destroy(s);
+    spm_dev_close(dev);
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // compilation
+    create_fails_invalid_input();
+    create_derives_tick_and_hyperperiod();
+    balancer_spreads_equal_tasks();
+    budget_is_checked_against_wire_model();
+    // execution
+    step_packs_device_tasks_into_one_message();
+    step_splits_packed_tasks_by_bufsiz();
+    timer_runs_ticks_until_stopped();
+
+    TEST_PASS();
+    return 0;
+}
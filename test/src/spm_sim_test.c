@@ -0,0 +1,311 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_sim.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ====================================================== */
+/* ==================== Echo Model ====================== */
+/* ====================================================== */
+
+/* Returns tx + 1 on every byte and counts what it saw */
+typedef struct {
+    size_t   calls;
+    size_t   xfers;
+    size_t   bytes;
+} echo_t;
+
+static void echo_model(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    echo_t *e = ctx;
+    e->calls++;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        for (size_t k = 0; rx && k < trs[i].len; k++) rx[k] = (uint8_t)((tx ? tx[k] : 0) + 1);
+        e->xfers++;
+        e->bytes += trs[i].len;
+    }
+}
+
+/* ====================================================== */
+/* ===================== Wire Model ===================== */
+/* ====================================================== */
+
+static void test_wire_ns(void)
+{
+    spm_sim_timing_t t = { .msg_overhead_ns = 10000, .xfer_overhead_ns = 500 };
+    spm_batch_xfer_t x[2] = {
+        { .len = 125 },                                 /* 1000 bits @ 1 MHz = 1 ms */
+        { .len = 4, .speed_hz = 32000000, .delay_usecs = 3 },
+    };
+
+    assert(spm_sim_wire_ns(&t, x, 1, 1000000, 8) == 10000 + 500 + 1000000);
+    assert(spm_sim_wire_ns(&t, x, 2, 1000000, 0) == 10000 + 500 + 1000000 + 500 + 1000 + 3000);
+    assert(spm_sim_wire_ns(&t, x, 0, 1000000, 8) == 0);
+
+    /* NULL = current model, defaults after reset */
+    spm_sim_reset();
+    assert(spm_sim_wire_ns(NULL, x, 1, 1000000, 8) == 15000 + 1000 + 1000000);
+
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Devices ======================= */
+/* ====================================================== */
+
+static void test_add_and_open(void)
+{
+    spm_sim_reset();
+
+    assert(spm_sim_add(NULL, 0, NULL, NULL) == SPM_EPARAM);
+    assert(spm_sim_add("/dev/spidev0.0", 0, NULL, NULL) == SPM_OK);
+    assert(spm_sim_add("/dev/spidev0.0", 0, NULL, NULL) == SPM_ESTATE);
+    assert(spm_sim_has("/dev/spidev0.0"));
+    assert(!spm_sim_has("/dev/spidev0.1"));
+
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(0, 1, NULL, &SPM_SYS_SIM, &dev) == SPM_ENODEV);
+    assert(dev == NULL);
+
+    assert(spm_dev_open_sys_ops(0, 0, NULL, &SPM_SYS_SIM, &dev) == SPM_OK);
+    uint8_t tx[4] = {1, 2, 3, 4}, rx[4] = {9, 9, 9, 9};
+    assert(spm_transfer(dev, tx, rx, 4) == SPM_OK);
+    for (int i = 0; i < 4; i++) assert(rx[i] == 0);   /* no model: zeros */
+    spm_dev_close(dev);
+
+    char path[32];
+    for (int i = 1; i < SPM_SIM_MAX_DEVICES; i++) {
+        snprintf(path, sizeof(path), "/dev/spidev1.%d", i);
+        assert(spm_sim_add(path, 0, NULL, NULL) == SPM_OK);
+    }
+    assert(spm_sim_add("/dev/spidev9.9", 0, NULL, NULL) == SPM_ENOMEM);
+
+    TEST_PASS();
+}
+
+static void run_model_through(const spm_sys_ops_t *ops)
+{
+    spm_sim_reset();
+    echo_t e = {0};
+    assert(spm_sim_add("/dev/spidev2.0", 4000000, echo_model, &e) == SPM_OK);
+
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 4000000, .bits_per_word = 8 };
+    spm_device_t *dev = NULL;
+    assert(spm_dev_open_sys_ops(2, 0, &cfg, ops, &dev) == SPM_OK);
+    spm_sim_reset_stats();
+
+    uint8_t tx[8] = {0, 1, 2, 3, 4, 5, 6, 7}, rx[8] = {0};
+    assert(spm_transfer(dev, tx, rx, 8) == SPM_OK);
+    for (int i = 0; i < 8; i++) assert(rx[i] == i + 1);
+
+    uint8_t rx2[3] = {0};
+    spm_batch_xfer_t x[2] = {
+        { .tx = tx, .len = 1 },
+        { .rx = rx2, .len = 3 },
+    };
+    assert(spm_batch(dev, x, 2) == SPM_OK);
+    assert(rx2[0] == 1 && rx2[2] == 1);
+
+    assert(e.calls == 2 && e.xfers == 3 && e.bytes == 12);
+
+    spm_sim_stats_t s;
+    assert(spm_sim_get_stats("/dev/spidev2.0", &s) == SPM_OK);
+    assert(s.messages == 2 && s.xfers == 3 && s.bytes == 12);
+    assert(s.syscalls >= 2);
+    assert(s.wire_ns == spm_sim_wire_ns(NULL, &(spm_batch_xfer_t){ .len = 8 }, 1, 4000000, 8)
+                     + spm_sim_wire_ns(NULL, x, 2, 4000000, 8));
+
+    spm_sim_stats_t tot;
+    assert(spm_sim_get_stats(NULL, &tot) == SPM_OK);
+    assert(tot.bytes == s.bytes && tot.wire_ns == s.wire_ns);
+    assert(spm_sim_get_stats("/dev/nope", &tot) == SPM_EPARAM);
+
+    spm_dev_close(dev);
+}
+
+static void test_model_ioctl(void)
+{
+    run_model_through(&SPM_SYS_SIM);
+    TEST_PASS();
+}
+
+static void test_model_msg(void)
+{
+    run_model_through(&SPM_SYS_SIM_MSG);
+    TEST_PASS();
+}
+
+static void test_cfg_roundtrip(void)
+{
+    const spm_sys_ops_t *ops[2] = { &SPM_SYS_SIM, &SPM_SYS_SIM_MSG };
+    for (int k = 0; k < 2; k++) {
+        spm_sim_reset();
+        assert(spm_sim_add("/dev/spidev0.0", 0, NULL, NULL) == SPM_OK);
+
+        spm_cfg_t cfg = { .mode = SPM_MODE3, .speed_hz = 2000000, .bits_per_word = 8 };
+        spm_device_t *dev = NULL;
+        assert(spm_dev_open_sys_ops(0, 0, &cfg, ops[k], &dev) == SPM_OK);
+
+        spm_cfg_t got;
+        assert(spm_dev_get_cfg(dev, &got) == SPM_OK);
+        assert(got.mode == SPM_MODE3 && got.speed_hz == 2000000 && got.bits_per_word == 8);
+        spm_dev_close(dev);
+    }
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Limits ======================== */
+/* ====================================================== */
+
+static void test_bufsiz_rejects_large_messages(void)
+{
+    const spm_sys_ops_t *ops[2] = { &SPM_SYS_SIM, &SPM_SYS_SIM_MSG };
+    for (int k = 0; k < 2; k++) {
+        spm_sim_reset();
+        echo_t e = {0};
+        assert(spm_sim_add("/dev/spidev0.0", 0, echo_model, &e) == SPM_OK);
+
+        spm_device_t *dev = NULL;
+        assert(spm_dev_open_sys_ops(0, 0, NULL, ops[k], &dev) == SPM_OK);
+        spm_sim_reset_stats();
+
+        /* rx sum at the default limit passes, one byte more does not */
+        static uint8_t buf[SPM_BUFSIZ_DEFAULT + 1];
+        assert(spm_read(dev, buf, SPM_BUFSIZ_DEFAULT) == SPM_OK);
+        assert(spm_read(dev, buf, SPM_BUFSIZ_DEFAULT + 1) == SPM_EPARAM);
+
+        /* each transfer counts rounded up to SPM_BUFSIZ_ALIGN */
+        uint8_t cmd = 0x03;
+        spm_batch_xfer_t x[2] = {
+            { .tx = &cmd, .len = 1 },
+            { .tx = buf,  .len = SPM_BUFSIZ_DEFAULT - SPM_BUFSIZ_ALIGN + 1 },
+        };
+        assert(spm_batch(dev, x, 2) == SPM_EPARAM);
+        x[1].len--;
+        assert(spm_batch(dev, x, 2) == SPM_OK);
+
+        spm_sim_stats_t st;
+        assert(spm_sim_get_stats("/dev/spidev0.0", &st) == SPM_OK);
+        assert(st.messages == 2 && st.errors == 2);
+        assert(e.calls == 2);
+
+        spm_sim_set_bufsiz(2 * SPM_BUFSIZ_DEFAULT);
+        assert(spm_read(dev, buf, SPM_BUFSIZ_DEFAULT + 1) == SPM_OK);
+        spm_dev_close(dev);
+    }
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+static void test_transfer_rejects_too_many_xfers(void)
+{
+    spm_sim_reset();
+    echo_t e = {0};
+    assert(spm_sim_add("/dev/spidev0.0", 0, echo_model, &e) == SPM_OK);
+    spm_sim_set_bufsiz((SPM_MAX_BATCH_XFERS + 1) * SPM_BUFSIZ_ALIGN);
+    int fd = SPM_SYS_SIM_MSG.open_("/dev/spidev0.0", 0);
+    assert(fd >= 0);
+
+    static spm_batch_xfer_t x[SPM_MAX_BATCH_XFERS + 1];
+    uint8_t b = 0;
+    for (size_t i = 0; i < SPM_MAX_BATCH_XFERS + 1; i++) x[i] = (spm_batch_xfer_t){ .tx = &b, .len = 1 };
+    spm_cfg_t cfg = { .speed_hz = 1000000, .bits_per_word = 8 };
+    spm_sys_msg_t msg = { .xfers = x, .count = SPM_MAX_BATCH_XFERS + 1, .cfg = &cfg };
+
+    errno = 0;
+    assert(SPM_SYS_SIM_MSG.transfer_(fd, &msg) == -1);
+    assert(errno == EMSGSIZE && spm_map_errno() == SPM_EPARAM);
+    assert(e.calls == 0);
+
+    msg.count = SPM_MAX_BATCH_XFERS;
+    assert(SPM_SYS_SIM_MSG.transfer_(fd, &msg) == 0);
+    assert(e.calls == 1 && e.xfers == SPM_MAX_BATCH_XFERS);
+
+    assert(SPM_SYS_SIM_MSG.close_(fd) == 0);
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ===================== Realtime ======================= */
+/* ====================================================== */
+
+static void test_realtime(void)
+{
+    spm_sim_reset();
+    spm_sim_set_timing(&(spm_sim_timing_t){ .realtime = true });
+    assert(spm_sim_add("/dev/spidev0.0", 1000000, NULL, NULL) == SPM_OK);
+
+    spm_device_t *dev = NULL;
+    spm_cfg_t cfg = { .mode = SPM_MODE0, .speed_hz = 1000000, .bits_per_word = 8 };
+    assert(spm_dev_open_sys_ops(0, 0, &cfg, &SPM_SYS_SIM, &dev) == SPM_OK);
+
+    static uint8_t buf[1250];                         /* 10 ms at 1 MHz */
+    uint64_t t0 = now_ns();
+    assert(spm_transfer(dev, buf, buf, sizeof(buf)) == SPM_OK);
+    uint64_t dt = now_ns() - t0;
+    assert(dt >= 10000000u);
+
+    spm_dev_close(dev);
+    spm_sim_reset();
+    TEST_PASS();
+}
+
+int main(void)
+{
+    // wire model
+    test_wire_ns();
+    // devices
+    test_add_and_open();
+    test_model_ioctl();
+    test_model_msg();
+    test_cfg_roundtrip();
+    // limits
+    test_bufsiz_rejects_large_messages();
+    test_transfer_rejects_too_many_xfers();
+    // realtime
+    test_realtime();
+
+    TEST_PASS();
+    return 0;
+}
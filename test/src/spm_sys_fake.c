@@ -1,6 +1,11 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
 #include <linux/spi/spidev.h>
 
 #include "spm_sys_fake.h"
@@ -22,13 +27,25 @@ typedef struct {
         bool repeat;            /* all ioctls fail */
     } inject;
     struct {
-        uint64_t total, rd, wr, msg, fail;
+        uint64_t total, rd, wr, msg, fail, native;
     } stats;
+    spm_sys_fake_xfer_fn xfer_fn;
+    void                *xfer_ctx;
     bool inited;
 } SpiDevice;
 
 static SpiDevice g;
 
+/* ---- Target Mode (survives spm_sys_fake_reset) ---- */
+static struct {
+    pthread_mutex_t                 lock;
+    pthread_cond_t                  armed_cond;
+    bool                            on;
+    const struct spi_ioc_transfer  *armed;      /* message waiting for the host */
+    size_t                          armed_n;
+    int                             done[2];    /* host -> target completion pipe */
+} tm = { .lock = PTHREAD_MUTEX_INITIALIZER, .armed_cond = PTHREAD_COND_INITIALIZER, .done = {-1, -1} };
+
 /* ====================================================== */
 /* ================ Helpers/Assertions ================== */
 /* ====================================================== */
@@ -89,6 +106,7 @@ spm_sys_fake_ioctl_stats spm_sys_fake_get_ioctl_stats(void) {
         .wr    = g.stats.wr,
         .msg   = g.stats.msg,
         .fail  = g.stats.fail,
+        .native = g.stats.native,
     };
     return s;
 }
@@ -114,6 +132,62 @@ void spm_sys_fake_set_defaults(uint32_t mode, uint8_t bpw, uint32_t max_hz) {
     g.max_hz = max_hz;
 }
 
+void spm_sys_fake_set_xfer_handler(spm_sys_fake_xfer_fn fn, void *ctx) {
+    init_once();
+    g.xfer_fn = fn;
+    g.xfer_ctx = ctx;
+}
+
+void spm_sys_fake_set_target_mode(bool on) {
+    pthread_mutex_lock(&tm.lock);
+    if (on && tm.done[0] < 0) {
+        if (pipe(tm.done) == 0) fcntl(tm.done[0], F_SETFL, O_NONBLOCK);
+        else tm.done[0] = tm.done[1] = -1;
+    }
+    char c;
+    while (tm.done[0] >= 0 && read(tm.done[0], &c, 1) == 1) { }
+    tm.on = on;
+    tm.armed = NULL;
+    pthread_mutex_unlock(&tm.lock);
+}
+
+int spm_sys_fake_host_xfer(const void *tx, void *rx, size_t len, int timeout_ms) {
+    struct timespec dl;
+    clock_gettime(CLOCK_REALTIME, &dl);
+    dl.tv_sec  += timeout_ms / 1000;
+    dl.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (dl.tv_nsec >= 1000000000L) { dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+
+    pthread_mutex_lock(&tm.lock);
+    while (!tm.armed) {
+        if (pthread_cond_timedwait(&tm.armed_cond, &tm.lock, &dl) != 0 && !tm.armed) {
+            pthread_mutex_unlock(&tm.lock);
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    /* Full duplex across the armed transfers; missing tx clocks zeros */
+    const uint8_t *htx = tx;
+    uint8_t *hrx = rx;
+    size_t pos = 0;
+    for (size_t i = 0; i < tm.armed_n && pos < len; i++) {
+        const struct spi_ioc_transfer *x = &tm.armed[i];
+        const uint8_t *ttx = (const uint8_t *)(uintptr_t)x->tx_buf;
+        uint8_t *trx = (uint8_t *)(uintptr_t)x->rx_buf;
+        for (uint32_t k = 0; k < x->len && pos < len; k++, pos++) {
+            if (hrx) hrx[pos] = ttx ? ttx[k] : 0;
+            if (trx) trx[k] = htx ? htx[pos] : 0;
+        }
+    }
+    tm.armed = NULL;
+    pthread_mutex_unlock(&tm.lock);
+
+    const char c = 1;
+    (void)!write(tm.done[1], &c, 1);
+    return 0;
+}
+
 /* Fail toggles */
 void spm_sys_fake_fail_open(void)                 { init_once(); g.inject.open = true; }
 void spm_sys_fake_fail_ioctl(void)                { init_once(); g.inject.repeat = true; }
@@ -140,6 +214,31 @@ static int f_close_(int fd) {
     return 0;
 }
 
+/* Arm a message and sleep until the host clocks it; a signal aborts */
+static int target_wait(const struct spi_ioc_transfer *trs, size_t n)
+{
+    pthread_mutex_lock(&tm.lock);
+    tm.armed = trs;
+    tm.armed_n = n;
+    pthread_cond_broadcast(&tm.armed_cond);
+    pthread_mutex_unlock(&tm.lock);
+
+    for (;;) {
+        struct pollfd pfd = { .fd = tm.done[0], .events = POLLIN };
+        int r = poll(&pfd, 1, -1);
+        char c;
+        if (r > 0 && read(tm.done[0], &c, 1) == 1) return 0;
+        if (r < 0 && errno == EINTR) {
+            pthread_mutex_lock(&tm.lock);
+            bool aborted = tm.armed == trs;
+            if (aborted) tm.armed = NULL;
+            pthread_mutex_unlock(&tm.lock);
+            if (aborted) { errno = EINTR; return -1; }
+            /* The host already took it: its completion byte is on the way */
+        }
+    }
+}
+
 static int f_ioctl_(int fd, unsigned long req, void *arg)
 {
     init_once();
@@ -165,7 +264,8 @@ static int f_ioctl_(int fd, unsigned long req, void *arg)
         }
         size_t n = sz / sizeof(struct spi_ioc_transfer);
         g.stats.msg += (n > 0 ? (n - 1) : 0);
-        (void)arg;
+        if (tm.on && n > 0) return target_wait((const struct spi_ioc_transfer*)arg, n);
+        if (g.xfer_fn && n > 0) g.xfer_fn((const struct spi_ioc_transfer*)arg, n, g.xfer_ctx);
         return 0;
     }
 
@@ -185,6 +285,79 @@ static int f_ioctl_(int fd, unsigned long req, void *arg)
     }
 }
 
+static uint32_t cfg_mode_mask(const spm_cfg_t *cfg) {
+    static const uint32_t lut[4] = {0, SPI_CPHA, SPI_CPOL, SPI_CPOL | SPI_CPHA};
+    return lut[cfg->mode & 3]
+         | (cfg->cs_active_high ? SPI_CS_HIGH   : 0)
+         | (cfg->lsb_first      ? SPI_LSB_FIRST : 0);
+}
+
+static void cfg_from_state(spm_cfg_t *cfg) {
+    cfg->mode           = (spm_mode_t)(g.mode & (SPI_CPOL | SPI_CPHA));
+    cfg->cs_active_high = !!(g.mode & SPI_CS_HIGH);
+    cfg->lsb_first      = !!(g.mode & SPI_LSB_FIRST);
+    cfg->bits_per_word  = g.bits_per_word;
+    cfg->speed_hz       = g.max_hz;
+}
+
+static int f_transfer_(int fd, spm_sys_msg_t *msg)
+{
+    init_once();
+    int cat_rd  = !!(msg->flags & SPM_SYS_MSG_CFG_READ);
+    int cat_wr  = !!(msg->flags & SPM_SYS_MSG_CFG_WRITE);
+
+    g.stats.total++;
+    g.stats.native++;
+    if (cat_rd)  g.stats.rd++;
+    if (cat_wr)  g.stats.wr++;
+    if (!cat_rd && !cat_wr) g.stats.msg += msg->count;
+
+    if (fd != g.fd || g.fd == INVALID_FD) {
+        errno = EBADF; g.stats.fail++; return -1;
+    }
+    if (should_fail_ioctl(cat_rd, cat_wr)) {
+        errno = EIO; g.stats.fail++; return -1;
+    }
+
+    if (cat_wr) {
+        g.mode = cfg_mode_mask(msg->cfg);
+        g.bits_per_word = msg->cfg->bits_per_word;
+        g.max_hz = msg->cfg->speed_hz;
+        return 0;
+    }
+    if (cat_rd) {
+        cfg_from_state(msg->out_cfg);
+        return 0;
+    }
+
+    /* Peripheral models speak spi_ioc_transfer */
+    if ((g.xfer_fn || tm.on) && msg->count > 0) {
+        struct spi_ioc_transfer trs[SPM_MAX_BATCH_XFERS];
+        size_t n = msg->count < SPM_MAX_BATCH_XFERS ? msg->count : SPM_MAX_BATCH_XFERS;
+        for (size_t i = 0; i < n; i++) {
+            const spm_batch_xfer_t *x = &msg->xfers[i];
+            trs[i] = (struct spi_ioc_transfer){
+                .tx_buf        = (uintptr_t)x->tx,
+                .rx_buf        = (uintptr_t)x->rx,
+                .len           = (uint32_t)x->len,
+                .speed_hz      = x->speed_hz ? x->speed_hz : msg->cfg->speed_hz,
+                .bits_per_word = x->bits_per_word ? x->bits_per_word : msg->cfg->bits_per_word,
+                .delay_usecs   = x->delay_usecs,
+                .cs_change     = x->cs_change,
+            };
+        }
+        if (tm.on) return target_wait(trs, n);
+        g.xfer_fn(trs, n, g.xfer_ctx);
+    }
+    return 0;
+}
+
+const spm_sys_ops_t SPM_SYS_F_MSG = {
+    .open_     = f_open_,
+    .close_    = f_close_,
+    .transfer_ = f_transfer_,
+};
+
 const spm_sys_ops_t SPM_SYS_F_DEFAULT = {
     .open_  = f_open_,
     .close_ = f_close_,
@@ -0,0 +1,251 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_target.h"
+#include "spm_sys_fake.h"
+
+#define TEST_COL 60
+
+/* ====================================================== */
+/* ================ Helpers/Assertions ================== */
+/* ====================================================== */
+
+static const char* basename_c(const char* p) {
+    const char* s = strrchr(p, '/');
+    return s ? s + 1 : p;
+}
+
+static void test_print_status_(const char* file, const char* func, const char* status)
+{
+    char label[256];
+    snprintf(label, sizeof label, "%s:%s", basename_c(file), func);
+
+    int pad = TEST_COL - (int)strlen(label);
+    if (pad < 1) pad = 1;
+
+    printf("%s%*s%s\n", label, pad, "", status);
+}
+
+#define TEST_PASS() test_print_status_(__FILE__, __func__, "PASSED")
+
+/* Fake in target mode: data messages wait for spm_sys_fake_host_xfer() */
+static spm_device_t *open_target_dev(const spm_sys_ops_t *ops)
+{
+    spm_sys_fake_reset();
+    spm_sys_fake_set_target_mode(true);
+
+    spm_device_t *dev = NULL;
+    spm_ecode_t rc = spm_dev_open_sys_ops(1, 0, NULL, ops, &dev);
+    assert(rc == SPM_OK);
+    return dev;
+}
+
+static void close_target_dev(spm_device_t *dev)
+{
+    spm_dev_close(dev);
+    spm_sys_fake_set_target_mode(false);
+}
+
+/* ====================================================== */
+/* ====================== Lifecycle ===================== */
+/* ====================================================== */
+
+static void create_fails_invalid_input(void)
+{
+    spm_device_t *dev = open_target_dev(&SPM_SYS_F_DEFAULT);
+    spm_target_t *tgt = (spm_target_t *)0x1;
+
+    spm_target_cfg_t cfg = { .frame_len = 4 };
+    assert(spm_target_create(NULL, &cfg, &tgt) == SPM_EPARAM);
+    assert(tgt == NULL);
+    assert(spm_target_create(dev, NULL, &tgt) == SPM_EPARAM);
+    assert(spm_target_create(dev, &cfg, NULL) == SPM_EPARAM);
+
+    spm_target_cfg_t empty = { .frame_len = 0 };
+    assert(spm_target_create(dev, &empty, &tgt) == SPM_EPARAM);
+    spm_target_cfg_t badsig = { .frame_len = 4, .abort_signal = -1 };
+    assert(spm_target_create(dev, &badsig, &tgt) == SPM_EPARAM);
+
+    assert(spm_target_create(dev, &cfg, &tgt) == SPM_OK);
+    uint8_t big[5] = {0}, out[4];
+    assert(spm_target_send(tgt, big, sizeof big, 0) == SPM_EPARAM);
+    assert(spm_target_recv(tgt, out, 3, NULL, 0) == SPM_EPARAM);
+    assert(spm_target_recv(tgt, out, sizeof out, NULL, 0) == SPM_ETIMEOUT);
+
+    spm_target_destroy(tgt);
+    spm_target_destroy(NULL);
+    close_target_dev(dev);
+    TEST_PASS();
+}
+
+static void send_times_out_when_queue_is_full(void)
+{
+    spm_device_t *dev = open_target_dev(&SPM_SYS_F_DEFAULT);
+
+    spm_target_cfg_t cfg = { .frame_len = 2, .tx_depth = 2 };
+    spm_target_t *tgt = NULL;
+    assert(spm_target_create(dev, &cfg, &tgt) == SPM_OK);
+
+    const uint8_t r[2] = {1, 2};
+    assert(spm_target_send(tgt, r, 2, 0) == SPM_OK);
+    assert(spm_target_send(tgt, r, 2, 0) == SPM_OK);
+    assert(spm_target_send(tgt, r, 2, 0) == SPM_ETIMEOUT);
+    assert(spm_target_send(tgt, r, 2, 20) == SPM_ETIMEOUT);
+
+    spm_target_destroy(tgt);
+    close_target_dev(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* ====================== Frames ======================== */
+/* ====================================================== */
+
+static void run_ordered_exchange(const spm_sys_ops_t *ops)
+{
+    spm_device_t *dev = open_target_dev(ops);
+
+    spm_target_cfg_t cfg = { .frame_len = 4, .fill = 0xEE };
+    spm_target_t *tgt = NULL;
+    assert(spm_target_create(dev, &cfg, &tgt) == SPM_OK);
+
+    /* Queued before the host starts clocking; the last one is short */
+    const uint8_t resp[3][4] = { {0x10, 0x11, 0x12, 0x13}, {0x20, 0x21, 0x22, 0x23}, {0x30, 0x31} };
+    assert(spm_target_send(tgt, resp[0], 4, 0) == SPM_OK);
+    assert(spm_target_send(tgt, resp[1], 4, 0) == SPM_OK);
+    assert(spm_target_send(tgt, resp[2], 2, 0) == SPM_OK);
+    assert(spm_target_start(tgt) == SPM_OK);
+    assert(spm_target_start(tgt) == SPM_ESTATE);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t htx[4] = { 0xA0, i, 0x00, 0xFF }, hrx[4];
+        assert(spm_sys_fake_host_xfer(htx, hrx, sizeof htx, 1000) == 0);
+        if (i < 2) assert(memcmp(hrx, resp[i], 4) == 0);
+        if (i == 2) assert(hrx[0] == 0x30 && hrx[1] == 0x31 && hrx[2] == 0xEE && hrx[3] == 0xEE);
+        if (i == 3) assert(hrx[0] == 0xEE && hrx[3] == 0xEE);
+
+        uint8_t got[4];
+        spm_target_frame_t fr;
+        assert(spm_target_recv(tgt, got, sizeof got, &fr, 1000) == SPM_OK);
+        assert(memcmp(got, htx, 4) == 0);
+        assert(fr.seq == i);
+        assert(fr.underrun == (i == 3));
+    }
+
+    assert(spm_target_stop(tgt) == SPM_OK);
+
+    spm_target_stats_t st;
+    assert(spm_target_get_stats(tgt, &st) == SPM_OK);
+    assert(st.frames == 4);
+    assert(st.bytes == 16);
+    assert(st.underruns == 1);
+    assert(st.overruns == 0);
+    assert(st.errors == 0);
+    assert(st.resp_latency_max_ns > 0 && st.resp_latency_avg_ns > 0.0);
+    assert(st.resp_latency_avg_ns <= (double)st.resp_latency_max_ns);
+    assert(st.rearm_avg_ns <= (double)st.rearm_max_ns);
+    assert(st.frames_per_s > 0.0 && st.kbps > 0.0);
+
+    spm_target_destroy(tgt);
+    close_target_dev(dev);
+}
+
+static void queued_responses_go_out_in_order(void)
+{
+    run_ordered_exchange(&SPM_SYS_F_DEFAULT);
+    run_ordered_exchange(&SPM_SYS_F_MSG);
+    TEST_PASS();
+}
+
+static void overrun_drops_new_or_oldest_frame(void)
+{
+    for (int overwrite = 0; overwrite <= 1; overwrite++) {
+        spm_device_t *dev = open_target_dev(&SPM_SYS_F_DEFAULT);
+
+        spm_target_cfg_t cfg = { .frame_len = 1, .rx_depth = 2, .overwrite = overwrite };
+        spm_target_t *tgt = NULL;
+        assert(spm_target_create(dev, &cfg, &tgt) == SPM_OK);
+        assert(spm_target_start(tgt) == SPM_OK);
+
+        for (uint8_t i = 0; i < 4; i++) {
+            uint8_t h = i;
+            assert(spm_sys_fake_host_xfer(&h, NULL, 1, 1000) == 0);
+        }
+        /* The fourth frame completes after its host_xfer returns */
+        spm_target_stats_t st;
+        for (int i = 0; i < 1000; i++) {
+            assert(spm_target_get_stats(tgt, &st) == SPM_OK);
+            if (st.frames == 4) break;
+            usleep(1000);
+        }
+        assert(st.frames == 4);
+        assert(st.overruns == 2);
+        assert(st.underruns == 4);
+
+        uint8_t got;
+        spm_target_frame_t fr;
+        assert(spm_target_recv(tgt, &got, 1, &fr, 0) == SPM_OK);
+        assert(fr.seq == (overwrite ? 2u : 0u) && got == fr.seq);
+        assert(spm_target_recv(tgt, &got, 1, &fr, 0) == SPM_OK);
+        assert(fr.seq == (overwrite ? 3u : 1u) && got == fr.seq);
+        assert(spm_target_recv(tgt, &got, 1, &fr, 0) == SPM_ETIMEOUT);
+
+        spm_target_destroy(tgt);
+        close_target_dev(dev);
+    }
+    TEST_PASS();
+}
+
+static void stop_interrupts_armed_message_and_keeps_response(void)
+{
+    spm_device_t *dev = open_target_dev(&SPM_SYS_F_DEFAULT);
+
+    spm_target_cfg_t cfg = { .frame_len = 2 };
+    spm_target_t *tgt = NULL;
+    assert(spm_target_create(dev, &cfg, &tgt) == SPM_OK);
+
+    const uint8_t resp[2] = { 0x5A, 0xA5 };
+    assert(spm_target_send(tgt, resp, 2, 0) == SPM_OK);
+
+    /* Nobody clocks: stop must not hang on the blocked message */
+    assert(spm_target_start(tgt) == SPM_OK);
+    usleep(10000);
+    assert(spm_target_stop(tgt) == SPM_OK);
+
+    spm_target_stats_t st;
+    assert(spm_target_get_stats(tgt, &st) == SPM_OK);
+    assert(st.frames == 0 && st.errors == 0);
+
+    /* The response is still first in line */
+    assert(spm_target_start(tgt) == SPM_OK);
+    uint8_t hrx[2];
+    assert(spm_sys_fake_host_xfer(NULL, hrx, 2, 1000) == 0);
+    assert(hrx[0] == 0x5A && hrx[1] == 0xA5);
+
+    spm_target_destroy(tgt);
+    close_target_dev(dev);
+    TEST_PASS();
+}
+
+/* ====================================================== */
+/* =========================== Main ===================== */
+/* ====================================================== */
+
+int main(void)
+{
+    // lifecycle
+    create_fails_invalid_input();
+    send_times_out_when_queue_is_full();
+    // frames
+    queued_responses_go_out_in_order();
+    overrun_drops_new_or_oldest_frame();
+    stop_interrupts_armed_message_and_keeps_response();
+
+    TEST_PASS();
+    return 0;
+}
@@ -0,0 +1,560 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "spm_sim.h"
+
+/*
+ * libspm-preload.so
+ *
+ *   LD_PRELOAD=libspm-preload.so ./legacy-tool
+ *
+ * Routes open/close/ioctl/read/write (and dup) on /dev/spidev* to the simulator
+ * so programs that drive spidev directly run without hardware. Each
+ * simulated node is backed by a real /dev/null descriptor, so the fd
+ * number is reserved and calls the shim does not know stay harmless.
+ *
+ * Environment:
+ *   SPM_PRELOAD_DEVICES  "path[=model][@hz],..." nodes to register up
+ *                        front; model is "zero" (rx reads 0, default)
+ *                        or "loop" (rx echoes tx)
+ *   SPM_PRELOAD_MODEL    model for nodes first seen at open (default zero)
+ *   SPM_PRELOAD_PLUGIN   shared object whose spm_preload_setup() is run
+ *                        first, to register models with spm_sim_add()
+ *   SPM_PRELOAD_REALTIME "1": busy-wait the modeled wire time
+ *   SPM_PRELOAD_TRACE    file ("-" = stderr) getting one line per call
+ *   SPM_PRELOAD_REPORT   file ("-" = stderr, default; "off" = none) for
+ *                        per-node totals and bus utilization at exit
+ */
+
+#define PRELOAD_MAX_FD     4096
+#define PRELOAD_PREFIX     "/dev/spidev"
+
+typedef int (*open_fn)(const char *, int, ...);
+typedef int (*openat_fn)(int, const char *, int, ...);
+typedef int (*close_fn)(int);
+typedef int (*ioctl_fn)(int, unsigned long, ...);
+typedef ssize_t (*rw_fn)(int, void *, size_t);
+typedef int (*dup_fn)(int);
+typedef int (*dup2_fn)(int, int);
+typedef int (*dup3_fn)(int, int, int);
+typedef int (*fcntl_fn)(int, int, ...);
+
+typedef struct {
+    int     sim;        /* simulator fd, 0 = not simulated */
+    size_t  path;       /* index into paths */
+} preload_fd_t;
+
+/*
+ * The lock is recursive: a plugin's setup, or libc inside it, may come
+ * back through the interposers while init holds it.
+ */
+static struct {
+    pthread_mutex_t  lock;
+    bool             ready;
+    open_fn          open;
+    openat_fn        openat;
+    close_fn         close;
+    ioctl_fn         ioctl;
+    rw_fn            read;
+    ssize_t        (*write)(int, const void *, size_t);
+    dup_fn           dup;
+    dup2_fn          dup2;
+    dup3_fn          dup3;
+    fcntl_fn         fcntl;
+    fcntl_fn         fcntl64;
+    spm_sim_xfer_fn  auto_model;
+    preload_fd_t     fds[PRELOAD_MAX_FD];           /* by placeholder fd */
+    char             paths[SPM_SIM_MAX_DEVICES][SPM_PATH_MAX];
+    size_t           npaths;
+    bool             used;                          /* a node was opened */
+    bool             realtime;
+    FILE            *trace;
+    FILE            *report;
+    uint64_t         t0;
+} g = { .lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP };
+
+/* ====================================================== */
+/* ====================== Helpers ======================= */
+/* ====================================================== */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void model_loop(const struct spi_ioc_transfer *trs, size_t n, void *ctx)
+{
+    (void)ctx;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *rx = (uint8_t *)(uintptr_t)trs[i].rx_buf;
+        const uint8_t *tx = (const uint8_t *)(uintptr_t)trs[i].tx_buf;
+        if (!rx) continue;
+        if (tx) memcpy(rx, tx, trs[i].len);
+        else    memset(rx, 0, trs[i].len);
+    }
+}
+
+static bool model_by_name(const char *name, spm_sim_xfer_fn *out)
+{
+    if (!name || !*name || strcmp(name, "zero") == 0) { *out = NULL;       return true; }
+    if (strcmp(name, "loop") == 0)                     { *out = model_loop; return true; }
+    return false;
+}
+
+/*
+ * stderr is duplicated because programs commonly close it from an
+ * atexit handler, which runs before the exit report.
+ */
+static FILE *open_stderr(void)
+{
+    int fd = dup(STDERR_FILENO);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!f) return stderr;
+    setvbuf(f, NULL, _IOLBF, 0);
+    return f;
+}
+
+static FILE *open_log(const char *spec, bool dflt)
+{
+    if (!spec || !*spec)            return dflt ? open_stderr() : NULL;
+    if (strcmp(spec, "off") == 0)   return NULL;
+    if (strcmp(spec, "-") == 0)     return open_stderr();
+    FILE *f = fopen(spec, "w");
+    if (f) setvbuf(f, NULL, _IOLBF, 0);
+    return f ? f : open_stderr();
+}
+
+/* Lock held; the simulator holds at most as many nodes as there are slots */
+static size_t remember_path(const char *path)
+{
+    for (size_t i = 0; i < g.npaths; i++) {
+        if (strcmp(g.paths[i], path) == 0) return i;
+    }
+    if (g.npaths == SPM_SIM_MAX_DEVICES) return 0;
+    snprintf(g.paths[g.npaths], SPM_PATH_MAX, "%s", path);
+    return g.npaths++;
+}
+
+/* "path[=model][@hz],..." */
+static void add_env_devices(const char *spec)
+{
+    char buf[1024];
+    snprintf(buf, sizeof buf, "%s", spec);
+
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        uint32_t hz = 0;
+        spm_sim_xfer_fn fn = NULL;
+        char *at = strchr(tok, '@');
+        if (at) {
+            *at = '\0';
+            hz = (uint32_t)strtoul(at + 1, NULL, 10);
+        }
+        char *eq = strchr(tok, '=');
+        if (eq) *eq = '\0';
+        if (!model_by_name(eq ? eq + 1 : NULL, &fn)) {
+            fprintf(stderr, "spm-preload: unknown model '%s' for %s\n", eq + 1, tok);
+            continue;
+        }
+        if (spm_sim_add(tok, hz, fn, NULL) == SPM_OK) remember_path(tok);
+    }
+}
+
+static void load_plugin(const char *path)
+{
+    void *h = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+    void (*setup)(void) = h ? (void (*)(void))dlsym(h, "spm_preload_setup") : NULL;
+    if (!setup) {
+        fprintf(stderr, "spm-preload: %s: %s\n", path, h ? "no spm_preload_setup()" : dlerror());
+        return;
+    }
+    setup();
+}
+
+static void init_locked(void)
+{
+    if (g.ready) return;
+    g.ready  = true;
+    g.open   = (open_fn)dlsym(RTLD_NEXT, "open");
+    g.openat = (openat_fn)dlsym(RTLD_NEXT, "openat");
+    g.close  = (close_fn)dlsym(RTLD_NEXT, "close");
+    g.ioctl  = (ioctl_fn)dlsym(RTLD_NEXT, "ioctl");
+    g.read   = (rw_fn)dlsym(RTLD_NEXT, "read");
+    g.write  = (ssize_t (*)(int, const void *, size_t))dlsym(RTLD_NEXT, "write");
+    g.dup    = (dup_fn)dlsym(RTLD_NEXT, "dup");
+    g.dup2   = (dup2_fn)dlsym(RTLD_NEXT, "dup2");
+    g.dup3   = (dup3_fn)dlsym(RTLD_NEXT, "dup3");
+    g.fcntl  = (fcntl_fn)dlsym(RTLD_NEXT, "fcntl");
+    g.fcntl64 = (fcntl_fn)dlsym(RTLD_NEXT, "fcntl64");
+    if (!g.fcntl64) g.fcntl64 = g.fcntl;
+    g.t0     = now_ns();
+
+    const char *realtime = getenv("SPM_PRELOAD_REALTIME");
+    if (realtime && strcmp(realtime, "1") == 0) {
+        spm_sim_timing_t t = { .realtime = true };
+        spm_sim_set_timing(&t);
+        g.realtime = true;
+    }
+    const char *plugin = getenv("SPM_PRELOAD_PLUGIN");
+    if (plugin && *plugin) load_plugin(plugin);
+    const char *devs = getenv("SPM_PRELOAD_DEVICES");
+    if (devs && *devs) add_env_devices(devs);
+    if (!model_by_name(getenv("SPM_PRELOAD_MODEL"), &g.auto_model)) {
+        fprintf(stderr, "spm-preload: unknown SPM_PRELOAD_MODEL, using zero\n");
+        g.auto_model = NULL;
+    }
+
+    g.trace  = open_log(getenv("SPM_PRELOAD_TRACE"), false);
+    g.report = open_log(getenv("SPM_PRELOAD_REPORT"), true);
+}
+
+static void init(void)
+{
+    pthread_mutex_lock(&g.lock);
+    init_locked();
+    pthread_mutex_unlock(&g.lock);
+}
+
+static preload_fd_t fd_lookup(int fd)
+{
+    preload_fd_t f = { 0, 0 };
+    if (fd < 0 || fd >= PRELOAD_MAX_FD) return f;
+    pthread_mutex_lock(&g.lock);
+    f = g.fds[fd];
+    pthread_mutex_unlock(&g.lock);
+    return f;
+}
+
+/* Drop the mapping of a descriptor the kernel is about to close or reuse */
+static void fd_forget(int fd)
+{
+    if (fd < 0 || fd >= PRELOAD_MAX_FD) return;
+    pthread_mutex_lock(&g.lock);
+    preload_fd_t f = g.fds[fd];
+    g.fds[fd].sim = 0;
+    if (f.sim && g.trace) fprintf(g.trace, "%llu close %s fd %d\n",
+                                  (unsigned long long)((now_ns() - g.t0) / 1000u), g.paths[f.path], fd);
+    pthread_mutex_unlock(&g.lock);
+    if (f.sim) SPM_SYS_SIM.close_(f.sim);
+}
+
+/* A duplicate addresses the same node; simulator fds are per node */
+static int fd_copy(int from, int to)
+{
+    if (to < 0 || from < 0 || from >= PRELOAD_MAX_FD) return to;
+    pthread_mutex_lock(&g.lock);
+    preload_fd_t f = g.fds[from];
+    if (f.sim && to >= PRELOAD_MAX_FD) {
+        pthread_mutex_unlock(&g.lock);
+        g.close(to);
+        errno = EMFILE;
+        return -1;
+    }
+    if (to < PRELOAD_MAX_FD) g.fds[to] = f;
+    pthread_mutex_unlock(&g.lock);
+    return to;
+}
+
+/* ====================================================== */
+/* ====================== Routing ======================= */
+/* ====================================================== */
+
+static bool is_spidev(const char *path)
+{
+    return path && strncmp(path, PRELOAD_PREFIX, sizeof PRELOAD_PREFIX - 1) == 0;
+}
+
+static int sim_open(const char *path, int flags)
+{
+    pthread_mutex_lock(&g.lock);
+    init_locked();
+    if (!spm_sim_has(path)) spm_sim_add(path, 0, g.auto_model, NULL);
+    size_t idx = remember_path(path);
+
+    int s = SPM_SYS_SIM.open_(path, flags);
+    int fd = -1;
+    if (s >= 0) {
+        fd = g.open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+        if (fd >= PRELOAD_MAX_FD) {
+            g.close(fd);
+            fd = -1;
+            errno = EMFILE;
+        }
+        if (fd >= 0) {
+            g.fds[fd] = (preload_fd_t){ s, idx };
+            g.used = true;
+        }
+    }
+    if (g.trace) fprintf(g.trace, "%llu open %s = %d\n",
+                         (unsigned long long)((now_ns() - g.t0) / 1000u), path, fd);
+    pthread_mutex_unlock(&g.lock);
+    return fd;
+}
+
+static void trace_ioctl(int fd, const char *path, unsigned long req, int rc,
+                        const spm_sim_stats_t *before)
+{
+    spm_sim_stats_t after;
+    unsigned long long t = (unsigned long long)((now_ns() - g.t0) / 1000u);
+
+    if (_IOC_TYPE(req) == SPI_IOC_MAGIC && _IOC_NR(req) == 0 && before &&
+        spm_sim_get_stats(path, &after) == SPM_OK) {
+        fprintf(g.trace, "%llu msg %s fd %d xfers %llu bytes %llu wire_ns %llu rc %d\n",
+                t, path, fd, (unsigned long long)(after.xfers - before->xfers),
+                (unsigned long long)(after.bytes - before->bytes),
+                (unsigned long long)(after.wire_ns - before->wire_ns), rc);
+        return;
+    }
+    fprintf(g.trace, "%llu ioctl %s fd %d req 0x%lx rc %d\n", t, path, fd, req, rc);
+}
+
+/* spidev answers SPI_IOC_MESSAGE with the bytes moved; tools check for it */
+static int message_len(unsigned long req, const void *arg, int rc)
+{
+    if (rc != 0 || _IOC_TYPE(req) != SPI_IOC_MAGIC || _IOC_NR(req) != 0) return rc;
+    const struct spi_ioc_transfer *trs = arg;
+    size_t n = _IOC_SIZE(req) / sizeof(struct spi_ioc_transfer);
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += trs[i].len;
+    return total > INT_MAX ? INT_MAX : (int)total;
+}
+
+static int sim_ioctl(int fd, preload_fd_t f, unsigned long req, void *arg)
+{
+    if (!g.trace) return message_len(req, arg, SPM_SYS_SIM.ioctl_(f.sim, req, arg));
+
+    /* tracing serializes calls so the counter deltas belong to this one */
+    pthread_mutex_lock(&g.lock);
+    const char *path = g.paths[f.path];
+    spm_sim_stats_t before;
+    bool have = spm_sim_get_stats(path, &before) == SPM_OK;
+    int rc = message_len(req, arg, SPM_SYS_SIM.ioctl_(f.sim, req, arg));
+    int err = errno;
+    trace_ioctl(fd, path, req, rc, have ? &before : NULL);
+    pthread_mutex_unlock(&g.lock);
+    errno = err;
+    return rc;
+}
+
+/* spidev read()/write(): one half-duplex transfer at the device config */
+static ssize_t sim_rw(int fd, preload_fd_t f, const void *tx, void *rx, size_t len)
+{
+    if (len == 0) return 0;
+    if (len > UINT32_MAX) len = UINT32_MAX;
+    struct spi_ioc_transfer tr = {
+        .tx_buf = (uintptr_t)tx,
+        .rx_buf = (uintptr_t)rx,
+        .len    = (uint32_t)len,
+    };
+    return sim_ioctl(fd, f, SPI_IOC_MESSAGE(1), &tr) < 0 ? -1 : (ssize_t)len;
+}
+
+/* ====================================================== */
+/* ==================== Interposers ===================== */
+/* ====================================================== */
+
+static mode_t open_mode(int flags, va_list ap)
+{
+    return (flags & (O_CREAT | O_TMPFILE)) ? (mode_t)va_arg(ap, int) : 0;
+}
+
+int open(const char *path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    if (is_spidev(path)) return sim_open(path, flags);
+    init();
+    return g.open(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    if (is_spidev(path)) return sim_open(path, flags);
+    init();
+    return g.open(path, flags | O_LARGEFILE, mode);
+}
+
+int __open_2(const char *path, int flags)
+{
+    return open(path, flags);
+}
+
+int __open64_2(const char *path, int flags)
+{
+    return open64(path, flags);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    if (is_spidev(path)) return sim_open(path, flags);
+    init();
+    return g.openat(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+
+    if (is_spidev(path)) return sim_open(path, flags);
+    init();
+    return g.openat(dirfd, path, flags | O_LARGEFILE, mode);
+}
+
+int close(int fd)
+{
+    init();
+    fd_forget(fd);
+    return g.close(fd);
+}
+
+int dup(int fd)
+{
+    init();
+    return fd_copy(fd, g.dup(fd));
+}
+
+int dup2(int fd, int fd2)
+{
+    init();
+    if (fd == fd2) return g.dup2(fd, fd2);
+    int rc = g.dup2(fd, fd2);
+    if (rc < 0) return rc;
+    fd_forget(fd2);
+    return fd_copy(fd, rc);
+}
+
+int dup3(int fd, int fd2, int flags)
+{
+    init();
+    int rc = g.dup3(fd, fd2, flags);
+    if (rc < 0) return rc;
+    fd_forget(fd2);
+    return fd_copy(fd, rc);
+}
+
+static int fcntl_common(fcntl_fn next, int fd, int cmd, void *arg)
+{
+    int rc = next(fd, cmd, arg);
+    if (cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC) return fd_copy(fd, rc);
+    return rc;
+}
+
+int fcntl(int fd, int cmd, ...)
+{
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    init();
+    return fcntl_common(g.fcntl, fd, cmd, arg);
+}
+
+int fcntl64(int fd, int cmd, ...)
+{
+    va_list ap;
+    va_start(ap, cmd);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    init();
+    return fcntl_common(g.fcntl64, fd, cmd, arg);
+}
+
+int ioctl(int fd, unsigned long req, ...)
+{
+    va_list ap;
+    va_start(ap, req);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    init();
+    preload_fd_t f = fd_lookup(fd);
+    if (f.sim) return sim_ioctl(fd, f, req, arg);
+    return g.ioctl(fd, req, arg);
+}
+
+ssize_t read(int fd, void *buf, size_t len)
+{
+    init();
+    preload_fd_t f = fd_lookup(fd);
+    if (f.sim) return sim_rw(fd, f, NULL, buf, len);
+    return g.read(fd, buf, len);
+}
+
+ssize_t write(int fd, const void *buf, size_t len)
+{
+    init();
+    preload_fd_t f = fd_lookup(fd);
+    if (f.sim) return sim_rw(fd, f, buf, NULL, len);
+    return g.write(fd, buf, len);
+}
+
+/* ====================================================== */
+/* ====================== Report ======================== */
+/* ====================================================== */
+
+__attribute__((destructor))
+static void report(void)
+{
+    pthread_mutex_lock(&g.lock);
+    if (!g.ready || !g.report || !g.used) {
+        pthread_mutex_unlock(&g.lock);
+        return;
+    }
+
+    /*
+     * Without realtime the modeled wire time never reached the clock, so
+     * utilization is taken against the run as it would be on hardware.
+     */
+    spm_sim_stats_t all;
+    spm_sim_get_stats(NULL, &all);
+    uint64_t elapsed = now_ns() - g.t0;
+    uint64_t span = g.realtime ? elapsed : elapsed + all.wire_ns;
+    fprintf(g.report, "spm-preload: elapsed %.3f ms  %s %.3f ms\n", (double)elapsed / 1e6,
+            g.realtime ? "realtime" : "with wire", (double)span / 1e6);
+    for (size_t i = 0; i < g.npaths; i++) {
+        spm_sim_stats_t st;
+        if (spm_sim_get_stats(g.paths[i], &st) != SPM_OK || st.syscalls == 0) continue;
+        fprintf(g.report,
+                "spm-preload: %-16s syscalls %llu  messages %llu  xfers %llu  bytes %llu  "
+                "bytes/msg %.1f  wire %.3f ms  bus %.1f%%  errors %llu\n",
+                g.paths[i], (unsigned long long)st.syscalls, (unsigned long long)st.messages,
+                (unsigned long long)st.xfers, (unsigned long long)st.bytes,
+                st.messages ? (double)st.bytes / (double)st.messages : 0.0,
+                (double)st.wire_ns / 1e6,
+                span ? 100.0 * (double)st.wire_ns / (double)span : 0.0,
+                (unsigned long long)st.errors);
+    }
+    fflush(g.report);
+    pthread_mutex_unlock(&g.lock);
+}
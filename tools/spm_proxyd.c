@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "spi_monkey.h"
+#include "spm_proxy.h"
+
+/*
+ * spm-proxyd [addr]
+ *
+ * Serves local spidev devices to spm_proxy clients. addr is
+ * "host:port", ":port" or "unix:/path" (default ":5755"). Clients are
+ * served one at a time; their devices are closed on disconnect.
+ */
+int main(int argc, char **argv)
+{
+    const char *addr = argc > 1 ? argv[1] : ":5755";
+    if (argc > 2 || strcmp(addr, "-h") == 0 || strcmp(addr, "--help") == 0) {
+        fprintf(stderr, "usage: %s [host:port | :port | unix:/path]\n", argv[0]);
+        return 2;
+    }
+
+    int lfd = -1;
+    spm_ecode_t rc = spm_proxy_listen(addr, &lfd);
+    if (rc != SPM_OK) {
+        fprintf(stderr, "spm-proxyd: cannot listen on %s (%d)\n", addr, (int)rc);
+        return 1;
+    }
+    fprintf(stderr, "spm-proxyd: listening on %s\n", addr);
+
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) continue;
+
+        fprintf(stderr, "spm-proxyd: client connected\n");
+        rc = spm_proxy_serve_fd(fd, NULL);
+        fprintf(stderr, "spm-proxyd: client disconnected (%d)\n", (int)rc);
+    }
+}
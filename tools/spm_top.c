@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spi_monkey.h"
+#include "spm_live.h"
+
+/*
+ * spm-top [-d seconds] [-n count] [-p pid] [-b]
+ *
+ * Live per-device rates of every process that publishes with
+ * spm_live_start(). Each refresh reads the shared segments without
+ * locking and shows the change since the previous one: messages,
+ * transfers and bytes per second, driver latency percentiles, errors,
+ * the in-flight and write-combining queue depths and the share of the
+ * interval the bus was clocking. -b prints frames one after another
+ * instead of redrawing; -n stops after count refreshes.
+ */
+
+#define TOP_MAX_PROCS  64
+
+typedef struct {
+    pid_t             pid;
+    spm_live_view_t  *view;
+    spm_live_proc_t   proc;
+    spm_live_dev_t    prev[SPM_LIVE_SLOTS];
+    size_t            nprev;
+    bool              seen;
+} top_proc_t;
+
+static top_proc_t g_procs[TOP_MAX_PROCS];
+static size_t     g_nprocs;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static const char *fmt_ns(uint64_t ns, char *buf, size_t size)
+{
+    if (ns == 0)                 snprintf(buf, size, "-");
+    else if (ns < 1000u)         snprintf(buf, size, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000u)      snprintf(buf, size, "%.1fus", (double)ns / 1e3);
+    else if (ns < 1000000000u)   snprintf(buf, size, "%.1fms", (double)ns / 1e6);
+    else                         snprintf(buf, size, "%.2fs",  (double)ns / 1e9);
+    return buf;
+}
+
+static top_proc_t *proc_find(pid_t pid)
+{
+    for (size_t i = 0; i < g_nprocs; i++) {
+        if (g_procs[i].pid == pid) return &g_procs[i];
+    }
+    if (g_nprocs == TOP_MAX_PROCS) return NULL;
+
+    spm_live_view_t *v;
+    if (spm_live_attach(pid, &v) != SPM_OK) return NULL;
+    top_proc_t *p = &g_procs[g_nprocs++];
+    memset(p, 0, sizeof(*p));
+    p->pid  = pid;
+    p->view = v;
+    return p;
+}
+
+static const spm_live_dev_t *prev_of(const top_proc_t *p, const char *path)
+{
+    for (size_t i = 0; i < p->nprev; i++) {
+        if (strcmp(p->prev[i].path, path) == 0) return &p->prev[i];
+    }
+    return NULL;
+}
+
+static void print_row(const top_proc_t *p, const spm_live_dev_t *cur, const spm_live_dev_t *old,
+                      double secs)
+{
+    /* counters restart when a device is re-attached */
+    spm_live_dev_t zero = { .messages = 0 };
+    if (!old || old->messages > cur->messages) old = &zero;
+
+    uint64_t hist[SPM_LIVE_BUCKETS];
+    for (size_t b = 0; b < SPM_LIVE_BUCKETS; b++) hist[b] = cur->hist[b] - old->hist[b];
+
+    char p50[16], p99[16], pmax[16];
+    printf("%-7ld %-12.12s %-16.16s %9.0f %9.0f %9.1f %7s %7s %7s %6.0f %4u %4u %5.1f\n",
+           (long)p->pid, p->proc.name, cur->path,
+           (double)(cur->messages - old->messages) / secs,
+           (double)(cur->xfers - old->xfers) / secs,
+           (double)(cur->bytes - old->bytes) / secs / 1024.0,
+           fmt_ns(spm_live_percentile(hist, 0.50), p50, sizeof p50),
+           fmt_ns(spm_live_percentile(hist, 0.99), p99, sizeof p99),
+           fmt_ns(spm_live_percentile(hist, 1.0), pmax, sizeof pmax),
+           (double)(cur->errors - old->errors) / secs,
+           cur->inflight, cur->wc_pending,
+           100.0 * (double)(cur->wire_ns - old->wire_ns) / (secs * 1e9));
+}
+
+/* Reads every segment; prints the change since the last pass if print */
+static void sample(pid_t only, bool print, double secs)
+{
+    pid_t pids[TOP_MAX_PROCS];
+    size_t n = 0;
+    spm_live_list(pids, TOP_MAX_PROCS, &n);
+    if (n > TOP_MAX_PROCS) n = TOP_MAX_PROCS;
+
+    for (size_t i = 0; i < g_nprocs; i++) g_procs[i].seen = false;
+
+    size_t ndevs = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (only && pids[i] != only) continue;
+        top_proc_t *p = proc_find(pids[i]);
+        if (!p) continue;
+
+        spm_live_dev_t cur[SPM_LIVE_SLOTS];
+        size_t count = 0;
+        spm_ecode_t rc = spm_live_read(p->view, &p->proc, cur, SPM_LIVE_SLOTS, &count);
+        if (rc != SPM_OK && rc != SPM_EAGAIN) continue;
+        if (count > SPM_LIVE_SLOTS) count = SPM_LIVE_SLOTS;
+        p->seen = true;
+
+        for (size_t d = 0; print && d < count; d++) {
+            print_row(p, &cur[d], prev_of(p, cur[d].path), secs);
+        }
+        memcpy(p->prev, cur, count * sizeof cur[0]);
+        p->nprev = count;
+        ndevs += count;
+    }
+
+    /* processes that stopped publishing */
+    for (size_t i = 0; i < g_nprocs; ) {
+        if (g_procs[i].seen) {
+            i++;
+            continue;
+        }
+        spm_live_detach(g_procs[i].view);
+        g_procs[i] = g_procs[--g_nprocs];
+    }
+    if (print && ndevs == 0) printf("(no devices published)\n");
+}
+
+int main(int argc, char **argv)
+{
+    double delay = 1.0;
+    long count = 0;
+    pid_t only = 0;
+    bool batch = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:n:p:bh")) != -1) {
+        switch (opt) {
+            case 'd': delay = atof(optarg);               break;
+            case 'n': count = atol(optarg);               break;
+            case 'p': only  = (pid_t)atol(optarg);        break;
+            case 'b': batch = true;                       break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-n count] [-p pid] [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (delay < 0.05) delay = 0.05;
+
+    sample(only, false, 0.0);
+    uint64_t t0 = now_ns();
+    for (long i = 0; count == 0 || i < count; i++) {
+        struct timespec ts = { (time_t)delay, (long)((delay - (double)(time_t)delay) * 1e9) };
+        nanosleep(&ts, NULL);
+
+        uint64_t t1 = now_ns();
+        double secs = (double)(t1 - t0) / 1e9;
+        t0 = t1;
+
+        if (!batch) printf("\033[H\033[2J");
+        printf("spm-top  interval %.2f s\n", secs);
+        printf("%-7s %-12s %-16s %9s %9s %9s %7s %7s %7s %6s %4s %4s %5s\n",
+               "PID", "PROCESS", "DEVICE", "MSG/S", "XFER/S", "KB/S",
+               "P50", "P99", "MAX", "ERR/S", "INFL", "WCQ", "BUS%");
+        sample(only, true, secs);
+        if (batch) printf("\n");
+        fflush(stdout);
+    }
+    return 0;
+}